@@ -22,6 +22,10 @@
 #include <chrono>
 #include <unordered_map>
 #include <random>
+#include <map>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
 
 #include "stb_image/stb_image.h"
 #include "tiny_obj_loader/tiny_obj_loader.h"
@@ -30,18 +34,86 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_vulkan.h"
 
+#include "asset_loader.hpp"
 #include "model.hpp"
+#include "linear_bvh.hpp"
+#include "prefix_sum.hpp"
+#include "occlusion_culler.hpp"
+#include "splat_renderer.hpp"
+#include "physics_layout.h"
+#include "ktx2.hpp"
 
 class Application
 {
 public:
     void Run();
 
+    // Must be called before Run(), the count can also be changed at runtime from the overlay.
+    // Throws above MAX_PHYSICS_OBJECT_COUNT, Run() throws if the device can't hold the count, see getMaxPhysicsObjectCount().
+    void SetPhysicsObjectCount(uint32_t objectCount);
+
+    // Keeps the grid hash size, 2 buckets per object rounded up to a power of two, and every per-object index within 32 bits
+    static const uint32_t MAX_PHYSICS_OBJECT_COUNT = 1u << 24;
+
+    // Times every workgroup size at startup instead of using the size cached for this device
+    void EnableWorkgroupAutotune();
+
+    // The simulation always advances in fixed steps of 1 / stepsPerSecond, a frame runs at most maxSubsteps of them (1 to 16)
+    void SetPhysicsRate(float stepsPerSecond);
+    void SetMaxPhysicsSubsteps(uint32_t substepCount);
+
+    // More frames in flight let the CPU run further ahead of the GPU, at the cost of latency and a copy of every per-frame resource
+    void SetFramesInFlight(uint32_t frameCount);
+    // Replaces the cached or autotuned workgroup size of the per-body compute passes
+    void SetComputeWorkgroupSize(uint32_t size);
+    // Lowered to what the device supports, 1 draws straight into the swap chain image without resolving
+    void SetMSAASampleCount(uint32_t sampleCount);
+
+    // Builds a linear BVH for the broadphase instead of the uniform grid, it can also be switched from the overlay
+    void UseLinearBVHBroadphase();
+
+    // Renders offscreen with no window, swap chain or overlay and runs a benchmark instead of the interactive loop,
+    // printing its results as JSON, see runBenchmark()
+    void EnableHeadless();
+    // The benchmark measures frameCount frames, or every frame until simulatedSeconds of physics have been stepped when that is set.
+    // Measuring starts warmupFrameCount frames after the streamed assets are resident.
+    void SetBenchmarkFrameCount(uint32_t frameCount);
+    void SetBenchmarkDuration(float simulatedSeconds);
+    void SetBenchmarkWarmupFrameCount(uint32_t frameCount);
+    // The results are written to this file instead of stdout
+    void SetBenchmarkResultsPath(const std::string &path);
+
+    // The pipeline and workgroup size caches are kept here rather than in the working directory, main() passes the executable's
+    void SetCacheDirectory(const std::filesystem::path &directory);
+
 private:
+    enum class BroadphaseMode
+    {
+        eUniformGrid,
+        eLinearBVH
+    };
+
+    enum class SphereRenderMode
+    {
+        eMesh,
+        eImpostor,
+        eSplat
+    };
+
+    struct ComputeWorkgroupConfig
+    {
+        uint32_t size;
+        uint32_t subgroupSize; // 0 leaves the subgroup size to the driver
+    };
+
     struct QueueFamilyIndices
     {
         std::optional<uint32_t> graphicsAndComputeFamily;
         std::optional<uint32_t> presentFamily;
+        // Compute-only family for the physics queue, it isn't required
+        std::optional<uint32_t> asyncComputeFamily;
+        // Transfer-only family for streamed uploads, usually the copy engine, it isn't required either
+        std::optional<uint32_t> transferFamily;
 
         bool isComplete()
         {
@@ -49,6 +121,20 @@ private:
         }
     };
 
+    // A texture as read by an asset loader thread, its levels tightly packed at levelOffsets
+    struct TextureData
+    {
+        std::string path;
+        vk::Format format;
+        uint32_t width;
+        uint32_t height;
+        uint32_t levelCount;
+        // Only the base level was read, the others are blitted from it after upload
+        bool isMipGenerationNeeded;
+        std::vector<char> data;
+        std::vector<vk::DeviceSize> levelOffsets;
+    };
+
     struct SwapChainSupportDetails
     {
         vk::SurfaceCapabilitiesKHR capabilities;
@@ -66,83 +152,57 @@ private:
     struct ComputeUniformBufferObject
     {
         float physicsTimeStep;
+        float gridCellSize;
+        uint32_t gridHashSize;
+        uint32_t objectCount;
+        uint32_t contactCapacity;
+        float sleepVelocity;
+        uint32_t sleepStepCount;
+        uint32_t isGridBinned;
+        alignas(16) glm::vec4 frustumPlanes[6]; // Left, right, bottom, top, near, far
     };
 
-    struct PhysicsObject
+    // Mirrors Contact and BodyDelta in contact_common.glsl
+    struct Contact
     {
-        alignas(16) glm::vec3 position;
-        alignas(16) glm::quat rotation;
-        alignas(16) glm::vec3 velocity;
-        alignas(16) glm::vec3 angularVelocity;
-        float radius;
-        float mass;
-        float elasticity; // Coefficient of Restitution using empirical measurements
-        float momentOfInertia;
-
-        static vk::VertexInputBindingDescription getBindingDescription()
-        {
-            vk::VertexInputBindingDescription bindingDescription = vk::VertexInputBindingDescription()
-                                                                       .setBinding(0)
-                                                                       .setStride(sizeof(PhysicsObject))
-                                                                       .setInputRate(vk::VertexInputRate::eVertex);
+        alignas(16) glm::vec3 normal;
+        float depth;
+        uint32_t bodyA;
+        uint32_t bodyB;
+        uint32_t padding0;
+        uint32_t padding1;
+    };
 
-            return bindingDescription;
-        }
+    struct BodyDelta
+    {
+        glm::ivec4 velocity;
+        glm::ivec4 position;
+    };
 
-        static std::array<vk::VertexInputAttributeDescription, 8> getAttributeDescriptions()
-        {
-            std::array<vk::VertexInputAttributeDescription, 8> attributeDescriptions;
-
-            attributeDescriptions[0] = vk::VertexInputAttributeDescription()
-                                           .setBinding(0)
-                                           .setLocation(0)
-                                           .setFormat(vk::Format::eR32G32B32Sfloat)
-                                           .setOffset(offsetof(PhysicsObject, position));
-
-            attributeDescriptions[1] = vk::VertexInputAttributeDescription()
-                                           .setBinding(0)
-                                           .setLocation(1)
-                                           .setFormat(vk::Format::eR32G32B32A32Sfloat)
-                                           .setOffset(offsetof(PhysicsObject, rotation));
-
-            attributeDescriptions[2] = vk::VertexInputAttributeDescription()
-                                           .setBinding(0)
-                                           .setLocation(2)
-                                           .setFormat(vk::Format::eR32G32B32Sfloat)
-                                           .setOffset(offsetof(PhysicsObject, velocity));
-
-            attributeDescriptions[3] = vk::VertexInputAttributeDescription()
-                                           .setBinding(0)
-                                           .setLocation(3)
-                                           .setFormat(vk::Format::eR32G32B32Sfloat)
-                                           .setOffset(offsetof(PhysicsObject, angularVelocity));
-
-            attributeDescriptions[4] = vk::VertexInputAttributeDescription()
-                                           .setBinding(0)
-                                           .setLocation(4)
-                                           .setFormat(vk::Format::eR32Sfloat)
-                                           .setOffset(offsetof(PhysicsObject, radius));
-                                           
-            attributeDescriptions[5] = vk::VertexInputAttributeDescription()
-                                           .setBinding(0)
-                                           .setLocation(5)
-                                           .setFormat(vk::Format::eR32Sfloat)
-                                           .setOffset(offsetof(PhysicsObject, mass));
-
-            attributeDescriptions[6] = vk::VertexInputAttributeDescription()
-                                           .setBinding(0)
-                                           .setLocation(6)
-                                           .setFormat(vk::Format::eR32Sfloat)
-                                           .setOffset(offsetof(PhysicsObject, elasticity));
-
-            attributeDescriptions[7] = vk::VertexInputAttributeDescription()
-                                           .setBinding(0)
-                                           .setLocation(7)
-                                           .setFormat(vk::Format::eR32Sfloat)
-                                           .setOffset(offsetof(PhysicsObject, momentOfInertia));
-
-            return attributeDescriptions;
-        }
+    // Written by the contact generation pass, the first three words are the solver's VkDispatchIndirectCommand
+    struct ContactHeader
+    {
+        uint32_t dispatchX;
+        uint32_t dispatchY;
+        uint32_t dispatchZ;
+        uint32_t contactCount;
+        uint32_t bvhStackOverflowCount;
+    };
+
+    // Followed by one body index per awake body
+    struct ActiveBodyHeader
+    {
+        uint32_t dispatchX;
+        uint32_t dispatchY;
+        uint32_t dispatchZ;
+        uint32_t activeCount;
+    };
+
+    // Copied back at the end of every physics substep for the overlay
+    struct PhysicsReadback
+    {
+        ContactHeader contactHeader;
+        ActiveBodyHeader activeBodyHeader;
     };
 
     void init();
@@ -196,36 +256,58 @@ private:
 
     void createGraphicsPipeline();
     void createComputePipeline();
-
-    static std::vector<char> readFile(const std::string &fileName);
-    vk::ShaderModule createShaderModule(const std::vector<char> &code);
+    void createWorkgroupPipelines();
+    void destroyWorkgroupPipelines();
+    void autotuneComputeWorkgroup();
+    void loadComputeWorkgroupCache();
+    void saveComputeWorkgroupCache();
+    std::string getComputeWorkgroupCacheKey();
+    bool isComputeWorkgroupSupported(const ComputeWorkgroupConfig &workgroup);
+    std::string getDeviceUUIDString();
+    void createPipelineCache();
+    void savePipelineCache();
 
     void createRenderPass();
     void createFramebuffers();
     void createCommandPool();
     void createComputeCommandPool();
+    void createStagingRings();
     void createCommandBuffers();
     void createComputeCommandBuffers();
     void recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t imageIndex);
+    void recordSphereDraw(vk::CommandBuffer commandBuffer, OcclusionCuller::Phase phase);
 
     void createShaderStorageBuffers();
+    void createPhysicsResources();
+    void destroyPhysicsResources();
+    void recreatePhysicsResources();
+    void createGridBuffers();
+    void createContactBuffers();
 
     void drawFrame();
 
     void createSyncObjects();
+    void waitForFrameSlot(uint32_t frame);
+    vk::Result submitCompute(vk::CommandBuffer commandBuffer);
 
     void recreateSwapChain();
     void cleanupSwapChain();
+    void createOffscreenTargets();
+
+    void runBenchmark();
+    void recordBenchmarkTimeStamps(uint32_t frame, bool areTimeStampsReady);
+    void writeBenchmarkResults(std::ostream &stream, uint32_t frameCount, uint64_t physicsStepCount);
+    static void writeBenchmarkStatistics(std::ostream &stream, std::vector<float> samples);
 
     static void framebufferResizeCallback(GLFWwindow *window, int width, int height);
     static void windowPositionCallback(GLFWwindow *window, int positionX, int positionY);
 
     void createVertexBuffer();
     void createIndexBuffer();
-    uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties);
 
-    void createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Buffer &buffer, vk::DeviceMemory &bufferMemory);
-    void copyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size);
+    void createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Buffer &buffer, MemoryAllocator::Allocation &bufferMemory,
+                      MemoryAllocator::Strategy strategy = MemoryAllocator::Strategy::eFreeList);
+    void recordBufferOwnershipBarrier(vk::CommandBuffer commandBuffer, vk::Buffer buffer, vk::PipelineStageFlags srcStage, vk::AccessFlags srcAccess, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess);
 
     void createGraphicsDescriptorSetLayout();
     void createComputeDescriptorSetLayout();
@@ -234,45 +316,93 @@ private:
     void createGraphicsDescriptorSets();
     void createComputeDescriptorSets();
 
-    void recordComputeCommandBuffer(vk::CommandBuffer commandBuffer);
+    void recordComputeCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t substepCount);
+    void recordPhysicsSubstep(vk::CommandBuffer commandBuffer, vk::DescriptorSet descriptorSet, uint32_t physicsBuffer, bool isFirstSubstep);
+    uint32_t getPhysicsDescriptorSetIndex(uint32_t frame, uint32_t physicsBuffer);
+    void recordMemoryBarrier(vk::CommandBuffer commandBuffer, vk::PipelineStageFlags srcStage, vk::AccessFlags srcAccess, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess);
 
     void createUniformBuffers();
     void createComputeUniformBuffers();
+    void updateCameraMatrices();
     void updateUniformBuffer(uint32_t currentImages);
     void updateComputeUniformBuffer(uint32_t currentImages);
 
-    void createTextureImage(const char *texturePath);
-    void createTextureImageView();
-    void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, vk::SampleCountFlagBits numSamples, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Image &image, vk::DeviceMemory &imageMemory);
-    vk::CommandBuffer beginSingleTimeCommands(vk::CommandPool commandPool);
-    void endSingleTimeCommands(vk::CommandBuffer commandBuffer, vk::CommandPool commandPool);
+    void startAssetLoads();
+    void updateStreamedAssets();
+    void recordStreamedAssetAcquires(vk::CommandBuffer commandBuffer);
 
-    void transitionImageLayout(vk::Image image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, uint32_t mipLevels);
-    void copyBufferToImage(vk::Buffer buffer, vk::Image image, uint32_t width, uint32_t height);
+    TextureData readTexture();
+    bool readCompressedTexture(TextureData &textureData);
+    void uploadTexture(const TextureData &textureData);
+    void recordTextureOwnershipBarrier(vk::CommandBuffer commandBuffer, vk::PipelineStageFlags srcStage, vk::AccessFlags srcAccess, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess);
+    void createPlaceholderTexture();
+    void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, vk::SampleCountFlagBits numSamples, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Image &image, MemoryAllocator::Allocation &imageMemory);
+
+    void transitionImageLayout(vk::CommandBuffer commandBuffer, vk::Image image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, uint32_t mipLevels);
+    void copyBufferToImage(vk::CommandBuffer commandBuffer, vk::Buffer buffer, vk::DeviceSize bufferOffset, vk::Image image, uint32_t width, uint32_t height);
 
     vk::ImageView createImageView(vk::Image image, vk::Format format, vk::ImageAspectFlags aspectFlags, uint32_t mipLevels);
     void createTextureSampler();
 
     void createDepthResources();
+    void createDepthPyramid();
+    void createSplatTarget();
     vk::Format findSupportedFormat(const std::vector<vk::Format> &candidates, vk::ImageTiling tiling, vk::FormatFeatureFlags features);
     vk::Format findDepthFormat();
     bool hasStencilComponent(vk::Format format);
 
-    void generateMipmaps(vk::Image image, vk::Format imageFormat, int32_t textureWidth, int32_t textureHeight, uint32_t mipLevels);
+    void generateMipmaps(vk::CommandBuffer commandBuffer, vk::Image image, vk::Format imageFormat, int32_t textureWidth, int32_t textureHeight, uint32_t mipLevels);
 
     vk::SampleCountFlagBits getMaxUsableSampleCount();
+    uint32_t getMaxPhysicsObjectCount();
     void createColorResources();
 
-    std::vector<PhysicsObject> createSphereBox(uint32_t objectCount, float sphereRadius);
+    void createSphereBox(uint32_t objectCount, float sphereRadius, std::vector<glm::vec4> &streams, std::vector<PhysicsMaterial> &materials);
 
     void createTimeStampQueryPool();
-    void getTimeStampResults();
+    void resetTimeStamps(uint32_t frame);
+    bool getTimeStampResults(uint32_t frame);
 
     std::string formatIntStringWithCommas(int number);
 
-    const int MAX_FRAMES_IN_FLIGHT = 2;
-    const int PHYSICS_OBJECT_COUNT = 1024 * 4;
-    const int WORKGROUP_SIZE_X = (PHYSICS_OBJECT_COUNT <= 32) ? PHYSICS_OBJECT_COUNT : 32;
+    // Every per-frame resource is created this many times, see SetFramesInFlight()
+    uint32_t framesInFlight = 2;
+    // Workgroup size of the per-body compute passes, specialised into their pipelines and cached per device UUID and driver version
+    ComputeWorkgroupConfig computeWorkgroup{32, 0};
+    // 0 uses the cached or autotuned size
+    uint32_t requestedWorkgroupSize = 0;
+    bool isWorkgroupAutotuneEnabled = false;
+    bool isSubgroupSizeControlSupported = false;
+    vk::PhysicalDeviceSubgroupSizeControlProperties subgroupSizeControlProperties;
+    const std::string WORKGROUP_CACHE_FILE_NAME = "compute_workgroup.cache";
+    std::string workgroupCachePath;
+    const uint32_t AUTOTUNE_WARMUP_STEPS = 4;
+    const uint32_t AUTOTUNE_TIMED_STEPS = 32;
+
+    // Shared by every pipeline, ImGui's included, and saved per device UUID and driver version
+    vk::PipelineCache pipelineCache;
+    std::string pipelineCachePath;
+    bool isPipelineCacheWarm = false;
+    // Empty resolves the caches against the working directory
+    std::filesystem::path cacheDirectory;
+
+    // A linear BVH needs at least one internal node
+    const uint32_t MIN_PHYSICS_OBJECT_COUNT = 2;
+    uint32_t physicsObjectCount = 1024 * 4;
+    uint32_t requestedPhysicsObjectCount = physicsObjectCount;
+    // The most objects the device's storage buffer range and memory can hold, set once a device is picked
+    uint32_t maxPhysicsObjectCount = MAX_PHYSICS_OBJECT_COUNT;
+    // The overlay's object count field, kept in step with physicsObjectCount whenever the physics resources are created
+    int objectCountInput = 0;
+    const float SPHERE_RADIUS = 0.115f;
+
+    // Broadphase grid cells are one sphere diameter wide so only the 27 surrounding cells need testing
+    const float GRID_CELL_SIZE = SPHERE_RADIUS * 2.0f;
+    uint32_t gridHashSize = 0;
+
+    // Resting spheres in a packed box touch at most twelve neighbours
+    const uint32_t CONTACTS_PER_OBJECT = 12;
+    uint32_t contactCapacity = 0;
 
     GLFWwindow *window = nullptr;
     GLFWmonitor *monitor = nullptr;
@@ -312,13 +442,16 @@ private:
     vk::PhysicalDeviceFeatures physicalDeviceFeatures{};
 
     vk::Device logicalDevice;
+    // Every buffer and image is suballocated from its blocks
+    MemoryAllocator memoryAllocator;
     vk::DeviceQueueCreateInfo deviceQueueCreateInfo{};
     vk::DeviceCreateInfo logicalDeviceCreateInfo{};
 
+    // VK_KHR_swapchain is added unless running headless, see initVulkan()
 #ifdef __APPLE__
-    const std::vector<const char *> logicalDeviceExtensions = {"VK_KHR_portability_subset", "VK_KHR_swapchain"};
+    std::vector<const char *> logicalDeviceExtensions = {"VK_KHR_portability_subset"};
 #else
-    const std::vector<const char *> logicalDeviceExtensions = {"VK_KHR_swapchain", "VK_EXT_host_query_reset"};
+    std::vector<const char *> logicalDeviceExtensions = {"VK_EXT_host_query_reset"};
 #endif
 
     vk::SurfaceKHR surface;
@@ -326,6 +459,14 @@ private:
     vk::Queue computeQueue;
     vk::Queue graphicsQueue;
     vk::Queue presentQueue;
+    vk::Queue transferQueue;
+
+    // The physics queue is the graphics queue itself only when the device offers nothing else, see createLogicalDevice()
+    uint32_t graphicsQueueFamily = 0;
+    uint32_t computeQueueFamily = 0;
+    uint32_t computeQueueIndex = 0;
+    // The graphics queue family when the device has no transfer-only family
+    uint32_t transferQueueFamily = 0;
 
     vk::SwapchainKHR swapChain;
     std::vector<vk::Image> swapChainImages;
@@ -333,42 +474,168 @@ private:
     vk::Extent2D swapChainExtent;
     std::vector<vk::ImageView> swapChainImageViews;
     std::vector<vk::Framebuffer> swapChainFrameBuffers;
+    // Backs swapChainImages when headless, one offscreen image per frame in flight
+    std::vector<MemoryAllocator::Allocation> offscreenImagesMemory;
+
+    // Headless benchmark state, see runBenchmark()
+    bool isHeadless = false;
+    const vk::Extent2D BENCHMARK_EXTENT = {1920, 1080};
+    // Each benchmark frame steps the simulation by the same time however long it took, so every frame does the same work
+    const float BENCHMARK_FRAME_TIME = 1.0f / 60.0f;
+    uint32_t benchmarkFrameCount = 600;
+    float benchmarkDuration = 0.0f;
+    uint32_t benchmarkWarmupFrameCount = 60;
+    std::string benchmarkResultsPath;
+    // Whether the frame last submitted from each slot is measured, its GPU times are read once the slot is free again
+    std::vector<bool> measuredFrameSlots;
+    std::vector<float> benchmarkFrameTimesMS;
+    std::vector<float> benchmarkComputeTimesMS;
+    std::vector<float> benchmarkGraphicsTimesMS;
+    std::array<std::vector<float>, LinearBVH::eBuildPhaseCount> benchmarkBVHPhaseTimesMS;
 
     vk::RenderPass renderPass;
+    // Compatible with renderPass, continues it for the late occlusion draw and the overlay
+    vk::RenderPass lateRenderPass;
 
     vk::DescriptorSetLayout graphicsDescriptorSetLayout;
     vk::PipelineLayout graphicsPipelineLayout;
     vk::Pipeline graphicsPipeline;
+    // Same layout as graphicsPipeline, ray casts each sphere on a camera-facing quad
+    vk::Pipeline impostorPipeline;
+    SphereRenderMode sphereRenderMode = SphereRenderMode::eMesh;
 
     vk::DescriptorSetLayout computeDescriptorSetLayout;
     vk::PipelineLayout computePipelineLayout;
+    vk::Pipeline compactActiveBodiesPipeline;
     vk::Pipeline computePipeline;
-
+    vk::Pipeline gridScatterPipeline;
+    vk::Pipeline collidePipeline;
+    vk::Pipeline collideBVHPipeline;
+    vk::Pipeline contactDispatchPipeline;
+    vk::Pipeline solveContactsPipeline;
+    vk::Pipeline applyContactsPipeline;
+    vk::Pipeline instanceTransformPipeline;
+
+    // Grid cell counts -> grid cell start offsets
+    PrefixSum gridPrefixSum;
+
+    // Substeps ping-pong between the physics buffers, physicsStateBuffer holds the latest state
+    const uint32_t PHYSICS_BUFFER_COUNT = 2;
+    uint32_t physicsStateBuffer = 0;
     std::vector<vk::Buffer> shaderStorageBuffers;
-    std::vector<vk::DeviceMemory> shaderStorageBuffersMemory;
+    std::vector<MemoryAllocator::Allocation> shaderStorageBuffersMemory;
+
+    float physicsTimeStep = 1.0f / 120.0f;
+    uint32_t maxPhysicsSubsteps = 8;
+    // Also the top of the overlay's slider
+    const uint32_t MAX_PHYSICS_SUBSTEPS = 16;
+    float physicsTimeAccumulator = 0.0f;
+    uint32_t physicsSubstepCount = 0;
+    std::chrono::high_resolution_clock::time_point lastFrameTime;
+
+    // Cold body properties, see physics_layout.h
+    vk::Buffer physicsMaterialBuffer;
+    MemoryAllocator::Allocation physicsMaterialBufferMemory;
+
+    // Uniform grid broadphase, shared by every frame since compute submissions are serialised by barriers
+    vk::Buffer gridCellCountBuffer;
+    MemoryAllocator::Allocation gridCellCountBufferMemory;
+    vk::Buffer gridCellStartBuffer;
+    MemoryAllocator::Allocation gridCellStartBufferMemory;
+    vk::Buffer gridCellCursorBuffer;
+    MemoryAllocator::Allocation gridCellCursorBufferMemory;
+    vk::Buffer gridBodyCellBuffer;
+    MemoryAllocator::Allocation gridBodyCellBufferMemory;
+    vk::Buffer gridSortedBodyBuffer;
+    MemoryAllocator::Allocation gridSortedBodyBufferMemory;
+
+    // Contact list filled by the narrowphase and consumed by the solver
+    vk::Buffer contactHeaderBuffer;
+    MemoryAllocator::Allocation contactHeaderBufferMemory;
+    vk::Buffer contactListBuffer;
+    MemoryAllocator::Allocation contactListBufferMemory;
+    vk::Buffer bodyDeltaBuffer;
+    MemoryAllocator::Allocation bodyDeltaBufferMemory;
+
+    // The header of each frame is copied back so the contact count can be shown without stalling
+    std::vector<vk::Buffer> physicsReadbackBuffers;
+    std::vector<MemoryAllocator::Allocation> physicsReadbackBuffersMemory;
+    std::vector<void *> physicsReadbackBuffersMapped;
+    uint32_t contactCount = 0;
+    uint32_t bvhStackOverflowCount = 0;
+
+    // Bodies slower than SLEEP_VELOCITY for SLEEP_STEP_COUNT consecutive steps drop out of the active set until something hits them
+    const float SLEEP_VELOCITY = 0.25f;
+    const uint32_t SLEEP_STEP_COUNT = 60;
+    bool isSleepingEnabled = true;
+    vk::Buffer activeBodyBuffer;
+    MemoryAllocator::Allocation activeBodyBufferMemory;
+    uint32_t activeBodyCount = 0;
+
+    // Spheres outside the camera frustum are dropped from the occlusion candidates before they are drawn
+    bool isFrustumCullingEnabled = true;
+
+    // Candidates hidden behind the depth of spheres drawn in front of them are not drawn, see OcclusionCuller
+    OcclusionCuller occlusionCuller;
+    bool isOcclusionCullingEnabled = true;
+    OcclusionCuller::Statistics occlusionStatistics{};
+    // Screen-space error in pixels a LOD may have to be drawn instead of the finer ones
+    float lodPixelError = 1.0f;
+
+    // Compute rasterized point splats of the occlusion candidates, for counts where most spheres cover a few pixels.
+    // Only created when the device has 64-bit buffer atomics.
+    SplatRenderer splatRenderer;
+    bool isSplatRenderingSupported = false;
+
+    // Rebuilt every frame when selected, better suited than the grid to sparse scenes and reusable for scene queries
+    LinearBVH physicsBVH;
+    BroadphaseMode broadphaseMode = BroadphaseMode::eUniformGrid;
 
     vk::CommandPool commandPool;
     vk::CommandPool computeCommandPool;
 
+    // Persistently mapped staging for every upload, recorded into batches that are submitted without waiting
+    const vk::DeviceSize STAGING_RING_SIZE = 32 * 1024 * 1024;
+    StagingRing graphicsStagingRing;
+    StagingRing computeStagingRing;
+    // Streamed assets, their buffers and images are released to the graphics queue family when it differs
+    StagingRing transferStagingRing;
+
+    // Decodes and parses the streamed assets while the window is already up, see startAssetLoads()
+    AssetLoader assetLoader;
+    std::future<void> modelLoad;
+    std::future<TextureData> textureLoad;
+
     std::vector<vk::CommandBuffer> commandBuffers;
     std::vector<vk::CommandBuffer> computeCommandBuffers;
 
+    // Binary semaphores, the swap chain can't use timeline semaphores
     std::vector<vk::Semaphore> imageAvailableSemaphores;
     std::vector<vk::Semaphore> renderFinishedSemaphores;
-    std::vector<vk::Semaphore> computeFinishedSemaphores;
-    std::vector<vk::Fence> inFlightFences;
-    std::vector<vk::Fence> computeInFlightFences;
+
+    // Each queue signals its own timeline, one value higher with every submission.
+    // A frame slot can be reused once both timelines reach the values its previous submissions signalled.
+    vk::Semaphore computeTimeline;
+    vk::Semaphore graphicsTimeline;
+    uint64_t computeTimelineValue = 0;
+    uint64_t graphicsTimelineValue = 0;
+    std::vector<uint64_t> frameComputeTimelineValues;
+    std::vector<uint64_t> frameGraphicsTimelineValues;
 
     uint32_t currentFrame = 0;
 
     bool framebufferResized = false;
 
+    // Shared by the vertex shader and the culling pass, so both see the same frustum
+    glm::mat4 cameraView = glm::mat4(1.0f);
+    glm::mat4 cameraProjection = glm::mat4(1.0f);
+
     std::vector<vk::Buffer> uniformBuffers;
-    std::vector<vk::DeviceMemory> uniformBuffersMemory;
+    std::vector<MemoryAllocator::Allocation> uniformBuffersMemory;
     std::vector<void *> uniformBuffersMapped;
 
     std::vector<vk::Buffer> computeUniformBuffers;
-    std::vector<vk::DeviceMemory> computeUniformBuffersMemory;
+    std::vector<MemoryAllocator::Allocation> computeUniformBuffersMemory;
     std::vector<void *> computeUniformBuffersMapped;
 
     vk::DescriptorPool graphicsDescriptorPool;
@@ -378,26 +645,52 @@ private:
     std::vector<vk::DescriptorSet> computeDescriptorSets;
 
     uint32_t mipLevels;
+    vk::Format textureFormat = vk::Format::eR8G8B8A8Srgb;
     vk::Image textureImage;
-    vk::DeviceMemory textureImageMemory;
+    MemoryAllocator::Allocation textureImageMemory;
     vk::ImageView textureImageView;
     vk::Sampler textureSampler;
+    // Satisfies the copy offset alignment of every block compressed format
+    const vk::DeviceSize TEXTURE_LEVEL_ALIGNMENT = 16;
+
+    // Streaming state, an upload becomes resident in the first frame recorded after its batch completes, which also
+    // acquires it when it was uploaded on another queue family. Until then the placeholder is bound and no mesh is drawn.
+    StagingRing *textureUploadRing = nullptr;
+    uint64_t textureUploadValue = 0;
+    uint32_t textureUploadQueueFamily = 0;
+    uint64_t modelUploadValue = 0;
+    bool isTextureResident = false;
+    bool isModelResident = false;
+    // The texture view each frame's descriptor set points at, rewritten once that frame is free again
+    std::vector<vk::ImageView> frameTextureImageViews;
+
+    vk::Image placeholderTextureImage;
+    MemoryAllocator::Allocation placeholderTextureImageMemory;
+    vk::ImageView placeholderTextureImageView;
 
     vk::Image colorImage;
-    vk::DeviceMemory colorImageMemory;
+    MemoryAllocator::Allocation colorImageMemory;
     vk::ImageView colorImageView;
 
     vk::Image depthImage;
-    vk::DeviceMemory depthImageMemory;
+    MemoryAllocator::Allocation depthImageMemory;
     vk::ImageView depthImageView;
 
     const std::string MODEL_PATH = "resources/models/football/football.obj";
     const std::string TEXTURE_PATH = "resources/models/football/football.png";
+    // Pre-compressed copies of TEXTURE_PATH with their mip chains, in order of preference, see tools/ktx2_converter.cpp
+    const std::vector<std::string> COMPRESSED_TEXTURE_PATHS = {
+        "resources/models/football/football.bc1.ktx2",
+        "resources/models/football/football.etc2.ktx2"};
 
     Model footballModel;
     Model groundModel;
 
     vk::SampleCountFlagBits msaaSamples = vk::SampleCountFlagBits::e1;
+    // Whether the depth attachment can be sampled at msaaSamples to build the occlusion culling pyramid
+    bool isDepthAttachmentSampled = false;
+    // 0 uses the most the device supports
+    uint32_t requestedMSAASampleCount = 0;
 
     vk::DescriptorPool imguiDescriptorPool;
     std::string objectString;
@@ -405,6 +698,12 @@ private:
     vk::QueryPool queryPool;
     std::vector<uint64_t> timeStamps;
     
+    // Each frame in flight owns a range of queries, so reading one frame's results never waits on the frame still running.
+    // Within a range queries 0-3 bracket the compute and graphics submissions, the BVH build phases follow.
+    const uint32_t BVH_FIRST_TIMESTAMP = 4;
+    const uint32_t FRAME_QUERY_COUNT = BVH_FIRST_TIMESTAMP + LinearBVH::TIMESTAMP_COUNT;
+    std::array<float, LinearBVH::eBuildPhaseCount> bvhPhaseTimesMS{};
+
     float computePipelineTimeMS = 0.0f;
     float graphicsPipelineTimeMS = 0.0f;
     float totalApplicationTimeMS = 0.0f;
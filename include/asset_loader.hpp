@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Worker threads that decode and parse assets off the main thread.
+// Jobs only touch CPU memory, their results are uploaded by the main thread once ready, which keeps every queue
+// submission on one thread.
+class AssetLoader
+{
+public:
+    // A threadCount of 0 leaves one hardware thread to the main thread
+    void Create(uint32_t threadCount = 0);
+    // Finishes the queued jobs first
+    void Destroy();
+
+    template <typename Function>
+    std::future<std::invoke_result_t<Function>> Submit(Function &&function)
+    {
+        using Result = std::invoke_result_t<Function>;
+
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+        std::future<Result> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push([task]()
+                      { (*task)(); });
+        }
+        jobAvailable.notify_one();
+
+        return result;
+    }
+
+    // Never blocks, false for a future whose result has already been taken
+    template <typename Result>
+    static bool IsReady(const std::future<Result> &future)
+    {
+        return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+private:
+    void work();
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+    bool isStopping = false;
+};
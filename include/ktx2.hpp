@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+// The parts of the KTX 2.0 container (Khronos, 2020) written by tools/ktx2_converter.cpp and read by Application::readCompressedTexture().
+// Only 2D textures without supercompression, one face and no array layers.
+namespace Ktx2
+{
+    constexpr uint8_t IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+    struct Header
+    {
+        uint8_t identifier[12];
+        // VkFormat of every level
+        uint32_t vkFormat;
+        // 1 for block compressed formats
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+
+    // One per level after the header, level 0 (the full size image) first. The level data itself is stored smallest level first.
+    struct LevelIndex
+    {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    static_assert(sizeof(Header) == 80, "KTX2 header layout");
+    static_assert(sizeof(LevelIndex) == 24, "KTX2 level index layout");
+}
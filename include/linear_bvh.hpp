@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <vector>
+
+#include "prefix_sum.hpp"
+#include "utilities.hpp"
+
+// GPU linear BVH (Karras 2012) rebuilt from the physics object SSBOs every time Record() is called.
+// Morton codes -> 4-bit LSD radix sort -> hierarchy emission -> bottom-up AABB refit.
+class LinearBVH
+{
+public:
+    struct Node
+    {
+        float boundsMin[3];
+        uint32_t leftChild;
+        float boundsMax[3];
+        uint32_t rightChild;
+    };
+
+    enum BuildPhase
+    {
+        eBounds,
+        eMortonCodes,
+        eRadixSort,
+        eHierarchy,
+        eRefit,
+        eBuildPhaseCount
+    };
+
+    // One timestamp before the build plus one after every phase
+    static const uint32_t TIMESTAMP_COUNT = eBuildPhaseCount + 1;
+
+    // Root of the tree, internal nodes come first in the node buffer
+    static const uint32_t ROOT_NODE = 0;
+
+    void Create(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, vk::PipelineCache pipelineCache, const std::vector<vk::Buffer> &physicsObjectBuffers, uint32_t objectCount);
+    // Pass a null queryPool to skip the per-phase timestamps
+    void Record(vk::CommandBuffer commandBuffer, uint32_t physicsObjectBufferIndex, vk::QueryPool queryPool, uint32_t firstQuery);
+    void Destroy(MemoryAllocator &memoryAllocator, vk::Device logicalDevice);
+
+    vk::Buffer GetNodeBuffer() const;
+    uint32_t GetObjectCount() const;
+
+    // Traversal stack entries a depth-first walk of a tree over objectCount objects can need
+    static uint32_t GetTraversalStackSize(uint32_t objectCount);
+
+    static std::array<float, eBuildPhaseCount> GetPhaseTimesMS(const uint64_t *timeStamps, float timestampPeriod);
+    static const char *GetPhaseName(BuildPhase phase);
+
+private:
+    struct PushConstants
+    {
+        uint32_t objectCount;
+        uint32_t radixShift;
+    };
+
+    void createBuffers(MemoryAllocator &memoryAllocator, vk::Device logicalDevice);
+    void createDescriptorSetLayouts(vk::Device logicalDevice);
+    void createPipelines(vk::Device logicalDevice, vk::PipelineCache pipelineCache);
+    void createDescriptorSets(vk::Device logicalDevice, const std::vector<vk::Buffer> &physicsObjectBuffers);
+
+    void recordComputeBarrier(vk::CommandBuffer commandBuffer);
+    void recordTimestamp(vk::CommandBuffer commandBuffer, vk::PipelineStageFlagBits stage, vk::QueryPool queryPool, uint32_t query);
+    void dispatchPass(vk::CommandBuffer commandBuffer, vk::Pipeline pipeline, uint32_t invocationCount, uint32_t radixShift);
+
+    static const uint32_t BLOCK_SIZE = 256;
+    static const uint32_t RADIX_BITS = 4;
+    static const uint32_t RADIX_SIZE = 1 << RADIX_BITS;
+    static const uint32_t KEY_BITS = 32;
+    // Bits of the Morton codes written by bvh_morton.comp, 10 per axis
+    static const uint32_t MORTON_BITS = 30;
+
+    uint32_t objectCount = 0;
+    uint32_t blockCount = 0;
+    uint32_t currentDescriptorSet = 0;
+
+    vk::Buffer sceneBoundsBuffer;
+    MemoryAllocator::Allocation sceneBoundsBufferMemory;
+    std::array<vk::Buffer, 4> sortBuffers;
+    std::array<MemoryAllocator::Allocation, 4> sortBuffersMemory;
+    vk::Buffer histogramBuffer;
+    MemoryAllocator::Allocation histogramBufferMemory;
+    vk::Buffer histogramOffsetBuffer;
+    MemoryAllocator::Allocation histogramOffsetBufferMemory;
+    // Per-block digit counts -> per-block digit offsets
+    PrefixSum histogramPrefixSum;
+    vk::Buffer nodeBuffer;
+    MemoryAllocator::Allocation nodeBufferMemory;
+    vk::Buffer parentBuffer;
+    MemoryAllocator::Allocation parentBufferMemory;
+    vk::Buffer refitCounterBuffer;
+    MemoryAllocator::Allocation refitCounterBufferMemory;
+
+    vk::DescriptorSetLayout descriptorSetLayout;
+    vk::DescriptorPool descriptorPool;
+    std::vector<vk::DescriptorSet> descriptorSets;
+
+    vk::PipelineLayout pipelineLayout;
+
+    vk::Pipeline boundsPipeline;
+    vk::Pipeline mortonPipeline;
+    vk::Pipeline radixHistogramPipeline;
+    vk::Pipeline radixScatterPipeline;
+    vk::Pipeline hierarchyPipeline;
+    vk::Pipeline refitPipeline;
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+// Suballocates buffers and images from large vk::DeviceMemory blocks, with one pool of blocks per memory type, rather
+// than one vkAllocateMemory per resource. Host visible blocks stay mapped for their whole lifetime.
+//
+// Free list blocks use a two level segregated fit (TLSF) allocator, for resources with independent lifetimes.
+// Linear blocks bump allocate and rewind once all of their allocations are freed, for short-lived staging resources.
+// Resources larger than half a block get a dedicated allocation of their own.
+class MemoryAllocator
+{
+    struct Block;
+
+public:
+    enum class Strategy
+    {
+        eFreeList,
+        eLinear
+    };
+
+    struct Allocation
+    {
+        vk::DeviceMemory memory;
+        vk::DeviceSize offset = 0;
+        vk::DeviceSize size = 0;
+        // Null unless the memory is host visible
+        void *mapped = nullptr;
+
+        Block *block = nullptr;
+        uint32_t range = 0;
+    };
+
+    struct Statistics
+    {
+        uint32_t blockCount = 0;
+        uint32_t allocationCount = 0;
+        // Allocated from the driver
+        vk::DeviceSize blockBytes = 0;
+        // Handed out to resources
+        vk::DeviceSize allocatedBytes = 0;
+    };
+
+    void Create(vk::PhysicalDevice physicalDevice);
+    // Every allocation must have been freed
+    void Destroy(vk::Device logicalDevice);
+
+    // Allocate and bind the memory of a buffer or an optimally tiled image
+    Allocation AllocateBuffer(vk::Device logicalDevice, vk::Buffer buffer, vk::MemoryPropertyFlags properties, Strategy strategy = Strategy::eFreeList);
+    Allocation AllocateImage(vk::Device logicalDevice, vk::Image image, vk::MemoryPropertyFlags properties);
+    void Free(vk::Device logicalDevice, Allocation &allocation);
+
+    uint32_t FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const;
+
+    Statistics GetStatistics() const;
+    Statistics GetStatistics(uint32_t memoryTypeIndex) const;
+    uint32_t GetMemoryTypeCount() const;
+
+private:
+    static constexpr uint32_t SECOND_LEVEL_BITS = 4;
+    static constexpr uint32_t SECOND_LEVEL_COUNT = 1 << SECOND_LEVEL_BITS;
+    static constexpr uint32_t FIRST_LEVEL_COUNT = 64;
+    static constexpr uint32_t NO_RANGE = ~0u;
+
+    // A free or allocated span of a free list block, linked to its physical neighbours and, while free, to the other free
+    // ranges of its size class
+    struct Range
+    {
+        vk::DeviceSize offset;
+        vk::DeviceSize size;
+        uint32_t previousPhysical;
+        uint32_t nextPhysical;
+        uint32_t previousFree;
+        uint32_t nextFree;
+        bool isFree;
+    };
+
+    struct Block
+    {
+        vk::DeviceMemory memory;
+        vk::DeviceSize size;
+        uint8_t *mapped;
+        uint32_t memoryTypeIndex;
+        Strategy strategy;
+        bool isDedicated;
+
+        uint32_t allocationCount = 0;
+        vk::DeviceSize allocatedBytes = 0;
+
+        // Strategy::eLinear
+        vk::DeviceSize linearOffset = 0;
+
+        // Strategy::eFreeList
+        std::vector<Range> ranges;
+        std::vector<uint32_t> unusedRanges;
+        uint64_t firstLevelBitmap = 0;
+        std::array<uint32_t, FIRST_LEVEL_COUNT> secondLevelBitmaps{};
+        std::array<uint32_t, FIRST_LEVEL_COUNT * SECOND_LEVEL_COUNT> freeHeads;
+    };
+
+    Allocation allocate(vk::Device logicalDevice, const vk::MemoryRequirements &memoryRequirements, vk::MemoryPropertyFlags properties, Strategy strategy);
+    Block *createBlock(vk::Device logicalDevice, uint32_t memoryTypeIndex, vk::DeviceSize size, Strategy strategy, bool isDedicated);
+    void destroyBlock(vk::Device logicalDevice, Block *block);
+    vk::DeviceSize getBlockSize(uint32_t memoryTypeIndex) const;
+
+    static bool allocateLinear(Block &block, vk::DeviceSize size, vk::DeviceSize alignment, Allocation &allocation);
+    static bool allocateFreeList(Block &block, vk::DeviceSize size, vk::DeviceSize alignment, Allocation &allocation);
+    static void freeFreeList(Block &block, uint32_t rangeIndex);
+
+    static void getSizeClass(vk::DeviceSize size, uint32_t &firstLevel, uint32_t &secondLevel);
+    static uint32_t findFreeRange(const Block &block, vk::DeviceSize size);
+    static void insertFreeRange(Block &block, uint32_t rangeIndex);
+    static void removeFreeRange(Block &block, uint32_t rangeIndex);
+    static uint32_t createRange(Block &block);
+    static void releaseRange(Block &block, uint32_t rangeIndex);
+
+    vk::PhysicalDeviceMemoryProperties memoryProperties;
+    vk::DeviceSize bufferImageGranularity = 1;
+
+    // One pool of blocks per memory type
+    std::vector<std::vector<std::unique_ptr<Block>>> pools;
+};
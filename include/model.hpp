@@ -6,50 +6,76 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 #include <glm/gtx/hash.hpp>
 
 #include "stb_image/stb_image.h"
 #include "tiny_obj_loader/tiny_obj_loader.h"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <set>
 #include <unordered_map>
 
+#include "staging_ring.hpp"
 #include "utilities.hpp"
 
 class Model
 {
 public:
+    // Per-instance world transform, the rows of a 3x4 matrix with the translation in w.
+    // Written by instance_transforms.comp and read through the instance-rate vertex binding.
+    struct InstanceTransform
+    {
+        glm::vec4 rows[3];
+    };
+
+    // A level of detail, a range of the shared index buffer over the shared vertices
+    struct Lod
+    {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        // Largest distance a vertex may have moved from the full mesh, relative to the bounding radius
+        float error;
+    };
+
+    // Including the full mesh at LOD 0, occlusion_cull.comp keeps the LOD errors in a vec4
+    static const uint32_t MAX_LOD_COUNT = 4;
+
+    // 20 bytes, tightly packed. The normal is octahedral encoded into two snorm16s and the texture coordinates are two unorm16s,
+    // see packNormal() and packTextureCoordinates().
     struct Vertex
     {
-        alignas(16) glm::vec3 position;
-        alignas(16) glm::vec3 color;
-        alignas(16) glm::vec2 textureCoordinates;
+        glm::vec3 position;
+        uint32_t normal;
+        uint32_t textureCoordinates;
 
-        static std::array<vk::VertexInputBindingDescription, 1> getBindingDescriptions()
+        static std::array<vk::VertexInputBindingDescription, 2> getBindingDescriptions()
         {
-            std::array<vk::VertexInputBindingDescription, 1> bindingDescriptions{};
+            std::array<vk::VertexInputBindingDescription, 2> bindingDescriptions{};
 
             bindingDescriptions[0]
                 .setBinding(0)
                 .setStride(sizeof(Vertex))
                 .setInputRate(vk::VertexInputRate::eVertex);
 
-            // bindingDescriptions[1]
-            //     .setBinding(0)
-            //     .setStride(sizeof(uint32_t))
-            //     .setInputRate(vk::VertexInputRate::eInstance);
-
-            // vk::VertexInputBindingDescription bindingDescription = vk::VertexInputBindingDescription()
-            //                                                            .setBinding(0)
-            //                                                            .setStride(sizeof(Vertex))
-            //                                                            .setInputRate(vk::VertexInputRate::eVertex);
+            bindingDescriptions[1]
+                .setBinding(1)
+                .setStride(sizeof(InstanceTransform))
+                .setInputRate(vk::VertexInputRate::eInstance);
 
             return bindingDescriptions;
         }
 
-        static std::array<vk::VertexInputAttributeDescription, 3> getAttributeDescriptions()
+        static std::array<vk::VertexInputAttributeDescription, 6> getAttributeDescriptions()
         {
-            std::array<vk::VertexInputAttributeDescription, 3> attributeDescriptions{};
+            std::array<vk::VertexInputAttributeDescription, 6> attributeDescriptions{};
 
             attributeDescriptions[0]
                 .setBinding(0)
@@ -60,21 +86,51 @@ public:
             attributeDescriptions[1]
                 .setBinding(0)
                 .setLocation(1)
-                .setFormat(vk::Format::eR32G32B32Sfloat)
-                .setOffset(offsetof(Vertex, color));
+                .setFormat(vk::Format::eR16G16Snorm)
+                .setOffset(offsetof(Vertex, normal));
 
             attributeDescriptions[2]
                 .setBinding(0)
                 .setLocation(2)
-                .setFormat(vk::Format::eR32G32Sfloat)
+                .setFormat(vk::Format::eR16G16Unorm)
                 .setOffset(offsetof(Vertex, textureCoordinates));
 
+            // The instance transform is a mat3x4 in the vertex shader, one location per row
+            for (uint32_t row = 0; row < 3; row++)
+            {
+                attributeDescriptions[3 + row]
+                    .setBinding(1)
+                    .setLocation(3 + row)
+                    .setFormat(vk::Format::eR32G32B32A32Sfloat)
+                    .setOffset(offsetof(InstanceTransform, rows) + sizeof(glm::vec4) * row);
+            }
+
             return attributeDescriptions;
         }
 
         bool operator==(const Vertex &other) const
         {
-            return position == other.position && color == other.color && textureCoordinates == other.textureCoordinates;
+            return position == other.position && normal == other.normal && textureCoordinates == other.textureCoordinates;
+        }
+
+        // Octahedral mapping (Meyer et al. 2010): the unit sphere is projected onto an octahedron whose lower half is folded over the upper
+        static uint32_t packNormal(glm::vec3 normal)
+        {
+            normal /= std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+
+            glm::vec2 encoded(normal.x, normal.y);
+            if (normal.z < 0.0f)
+            {
+                encoded = (1.0f - glm::abs(glm::vec2(normal.y, normal.x))) *
+                          glm::vec2(normal.x >= 0.0f ? 1.0f : -1.0f, normal.y >= 0.0f ? 1.0f : -1.0f);
+            }
+
+            return glm::packSnorm2x16(encoded);
+        }
+
+        static uint32_t packTextureCoordinates(glm::vec2 textureCoordinates)
+        {
+            return glm::packUnorm2x16(glm::clamp(textureCoordinates, 0.0f, 1.0f));
         }
 
         friend struct std::hash<Vertex>;
@@ -85,28 +141,94 @@ public:
         size_t operator()(Vertex const &vertex) const
         {
             return ((std::hash<glm::vec3>()(vertex.position) ^
-                     (std::hash<glm::vec3>()(vertex.color) << 1)) >>
+                     (std::hash<uint32_t>()(vertex.normal) << 1)) >>
                     1) ^
-                   (std::hash<glm::vec2>()(vertex.textureCoordinates) << 1);
+                   (std::hash<uint32_t>()(vertex.textureCoordinates) << 1);
         }
     };
 
-    void Load(const char *modelPath, vk::PhysicalDevice physicalDevice, vk::Device logicalDevice, vk::Queue queue, vk::CommandPool commandPool);
-    void LoadInstantiable(const char *modelPath, uint32_t instanceData, vk::PhysicalDevice physicalDevice, vk::Device logicalDevice, vk::Queue queue, vk::CommandPool commandPool);
+    // Uploads through the staging ring's current batch, drawable on queueFamily once the caller has flushed it
+    void Load(const char *modelPath, MemoryAllocator &memoryAllocator, vk::Device logicalDevice, StagingRing &stagingRing, uint32_t queueFamily);
+    // Each instance buffer holds instanceCount transforms shared by the draws of the drawGroupCount groups, one indirect draw command
+    // per LOD of each group alongside it. Whatever fills the buffer sets each draw's first instance to where its transforms start.
+    void LoadInstantiable(const char *modelPath, uint32_t instanceCount, uint32_t drawGroupCount, uint32_t instanceBufferCount, MemoryAllocator &memoryAllocator, vk::Device logicalDevice, StagingRing &stagingRing, uint32_t queueFamily);
+    // Load() in two steps. LoadMeshData() only uses the CPU so it can run on a worker thread, nothing else may use the model meanwhile.
+    // UploadMesh() releases the buffers to dstQueueFamily when it differs from the staging ring's srcQueueFamily, they
+    // must then be acquired with RecordMeshAcquire() before they're drawn.
+    void LoadMeshData(const char *modelPath);
+    void UploadMesh(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, StagingRing &stagingRing, uint32_t srcQueueFamily, uint32_t dstQueueFamily);
+    void RecordMeshAcquire(vk::CommandBuffer commandBuffer, uint32_t srcQueueFamily, uint32_t dstQueueFamily) const;
+    void CreateInstanceBuffers(uint32_t instanceCount, uint32_t drawGroupCount, uint32_t instanceBufferCount, MemoryAllocator &memoryAllocator, vk::Device logicalDevice);
+    void DestroyInstanceBuffers(MemoryAllocator &memoryAllocator, vk::Device logicalDevice);
+    vk::Buffer GetInstanceBuffer(uint32_t instanceBufferIndex) const;
+    vk::Buffer GetIndirectBuffer(uint32_t instanceBufferIndex) const;
+    uint32_t GetLodCount() const;
+    const Lod &GetLod(uint32_t lodIndex) const;
+    // Two triangles over vertex indices 0 to 3, for pipelines that place their own vertices such as the sphere impostors
+    const Lod &GetQuad() const;
+    // Radius of the sphere around the model's origin enclosing every vertex
+    float GetBoundingRadius() const;
     void Draw(vk::CommandBuffer commandBuffer);
-    void DrawInstanced(vk::CommandBuffer commandBuffer, uint32_t instanceCount);
-    void Destroy(vk::Device logicalDevice);
+    void DrawInstanced(vk::CommandBuffer commandBuffer, uint32_t instanceCount, uint32_t instanceBufferIndex);
+    void DrawInstancedIndirect(vk::CommandBuffer commandBuffer, uint32_t instanceBufferIndex, uint32_t drawGroup = 0);
+    void Destroy(MemoryAllocator &memoryAllocator, vk::Device logicalDevice);
 
 private:
+    // Start of a mesh cache file, the vertex data and the packed index data follow it
+    struct MeshCacheHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t vertexSize;
+        uint32_t vertexCount;
+        uint64_t sourceHash;
+        int64_t sourceModifiedTime;
+        uint32_t indexCount;
+        // VkIndexType of the packed indices
+        uint32_t indexType;
+        uint32_t lodCount;
+        Lod lods[MAX_LOD_COUNT];
+        Lod quad;
+        float boundingRadius;
+    };
+
+    static constexpr char MESH_CACHE_MAGIC[4] = {'V', 'C', 'G', 'M'};
+    // Bump whenever the mesh processing changes what ends up in the buffers
+    static const uint32_t MESH_CACHE_VERSION = 1;
+
+    bool loadMeshCache(const char *modelPath, const std::string &cachePath);
+    void saveMeshCache(const char *modelPath, const std::string &cachePath, const std::vector<char> &indexData) const;
+    static uint64_t hashFile(const char *path);
+
     void loadModel(const char *path);
+    void generateLods();
+    void optimizeMesh();
+    void appendQuad();
+    std::vector<uint32_t> simplifyByClustering(uint32_t gridResolution) const;
+    static std::vector<uint32_t> optimizeVertexCache(const uint32_t *lodIndices, size_t indexCount, size_t vertexCount);
 
-    void createVertexBuffer(vk::PhysicalDevice physicalDevice, vk::Device logicalDevice, vk::Queue queue, vk::CommandPool commandPool);
-    void createIndexBuffer(vk::PhysicalDevice physicalDevice, vk::Device logicalDevice, vk::Queue queue, vk::CommandPool commandPool);
+    std::vector<char> packIndices();
+    static vk::BufferMemoryBarrier createMeshOwnershipBarrier(vk::Buffer buffer, uint32_t srcQueueFamily, uint32_t dstQueueFamily);
 
     std::vector<Vertex> vertices;
+    // Only kept while the mesh is built, the indices are uploaded as 16-bit when every vertex fits, see packIndices()
     std::vector<uint32_t> indices;
+    vk::IndexType indexType = vk::IndexType::eUint32;
+    std::vector<Lod> lods;
+    Lod quad{};
+    float boundingRadius = 0.0f;
+    // The vertex data followed by the packed index data, kept from LoadMeshData() until UploadMesh()
+    std::vector<char> meshData;
+    vk::DeviceSize vertexDataSize = 0;
     vk::Buffer vertexBuffer;
-    vk::DeviceMemory vertexBufferMemory;
+    MemoryAllocator::Allocation vertexBufferMemory;
     vk::Buffer indexBuffer;
-    vk::DeviceMemory indexBufferMemory;
+    MemoryAllocator::Allocation indexBufferMemory;
+
+    // One instance transform stream per frame in flight, filled on the GPU so nothing is uploaded here.
+    // Each has VkDrawIndexedIndirectCommands alongside it, whose first instances and instance counts give the range each draw reads.
+    std::vector<vk::Buffer> instanceBuffers;
+    std::vector<MemoryAllocator::Allocation> instanceBuffersMemory;
+    std::vector<vk::Buffer> indirectBuffers;
+    std::vector<MemoryAllocator::Allocation> indirectBuffersMemory;
 };
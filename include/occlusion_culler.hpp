@@ -0,0 +1,170 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "model.hpp"
+#include "utilities.hpp"
+
+// Two-phase hierarchical-Z occlusion culling of instanced spheres, recorded on the graphics queue around the draws.
+// The early phase tests the frustum culled candidates against the depth pyramid left by the previous frame and draws the survivors,
+// the pyramid is then rebuilt from that depth and the late phase re-tests the early rejects against it.
+// Survivors are bucketed into one indirect draw per model LOD, picked from their projected size. Each phase counts its draws
+// first, then places them back to back in the model's instance buffer and copies the transforms in.
+class OcclusionCuller
+{
+public:
+    enum Phase
+    {
+        eEarly,
+        eLate,
+        ePhaseCount
+    };
+
+    // VkDispatchIndirectCommand followed by the number of entries in the list, see occlusion_common.glsl
+    struct CandidateHeader
+    {
+        uint32_t dispatchX;
+        uint32_t dispatchY;
+        uint32_t dispatchZ;
+        uint32_t count;
+    };
+
+    struct Statistics
+    {
+        uint32_t candidateCount;
+        uint32_t rejectedCounts[ePhaseCount];
+        uint32_t drawnCounts[ePhaseCount][Model::MAX_LOD_COUNT];
+    };
+
+    struct CullSettings
+    {
+        glm::mat4 viewProjection;
+        // Converts a LOD's error over its distance from the camera into the fraction of the allowed pixel error it covers on screen,
+        // an instance is drawn with the coarsest LOD under that error
+        float lodScale;
+        bool isOcclusionEnabled;
+        // Every draw uses the model's quad instead of its LOD's index range, see Model::GetQuad()
+        bool isQuadDrawn;
+    };
+
+    // Must match OCCLUSION_WORKGROUP_SIZE in occlusion_common.glsl
+    static const uint32_t WORKGROUP_SIZE = 64;
+
+    void Create(vk::PhysicalDevice physicalDevice, vk::Device logicalDevice, vk::PipelineCache pipelineCache);
+    void Destroy(vk::Device logicalDevice);
+
+    // Sized by the instance count. The model's instance buffers hold a draw group per phase, see Model::CreateInstanceBuffers().
+    void CreateInstanceResources(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, uint32_t instanceCapacity, uint32_t frameCount,
+                                 const Model &model);
+    void DestroyInstanceResources(MemoryAllocator &memoryAllocator, vk::Device logicalDevice);
+
+    // Sized by the depth attachment. A null depthImageView, for a depth attachment the device can't sample, leaves the pyramid
+    // at the far plane so nothing is occluded.
+    void CreateDepthPyramid(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, vk::Image depthImage, vk::ImageView depthImageView,
+                            vk::ImageAspectFlags depthAspect, vk::SampleCountFlagBits depthSamples, vk::Extent2D extent);
+    void DestroyDepthPyramid(MemoryAllocator &memoryAllocator, vk::Device logicalDevice);
+
+    // The candidate buffers must be acquired by the graphics queue family before RecordEarlyCull()
+    void RecordEarlyCull(vk::CommandBuffer commandBuffer, uint32_t frame, const CullSettings &settings);
+    // Between the early draw's render pass and RecordLateCull(), leaves the depth attachment back in its attachment layout.
+    // Level 0 takes the farthest sample of a multisampled depth attachment, or copies a single sampled one.
+    void RecordDepthPyramid(vk::CommandBuffer commandBuffer);
+    void RecordLateCull(vk::CommandBuffer commandBuffer, uint32_t frame);
+
+    // Written by the frame's last RecordLateCull(), valid once that submission has completed
+    Statistics GetStatistics(uint32_t frame) const;
+
+    // False when the depth pyramid can't be built from the current depth attachment, see CreateDepthPyramid()
+    bool IsOcclusionSupported() const;
+
+    // Filled by the instance transform pass on the compute queue
+    vk::Buffer GetCandidateBuffer(uint32_t frame) const;
+    vk::Buffer GetCandidateHeaderBuffer(uint32_t frame) const;
+
+private:
+    struct CullPushConstants
+    {
+        glm::mat4 viewProjection;
+        glm::vec4 lodErrors;
+        glm::vec2 pyramidSize;
+        uint32_t pyramidLevelCount;
+        uint32_t phase;
+        float boundingRadius;
+        uint32_t isOcclusionEnabled;
+        uint32_t lodCount;
+        float lodScale;
+    };
+
+    void createDescriptorSetLayouts(vk::Device logicalDevice);
+    void createPipelines(vk::Device logicalDevice, vk::PipelineCache pipelineCache);
+    void createSampler(vk::Device logicalDevice);
+    void createCullDescriptorSets(vk::Device logicalDevice, const Model &model);
+    void createPyramidDescriptorSets(vk::Device logicalDevice, vk::ImageView depthImageView);
+
+    void recordComputeBarrier(vk::CommandBuffer commandBuffer, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess);
+    void dispatchCull(vk::CommandBuffer commandBuffer, uint32_t frame, Phase phase, vk::Buffer dispatchBuffer);
+
+    static const uint32_t PYRAMID_WORKGROUP_SIZE = 8;
+
+    float boundingRadius = 0.0f;
+    // Every phase's draw group with no instances yet, drawing the LODs or the model's quad
+    std::vector<vk::DrawIndexedIndirectCommand> emptyLodDraws;
+    std::vector<vk::DrawIndexedIndirectCommand> emptyQuadDraws;
+    CullPushConstants pushConstants{};
+
+    // Per frame in flight
+    std::vector<vk::Buffer> candidateBuffers;
+    std::vector<MemoryAllocator::Allocation> candidateBuffersMemory;
+    std::vector<vk::Buffer> candidateHeaderBuffers;
+    std::vector<MemoryAllocator::Allocation> candidateHeaderBuffersMemory;
+    std::vector<vk::Buffer> lateCandidateBuffers;
+    std::vector<MemoryAllocator::Allocation> lateCandidateBuffersMemory;
+    // Per candidate, the draw and slot the cull pass gave it, see occlusion_cull_common.glsl
+    std::vector<vk::Buffer> drawSlotBuffers;
+    std::vector<MemoryAllocator::Allocation> drawSlotBuffersMemory;
+    std::vector<vk::Buffer> counterBuffers;
+    std::vector<MemoryAllocator::Allocation> counterBuffersMemory;
+    std::vector<vk::Buffer> statisticsBuffers;
+    std::vector<MemoryAllocator::Allocation> statisticsBuffersMemory;
+    std::vector<void *> statisticsBuffersMapped;
+    std::vector<vk::Buffer> drawInstanceBuffers;
+    std::vector<vk::Buffer> drawIndirectBuffers;
+
+    // Farthest depth of every texel's footprint, level 0 matches the depth attachment
+    vk::Image depthImage;
+    vk::ImageAspectFlags depthAspect;
+    bool isDepthSampled = false;
+    bool isDepthMultisampled = false;
+    bool isPyramidInitialised = false;
+    vk::Extent2D pyramidExtent;
+    uint32_t pyramidLevelCount = 0;
+    vk::Image pyramidImage;
+    MemoryAllocator::Allocation pyramidImageMemory;
+    vk::ImageView pyramidImageView;
+    std::vector<vk::ImageView> pyramidLevelImageViews;
+    vk::Sampler pyramidSampler;
+
+    vk::DescriptorSetLayout cullDescriptorSetLayout;
+    vk::DescriptorSetLayout pyramidSampleDescriptorSetLayout;
+    vk::DescriptorSetLayout pyramidLevelDescriptorSetLayout;
+    vk::DescriptorPool cullDescriptorPool;
+    vk::DescriptorPool pyramidDescriptorPool;
+    std::vector<vk::DescriptorSet> cullDescriptorSets;
+    vk::DescriptorSet pyramidSampleDescriptorSet;
+    std::vector<vk::DescriptorSet> pyramidLevelDescriptorSets;
+
+    vk::PipelineLayout cullPipelineLayout;
+    vk::PipelineLayout pyramidPipelineLayout;
+    vk::Pipeline cullPipeline;
+    vk::Pipeline drawOffsetsPipeline;
+    vk::Pipeline scatterPipeline;
+    vk::Pipeline pyramidResolvePipeline;
+    vk::Pipeline pyramidCopyPipeline;
+    vk::Pipeline pyramidReducePipeline;
+};
@@ -0,0 +1,26 @@
+// Physics body layout, included by both the C++ host code and the GLSL shaders so the two cannot drift apart.
+// Only preprocessor definitions and plain float structs belong here, they must parse as C++ and as GLSL.
+#ifndef PHYSICS_LAYOUT_H
+#define PHYSICS_LAYOUT_H
+
+// Each frame's physics buffer is a structure of arrays: PHYSICS_STREAM_COUNT tightly packed (std430) vec4 streams
+// of objectCount entries each. Position and radius come first so pair tests fetch 16 bytes per body.
+#define PHYSICS_STREAM_POSITION_RADIUS 0   // xyz position, w radius
+#define PHYSICS_STREAM_ROTATION 1          // Quaternion xyzw
+#define PHYSICS_STREAM_VELOCITY 2          // xyz linear velocity, w consecutive steps spent below the sleep velocity
+#define PHYSICS_STREAM_ANGULAR_VELOCITY 3  // xyz angular velocity, w unused
+#define PHYSICS_STREAM_COUNT 4
+
+// Index of a body's entry in one of the streams
+#define PHYSICS_STREAM_INDEX(stream, body, objectCount) ((stream) * (objectCount) + (body))
+
+// Cold per-body properties, never written by the simulation so a single buffer is shared by every frame
+struct PhysicsMaterial
+{
+    float mass;
+    float inverseMass;
+    float elasticity; // Coefficient of Restitution using empirical measurements
+    float momentOfInertia;
+};
+
+#endif
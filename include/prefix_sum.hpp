@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include "utilities.hpp"
+
+// Exclusive prefix sum of a uint buffer spread over as many workgroups as it has blocks of values: every block is
+// reduced to its total, a single workgroup scans the totals, then every block is scanned again from its total's prefix.
+// Shared by the grid broadphase's cell offsets and the linear BVH's radix sort histograms.
+class PrefixSum
+{
+public:
+    // Scans the first count values of inputBuffer into outputBuffer, both must outlive this
+    void Create(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, vk::PipelineCache pipelineCache, vk::Buffer inputBuffer, vk::Buffer outputBuffer, uint32_t count);
+    // The input must already be visible to compute shaders, making the output visible is left to the caller
+    void Record(vk::CommandBuffer commandBuffer);
+    void Destroy(MemoryAllocator &memoryAllocator, vk::Device logicalDevice);
+
+private:
+    struct PushConstants
+    {
+        uint32_t count;
+    };
+
+    void createDescriptorSet(vk::Device logicalDevice, vk::Buffer inputBuffer, vk::Buffer outputBuffer);
+    void createPipelines(vk::Device logicalDevice, vk::PipelineCache pipelineCache);
+    void recordComputeBarrier(vk::CommandBuffer commandBuffer);
+
+    // Values per workgroup, matches prefix_sum_common.glsl
+    static const uint32_t BLOCK_SIZE = 1024;
+
+    uint32_t count = 0;
+    uint32_t blockCount = 0;
+
+    vk::Buffer blockSumBuffer;
+    MemoryAllocator::Allocation blockSumBufferMemory;
+
+    vk::DescriptorSetLayout descriptorSetLayout;
+    vk::DescriptorPool descriptorPool;
+    vk::DescriptorSet descriptorSet;
+
+    vk::PipelineLayout pipelineLayout;
+    vk::Pipeline reducePipeline;
+    vk::Pipeline blockScanPipeline;
+    vk::Pipeline addPipeline;
+};
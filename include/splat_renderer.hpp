@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "model.hpp"
+#include "occlusion_culler.hpp"
+#include "utilities.hpp"
+
+// Point splat rasterizer for scenes where most spheres cover a few pixels at most.
+// A compute pass projects the frustum culled candidates and resolves their depth with 64-bit atomic mins on a packed
+// depth and colour buffer, which a fullscreen pass then composites into the render pass's colour and depth attachments.
+// Needs shaderInt64 and shaderBufferInt64Atomics.
+class SplatRenderer
+{
+public:
+    // Depth in the high half so the nearest splat wins, see splat.comp.glsl
+    static const uint64_t EMPTY_PIXEL = ~0ull;
+
+    // The composite pipeline draws in the first subpass of renderPass
+    void Create(vk::Device logicalDevice, vk::PipelineCache pipelineCache, vk::RenderPass renderPass, vk::SampleCountFlagBits sampleCount);
+    void Destroy(vk::Device logicalDevice);
+
+    // Reads the occlusion culler's per-frame candidate lists, so these are rebuilt along with its instance resources
+    void CreateInstanceResources(vk::Device logicalDevice, const OcclusionCuller &occlusionCuller, uint32_t frameCount, const Model &model);
+    void DestroyInstanceResources(vk::Device logicalDevice);
+
+    // One packed pixel per swap chain pixel
+    void CreateTarget(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, vk::Extent2D extent);
+    void DestroyTarget(MemoryAllocator &memoryAllocator, vk::Device logicalDevice);
+
+    // Outside a render pass, the candidate buffers must be acquired by the graphics queue family first
+    void RecordSplat(vk::CommandBuffer commandBuffer, uint32_t frame, const glm::mat4 &view, const glm::mat4 &projection);
+    // Inside the render pass passed to Create()
+    void RecordComposite(vk::CommandBuffer commandBuffer);
+
+private:
+    struct SplatPushConstants
+    {
+        glm::mat4 viewProjection;
+        glm::vec2 targetSize;
+        float pixelScale;
+        float depthOffset;
+        float depthScale;
+        float boundingRadius;
+    };
+
+    struct CompositePushConstants
+    {
+        uint32_t targetWidth;
+    };
+
+    void createDescriptorSetLayouts(vk::Device logicalDevice);
+    void createSplatPipeline(vk::Device logicalDevice, vk::PipelineCache pipelineCache);
+    void createCompositePipeline(vk::Device logicalDevice, vk::PipelineCache pipelineCache, vk::RenderPass renderPass, vk::SampleCountFlagBits sampleCount);
+    void createCandidateDescriptorSets(vk::Device logicalDevice, const OcclusionCuller &occlusionCuller, uint32_t frameCount);
+    void createTargetDescriptorSet(vk::Device logicalDevice);
+
+    float boundingRadius = 0.0f;
+    // Per frame in flight, owned by the occlusion culler
+    std::vector<vk::Buffer> candidateHeaderBuffers;
+
+    vk::Extent2D targetExtent;
+    vk::Buffer targetBuffer;
+    MemoryAllocator::Allocation targetBufferMemory;
+
+    vk::DescriptorSetLayout candidateDescriptorSetLayout;
+    vk::DescriptorSetLayout targetDescriptorSetLayout;
+    vk::DescriptorPool candidateDescriptorPool;
+    vk::DescriptorPool targetDescriptorPool;
+    // Per frame in flight
+    std::vector<vk::DescriptorSet> candidateDescriptorSets;
+    vk::DescriptorSet targetDescriptorSet;
+
+    vk::PipelineLayout splatPipelineLayout;
+    vk::PipelineLayout compositePipelineLayout;
+    vk::Pipeline splatPipeline;
+    vk::Pipeline compositePipeline;
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <deque>
+#include <vector>
+
+#include "memory_allocator.hpp"
+
+// Uploads to device local resources through one persistently mapped staging buffer used as a ring.
+// Copies are recorded into a shared batch command buffer and Flush() submits the whole batch at once, signalling a
+// timeline semaphore. Each batch's span of the ring is reused only once its timeline value has been reached, so the host
+// waits only when the ring is full rather than after every copy.
+//
+// Each batch ends with a barrier making its transfer writes visible to every later command on the same queue, so
+// submissions after Flush() can use the uploaded resources without waiting on the timeline.
+class StagingRing
+{
+public:
+    struct Region
+    {
+        vk::Buffer buffer;
+        vk::DeviceSize offset;
+        // Host coherent, so written data needs no flush
+        char *mapped;
+    };
+
+    void Create(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, vk::Queue queue, uint32_t queueFamily, vk::DeviceSize size);
+    // Waits for every submitted batch, anything still unflushed is submitted first
+    void Destroy(MemoryAllocator &memoryAllocator, vk::Device logicalDevice);
+
+    // Space for size bytes of staging data that stays valid until the current batch completes. Regions larger than the ring
+    // get a staging buffer of their own. May submit the current batch to make room, so call GetCommandBuffer() afterwards.
+    Region Stage(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, vk::DeviceSize size, vk::DeviceSize alignment = 16);
+    // The current batch, begun when first asked for
+    vk::CommandBuffer GetCommandBuffer(vk::Device logicalDevice);
+
+    // Staged in quarter ring chunks when the data is larger than that, so copying one chunk overlaps writing the next
+    void CopyToBuffer(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, const void *data, vk::DeviceSize size, vk::Buffer dstBuffer, vk::DeviceSize dstOffset = 0);
+
+    // Submits the current batch, if anything was recorded, and returns the timeline value signalled once it completes
+    uint64_t Flush();
+    void Wait(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, uint64_t value);
+    // Never blocks, false for a value that hasn't been flushed yet
+    bool IsComplete(vk::Device logicalDevice, uint64_t value) const;
+
+    uint32_t GetSubmittedBatchCount() const;
+
+private:
+    // The end of a submitted batch's span of the ring
+    struct Retirement
+    {
+        uint64_t value;
+        vk::DeviceSize end;
+    };
+
+    struct OversizedBuffer
+    {
+        uint64_t value;
+        vk::Buffer buffer;
+        MemoryAllocator::Allocation memory;
+    };
+
+    struct BatchCommandBuffer
+    {
+        uint64_t value;
+        vk::CommandBuffer commandBuffer;
+    };
+
+    bool tryStage(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize &offset);
+    // Releases the space, command buffers and oversized buffers of every batch that has completed
+    void reclaim(MemoryAllocator &memoryAllocator, vk::Device logicalDevice);
+    uint64_t getCompletedValue(vk::Device logicalDevice) const;
+
+    vk::Queue queue;
+    vk::CommandPool commandPool;
+    vk::Semaphore timeline;
+    uint64_t timelineValue = 0;
+
+    vk::Buffer buffer;
+    MemoryAllocator::Allocation bufferMemory;
+    vk::DeviceSize bufferSize = 0;
+    // Staging data is written at head, the oldest batch still in flight starts at tail
+    vk::DeviceSize head = 0;
+    vk::DeviceSize tail = 0;
+    std::deque<Retirement> retirements;
+
+    vk::CommandBuffer batchCommandBuffer;
+    bool isBatchStaged = false;
+    std::vector<OversizedBuffer> oversizedBuffers;
+    std::deque<BatchCommandBuffer> submittedCommandBuffers;
+    std::vector<vk::CommandBuffer> freeCommandBuffers;
+
+    uint32_t submittedBatchCount = 0;
+};
@@ -2,14 +2,21 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include "memory_allocator.hpp"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
 class Utilities
 {
 public:
-    static vk::CommandBuffer beginSingleTimeCommands(vk::Device logicalDevice, vk::CommandPool commandPool);
-    static void endSingleTimeCommands(vk::Device logicalDevice, vk::Queue queue, vk::CommandBuffer commandBuffer, vk::CommandPool commandPool);
-
-    static void createBuffer(vk::PhysicalDevice physicalDevice, vk::Device logicalDevice, vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Buffer &buffer, vk::DeviceMemory &bufferMemory);
-    static void copyBuffer(vk::Device logicalDevice, vk::Queue queue, vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size, vk::CommandPool commandPool);
+    static void createBuffer(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Buffer &buffer, MemoryAllocator::Allocation &bufferMemory,
+                             MemoryAllocator::Strategy strategy = MemoryAllocator::Strategy::eFreeList);
 
-    static uint32_t findMemoryType(vk::PhysicalDevice physicalDevice, uint32_t typeFilter, vk::MemoryPropertyFlags properties);
+    static std::vector<char> readFile(const std::string &fileName);
+    static vk::ShaderModule createShaderModule(vk::Device logicalDevice, const std::vector<char> &code);
+    // A requiredSubgroupSize of 0 leaves the subgroup size to the driver, otherwise subgroupSizeControl must be enabled
+    static vk::Pipeline createComputePipeline(vk::Device logicalDevice, vk::PipelineCache pipelineCache, const std::string &shaderPath, vk::PipelineLayout pipelineLayout,
+                                              const vk::SpecializationInfo *specializationInfo = nullptr, uint32_t requiredSubgroupSize = 0);
 };
\ No newline at end of file
@@ -0,0 +1,30 @@
+#version 460
+#include "physics_common.glsl"
+#include "contact_common.glsl"
+
+layout(std430, binding = 2) buffer PhysicsStreamsOut {
+   vec4 streamsOut[];
+};
+
+layout(local_size_x_id = 0, local_size_y = 1, local_size_z = 1) in;
+
+// Folds the impulses and corrections accumulated by the solver back into each awake body
+void main() {
+    if (gl_GlobalInvocationID.x >= activeSet.count) {
+        return;
+    }
+    uint index = activeSet.bodies[gl_GlobalInvocationID.x];
+
+    BodyDelta delta = bodyDeltas[index];
+    vec4 velocity = streamsOut[streamIndex(PHYSICS_STREAM_VELOCITY, index)];
+    velocity.xyz += fromFixedPoint(delta.velocity);
+
+    // Count the steps spent below the sleep velocity, resetting on any faster step. A body falls asleep at rest.
+    velocity.w = (dot(velocity.xyz, velocity.xyz) < ubo.sleepVelocity * ubo.sleepVelocity) ? velocity.w + 1.0 : 0.0;
+    if (isSleeping(velocity)) {
+        velocity.xyz = vec3(0.0);
+    }
+
+    streamsOut[streamIndex(PHYSICS_STREAM_VELOCITY, index)] = velocity;
+    streamsOut[streamIndex(PHYSICS_STREAM_POSITION_RADIUS, index)].xyz += fromFixedPoint(delta.position);
+}
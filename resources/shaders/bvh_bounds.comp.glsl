@@ -0,0 +1,41 @@
+#version 460
+#include "bvh_build_common.glsl"
+
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+shared vec3 sharedMin[gl_WorkGroupSize.x];
+shared vec3 sharedMax[gl_WorkGroupSize.x];
+
+// Scene AABB over every sphere, reduced per workgroup then merged with atomics
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    uint thread = gl_LocalInvocationID.x;
+
+    vec3 boundsMin = vec3(3.402823466e+38);
+    vec3 boundsMax = vec3(-3.402823466e+38);
+
+    if (index < parameters.objectCount) {
+        vec4 sphere = loadPositionRadius(index);
+        boundsMin = sphere.xyz - vec3(sphere.w);
+        boundsMax = sphere.xyz + vec3(sphere.w);
+    }
+
+    sharedMin[thread] = boundsMin;
+    sharedMax[thread] = boundsMax;
+    barrier();
+
+    for (uint stride = gl_WorkGroupSize.x / 2u; stride > 0u; stride >>= 1u) {
+        if (thread < stride) {
+            sharedMin[thread] = min(sharedMin[thread], sharedMin[thread + stride]);
+            sharedMax[thread] = max(sharedMax[thread], sharedMax[thread + stride]);
+        }
+        barrier();
+    }
+
+    if (thread == 0u) {
+        for (uint axis = 0u; axis < 3u; ++axis) {
+            atomicMin(sceneBounds[axis], floatToOrderedUint(sharedMin[0][axis]));
+            atomicMax(sceneBounds[4u + axis], floatToOrderedUint(sharedMax[0][axis]));
+        }
+    }
+}
@@ -0,0 +1,64 @@
+// Resources shared by every LinearBVH build pass, see LinearBVH::createDescriptorSetLayout()
+#ifndef BVH_BUILD_COMMON_GLSL
+#define BVH_BUILD_COMMON_GLSL
+
+#include "physics_layout.h"
+#include "bvh_common.glsl"
+
+layout(push_constant) uniform BVHParameters {
+    uint objectCount;
+    uint radixShift;
+} parameters;
+
+// Physics buffer streams, only the position and radius stream is read by the build
+layout(std430, binding = 0) readonly buffer PhysicsStreams {
+   vec4 streams[];
+};
+
+vec4 loadPositionRadius(uint body) {
+    return streams[PHYSICS_STREAM_INDEX(PHYSICS_STREAM_POSITION_RADIUS, body, parameters.objectCount)];
+}
+
+// Ordered uint bits of the scene AABB: [0..2] minimum, [4..6] maximum
+layout(std430, binding = 1) buffer SceneBounds {
+   uint sceneBounds[8];
+};
+
+layout(std430, binding = 2) buffer MortonKeysA {
+   uint keysA[];
+};
+
+layout(std430, binding = 3) buffer MortonValuesA {
+   uint valuesA[];
+};
+
+layout(std430, binding = 4) buffer MortonKeysB {
+   uint keysB[];
+};
+
+layout(std430, binding = 5) buffer MortonValuesB {
+   uint valuesB[];
+};
+
+// Digit-major per-workgroup digit counts: radixHistogram[digit * workgroupCount + workgroup]
+layout(std430, binding = 6) buffer RadixHistogram {
+   uint radixHistogram[];
+};
+
+layout(std430, binding = 7) readonly buffer RadixOffsets {
+   uint radixOffsets[];
+};
+
+layout(std430, binding = 8) coherent buffer BVHNodes {
+   BVHNode nodes[];
+};
+
+layout(std430, binding = 9) buffer BVHParents {
+   uint parents[];
+};
+
+layout(std430, binding = 10) buffer BVHRefitCounters {
+   uint refitCounters[];
+};
+
+#endif
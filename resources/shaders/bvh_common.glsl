@@ -0,0 +1,27 @@
+// Shared declarations for the linear BVH build and traversal passes
+#ifndef BVH_COMMON_GLSL
+#define BVH_COMMON_GLSL
+
+// Internal nodes occupy [0, objectCount - 1), leaves follow at [objectCount - 1, 2 * objectCount - 1)
+struct BVHNode {
+    vec3 boundsMin;
+    uint leftChild;  // Physics object index for leaves
+    vec3 boundsMax;
+    uint rightChild; // BVH_LEAF for leaves
+};
+
+const uint BVH_LEAF = 0xFFFFFFFFu;
+const uint BVH_RADIX_BITS = 4u;
+const uint BVH_RADIX_SIZE = 1u << BVH_RADIX_BITS;
+
+// Maps floats onto uints with the same ordering so bounds can be reduced with integer atomics
+uint floatToOrderedUint(float value) {
+    uint bits = floatBitsToUint(value);
+    return ((bits & 0x80000000u) != 0u) ? ~bits : (bits | 0x80000000u);
+}
+
+float orderedUintToFloat(uint value) {
+    return ((value & 0x80000000u) != 0u) ? uintBitsToFloat(value & 0x7FFFFFFFu) : uintBitsToFloat(~value);
+}
+
+#endif
@@ -0,0 +1,76 @@
+#version 460
+#include "bvh_build_common.glsl"
+
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+int countLeadingZeros(uint value) {
+    return 31 - findMSB(value);
+}
+
+// Length of the common prefix of two sorted keys, duplicate keys fall back to their indices
+int commonPrefix(int i, int j) {
+    if (j < 0 || j >= int(parameters.objectCount)) {
+        return -1;
+    }
+
+    uint keyI = keysA[i];
+    uint keyJ = keysA[j];
+    if (keyI == keyJ) {
+        return 32 + countLeadingZeros(uint(i) ^ uint(j));
+    }
+
+    return countLeadingZeros(keyI ^ keyJ);
+}
+
+// One thread per internal node (Karras 2012, "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d Trees")
+void main() {
+    int i = int(gl_GlobalInvocationID.x);
+    int internalCount = int(parameters.objectCount) - 1;
+    if (i >= internalCount) {
+        return;
+    }
+
+    if (i == 0) {
+        parents[0] = BVH_LEAF;
+    }
+
+    // Direction of the range covered by node i
+    int direction = (commonPrefix(i, i + 1) - commonPrefix(i, i - 1)) >= 0 ? 1 : -1;
+    int minimumPrefix = commonPrefix(i, i - direction);
+
+    // Upper bound for the range length, then binary search for the other end
+    int maximumLength = 2;
+    while (commonPrefix(i, i + maximumLength * direction) > minimumPrefix) {
+        maximumLength *= 2;
+    }
+
+    int rangeLength = 0;
+    for (int searchStep = maximumLength / 2; searchStep >= 1; searchStep /= 2) {
+        if (commonPrefix(i, i + (rangeLength + searchStep) * direction) > minimumPrefix) {
+            rangeLength += searchStep;
+        }
+    }
+    int j = i + rangeLength * direction;
+
+    // Binary search for the split position
+    int nodePrefix = commonPrefix(i, j);
+    int split = 0;
+    int divisor = 2;
+    int searchStep = 0;
+    do {
+        searchStep = (rangeLength + divisor - 1) / divisor;
+        if (commonPrefix(i, i + (split + searchStep) * direction) > nodePrefix) {
+            split += searchStep;
+        }
+        divisor *= 2;
+    } while (searchStep > 1);
+    int gamma = i + split * direction + min(direction, 0);
+
+    uint leftChild = (min(i, j) == gamma) ? uint(internalCount + gamma) : uint(gamma);
+    uint rightChild = (max(i, j) == gamma + 1) ? uint(internalCount + gamma + 1) : uint(gamma + 1);
+
+    nodes[i].leftChild = leftChild;
+    nodes[i].rightChild = rightChild;
+    parents[leftChild] = uint(i);
+    parents[rightChild] = uint(i);
+}
@@ -0,0 +1,33 @@
+#version 460
+#include "bvh_build_common.glsl"
+
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+// Spreads the lower 10 bits of value so two zero bits sit between each of them
+uint expandBits(uint value) {
+    value = (value * 0x00010001u) & 0xFF0000FFu;
+    value = (value * 0x00000101u) & 0x0F00F00Fu;
+    value = (value * 0x00000011u) & 0xC30C30C3u;
+    value = (value * 0x00000005u) & 0x49249249u;
+    return value;
+}
+
+// 30-bit Morton code of a point inside the unit cube
+uint morton3D(vec3 position) {
+    uvec3 quantised = uvec3(clamp(position * 1024.0, vec3(0.0), vec3(1023.0)));
+    return (expandBits(quantised.x) << 2u) | (expandBits(quantised.y) << 1u) | expandBits(quantised.z);
+}
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= parameters.objectCount) {
+        return;
+    }
+
+    vec3 sceneMin = vec3(orderedUintToFloat(sceneBounds[0]), orderedUintToFloat(sceneBounds[1]), orderedUintToFloat(sceneBounds[2]));
+    vec3 sceneMax = vec3(orderedUintToFloat(sceneBounds[4]), orderedUintToFloat(sceneBounds[5]), orderedUintToFloat(sceneBounds[6]));
+    vec3 sceneExtent = max(sceneMax - sceneMin, vec3(1e-6));
+
+    keysA[index] = morton3D((loadPositionRadius(index).xyz - sceneMin) / sceneExtent);
+    valuesA[index] = index;
+}
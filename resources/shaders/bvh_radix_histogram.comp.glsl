@@ -0,0 +1,29 @@
+#version 460
+#include "bvh_build_common.glsl"
+
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+shared uint digitCounts[BVH_RADIX_SIZE];
+
+// Counts how many keys of this workgroup's block fall into each radix digit
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    uint thread = gl_LocalInvocationID.x;
+
+    if (thread < BVH_RADIX_SIZE) {
+        digitCounts[thread] = 0u;
+    }
+    barrier();
+
+    if (index < parameters.objectCount) {
+        // Even passes sort A into B, odd passes sort B back into A
+        bool isOddPass = ((parameters.radixShift / BVH_RADIX_BITS) & 1u) != 0u;
+        uint key = isOddPass ? keysB[index] : keysA[index];
+        atomicAdd(digitCounts[(key >> parameters.radixShift) & (BVH_RADIX_SIZE - 1u)], 1u);
+    }
+    barrier();
+
+    if (thread < BVH_RADIX_SIZE) {
+        radixHistogram[thread * gl_NumWorkGroups.x + gl_WorkGroupID.x] = digitCounts[thread];
+    }
+}
@@ -0,0 +1,56 @@
+#version 460
+#include "bvh_build_common.glsl"
+
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+shared uint digitFlags[gl_WorkGroupSize.x];
+
+// Stable scatter of one radix pass, radixOffsets holds the exclusive scan of radixHistogram
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    uint thread = gl_LocalInvocationID.x;
+    bool isOddPass = ((parameters.radixShift / BVH_RADIX_BITS) & 1u) != 0u;
+    bool isValid = index < parameters.objectCount;
+
+    uint key = 0u;
+    uint value = 0u;
+    uint digit = BVH_RADIX_SIZE; // Out of range keys take part in no digit
+
+    if (isValid) {
+        key = isOddPass ? keysB[index] : keysA[index];
+        value = isOddPass ? valuesB[index] : valuesA[index];
+        digit = (key >> parameters.radixShift) & (BVH_RADIX_SIZE - 1u);
+    }
+
+    // Rank of this key among the keys of the same digit earlier in the block, keeps the sort stable
+    uint localRank = 0u;
+    for (uint d = 0u; d < BVH_RADIX_SIZE; ++d) {
+        digitFlags[thread] = (digit == d) ? 1u : 0u;
+        barrier();
+
+        for (uint offset = 1u; offset < gl_WorkGroupSize.x; offset <<= 1u) {
+            uint addend = (thread >= offset) ? digitFlags[thread - offset] : 0u;
+            barrier();
+            digitFlags[thread] += addend;
+            barrier();
+        }
+
+        if (digit == d) {
+            localRank = digitFlags[thread] - 1u;
+        }
+        barrier();
+    }
+
+    if (!isValid) {
+        return;
+    }
+
+    uint destination = radixOffsets[digit * gl_NumWorkGroups.x + gl_WorkGroupID.x] + localRank;
+    if (isOddPass) {
+        keysA[destination] = key;
+        valuesA[destination] = value;
+    } else {
+        keysB[destination] = key;
+        valuesB[destination] = value;
+    }
+}
@@ -0,0 +1,40 @@
+#version 460
+#include "bvh_build_common.glsl"
+
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+// Writes the leaf bounds then walks towards the root, the second child to reach a node computes its bounds
+void main() {
+    uint leaf = gl_GlobalInvocationID.x;
+    if (leaf >= parameters.objectCount) {
+        return;
+    }
+
+    uint objectIndex = valuesA[leaf];
+    uint node = parameters.objectCount - 1u + leaf;
+
+    vec4 sphere = loadPositionRadius(objectIndex);
+    nodes[node].boundsMin = sphere.xyz - vec3(sphere.w);
+    nodes[node].boundsMax = sphere.xyz + vec3(sphere.w);
+    nodes[node].leftChild = objectIndex;
+    nodes[node].rightChild = BVH_LEAF;
+
+    memoryBarrierBuffer();
+
+    uint current = parents[node];
+    while (current != BVH_LEAF) {
+        if (atomicAdd(refitCounters[current], 1u) == 0u) {
+            return; // The sibling subtree is still being refitted and will finish this node
+        }
+
+        uint leftChild = nodes[current].leftChild;
+        uint rightChild = nodes[current].rightChild;
+
+        nodes[current].boundsMin = min(nodes[leftChild].boundsMin, nodes[rightChild].boundsMin);
+        nodes[current].boundsMax = max(nodes[leftChild].boundsMax, nodes[rightChild].boundsMax);
+
+        memoryBarrierBuffer();
+
+        current = parents[current];
+    }
+}
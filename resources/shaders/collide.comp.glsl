@@ -0,0 +1,99 @@
+#version 460
+#include "physics_common.glsl"
+#include "contact_common.glsl"
+
+layout(std430, binding = 1) readonly buffer PhysicsStreamsIn {
+   vec4 streamsIn[];
+};
+
+// Written only to wake sleeping bodies
+layout(std430, binding = 2) buffer PhysicsStreamsOut {
+   vec4 streamsOut[];
+};
+
+layout(std430, binding = 3) readonly buffer GridCellCounts {
+   uint cellCounts[];
+};
+
+layout(std430, binding = 4) readonly buffer GridCellStarts {
+   uint cellStarts[];
+};
+
+layout(std430, binding = 7) readonly buffer GridSortedBodies {
+   uint sortedBodies[];
+};
+
+layout(local_size_x_id = 0, local_size_y = 1, local_size_z = 1) in;
+
+bool isCollidingSphereWithSphere(vec4 sphereOne, vec4 sphereTwo) {
+    // Squaring radii to avoid calling sqrt(), xyz is the position and w the radius
+    float sumRadiiSquared = (sphereOne.w + sphereTwo.w) * (sphereOne.w + sphereTwo.w);
+    vec3 offset = sphereTwo.xyz - sphereOne.xyz;
+
+    return dot(offset, offset) <= sumRadiiSquared;
+}
+
+// Pairs of awake bodies are recorded once, by the lower indexed body.
+// Sleeping bodies run no narrowphase, so pairs with them are recorded by the awake body.
+bool isPairOwner(uint index, uint other) {
+    if (isSleeping(streamsIn[streamIndex(PHYSICS_STREAM_VELOCITY, other)])) {
+        return true;
+    }
+
+    return other > index;
+}
+
+// Wake-on-contact: a sleeping body hit by one moving faster than the sleep velocity rejoins the active set next step
+void wakeOnContact(uint index, uint other) {
+    if (isSleeping(streamsIn[streamIndex(PHYSICS_STREAM_VELOCITY, other)]) &&
+        length(streamsOut[streamIndex(PHYSICS_STREAM_VELOCITY, index)].xyz) > ubo.sleepVelocity) {
+        streamsOut[streamIndex(PHYSICS_STREAM_VELOCITY, other)].w = 0.0;
+    }
+}
+
+void main() {
+    if (gl_GlobalInvocationID.x >= activeSet.count) {
+        return;
+    }
+    uint index = activeSet.bodies[gl_GlobalInvocationID.x];
+
+    vec4 sphere = streamsOut[streamIndex(PHYSICS_STREAM_POSITION_RADIUS, index)];
+    ivec3 cell = gridCell(sphere.xyz);
+
+    // Neighbouring cells can fold onto the same hash bucket, remember visited buckets so no pair is recorded twice
+    uint visitedHashes[27];
+    uint visitedCount = 0;
+
+    for (int z = -1; z <= 1; ++z) {
+        for (int y = -1; y <= 1; ++y) {
+            for (int x = -1; x <= 1; ++x) {
+                uint cellHash = gridHash(cell + ivec3(x, y, z));
+
+                bool visited = false;
+                for (uint v = 0; v < visitedCount; ++v) {
+                    visited = visited || (visitedHashes[v] == cellHash);
+                }
+
+                if (visited) {
+                    continue;
+                }
+
+                visitedHashes[visitedCount++] = cellHash;
+
+                uint cellStart = cellStarts[cellHash];
+                uint cellEnd = cellStart + cellCounts[cellHash];
+
+                for (uint slot = cellStart; slot < cellEnd; ++slot) {
+                    uint other = sortedBodies[slot];
+                    if (isPairOwner(index, other)) {
+                        vec4 sphereTwo = streamsOut[streamIndex(PHYSICS_STREAM_POSITION_RADIUS, other)];
+                        if (isCollidingSphereWithSphere(sphere, sphereTwo)) {
+                            appendContact(index, other, sphere.xyz, sphereTwo.xyz, sphere.w + sphereTwo.w);
+                            wakeOnContact(index, other);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
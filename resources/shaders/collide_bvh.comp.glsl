@@ -0,0 +1,93 @@
+#version 460
+#include "physics_common.glsl"
+#include "contact_common.glsl"
+#include "bvh_common.glsl"
+
+layout(std430, binding = 1) readonly buffer PhysicsStreamsIn {
+   vec4 streamsIn[];
+};
+
+// Written only to wake sleeping bodies
+layout(std430, binding = 2) buffer PhysicsStreamsOut {
+   vec4 streamsOut[];
+};
+
+layout(std430, binding = 8) readonly buffer BVHNodes {
+   BVHNode nodes[];
+};
+
+layout(local_size_x_id = 0, local_size_y = 1, local_size_z = 1) in;
+
+// Deep enough for any tree of this many objects, see LinearBVH::GetTraversalStackSize()
+layout(constant_id = 1) const uint BVH_STACK_SIZE = 64u;
+
+bool isCollidingSphereWithSphere(vec4 sphereOne, vec4 sphereTwo) {
+    // Squaring radii to avoid calling sqrt(), xyz is the position and w the radius
+    float sumRadiiSquared = (sphereOne.w + sphereTwo.w) * (sphereOne.w + sphereTwo.w);
+    vec3 offset = sphereTwo.xyz - sphereOne.xyz;
+
+    return dot(offset, offset) <= sumRadiiSquared;
+}
+
+// Pairs of awake bodies are recorded once, by the lower indexed body.
+// Sleeping bodies run no narrowphase, so pairs with them are recorded by the awake body.
+bool isPairOwner(uint index, uint other) {
+    if (isSleeping(streamsIn[streamIndex(PHYSICS_STREAM_VELOCITY, other)])) {
+        return true;
+    }
+
+    return other > index;
+}
+
+// Wake-on-contact: a sleeping body hit by one moving faster than the sleep velocity rejoins the active set next step
+void wakeOnContact(uint index, uint other) {
+    if (isSleeping(streamsIn[streamIndex(PHYSICS_STREAM_VELOCITY, other)]) &&
+        length(streamsOut[streamIndex(PHYSICS_STREAM_VELOCITY, index)].xyz) > ubo.sleepVelocity) {
+        streamsOut[streamIndex(PHYSICS_STREAM_VELOCITY, other)].w = 0.0;
+    }
+}
+
+bool overlapsBounds(vec3 boundsMinA, vec3 boundsMaxA, vec3 boundsMinB, vec3 boundsMaxB) {
+    return all(lessThanEqual(boundsMinA, boundsMaxB)) && all(lessThanEqual(boundsMinB, boundsMaxA));
+}
+
+// Narrowphase driven by a traversal of this frame's LinearBVH, the root is internal node 0
+void main() {
+    if (gl_GlobalInvocationID.x >= activeSet.count) {
+        return;
+    }
+    uint index = activeSet.bodies[gl_GlobalInvocationID.x];
+
+    vec4 sphere = streamsOut[streamIndex(PHYSICS_STREAM_POSITION_RADIUS, index)];
+    vec3 sphereMin = sphere.xyz - vec3(sphere.w);
+    vec3 sphereMax = sphere.xyz + vec3(sphere.w);
+
+    uint stack[BVH_STACK_SIZE];
+    uint stackSize = 0u;
+    stack[stackSize++] = 0u;
+
+    while (stackSize > 0u) {
+        BVHNode node = nodes[stack[--stackSize]];
+
+        if (!overlapsBounds(sphereMin, sphereMax, node.boundsMin, node.boundsMax)) {
+            continue;
+        }
+
+        if (node.rightChild == BVH_LEAF) {
+            uint other = node.leftChild;
+            if (isPairOwner(index, other)) {
+                vec4 sphereTwo = streamsOut[streamIndex(PHYSICS_STREAM_POSITION_RADIUS, other)];
+                if (isCollidingSphereWithSphere(sphere, sphereTwo)) {
+                    appendContact(index, other, sphere.xyz, sphereTwo.xyz, sphere.w + sphereTwo.w);
+                    wakeOnContact(index, other);
+                }
+            }
+        } else if (stackSize + 2u <= BVH_STACK_SIZE) {
+            stack[stackSize++] = node.leftChild;
+            stack[stackSize++] = node.rightChild;
+        } else {
+            // Can't happen with a correctly sized stack, counted so lost pairs show up on the overlay
+            atomicAdd(contactHeader.bvhStackOverflowCount, 1u);
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#version 460
+#include "physics_common.glsl"
+
+layout(std430, binding = 1) readonly buffer PhysicsStreamsIn {
+   vec4 streamsIn[];
+};
+
+layout(std430, binding = 2) writeonly buffer PhysicsStreamsOut {
+   vec4 streamsOut[];
+};
+
+layout(std430, binding = 3) buffer GridCellCounts {
+   uint cellCounts[];
+};
+
+layout(std430, binding = 6) writeonly buffer GridBodyCells {
+   uint bodyCells[];
+};
+
+layout(local_size_x_id = 0, local_size_y = 1, local_size_z = 1) in;
+
+// Appends every awake body to the active set, integration, narrowphase and apply are dispatched indirectly over it.
+// Sleeping bodies are carried over to the output buffer as they are and still binned, so awake bodies can hit (and wake) them.
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= ubo.objectCount) {
+        return;
+    }
+
+    if (!isSleeping(streamsIn[streamIndex(PHYSICS_STREAM_VELOCITY, index)])) {
+        uint slot = atomicAdd(activeSet.count, 1u);
+        activeSet.bodies[slot] = index;
+        atomicMax(activeSet.dispatchX, slot / PHYSICS_WORKGROUP_SIZE + 1u);
+        return;
+    }
+
+    for (uint stream = 0u; stream < PHYSICS_STREAM_COUNT; ++stream) {
+        streamsOut[streamIndex(stream, index)] = streamsIn[streamIndex(stream, index)];
+    }
+
+    if (ubo.isGridBinned != 0u) {
+        uint cellHash = gridHash(gridCell(streamsIn[streamIndex(PHYSICS_STREAM_POSITION_RADIUS, index)].xyz));
+        bodyCells[index] = cellHash;
+        atomicAdd(cellCounts[cellHash], 1u);
+    }
+}
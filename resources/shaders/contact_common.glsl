@@ -0,0 +1,74 @@
+// Contact list shared by the detection, solver and apply passes
+#ifndef CONTACT_COMMON_GLSL
+#define CONTACT_COMMON_GLSL
+
+#include "physics_common.glsl"
+
+const uint CONTACT_WORKGROUP_SIZE = 64u;
+
+// Solver impulses are accumulated per body with integer atomics in this fixed point scale: a resolution of 2^-17
+// (under 8 um or um/s) over a range of +-2^14 per component before an int32 sum wraps.
+const float CONTACT_FIXED_POINT_SCALE = 131072.0;
+// Each contact's velocity and position change is clamped to this, so CONTACT_MAX_PER_BODY of them sum to under 2^31.
+const float CONTACT_MAX_DELTA = 255.0;
+// A sphere among equal sized ones touches at most 12 others, deep overlaps when bodies spawn can touch many more.
+// Deltas past this many on one body are dropped for the step, see solve_contacts.comp.
+const int CONTACT_MAX_PER_BODY = 64;
+
+struct Contact {
+    vec3 normal; // From bodyB towards bodyA
+    float depth;
+    uint bodyA;
+    uint bodyB;
+    uint padding0;
+    uint padding1;
+};
+
+struct BodyDelta {
+    ivec4 velocity; // w counts the contacts that added to the body
+    ivec4 position;
+};
+
+// The first three words double as the VkDispatchIndirectCommand of the solver pass
+layout(std430, binding = 9) buffer ContactHeader {
+    uint dispatchX;
+    uint dispatchY;
+    uint dispatchZ;
+    uint contactCount;
+    uint bvhStackOverflowCount; // BVH nodes collide_bvh.comp had no stack room to visit
+} contactHeader;
+
+layout(std430, binding = 10) buffer ContactList {
+    Contact contacts[];
+};
+
+layout(std430, binding = 11) buffer BodyDeltas {
+    BodyDelta bodyDeltas[];
+};
+
+// Records a touching pair, contacts past the list capacity are dropped this step
+void appendContact(uint bodyA, uint bodyB, vec3 positionA, vec3 positionB, float radiusSum) {
+    uint slot = atomicAdd(contactHeader.contactCount, 1u);
+    if (slot >= ubo.contactCapacity) {
+        return;
+    }
+
+    vec3 normalDirection = positionA - positionB;
+    float separationDistance = length(normalDirection);
+
+    contacts[slot].normal = normalDirection / max(separationDistance, 1e-12);
+    contacts[slot].depth = radiusSum - separationDistance;
+    contacts[slot].bodyA = bodyA;
+    contacts[slot].bodyB = bodyB;
+}
+
+// Clamped first, round() of a float outside the int32 range is undefined
+ivec4 toFixedPoint(vec3 value) {
+    return ivec4(round(clamp(value, vec3(-CONTACT_MAX_DELTA), vec3(CONTACT_MAX_DELTA)) * CONTACT_FIXED_POINT_SCALE), 0);
+}
+
+vec3 fromFixedPoint(ivec4 value) {
+    return vec3(value.xyz) / CONTACT_FIXED_POINT_SCALE;
+}
+
+#endif
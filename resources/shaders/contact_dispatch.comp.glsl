@@ -0,0 +1,13 @@
+#version 460
+#include "contact_common.glsl"
+
+layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
+
+// Turns the contact count written by the detection pass into the solver's indirect dispatch size
+void main() {
+    uint contactCount = min(contactHeader.contactCount, ubo.contactCapacity);
+
+    contactHeader.dispatchX = (contactCount + CONTACT_WORKGROUP_SIZE - 1u) / CONTACT_WORKGROUP_SIZE;
+    contactHeader.dispatchY = 1u;
+    contactHeader.dispatchZ = 1u;
+}
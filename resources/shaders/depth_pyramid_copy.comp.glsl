@@ -0,0 +1,19 @@
+#version 460
+
+// The single sampled depth attachment of the early draw
+layout(binding = 0) uniform sampler2D depthImage;
+
+// Level 0 of the depth pyramid
+layout(binding = 1, r32f) uniform writeonly image2D pyramidLevel;
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+// Without multisampling level 0 is a straight copy of the depth attachment
+void main() {
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(texel, imageSize(pyramidLevel)))) {
+        return;
+    }
+
+    imageStore(pyramidLevel, texel, vec4(texelFetch(depthImage, texel, 0).r));
+}
@@ -0,0 +1,38 @@
+#version 460
+
+// The level above, a single mip view
+layout(binding = 0) uniform sampler2D sourceLevel;
+
+layout(binding = 1, r32f) uniform writeonly image2D pyramidLevel;
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+// Keeps the farthest of the 2x2 source texels, the last row and column also take the third texel of an odd sized source
+// so every source texel is covered
+void main() {
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 levelSize = imageSize(pyramidLevel);
+    if (any(greaterThanEqual(texel, levelSize))) {
+        return;
+    }
+
+    ivec2 sourceSize = textureSize(sourceLevel, 0);
+    ivec2 sourceMin = texel * 2;
+    ivec2 sourceMax = min(sourceMin + 1, sourceSize - 1);
+
+    if (texel.x == levelSize.x - 1) {
+        sourceMax.x = sourceSize.x - 1;
+    }
+    if (texel.y == levelSize.y - 1) {
+        sourceMax.y = sourceSize.y - 1;
+    }
+
+    float farthestDepth = 0.0;
+    for (int y = sourceMin.y; y <= sourceMax.y; ++y) {
+        for (int x = sourceMin.x; x <= sourceMax.x; ++x) {
+            farthestDepth = max(farthestDepth, texelFetch(sourceLevel, ivec2(x, y), 0).r);
+        }
+    }
+
+    imageStore(pyramidLevel, texel, vec4(farthestDepth));
+}
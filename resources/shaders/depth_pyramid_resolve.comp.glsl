@@ -0,0 +1,24 @@
+#version 460
+
+// The multisampled depth attachment of the early draw
+layout(binding = 0) uniform sampler2DMS depthImage;
+
+// Level 0 of the depth pyramid
+layout(binding = 1, r32f) uniform writeonly image2D pyramidLevel;
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+// Keeps the farthest sample of every pixel, so a pixel only occludes what is behind all of its samples
+void main() {
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(texel, imageSize(pyramidLevel)))) {
+        return;
+    }
+
+    float farthestDepth = 0.0;
+    for (int sampleIndex = 0; sampleIndex < textureSamples(depthImage); ++sampleIndex) {
+        farthestDepth = max(farthestDepth, texelFetch(depthImage, texel, sampleIndex).r);
+    }
+
+    imageStore(pyramidLevel, texel, vec4(farthestDepth));
+}
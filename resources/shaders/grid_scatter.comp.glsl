@@ -0,0 +1,27 @@
+#version 460
+#include "physics_common.glsl"
+
+layout(std430, binding = 5) buffer GridCellCursors {
+   uint cellCursors[];
+};
+
+layout(std430, binding = 6) readonly buffer GridBodyCells {
+   uint bodyCells[];
+};
+
+layout(std430, binding = 7) writeonly buffer GridSortedBodies {
+   uint sortedBodies[];
+};
+
+layout(local_size_x_id = 0, local_size_y = 1, local_size_z = 1) in;
+
+// Counting sort: each body claims a slot inside its cell's range, cursors start at the exclusive prefix sum
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= ubo.objectCount) {
+        return;
+    }
+
+    uint slot = atomicAdd(cellCursors[bodyCells[index]], 1u);
+    sortedBodies[slot] = index;
+}
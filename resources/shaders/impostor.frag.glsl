@@ -0,0 +1,58 @@
+#version 460
+
+layout(set = 0, binding = 0) uniform UniformBufferObject
+{
+    mat4 model;
+    mat4 view;
+    mat4 projection;
+}ubo;
+
+layout(binding = 1) uniform sampler2D textureSampler;
+
+layout(location = 0) in vec3 fragQuadPosition;
+layout(location = 1) flat in vec4 fragSphere;
+layout(location = 2) flat in vec3 fragCameraPosition;
+layout(location = 3) flat in vec3 fragInstanceRows[3];
+
+layout(location = 0) out vec4 outColor;
+
+const float PI = 3.14159265358979;
+
+// Casts the view ray through the quad at the sphere, writing the hit's depth and texturing it with a spherical mapping
+// that turns with the body
+void main()
+{
+    vec3 rayDirection = normalize(fragQuadPosition - fragCameraPosition);
+    vec3 centerToCamera = fragCameraPosition - fragSphere.xyz;
+
+    float halfB = dot(centerToCamera, rayDirection);
+    float c = dot(centerToCamera, centerToCamera) - fragSphere.w * fragSphere.w;
+    float discriminant = halfB * halfB - c;
+
+    // Misses are discarded at the end, so the neighbouring pixels' derivatives below stay defined
+    float hitDistance = -halfB - sqrt(max(discriminant, 0.0));
+    bool isHit = discriminant >= 0.0 && hitDistance >= 0.0;
+
+    vec3 hitPosition = fragCameraPosition + rayDirection * hitDistance;
+    vec3 normal = (hitPosition - fragSphere.xyz) / fragSphere.w;
+
+    vec4 clipPosition = ubo.projection * ubo.view * ubo.model * vec4(hitPosition, 1.0);
+    gl_FragDepth = clipPosition.z / clipPosition.w;
+
+    // Back into the body's frame through the transpose of its scaled rotation
+    vec3 bodyDirection = normalize(fragInstanceRows[0] * normal.x + fragInstanceRows[1] * normal.y + fragInstanceRows[2] * normal.z);
+
+    float u = atan(bodyDirection.z, bodyDirection.x) / (2.0 * PI) + 0.5;
+    float v = acos(clamp(bodyDirection.y, -1.0, 1.0)) / PI;
+
+    // u wraps around at the back of the sphere, take the gradients of whichever of u and its half turn is continuous here
+    float uShifted = fract(u + 0.5);
+    vec2 gradientX = vec2(abs(dFdx(u)) < abs(dFdx(uShifted)) ? dFdx(u) : dFdx(uShifted), dFdx(v));
+    vec2 gradientY = vec2(abs(dFdy(u)) < abs(dFdy(uShifted)) ? dFdy(u) : dFdy(uShifted), dFdy(v));
+
+    if (!isHit) {
+        discard;
+    }
+
+    outColor = vec4(textureGrad(textureSampler, vec2(u, v), gradientX, gradientY).rgb, 1.0);
+}
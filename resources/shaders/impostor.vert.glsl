@@ -0,0 +1,53 @@
+#version 460
+
+layout(set = 0, binding = 0) uniform UniformBufferObject
+{
+    mat4 model;
+    mat4 view;
+    mat4 projection;
+}ubo;
+
+// Instance-rate binding, each column holds a row of the instance's 3x4 world matrix (see instance_transforms.comp)
+layout(location = 3) in mat3x4 inInstanceTransform;
+
+layout(location = 0) out vec3 fragQuadPosition;
+layout(location = 1) flat out vec4 fragSphere;
+layout(location = 2) flat out vec3 fragCameraPosition;
+layout(location = 3) flat out vec3 fragInstanceRows[3];
+
+// Half the football model's diameter, instance_transforms.comp scales the model to the body's diameter
+const float MODEL_RADIUS = 0.115;
+
+// One camera-facing quad per body, drawn over Model::GetQuad(). The quad sits on the sphere's centre, perpendicular to the
+// direction to the camera, and is sized to cover the sphere's silhouette seen from there.
+void main()
+{
+    vec3 center = vec3(inInstanceTransform[0].w, inInstanceTransform[1].w, inInstanceTransform[2].w);
+    float scale = length(vec3(inInstanceTransform[0].x, inInstanceTransform[1].x, inInstanceTransform[2].x));
+    float radius = scale * MODEL_RADIUS;
+
+    vec3 cameraPosition = inverse(ubo.view * ubo.model)[3].xyz;
+    vec3 toCamera = cameraPosition - center;
+    float cameraDistance = length(toCamera);
+    vec3 forward = toCamera / cameraDistance;
+
+    vec3 up = abs(forward.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+    vec3 right = normalize(cross(up, forward));
+    up = cross(forward, right);
+
+    // Radius of the silhouette cone where it crosses the quad's plane, capped once the camera is about to enter the sphere
+    float silhouetteDistance = sqrt(max(cameraDistance * cameraDistance - radius * radius, 0.01 * radius * radius));
+    float halfSize = radius * cameraDistance / silhouetteDistance;
+
+    vec2 corner = vec2((gl_VertexIndex & 1) != 0 ? 1.0 : -1.0, (gl_VertexIndex & 2) != 0 ? 1.0 : -1.0);
+    vec3 quadPosition = center + (right * corner.x + up * corner.y) * halfSize;
+
+    gl_Position = ubo.projection * ubo.view * ubo.model * vec4(quadPosition, 1.0);
+
+    fragQuadPosition = quadPosition;
+    fragSphere = vec4(center, radius);
+    fragCameraPosition = cameraPosition;
+    for (int row = 0; row < 3; ++row) {
+        fragInstanceRows[row] = inInstanceTransform[row].xyz;
+    }
+}
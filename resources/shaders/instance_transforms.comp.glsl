@@ -0,0 +1,93 @@
+#version 460
+#include "physics_common.glsl"
+#include "occlusion_common.glsl"
+
+// Latest physics state, only the position and rotation streams are read
+layout(std430, binding = 2) readonly buffer PhysicsStreams {
+   vec4 streams[];
+};
+
+// This frame's occlusion candidates, bodies inside the frustum are packed at the front
+layout(std430, binding = 14) writeonly buffer CandidateTransforms {
+    InstanceTransform transforms[];
+};
+
+// OcclusionCuller::CandidateHeader, the dispatch of the early occlusion cull over the candidates.
+// Starts at {0, 1, 1, 0}.
+layout(std430, binding = 15) buffer CandidateHeader {
+    uint dispatchX;
+    uint dispatchY;
+    uint dispatchZ;
+    uint count;
+} candidates;
+
+layout(local_size_x_id = 0, local_size_y = 1, local_size_z = 1) in;
+
+// Diameter of the football model, bodies are drawn scaled to their own diameter
+const float MODEL_DIAMETER = 0.23;
+
+// Reimplementation of glm::toMat3()
+mat3 quatToMat3(vec4 quat) {
+    float quatXX = quat.x * quat.x;
+    float quatYY = quat.y * quat.y;
+    float quatZZ = quat.z * quat.z;
+
+    float quatXZ = quat.x * quat.z;
+    float quatXY = quat.x * quat.y;
+    float quatYZ = quat.y * quat.z;
+
+    float quatWX = quat.w * quat.x;
+    float quatWY = quat.w * quat.y;
+    float quatWZ = quat.w * quat.z;
+
+    mat3 resultMatrix;
+    resultMatrix[0][0] = 1.0 - 2.0 * (quatYY + quatZZ);
+    resultMatrix[0][1] = 2.0 * (quatXY + quatWZ);
+    resultMatrix[0][2] = 2.0 * (quatXZ - quatWY);
+
+    resultMatrix[1][0] = 2.0 * (quatXY - quatWZ);
+    resultMatrix[1][1] = 1.0 - 2.0 * (quatXX + quatZZ);
+    resultMatrix[1][2] = 2.0 * (quatYZ + quatWX);
+
+    resultMatrix[2][0] = 2.0 * (quatXZ + quatWY);
+    resultMatrix[2][1] = 2.0 * (quatYZ - quatWX);
+    resultMatrix[2][2] = 1.0 - 2.0 * (quatXX + quatYY);
+
+    return resultMatrix;
+}
+
+// The model is scaled to the body's diameter, so the body's own sphere bounds it
+bool isInFrustum(vec4 sphere) {
+    for (int plane = 0; plane < 6; ++plane) {
+        if (dot(ubo.frustumPlanes[plane].xyz, sphere.xyz) + ubo.frustumPlanes[plane].w < -sphere.w) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Builds the translate * scale * rotate model matrix of every body inside the camera frustum once per frame instead of once per vertex.
+// Sleeping bodies are included, each frame in flight has its own candidate buffer.
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= ubo.objectCount) {
+        return;
+    }
+
+    vec4 positionRadius = streams[streamIndex(PHYSICS_STREAM_POSITION_RADIUS, index)];
+    if (!isInFrustum(positionRadius)) {
+        return;
+    }
+
+    uint slot = atomicAdd(candidates.count, 1u);
+    atomicMax(candidates.dispatchX, slot / OCCLUSION_WORKGROUP_SIZE + 1u);
+    mat3 rotation = quatToMat3(streams[streamIndex(PHYSICS_STREAM_ROTATION, index)]);
+
+    // GLSL matrices are column-major, so row r of the scaled rotation is (m[0][r], m[1][r], m[2][r])
+    mat3 scaledRotation = rotation * ((positionRadius.w * 2.0) / MODEL_DIAMETER);
+
+    for (int row = 0; row < 3; ++row) {
+        transforms[slot].rows[row] = vec4(scaledRotation[0][row], scaledRotation[1][row], scaledRotation[2][row], positionRadius[row]);
+    }
+}
@@ -0,0 +1,13 @@
+// Shared declarations for the instance transform pass and the occlusion culling passes
+#ifndef OCCLUSION_COMMON_GLSL
+#define OCCLUSION_COMMON_GLSL
+
+// Must match OcclusionCuller::WORKGROUP_SIZE
+#define OCCLUSION_WORKGROUP_SIZE 64u
+
+// Rows of a 3x4 world matrix with the translation in w, matches Model::InstanceTransform
+struct InstanceTransform {
+    vec4 rows[3];
+};
+
+#endif
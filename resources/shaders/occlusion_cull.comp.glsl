@@ -0,0 +1,107 @@
+#version 460
+#include "occlusion_cull_common.glsl"
+
+// Farthest depth of each texel's footprint, see depth_pyramid_*.comp
+layout(set = 1, binding = 0) uniform sampler2D depthPyramid;
+
+layout(local_size_x = OCCLUSION_WORKGROUP_SIZE, local_size_y = 1, local_size_z = 1) in;
+
+// Projects the sphere's bounding box and compares its nearest depth against the farthest depth in the pyramid texels covering it.
+// The level is picked so the box covers at most 2x2 texels.
+bool isOccluded(vec3 center, float radius) {
+    vec2 uvMin = vec2(1.0);
+    vec2 uvMax = vec2(0.0);
+    float nearestDepth = 1.0;
+
+    for (uint corner = 0; corner < 8; ++corner) {
+        vec3 offset = vec3((corner & 1u) != 0u ? radius : -radius,
+                           (corner & 2u) != 0u ? radius : -radius,
+                           (corner & 4u) != 0u ? radius : -radius);
+        vec4 clip = parameters.viewProjection * vec4(center + offset, 1.0);
+
+        // Crossing the near plane, the projection is meaningless so keep it
+        if (clip.w <= 0.0) {
+            return false;
+        }
+
+        vec3 ndc = clip.xyz / clip.w;
+        vec2 uv = ndc.xy * 0.5 + 0.5;
+
+        uvMin = min(uvMin, uv);
+        uvMax = max(uvMax, uv);
+        nearestDepth = min(nearestDepth, ndc.z);
+    }
+
+    uvMin = clamp(uvMin, vec2(0.0), vec2(1.0));
+    uvMax = clamp(uvMax, vec2(0.0), vec2(1.0));
+
+    vec2 pixelSize = (uvMax - uvMin) * parameters.pyramidSize;
+    int level = int(ceil(log2(max(max(pixelSize.x, pixelSize.y), 1.0))));
+    level = clamp(level, 0, int(parameters.pyramidLevelCount) - 1);
+
+    ivec2 levelSize = textureSize(depthPyramid, level);
+    ivec2 texelMin = clamp(ivec2(uvMin * parameters.pyramidSize) >> level, ivec2(0), levelSize - 1);
+    ivec2 texelMax = clamp(ivec2(uvMax * parameters.pyramidSize) >> level, ivec2(0), levelSize - 1);
+
+    float farthestDepth = 0.0;
+    for (int y = texelMin.y; y <= texelMax.y; ++y) {
+        for (int x = texelMin.x; x <= texelMax.x; ++x) {
+            farthestDepth = max(farthestDepth, texelFetch(depthPyramid, ivec2(x, y), level).r);
+        }
+    }
+
+    return nearestDepth > farthestDepth;
+}
+
+// Coarsest LOD whose error stays under the allowed pixel error at the sphere's distance,
+// the full mesh when the camera is inside the sphere
+uint selectLod(vec3 center, float radius) {
+    float viewDepth = (parameters.viewProjection * vec4(center, 1.0)).w;
+    if (viewDepth <= radius) {
+        return 0u;
+    }
+
+    float projectedRadius = radius * parameters.lodScale / viewDepth;
+
+    uint lod = 0u;
+    while (lod + 1u < parameters.lodCount && parameters.lodErrors[lod + 1u] * projectedRadius <= 1.0) {
+        ++lod;
+    }
+
+    return lod;
+}
+
+// The early phase draws the candidates visible in the previous frame's pyramid and queues the rest for the late phase,
+// which draws those visible in the pyramid built from the early draw. Only the draw and slot of each candidate are recorded,
+// occlusion_scatter.comp copies the transforms once occlusion_draw_offsets.comp has placed every draw.
+void main() {
+    uint candidate;
+    if (!loadCandidate(candidate)) {
+        return;
+    }
+
+    InstanceTransform transform = candidateTransforms[candidate];
+
+    // The transform is a uniformly scaled rotation, any column's length is the scale
+    vec3 center = vec3(transform.rows[0].w, transform.rows[1].w, transform.rows[2].w);
+    float scale = length(vec3(transform.rows[0].x, transform.rows[1].x, transform.rows[2].x));
+
+    float radius = scale * parameters.boundingRadius;
+
+    if (parameters.isOcclusionEnabled != 0u && isOccluded(center, radius)) {
+        atomicAdd(rejectedCounts[parameters.phase], 1u);
+        drawSlots[candidate] = NOT_DRAWN;
+
+        if (parameters.phase == PHASE_EARLY) {
+            uint lateSlot = atomicAdd(lateCandidates.count, 1u);
+            atomicMax(lateCandidates.dispatchX, lateSlot / OCCLUSION_WORKGROUP_SIZE + 1u);
+            lateCandidates.indices[lateSlot] = candidate;
+        }
+
+        return;
+    }
+
+    uint drawIndex = parameters.phase * parameters.lodCount + selectLod(center, radius);
+    uint slot = atomicAdd(draws[drawIndex].instanceCount, 1u);
+    drawSlots[candidate] = drawIndex | (slot << DRAW_INDEX_BITS);
+}
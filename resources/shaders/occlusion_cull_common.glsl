@@ -0,0 +1,93 @@
+// Shared declarations of the occlusion cull, draw offsets and scatter passes, see OcclusionCuller
+#ifndef OCCLUSION_CULL_COMMON_GLSL
+#define OCCLUSION_CULL_COMMON_GLSL
+
+#include "occlusion_common.glsl"
+
+// Bodies inside the camera frustum, written by instance_transforms.comp
+layout(std430, set = 0, binding = 0) readonly buffer CandidateTransforms {
+    InstanceTransform candidateTransforms[];
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer CandidateHeader {
+    uint dispatchX;
+    uint dispatchY;
+    uint dispatchZ;
+    uint count;
+} candidates;
+
+// The model's instance-rate vertex buffer, instanceCapacity transforms shared by every draw.
+// Each draw reads its own range from its firstInstance.
+layout(std430, set = 0, binding = 2) writeonly buffer DrawTransforms {
+    InstanceTransform drawTransforms[];
+};
+
+// VkDrawIndexedIndirectCommand
+struct DrawCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+// One draw per LOD of each phase, instanceCount starts at zero
+layout(std430, set = 0, binding = 3) buffer DrawCommands {
+    DrawCommand draws[];
+};
+
+// Candidates rejected by the early phase, re-tested by the late phase.
+// The first three words double as the late phase's VkDispatchIndirectCommand.
+layout(std430, set = 0, binding = 4) buffer LateCandidates {
+    uint dispatchX;
+    uint dispatchY;
+    uint dispatchZ;
+    uint count;
+    uint indices[];
+} lateCandidates;
+
+layout(std430, set = 0, binding = 5) buffer RejectedCounters {
+    uint rejectedCounts[2];
+};
+
+// Per candidate, the draw it went to in the low DRAW_INDEX_BITS and its slot in that draw above them, or NOT_DRAWN
+layout(std430, set = 0, binding = 6) buffer DrawSlots {
+    uint drawSlots[];
+};
+
+layout(push_constant) uniform CullParameters {
+    mat4 viewProjection;
+    vec4 lodErrors; // Model::Lod::error of each LOD
+    vec2 pyramidSize;
+    uint pyramidLevelCount;
+    uint phase;
+    float boundingRadius;
+    uint isOcclusionEnabled;
+    uint lodCount;
+    float lodScale;
+} parameters;
+
+const uint PHASE_EARLY = 0u;
+const uint PHASE_LATE = 1u;
+
+// Enough for every LOD of both phases, the slot is below Application::MAX_PHYSICS_OBJECT_COUNT
+const uint DRAW_INDEX_BITS = 4u;
+const uint DRAW_INDEX_MASK = (1u << DRAW_INDEX_BITS) - 1u;
+const uint NOT_DRAWN = 0xFFFFFFFFu;
+
+// The early phase runs over every candidate, the late phase over the early rejects
+bool loadCandidate(out uint candidate) {
+    if (parameters.phase == PHASE_EARLY) {
+        candidate = gl_GlobalInvocationID.x;
+        return gl_GlobalInvocationID.x < candidates.count;
+    }
+
+    if (gl_GlobalInvocationID.x >= lateCandidates.count) {
+        candidate = 0u;
+        return false;
+    }
+    candidate = lateCandidates.indices[gl_GlobalInvocationID.x];
+    return true;
+}
+
+#endif
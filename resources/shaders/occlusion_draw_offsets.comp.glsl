@@ -0,0 +1,20 @@
+#version 460
+#include "occlusion_cull_common.glsl"
+
+layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
+
+// Places this phase's draws back to back in the instance buffer, after every draw of the phases before it.
+// A candidate is drawn by at most one phase, so all of them fit in instanceCapacity transforms.
+void main() {
+    uint phaseFirstDraw = parameters.phase * parameters.lodCount;
+
+    uint firstInstance = 0u;
+    for (uint drawIndex = 0u; drawIndex < phaseFirstDraw; ++drawIndex) {
+        firstInstance += draws[drawIndex].instanceCount;
+    }
+
+    for (uint lod = 0u; lod < parameters.lodCount; ++lod) {
+        draws[phaseFirstDraw + lod].firstInstance = firstInstance;
+        firstInstance += draws[phaseFirstDraw + lod].instanceCount;
+    }
+}
@@ -0,0 +1,21 @@
+#version 460
+#include "occlusion_cull_common.glsl"
+
+layout(local_size_x = OCCLUSION_WORKGROUP_SIZE, local_size_y = 1, local_size_z = 1) in;
+
+// Copies every candidate this phase drew into its draw's range of the instance buffer, over the same list as the cull
+void main() {
+    uint candidate;
+    if (!loadCandidate(candidate)) {
+        return;
+    }
+
+    uint drawSlot = drawSlots[candidate];
+    if (drawSlot == NOT_DRAWN) {
+        return;
+    }
+
+    uint drawIndex = drawSlot & DRAW_INDEX_MASK;
+    uint slot = drawSlot >> DRAW_INDEX_BITS;
+    drawTransforms[draws[drawIndex].firstInstance + slot] = candidateTransforms[candidate];
+}
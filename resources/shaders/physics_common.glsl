@@ -0,0 +1,57 @@
+// Shared declarations for the physics compute passes
+#ifndef PHYSICS_COMMON_GLSL
+#define PHYSICS_COMMON_GLSL
+
+#include "physics_layout.h"
+
+// Workgroup size of the per-body passes, specialised at pipeline creation (see Application::createWorkgroupPipelines())
+layout(constant_id = 0) const uint PHYSICS_WORKGROUP_SIZE = 32u;
+
+layout(binding = 0) uniform ParameterUBO {
+    float physicsTimeStep;
+    float gridCellSize;
+    uint gridHashSize; // Always a power of two
+    uint objectCount;
+    uint contactCapacity;
+    float sleepVelocity;
+    uint sleepStepCount;
+    uint isGridBinned; // Zero with the linear BVH broadphase, which never reads the grid cells
+    vec4 frustumPlanes[6]; // xyz inward normal, w distance
+} ubo;
+
+layout(std430, binding = 12) readonly buffer PhysicsMaterials {
+    PhysicsMaterial materials[];
+};
+
+// Awake bodies of this step, filled by compact_active_bodies.comp.
+// The first three words double as the VkDispatchIndirectCommand of the per-body passes that follow it.
+layout(std430, binding = 13) buffer ActiveBodies {
+    uint dispatchX;
+    uint dispatchY;
+    uint dispatchZ;
+    uint count;
+    uint bodies[];
+} activeSet;
+
+// Index of a body's entry in one of the physics buffer streams
+uint streamIndex(uint stream, uint body) {
+    return PHYSICS_STREAM_INDEX(stream, body, ubo.objectCount);
+}
+
+// Takes a velocity stream entry, bodies that stayed slow for ubo.sleepStepCount steps are left out of the active set
+bool isSleeping(vec4 velocity) {
+    return velocity.w >= float(ubo.sleepStepCount);
+}
+
+// Integer coordinates of the grid cell containing a point
+ivec3 gridCell(vec3 position) {
+    return ivec3(floor(position / ubo.gridCellSize));
+}
+
+// Spatial hash (Teschner et al.) folded into the hash table, the grid itself is unbounded
+uint gridHash(ivec3 cell) {
+    uint hash = (uint(cell.x) * 73856093u) ^ (uint(cell.y) * 19349663u) ^ (uint(cell.z) * 83492791u);
+    return hash & (ubo.gridHashSize - 1u);
+}
+
+#endif
@@ -0,0 +1,29 @@
+#version 460
+
+#include "prefix_sum_common.glsl"
+
+// Third pass: every block scans its values again, offset by the prefix of the block totals
+void main() {
+    uint thread = gl_LocalInvocationID.x;
+    uint first = gl_WorkGroupID.x * PREFIX_SUM_BLOCK_SIZE + thread * PREFIX_SUM_VALUES_PER_THREAD;
+
+    uint threadValues[PREFIX_SUM_VALUES_PER_THREAD];
+    uint threadSum = 0u;
+    for (uint i = 0u; i < PREFIX_SUM_VALUES_PER_THREAD; ++i) {
+        uint index = first + i;
+        threadValues[i] = (index < parameters.count) ? values[index] : 0u;
+        threadSum += threadValues[i];
+    }
+
+    threadSums[thread] = threadSum;
+    scanThreadSums(thread);
+
+    uint runningSum = blockSums[gl_WorkGroupID.x] + ((thread > 0u) ? threadSums[thread - 1u] : 0u);
+    for (uint i = 0u; i < PREFIX_SUM_VALUES_PER_THREAD; ++i) {
+        uint index = first + i;
+        if (index < parameters.count) {
+            prefixSums[index] = runningSum;
+        }
+        runningSum += threadValues[i];
+    }
+}
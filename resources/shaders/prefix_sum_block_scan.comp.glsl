@@ -0,0 +1,30 @@
+#version 460
+
+#include "prefix_sum_common.glsl"
+
+// Second pass, a single workgroup: exclusive prefix sum of the block totals in place.
+// There are a thousand times fewer blocks than values, so every thread walks a short chunk of them.
+void main() {
+    uint thread = gl_LocalInvocationID.x;
+    uint blockCount = getBlockCount();
+
+    uint chunkSize = (blockCount + gl_WorkGroupSize.x - 1u) / gl_WorkGroupSize.x;
+    uint chunkBegin = min(thread * chunkSize, blockCount);
+    uint chunkEnd = min(chunkBegin + chunkSize, blockCount);
+
+    uint chunkSum = 0u;
+    for (uint i = chunkBegin; i < chunkEnd; ++i) {
+        chunkSum += blockSums[i];
+    }
+
+    threadSums[thread] = chunkSum;
+    scanThreadSums(thread);
+
+    // Every thread only rewrites its own chunk, which it has already read
+    uint runningSum = (thread > 0u) ? threadSums[thread - 1u] : 0u;
+    for (uint i = chunkBegin; i < chunkEnd; ++i) {
+        uint blockSum = blockSums[i];
+        blockSums[i] = runningSum;
+        runningSum += blockSum;
+    }
+}
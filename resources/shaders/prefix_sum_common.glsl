@@ -0,0 +1,45 @@
+// Shared declarations for the three passes of the multi-workgroup exclusive prefix sum, see include/prefix_sum.hpp
+#ifndef PREFIX_SUM_COMMON_GLSL
+#define PREFIX_SUM_COMMON_GLSL
+
+// Every workgroup covers a block of PREFIX_SUM_BLOCK_SIZE values, each thread a contiguous run of four of them
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+const uint PREFIX_SUM_VALUES_PER_THREAD = 4u;
+const uint PREFIX_SUM_BLOCK_SIZE = 256u * PREFIX_SUM_VALUES_PER_THREAD;
+
+layout(push_constant) uniform ScanParameters {
+    uint count;
+} parameters;
+
+layout(std430, binding = 0) readonly buffer ScanInput {
+   uint values[];
+};
+
+layout(std430, binding = 1) writeonly buffer ScanOutput {
+   uint prefixSums[];
+};
+
+// One total per block, turned into the block's start offset by prefix_sum_block_scan.comp
+layout(std430, binding = 2) buffer ScanBlockSums {
+   uint blockSums[];
+};
+
+shared uint threadSums[gl_WorkGroupSize.x];
+
+uint getBlockCount() {
+    return (parameters.count + PREFIX_SUM_BLOCK_SIZE - 1u) / PREFIX_SUM_BLOCK_SIZE;
+}
+
+// Inclusive Hillis-Steele scan of threadSums across the workgroup
+void scanThreadSums(uint thread) {
+    barrier();
+    for (uint offset = 1u; offset < gl_WorkGroupSize.x; offset <<= 1u) {
+        uint addend = (thread >= offset) ? threadSums[thread - offset] : 0u;
+        barrier();
+        threadSums[thread] += addend;
+        barrier();
+    }
+}
+
+#endif
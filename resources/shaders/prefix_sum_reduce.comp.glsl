@@ -0,0 +1,29 @@
+#version 460
+
+#include "prefix_sum_common.glsl"
+
+// First pass: the total of every block
+void main() {
+    uint thread = gl_LocalInvocationID.x;
+    uint first = gl_WorkGroupID.x * PREFIX_SUM_BLOCK_SIZE + thread * PREFIX_SUM_VALUES_PER_THREAD;
+
+    uint threadSum = 0u;
+    for (uint i = 0u; i < PREFIX_SUM_VALUES_PER_THREAD; ++i) {
+        uint index = first + i;
+        threadSum += (index < parameters.count) ? values[index] : 0u;
+    }
+
+    threadSums[thread] = threadSum;
+    barrier();
+
+    for (uint stride = gl_WorkGroupSize.x / 2u; stride > 0u; stride >>= 1u) {
+        if (thread < stride) {
+            threadSums[thread] += threadSums[thread + stride];
+        }
+        barrier();
+    }
+
+    if (thread == 0u) {
+        blockSums[gl_WorkGroupID.x] = threadSums[0];
+    }
+}
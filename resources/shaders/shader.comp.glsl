@@ -1,123 +1,73 @@
 #version 460
+#include "physics_common.glsl"
 
-struct PhysicsObject {
-    vec3 position;
-    vec4 rotation;
-    vec3 velocity;
-    vec3 angularVelocity;
-    float radius;
-    float mass;
-    float elasticity;
-    float momentOfInertia;
+layout(std430, binding = 1) readonly buffer PhysicsStreamsIn {
+   vec4 streamsIn[];
 };
 
-layout(binding = 0) uniform ParameterUBO {
-    float physicsTimeStep;
-} ubo;
+layout(std430, binding = 2) writeonly buffer PhysicsStreamsOut {
+   vec4 streamsOut[];
+};
 
-layout(std140, binding = 1) readonly buffer PhysicsObjectSSBOIn {
-   PhysicsObject objectsIn[];
+layout(std430, binding = 3) buffer GridCellCounts {
+   uint cellCounts[];
 };
 
-layout(std140, binding = 2) buffer PhysicsObjectSSBOOut {
-   PhysicsObject objectsOut[];
+layout(std430, binding = 6) writeonly buffer GridBodyCells {
+   uint bodyCells[];
 };
 
-layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+layout(local_size_x_id = 0, local_size_y = 1, local_size_z = 1) in;
 
-bool isCollidingSphereWithPlane(inout PhysicsObject sphere) {
-    if ((sphere.position.y - sphere.radius) <= 0.0) {
+bool isCollidingSphereWithPlane(vec3 position, float radius) {
+    if ((position.y - radius) <= 0.0) {
         return true;
     }
 
     return false;
 }
 
-bool isCollidingSphereWithSphere(inout PhysicsObject sphereOne, inout PhysicsObject sphereTwo) {
-    // Squaring radii to avoid calling sqrt()
-    float sumRadiiSquared = (sphereOne.radius + sphereTwo.radius) * (sphereOne.radius + sphereTwo.radius);
-    float distanceSquared = (sphereTwo.position.x - sphereOne.position.x) * (sphereTwo.position.x - sphereOne.position.x)
-                          + (sphereTwo.position.y - sphereOne.position.y) * (sphereTwo.position.y - sphereOne.position.y)
-                          + (sphereTwo.position.z - sphereOne.position.z) * (sphereTwo.position.z - sphereOne.position.z);
-
-    return distanceSquared <= sumRadiiSquared;
-}
-
-void resolveCollisionSphereWithPlane(inout PhysicsObject sphere) {
+void resolveCollisionSphereWithPlane(inout vec3 position, inout vec3 velocity, float radius, float elasticity) {
     const float planeFrictionCoefficient = 0.5;
 
-    sphere.velocity.y = -sphere.velocity.y * sphere.elasticity;
-    sphere.position.y = 0.0 + sphere.radius;
+    velocity.y = -velocity.y * elasticity;
+    position.y = 0.0 + radius;
 
-    vec3 tangentialVelocity = vec3(sphere.velocity.x, 0.0, sphere.velocity.z);
+    vec3 tangentialVelocity = vec3(velocity.x, 0.0, velocity.z);
     vec3 frictionImpulse = -planeFrictionCoefficient * tangentialVelocity;
 
-    sphere.velocity += frictionImpulse;
+    velocity += frictionImpulse;
 }
 
-void resolveCollisionSphereWithSphere(inout PhysicsObject sphereOne, inout PhysicsObject sphereTwo) {
-    vec3 normalDirection = sphereOne.position - sphereTwo.position;
-    vec3 normalizedNormalDirection = normalize(normalDirection);
-
-    float separationDistance = length(normalDirection);
-    float overlap = (sphereOne.radius + sphereTwo.radius) - separationDistance;
-
-    // Separate spheres to avoid overlap with a positional correction factor
-    const float percent = 0.2; // Positional correction factor (20%)
-    const float slop = 0.00001;   // Allowable penetration
-    vec3 correction = max(overlap - slop, 0.0) / (1.0 / sphereOne.mass + 1.0 / sphereTwo.mass) * percent * normalizedNormalDirection;
-
-    sphereOne.position += correction * (1.0 / sphereOne.mass);
-    sphereTwo.position -= correction * (1.0 / sphereTwo.mass);
-
-    // Calculate relative velocity
-    vec3 relativeVelocity = sphereOne.velocity - sphereTwo.velocity;
-
-    // Calculate velocity along normal
-    float velocityAlongNormal = dot(relativeVelocity, normalizedNormalDirection);
+void main() {
+    const vec3 gravity = vec3(0.0, -9.81, 0.0);
 
-    // If spheres are moving apart, no need to resolve the collision
-    if (velocityAlongNormal > 0.0) {
+    // Only awake bodies are integrated, sleeping ones were carried over by the compaction pass
+    if (gl_GlobalInvocationID.x >= activeSet.count) {
         return;
     }
+    uint index = activeSet.bodies[gl_GlobalInvocationID.x];
 
-    // Calculate combined Coefficient of Restitution
-    float e = min(sphereOne.elasticity, sphereTwo.elasticity);
-
-    // Calculate impulse scalar
-    float j = -(1.0 + e) * velocityAlongNormal;
-    j /= (1.0 / sphereOne.mass) + (1.0 / sphereTwo.mass);
-
-    // Apply impulse to spheres
-    vec3 impulse = j * normalizedNormalDirection;
-    sphereOne.velocity += impulse / sphereOne.mass;
-    sphereTwo.velocity -= impulse / sphereTwo.mass;
-}
-
-void main() {
-    const vec3 gravity = vec3(0.0, -9.81, 0.0);
-
-    uint index = gl_GlobalInvocationID.x;
-    PhysicsObject objectIn = objectsIn[index];
+    vec4 positionRadius = streamsIn[streamIndex(PHYSICS_STREAM_POSITION_RADIUS, index)];
+    float radius = positionRadius.w;
 
-    objectsOut[index].velocity = objectIn.velocity + gravity * ubo.physicsTimeStep;
-    objectsOut[index].position = objectIn.position + objectsOut[index].velocity * ubo.physicsTimeStep;
-    objectsOut[index].rotation = objectIn.rotation;
-    objectsOut[index].angularVelocity = objectIn.angularVelocity;
-    objectsOut[index].radius = objectIn.radius;
-    objectsOut[index].mass = objectIn.mass;
-    objectsOut[index].elasticity = objectIn.elasticity;
-    objectsOut[index].momentOfInertia = objectIn.momentOfInertia;
+    vec4 velocityIn = streamsIn[streamIndex(PHYSICS_STREAM_VELOCITY, index)];
+    vec3 velocity = velocityIn.xyz + gravity * ubo.physicsTimeStep;
+    vec3 position = positionRadius.xyz + velocity * ubo.physicsTimeStep;
 
-    if (isCollidingSphereWithPlane(objectsOut[index])) {
-        resolveCollisionSphereWithPlane(objectsOut[index]);
+    if (isCollidingSphereWithPlane(position, radius)) {
+        resolveCollisionSphereWithPlane(position, velocity, radius, materials[index].elasticity);
     }
 
-    for (uint i = 0; i < objectsIn.length(); ++i) {
-        if (i != index) {
-            if (isCollidingSphereWithSphere(objectsOut[index], objectsOut[i])) {
-                resolveCollisionSphereWithSphere(objectsOut[index], objectsOut[i]);
-            }
-        }
+    streamsOut[streamIndex(PHYSICS_STREAM_POSITION_RADIUS, index)] = vec4(position, radius);
+    streamsOut[streamIndex(PHYSICS_STREAM_VELOCITY, index)] = vec4(velocity, velocityIn.w);
+    streamsOut[streamIndex(PHYSICS_STREAM_ROTATION, index)] = streamsIn[streamIndex(PHYSICS_STREAM_ROTATION, index)];
+    streamsOut[streamIndex(PHYSICS_STREAM_ANGULAR_VELOCITY, index)] = streamsIn[streamIndex(PHYSICS_STREAM_ANGULAR_VELOCITY, index)];
+
+    // Broadphase: bin the integrated body into its grid cell
+    if (ubo.isGridBinned != 0u) {
+        uint cellHash = gridHash(gridCell(position));
+        bodyCells[index] = cellHash;
+        atomicAdd(cellCounts[cellHash], 1u);
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,71 @@
+#version 460
+#include "physics_common.glsl"
+#include "contact_common.glsl"
+
+layout(std430, binding = 1) readonly buffer PhysicsStreamsIn {
+   vec4 streamsIn[];
+};
+
+layout(std430, binding = 2) readonly buffer PhysicsStreamsOut {
+   vec4 streamsOut[];
+};
+
+layout(local_size_x = CONTACT_WORKGROUP_SIZE, local_size_y = 1, local_size_z = 1) in;
+
+// Keeps the fixed point sums in range however many contacts the body is in, see CONTACT_MAX_PER_BODY
+void addBodyDelta(uint body, vec3 velocityDelta, vec3 positionDelta) {
+    if (atomicAdd(bodyDeltas[body].velocity.w, 1) >= CONTACT_MAX_PER_BODY) {
+        return;
+    }
+
+    ivec4 velocityFixed = toFixedPoint(velocityDelta);
+    ivec4 positionFixed = toFixedPoint(positionDelta);
+
+    atomicAdd(bodyDeltas[body].velocity.x, velocityFixed.x);
+    atomicAdd(bodyDeltas[body].velocity.y, velocityFixed.y);
+    atomicAdd(bodyDeltas[body].velocity.z, velocityFixed.z);
+    atomicAdd(bodyDeltas[body].position.x, positionFixed.x);
+    atomicAdd(bodyDeltas[body].position.y, positionFixed.y);
+    atomicAdd(bodyDeltas[body].position.z, positionFixed.z);
+}
+
+// One thread per contact, every contact sees the body state from before the solve (Jacobi style)
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= min(contactHeader.contactCount, ubo.contactCapacity)) {
+        return;
+    }
+
+    Contact contact = contacts[index];
+    PhysicsMaterial materialOne = materials[contact.bodyA];
+    PhysicsMaterial materialTwo = materials[contact.bodyB];
+
+    // Bodies that started the step asleep don't receive deltas, so they act as immovable for this step
+    float inverseMassOne = isSleeping(streamsIn[streamIndex(PHYSICS_STREAM_VELOCITY, contact.bodyA)]) ? 0.0 : materialOne.inverseMass;
+    float inverseMassTwo = isSleeping(streamsIn[streamIndex(PHYSICS_STREAM_VELOCITY, contact.bodyB)]) ? 0.0 : materialTwo.inverseMass;
+
+    // Separate spheres to avoid overlap with a positional correction factor
+    const float percent = 0.2; // Positional correction factor (20%)
+    const float slop = 0.00001;   // Allowable penetration
+    vec3 correction = max(contact.depth - slop, 0.0) / (inverseMassOne + inverseMassTwo) * percent * contact.normal;
+
+    vec3 impulse = vec3(0.0);
+
+    // Calculate velocity along normal, spheres already moving apart get no impulse
+    vec3 velocityOne = streamsOut[streamIndex(PHYSICS_STREAM_VELOCITY, contact.bodyA)].xyz;
+    vec3 velocityTwo = streamsOut[streamIndex(PHYSICS_STREAM_VELOCITY, contact.bodyB)].xyz;
+    float velocityAlongNormal = dot(velocityOne - velocityTwo, contact.normal);
+    if (velocityAlongNormal <= 0.0) {
+        // Calculate combined Coefficient of Restitution
+        float e = min(materialOne.elasticity, materialTwo.elasticity);
+
+        // Calculate impulse scalar
+        float j = -(1.0 + e) * velocityAlongNormal;
+        j /= inverseMassOne + inverseMassTwo;
+
+        impulse = j * contact.normal;
+    }
+
+    addBodyDelta(contact.bodyA, impulse * inverseMassOne, correction * inverseMassOne);
+    addBodyDelta(contact.bodyB, -impulse * inverseMassTwo, -correction * inverseMassTwo);
+}
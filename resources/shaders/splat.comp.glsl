@@ -0,0 +1,95 @@
+#version 460
+#extension GL_ARB_gpu_shader_int64 : require
+#extension GL_EXT_shader_atomic_int64 : require
+#include "occlusion_common.glsl"
+
+// Bodies inside the camera frustum, written by instance_transforms.comp
+layout(std430, set = 0, binding = 0) readonly buffer CandidateTransforms {
+    InstanceTransform candidateTransforms[];
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer CandidateHeader {
+    uint dispatchX;
+    uint dispatchY;
+    uint dispatchZ;
+    uint count;
+} candidates;
+
+// One word per pixel: depth bits in the high half and RGBA8 in the low half, so atomicMin() keeps the nearest splat's colour.
+// Cleared to all ones, which no splat can write.
+layout(std430, set = 1, binding = 0) buffer SplatTarget {
+    uint64_t pixels[];
+};
+
+layout(push_constant) uniform PushConstants {
+    mat4 viewProjection;
+    vec2 targetSize;
+    // Pixels covered by a unit of world size at unit view depth
+    float pixelScale;
+    // Device depth of a point is depthOffset + depthScale / its view depth
+    float depthOffset;
+    float depthScale;
+    float boundingRadius;
+} pc;
+
+// Larger spheres are clamped to this footprint, the mesh and impostor modes are the better fit for them
+const float MAX_SPLAT_RADIUS = 16.0;
+
+const vec3 SPLAT_COLOUR = vec3(0.9);
+const vec3 LIGHT_DIRECTION = vec3(-0.4, 0.6, 0.7); // Screen space, towards the camera
+
+layout(local_size_x = OCCLUSION_WORKGROUP_SIZE) in;
+
+void splatPixel(ivec2 pixel, float depth, vec4 colour) {
+    if (any(lessThan(pixel, ivec2(0))) || any(greaterThanEqual(pixel, ivec2(pc.targetSize))) || depth < 0.0 || depth > 1.0) {
+        return;
+    }
+
+    uint64_t packed = (uint64_t(floatBitsToUint(depth)) << 32) | uint64_t(packUnorm4x8(colour));
+    atomicMin(pixels[pixel.y * int(pc.targetSize.x) + pixel.x], packed);
+}
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= candidates.count) {
+        return;
+    }
+
+    InstanceTransform transform = candidateTransforms[index];
+    vec3 center = vec3(transform.rows[0].w, transform.rows[1].w, transform.rows[2].w);
+    float radius = length(transform.rows[0].xyz) * pc.boundingRadius;
+
+    vec4 clip = pc.viewProjection * vec4(center, 1.0);
+    if (clip.w <= radius) {
+        return;
+    }
+
+    vec2 screenCenter = (clip.xy / clip.w * 0.5 + 0.5) * pc.targetSize;
+    float screenRadius = min(radius * pc.pixelScale / clip.w, MAX_SPLAT_RADIUS);
+
+    // Sub-pixel spheres land on the pixel holding their centre
+    if (screenRadius < 0.5) {
+        vec3 shade = SPLAT_COLOUR * (0.35 + 0.65 * normalize(LIGHT_DIRECTION).z);
+        splatPixel(ivec2(screenCenter), pc.depthOffset + pc.depthScale / (clip.w - radius), vec4(shade, 1.0));
+        return;
+    }
+
+    ivec2 minPixel = ivec2(floor(screenCenter - screenRadius));
+    ivec2 maxPixel = ivec2(ceil(screenCenter + screenRadius));
+    for (int y = minPixel.y; y <= maxPixel.y; y++) {
+        for (int x = minPixel.x; x <= maxPixel.x; x++) {
+            vec2 offset = (vec2(x, y) + 0.5 - screenCenter) / screenRadius;
+            float distanceSquared = dot(offset, offset);
+            if (distanceSquared > 1.0) {
+                continue;
+            }
+
+            // Front of the sphere under the pixel, screen y points down
+            float height = sqrt(1.0 - distanceSquared);
+            vec3 normal = vec3(offset.x, -offset.y, height);
+            vec3 shade = SPLAT_COLOUR * (0.35 + 0.65 * max(dot(normal, normalize(LIGHT_DIRECTION)), 0.0));
+
+            splatPixel(ivec2(x, y), pc.depthOffset + pc.depthScale / (clip.w - radius * height), vec4(shade, 1.0));
+        }
+    }
+}
@@ -0,0 +1,25 @@
+#version 460
+
+// splat.comp's target read as (colour, depth) word pairs, which needs no 64-bit support in the fragment stage
+layout(std430, set = 0, binding = 0) readonly buffer SplatTarget {
+    uvec2 pixels[];
+};
+
+layout(push_constant) uniform PushConstants {
+    uint targetWidth;
+} pc;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    uvec2 pixel = uvec2(gl_FragCoord.xy);
+    uvec2 packed = pixels[pixel.y * pc.targetWidth + pixel.x];
+
+    // Still cleared, no splat covers the pixel
+    if (packed.y == 0xFFFFFFFFu) {
+        discard;
+    }
+
+    outColor = unpackUnorm4x8(packed.x);
+    gl_FragDepth = uintBitsToFloat(packed.y);
+}
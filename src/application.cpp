@@ -7,11 +7,99 @@ void Application::Run()
     shutdown();
 }
 
+void Application::SetPhysicsObjectCount(uint32_t objectCount)
+{
+    if (objectCount > MAX_PHYSICS_OBJECT_COUNT)
+    {
+        throw std::invalid_argument("At most " + std::to_string(MAX_PHYSICS_OBJECT_COUNT) + " physics objects are supported!");
+    }
+
+    physicsObjectCount = std::max(objectCount, MIN_PHYSICS_OBJECT_COUNT);
+    requestedPhysicsObjectCount = physicsObjectCount;
+}
+
+void Application::EnableWorkgroupAutotune()
+{
+    isWorkgroupAutotuneEnabled = true;
+}
+
+void Application::SetPhysicsRate(float stepsPerSecond)
+{
+    physicsTimeStep = 1.0f / std::max(stepsPerSecond, 1.0f);
+}
+
+void Application::SetMaxPhysicsSubsteps(uint32_t substepCount)
+{
+    maxPhysicsSubsteps = std::clamp(substepCount, 1u, MAX_PHYSICS_SUBSTEPS);
+}
+
+void Application::SetFramesInFlight(uint32_t frameCount)
+{
+    framesInFlight = std::max(frameCount, 1u);
+}
+
+void Application::SetComputeWorkgroupSize(uint32_t size)
+{
+    requestedWorkgroupSize = size;
+}
+
+void Application::SetMSAASampleCount(uint32_t sampleCount)
+{
+    requestedMSAASampleCount = std::max(sampleCount, 1u);
+}
+
+void Application::UseLinearBVHBroadphase()
+{
+    broadphaseMode = BroadphaseMode::eLinearBVH;
+}
+
+void Application::EnableHeadless()
+{
+    isHeadless = true;
+}
+
+void Application::SetBenchmarkFrameCount(uint32_t frameCount)
+{
+    benchmarkFrameCount = std::max(frameCount, 1u);
+    benchmarkDuration = 0.0f;
+}
+
+void Application::SetBenchmarkDuration(float simulatedSeconds)
+{
+    benchmarkDuration = std::max(simulatedSeconds, 0.0f);
+}
+
+void Application::SetBenchmarkWarmupFrameCount(uint32_t frameCount)
+{
+    benchmarkWarmupFrameCount = frameCount;
+}
+
+void Application::SetBenchmarkResultsPath(const std::string &path)
+{
+    benchmarkResultsPath = path;
+}
+
+void Application::SetCacheDirectory(const std::filesystem::path &directory)
+{
+    cacheDirectory = directory;
+}
+
 void Application::init()
 {
-    initWindow();
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    if (!isHeadless)
+    {
+        initWindow();
+    }
     initVulkan();
-    initImGui();
+    if (!isHeadless)
+    {
+        initImGui();
+    }
+
+    float startupTimeMS = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+    std::cout << "Started in " << startupTimeMS << " ms with a " << (isPipelineCacheWarm ? "warm" : "cold") << " pipeline cache" << std::endl;
 }
 
 void Application::initWindow()
@@ -28,34 +116,74 @@ void Application::initVulkan()
 {
     createVulkanInstance();
     setupDebugMessenger();
-    createSurface();
+    if (!isHeadless)
+    {
+        createSurface();
+        logicalDeviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
     pickPhysicalDevice();
+
+    maxPhysicsObjectCount = getMaxPhysicsObjectCount();
+    if (physicsObjectCount > maxPhysicsObjectCount)
+    {
+        throw std::runtime_error(std::to_string(physicsObjectCount) + " physics objects don't fit this device, at most " + std::to_string(maxPhysicsObjectCount) + " do!");
+    }
+
     createLogicalDevice();
+    memoryAllocator.Create(physicalDevice);
+    startAssetLoads();
+    loadComputeWorkgroupCache();
+    createPipelineCache();
     createTimeStampQueryPool();
     createSwapChain();
     createImageViews();
     createRenderPass();
 
+    auto pipelineStartTime = std::chrono::high_resolution_clock::now();
+
     createGraphicsDescriptorSetLayout();
     createGraphicsPipeline();
     createComputeDescriptorSetLayout();
     createComputePipeline();
+    occlusionCuller.Create(physicalDevice, logicalDevice, pipelineCache);
+    if (isSplatRenderingSupported)
+    {
+        splatRenderer.Create(logicalDevice, pipelineCache, renderPass, msaaSamples);
+    }
+
+    float pipelineTimeMS = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - pipelineStartTime).count();
+    std::cout << "Created the render and physics pipelines in " << pipelineTimeMS << " ms" << std::endl;
 
     createCommandPool();
+    createStagingRings();
 
     createColorResources();
     createDepthResources();
     createFramebuffers();
+    createDepthPyramid();
+    createSplatTarget();
 
-    createTextureImage(TEXTURE_PATH.c_str());
-    createTextureImageView();
+    createPlaceholderTexture();
     createTextureSampler();
 
-    footballModel.Load(MODEL_PATH.c_str(), physicalDevice, logicalDevice, graphicsQueue, commandPool);
+    // The instance buffers and culling resources are sized by the model's LODs, so only its parsing is waited for here.
+    // The mesh itself streams in on the transfer queue, see updateStreamedAssets().
+    modelLoad.get();
+    footballModel.UploadMesh(memoryAllocator, logicalDevice, transferStagingRing, transferQueueFamily, graphicsQueueFamily);
+    modelUploadValue = transferStagingRing.Flush();
+
+    // One instance transform buffer per frame in flight, with a region and indirect draw per LOD of each occlusion culling phase
+    footballModel.CreateInstanceBuffers(physicsObjectCount, OcclusionCuller::ePhaseCount, framesInFlight, memoryAllocator, logicalDevice);
 
     createComputeCommandPool();
 
-    createShaderStorageBuffers();
+    createPhysicsResources();
+
+    // Every upload above was recorded into one batch per queue. Neither is waited for: each batch ends with a barrier
+    // ordering it before the first frame's submissions on the same queue.
+    graphicsStagingRing.Flush();
+    computeStagingRing.Flush();
+    std::cout << "Submitted the startup uploads in " << graphicsStagingRing.GetSubmittedBatchCount() + computeStagingRing.GetSubmittedBatchCount() + transferStagingRing.GetSubmittedBatchCount() << " batches" << std::endl;
 
     createUniformBuffers();
     createComputeUniformBuffers();
@@ -66,14 +194,29 @@ void Application::initVulkan()
     createCommandBuffers();
     createComputeCommandBuffers();
     createSyncObjects();
+
+    if (isWorkgroupAutotuneEnabled)
+    {
+        autotuneComputeWorkgroup();
+    }
 }
 
 void Application::update()
 {
-    while (!glfwWindowShouldClose(window))
+    // Time spent initialising isn't simulated
+    lastFrameTime = std::chrono::high_resolution_clock::now();
+
+    if (isHeadless)
     {
-        glfwPollEvents();
-        drawFrame();
+        runBenchmark();
+    }
+    else
+    {
+        while (!glfwWindowShouldClose(window))
+        {
+            glfwPollEvents();
+            drawFrame();
+        }
     }
 
     logicalDevice.waitIdle();
@@ -81,32 +224,48 @@ void Application::update()
 
 void Application::shutdown()
 {
+    // A texture still being read is dropped along with its future
+    assetLoader.Destroy();
+
     if (enableValidationLayers)
     {
         DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
     }
 
-    cleanupImGui();
+    if (!isHeadless)
+    {
+        cleanupImGui();
+    }
 
     cleanupSwapChain();
 
     logicalDevice.destroyQueryPool(queryPool);
 
     logicalDevice.destroyPipeline(graphicsPipeline);
+    logicalDevice.destroyPipeline(impostorPipeline);
     logicalDevice.destroyPipelineLayout(graphicsPipelineLayout);
 
-    logicalDevice.destroyPipeline(computePipeline);
+    destroyWorkgroupPipelines();
+    logicalDevice.destroyPipeline(contactDispatchPipeline);
+    logicalDevice.destroyPipeline(solveContactsPipeline);
     logicalDevice.destroyPipelineLayout(computePipelineLayout);
 
+    occlusionCuller.Destroy(logicalDevice);
+    if (isSplatRenderingSupported)
+    {
+        splatRenderer.Destroy(logicalDevice);
+    }
+
     logicalDevice.destroyRenderPass(renderPass);
+    logicalDevice.destroyRenderPass(lateRenderPass);
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (size_t i = 0; i < framesInFlight; i++)
     {
         logicalDevice.destroyBuffer(uniformBuffers[i]);
-        logicalDevice.freeMemory(uniformBuffersMemory[i]);
+        memoryAllocator.Free(logicalDevice, uniformBuffersMemory[i]);
 
         logicalDevice.destroyBuffer(computeUniformBuffers[i]);
-        logicalDevice.freeMemory(computeUniformBuffersMemory[i]);
+        memoryAllocator.Free(logicalDevice, computeUniformBuffersMemory[i]);
     }
 
     logicalDevice.destroyDescriptorPool(imguiDescriptorPool);
@@ -117,38 +276,53 @@ void Application::shutdown()
     logicalDevice.destroyImageView(textureImageView);
 
     logicalDevice.destroyImage(textureImage);
-    logicalDevice.freeMemory(textureImageMemory);
+    memoryAllocator.Free(logicalDevice, textureImageMemory);
+
+    logicalDevice.destroyImageView(placeholderTextureImageView);
+    logicalDevice.destroyImage(placeholderTextureImage);
+    memoryAllocator.Free(logicalDevice, placeholderTextureImageMemory);
 
     logicalDevice.destroyDescriptorSetLayout(graphicsDescriptorSetLayout);
     logicalDevice.destroyDescriptorSetLayout(computeDescriptorSetLayout);
 
-    footballModel.Destroy(logicalDevice);
+    footballModel.Destroy(memoryAllocator, logicalDevice);
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-    {
-        logicalDevice.destroyBuffer(shaderStorageBuffers[i]);
-        logicalDevice.freeMemory(shaderStorageBuffersMemory[i]);
-    }
+    destroyPhysicsResources();
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (size_t i = 0; i < framesInFlight; i++)
     {
         logicalDevice.destroySemaphore(imageAvailableSemaphores[i]);
         logicalDevice.destroySemaphore(renderFinishedSemaphores[i]);
-        logicalDevice.destroySemaphore(computeFinishedSemaphores[i]);
-        logicalDevice.destroyFence(inFlightFences[i]);
-        logicalDevice.destroyFence(computeInFlightFences[i]);
     }
 
+    logicalDevice.destroySemaphore(computeTimeline);
+    logicalDevice.destroySemaphore(graphicsTimeline);
+
+    graphicsStagingRing.Destroy(memoryAllocator, logicalDevice);
+    computeStagingRing.Destroy(memoryAllocator, logicalDevice);
+    transferStagingRing.Destroy(memoryAllocator, logicalDevice);
+
     logicalDevice.destroyCommandPool(computeCommandPool);
     logicalDevice.destroyCommandPool(commandPool);
 
+    savePipelineCache();
+    logicalDevice.destroyPipelineCache(pipelineCache);
+
+    memoryAllocator.Destroy(logicalDevice);
+
     logicalDevice.destroy();
 
-    instance.destroySurfaceKHR(surface);
+    if (!isHeadless)
+    {
+        instance.destroySurfaceKHR(surface);
+    }
     instance.destroy();
 
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    if (!isHeadless)
+    {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
 }
 
 void Application::createVulkanInstance()
@@ -235,11 +409,15 @@ bool Application::checkValidationLayerSupport()
 
 std::vector<const char *> Application::getRequiredInstanceExtensions()
 {
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-    for (uint32_t i = 0; i < glfwExtensionCount; i++)
+    // Headless runs have no surface to create
+    if (!isHeadless)
     {
-        requiredExtensions.emplace_back(glfwExtensions[i]);
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+        for (uint32_t i = 0; i < glfwExtensionCount; i++)
+        {
+            requiredExtensions.emplace_back(glfwExtensions[i]);
+        }
     }
 
 #ifdef __APPLE__
@@ -393,6 +571,11 @@ void Application::pickPhysicalDevice()
         {
             physicalDevice = device;
             msaaSamples = getMaxUsableSampleCount();
+            // A requested count the device can't use is lowered to the next power of two it can
+            while (requestedMSAASampleCount != 0 && static_cast<uint32_t>(msaaSamples) > requestedMSAASampleCount)
+            {
+                msaaSamples = static_cast<vk::SampleCountFlagBits>(static_cast<uint32_t>(msaaSamples) >> 1);
+            }
             break;
         }
     }
@@ -401,6 +584,15 @@ void Application::pickPhysicalDevice()
     {
         throw std::runtime_error("failed to find a suitable GPU!");
     }
+
+    // The occlusion culler builds its depth pyramid by sampling the depth attachment, which the device may not support at this sample count
+    vk::FormatProperties depthFormatProperties = physicalDevice.getFormatProperties(findDepthFormat());
+    isDepthAttachmentSampled = (physicalDevice.getProperties().limits.sampledImageDepthSampleCounts & msaaSamples) &&
+                               (depthFormatProperties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage);
+    if (!isDepthAttachmentSampled)
+    {
+        std::cout << "The depth attachment can't be sampled at " << static_cast<uint32_t>(msaaSamples) << "x MSAA, occlusion culling is disabled" << std::endl;
+    }
 }
 
 bool Application::checkDeviceExtensionSupport(vk::PhysicalDevice device)
@@ -479,8 +671,8 @@ bool Application::isDeviceSuitable(vk::PhysicalDevice device)
     Application::QueueFamilyIndices indices = findQueueFamilies(device);
     bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-    bool swapChainAdequate = false;
-    if (extensionsSupported)
+    bool swapChainAdequate = isHeadless;
+    if (extensionsSupported && !isHeadless)
     {
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
         swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
@@ -488,7 +680,16 @@ bool Application::isDeviceSuitable(vk::PhysicalDevice device)
 
     vk::PhysicalDeviceFeatures supportedFeatures = device.getFeatures();
 
-    return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+    bool timelineSemaphoreSupported = false;
+    if (device.getProperties().apiVersion >= VK_API_VERSION_1_2)
+    {
+        auto supportedFeatures2 = device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceTimelineSemaphoreFeatures>();
+        timelineSemaphoreSupported = supportedFeatures2.get<vk::PhysicalDeviceTimelineSemaphoreFeatures>().timelineSemaphore;
+    }
+
+    // The occlusion culling draws read their instances from a region of the instance buffer chosen by the indirect command's first instance
+    return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy && supportedFeatures.drawIndirectFirstInstance &&
+           timelineSemaphoreSupported;
 }
 
 Application::QueueFamilyIndices Application::findQueueFamilies(vk::PhysicalDevice device)
@@ -503,15 +704,19 @@ Application::QueueFamilyIndices Application::findQueueFamilies(vk::PhysicalDevic
     int i = 0;
     for (const auto &queueFamily : queueFamilies)
     {
-        vk::Bool32 presentSupport = false;
+        // Nothing is presented when headless, the graphics family stands in for the present family
+        vk::Bool32 presentSupport = isHeadless && (queueFamily.queueFlags & vk::QueueFlagBits::eGraphics);
 
-        vk::Result result = device.getSurfaceSupportKHR(i, surface, &presentSupport);
-        if (result != vk::Result::eSuccess)
+        if (!isHeadless)
         {
-            throw std::runtime_error("Failed to physical device surface support! Error Code: " + vk::to_string(result));
+            vk::Result result = device.getSurfaceSupportKHR(i, surface, &presentSupport);
+            if (result != vk::Result::eSuccess)
+            {
+                throw std::runtime_error("Failed to physical device surface support! Error Code: " + vk::to_string(result));
+            }
         }
 
-        if (queueFamily.queueCount > 0)
+        if (queueFamily.queueCount > 0 && !indices.isComplete())
         {
             if ((queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) && (queueFamily.queueFlags & vk::QueueFlagBits::eCompute))
             {
@@ -524,9 +729,19 @@ Application::QueueFamilyIndices Application::findQueueFamilies(vk::PhysicalDevic
             }
         }
 
-        if (indices.isComplete())
+        // The physics compute pass is timed, so the family also needs timestamp support
+        if (queueFamily.queueCount > 0 && !indices.asyncComputeFamily.has_value() &&
+            (queueFamily.queueFlags & vk::QueueFlagBits::eCompute) && !(queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) &&
+            queueFamily.timestampValidBits > 0)
         {
-            break;
+            indices.asyncComputeFamily = i;
+        }
+
+        if (queueFamily.queueCount > 0 && !indices.transferFamily.has_value() &&
+            (queueFamily.queueFlags & vk::QueueFlagBits::eTransfer) &&
+            !(queueFamily.queueFlags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute)))
+        {
+            indices.transferFamily = i;
         }
 
         i++;
@@ -538,26 +753,83 @@ Application::QueueFamilyIndices Application::findQueueFamilies(vk::PhysicalDevic
 void Application::createLogicalDevice()
 {
     QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
-    float queuePriority = 1.0f;
+    std::array<float, 2> queuePriorities = {1.0f, 1.0f};
 
-    std::vector<vk::DeviceQueueCreateInfo> queueFamilyCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = {
-        indices.graphicsAndComputeFamily.value(),
-        indices.presentFamily.value()};
+    // Physics runs on its own queue whenever the device has one, so it can overlap rendering.
+    // A compute-only family is preferred over a second graphics family queue, sharing the graphics queue serialises the two.
+    graphicsQueueFamily = indices.graphicsAndComputeFamily.value();
+    computeQueueFamily = graphicsQueueFamily;
+    computeQueueIndex = 0;
+
+    if (indices.asyncComputeFamily.has_value())
+    {
+        computeQueueFamily = indices.asyncComputeFamily.value();
+    }
+    else if (physicalDevice.getQueueFamilyProperties()[graphicsQueueFamily].queueCount > 1)
+    {
+        computeQueueIndex = 1;
+    }
+
+    // Streamed assets are uploaded on a transfer-only queue so they don't hold up rendering, or on the graphics queue without one
+    transferQueueFamily = indices.transferFamily.value_or(graphicsQueueFamily);
+
+    // Queue count per family
+    std::map<uint32_t, uint32_t> uniqueQueueFamilies = {{indices.presentFamily.value(), 1}};
+    uniqueQueueFamilies[graphicsQueueFamily] = std::max(uniqueQueueFamilies[graphicsQueueFamily], 1u);
+    uniqueQueueFamilies[computeQueueFamily] = std::max(uniqueQueueFamilies[computeQueueFamily], computeQueueIndex + 1);
+    uniqueQueueFamilies[transferQueueFamily] = std::max(uniqueQueueFamilies[transferQueueFamily], 1u);
 
-    for (uint32_t queueFamily : uniqueQueueFamilies)
+    std::vector<vk::DeviceQueueCreateInfo> queueFamilyCreateInfos;
+    for (const auto &[queueFamily, queueCount] : uniqueQueueFamilies)
     {
         queueFamilyCreateInfos.push_back(vk::DeviceQueueCreateInfo()
                                              .setQueueFamilyIndex(queueFamily)
-                                             .setQueueCount(1)
-                                             .setPQueuePriorities(&queuePriority));
+                                             .setQueueCount(queueCount)
+                                             .setPQueuePriorities(queuePriorities.data()));
     }
 
     physicalDeviceFeatures.samplerAnisotropy = vk::True;
     physicalDeviceFeatures.sampleRateShading = vk::True;
+    physicalDeviceFeatures.drawIndirectFirstInstance = vk::True;
+
+    // Whichever block compression families the device has, for the pre-compressed textures, see readCompressedTexture()
+    vk::PhysicalDeviceFeatures supportedDeviceFeatures = physicalDevice.getFeatures();
+    physicalDeviceFeatures.textureCompressionBC = supportedDeviceFeatures.textureCompressionBC;
+    physicalDeviceFeatures.textureCompressionETC2 = supportedDeviceFeatures.textureCompressionETC2;
+    physicalDeviceFeatures.textureCompressionASTC_LDR = supportedDeviceFeatures.textureCompressionASTC_LDR;
+
+    // Subgroup size control (core in 1.3) lets the workgroup autotuner also try forced subgroup sizes
+    if (physicalDevice.getProperties().apiVersion >= VK_API_VERSION_1_3)
+    {
+        auto supportedFeatures = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceSubgroupSizeControlFeatures>();
+        auto supportedProperties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceSubgroupSizeControlProperties>();
+        subgroupSizeControlProperties = supportedProperties.get<vk::PhysicalDeviceSubgroupSizeControlProperties>();
+
+        isSubgroupSizeControlSupported = supportedFeatures.get<vk::PhysicalDeviceSubgroupSizeControlFeatures>().subgroupSizeControl &&
+                                         (subgroupSizeControlProperties.requiredSubgroupSizeStages & vk::ShaderStageFlagBits::eCompute);
+    }
+
+    // The splat render mode resolves depth with 64-bit atomic mins on a storage buffer (core in 1.2), see SplatRenderer
+    auto supportedAtomicFeatures = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceShaderAtomicInt64Features>();
+    isSplatRenderingSupported = supportedAtomicFeatures.get<vk::PhysicalDeviceFeatures2>().features.shaderInt64 &&
+                                supportedAtomicFeatures.get<vk::PhysicalDeviceShaderAtomicInt64Features>().shaderBufferInt64Atomics;
+    physicalDeviceFeatures.shaderInt64 = isSplatRenderingSupported ? vk::True : vk::False;
+
+    vk::PhysicalDeviceSubgroupSizeControlFeatures subgroupSizeControlFeatures = vk::PhysicalDeviceSubgroupSizeControlFeatures()
+                                                                                    .setPNext(nullptr)
+                                                                                    .setSubgroupSizeControl(vk::True);
+
+    vk::PhysicalDeviceShaderAtomicInt64Features atomicInt64Features = vk::PhysicalDeviceShaderAtomicInt64Features()
+                                                                          .setPNext(isSubgroupSizeControlSupported ? &subgroupSizeControlFeatures : nullptr)
+                                                                          .setShaderBufferInt64Atomics(vk::True);
+
+    // Frame synchronisation is built on timeline semaphores (core in 1.2), see waitForFrameSlot()
+    vk::PhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures = vk::PhysicalDeviceTimelineSemaphoreFeatures()
+                                                                                .setPNext(isSplatRenderingSupported ? &atomicInt64Features : atomicInt64Features.pNext)
+                                                                                .setTimelineSemaphore(vk::True);
 
     vk::PhysicalDeviceHostQueryResetFeatures hostQueryResetFeatures = vk::PhysicalDeviceHostQueryResetFeatures()
-                                                                          .setPNext(nullptr)
+                                                                          .setPNext(&timelineSemaphoreFeatures)
                                                                           .setHostQueryReset(vk::True);
 
     logicalDeviceCreateInfo = vk::DeviceCreateInfo()
@@ -584,9 +856,10 @@ void Application::createLogicalDevice()
         throw std::runtime_error("Failed to create logical device! Error Code: " + vk::to_string(result));
     }
 
-    logicalDevice.getQueue(indices.graphicsAndComputeFamily.value(), 0, &graphicsQueue);
-    logicalDevice.getQueue(indices.graphicsAndComputeFamily.value(), 0, &computeQueue);
+    logicalDevice.getQueue(graphicsQueueFamily, 0, &graphicsQueue);
+    logicalDevice.getQueue(computeQueueFamily, computeQueueIndex, &computeQueue);
     logicalDevice.getQueue(indices.presentFamily.value(), 0, &presentQueue);
+    logicalDevice.getQueue(transferQueueFamily, 0, &transferQueue);
 }
 
 void Application::createSurface()
@@ -655,6 +928,12 @@ vk::Extent2D Application::chooseSwapExtent(const vk::SurfaceCapabilitiesKHR &cap
 
 void Application::createSwapChain()
 {
+    if (isHeadless)
+    {
+        createOffscreenTargets();
+        return;
+    }
+
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
 
     vk::SurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
@@ -730,11 +1009,11 @@ void Application::createImageViews()
 
 void Application::createGraphicsPipeline()
 {
-    auto vertexShaderCode = readFile("resources/shaders/shader.vert.spv");
-    auto fragmentShaderCode = readFile("resources/shaders/shader.frag.spv");
+    auto vertexShaderCode = Utilities::readFile("resources/shaders/shader.vert.spv");
+    auto fragmentShaderCode = Utilities::readFile("resources/shaders/shader.frag.spv");
 
-    vk::ShaderModule vertexShaderModule = createShaderModule(vertexShaderCode);
-    vk::ShaderModule fragmentShaderModule = createShaderModule(fragmentShaderCode);
+    vk::ShaderModule vertexShaderModule = Utilities::createShaderModule(logicalDevice, vertexShaderCode);
+    vk::ShaderModule fragmentShaderModule = Utilities::createShaderModule(logicalDevice, fragmentShaderCode);
 
     vk::PipelineShaderStageCreateInfo vertexShaderStageCreateInfo = vk::PipelineShaderStageCreateInfo()
                                                                         .setStage(vk::ShaderStageFlagBits::eVertex)
@@ -845,7 +1124,7 @@ void Application::createGraphicsPipeline()
                                                             .setSubpass(0)
                                                             .setBasePipelineHandle(VK_NULL_HANDLE);
 
-    result = logicalDevice.createGraphicsPipelines(VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &graphicsPipeline);
+    result = logicalDevice.createGraphicsPipelines(pipelineCache, 1, &pipelineCreateInfo, nullptr, &graphicsPipeline);
     if (result != vk::Result::eSuccess)
     {
         throw std::runtime_error("Failed to create graphics pipeline! Error Code: " + vk::to_string(result));
@@ -853,6 +1132,33 @@ void Application::createGraphicsPipeline()
 
     logicalDevice.destroyShaderModule(fragmentShaderModule);
     logicalDevice.destroyShaderModule(vertexShaderModule);
+
+    // The impostor pipeline only reads the instance-rate binding, its quads' corners come from gl_VertexIndex
+    auto impostorVertexShaderCode = Utilities::readFile("resources/shaders/impostor.vert.spv");
+    auto impostorFragmentShaderCode = Utilities::readFile("resources/shaders/impostor.frag.spv");
+
+    vertexShaderModule = Utilities::createShaderModule(logicalDevice, impostorVertexShaderCode);
+    fragmentShaderModule = Utilities::createShaderModule(logicalDevice, impostorFragmentShaderCode);
+    shaderStages[0].setModule(vertexShaderModule);
+    shaderStages[1].setModule(fragmentShaderModule);
+
+    vertexInputCreateInfo
+        .setVertexBindingDescriptionCount(1)
+        .setPVertexBindingDescriptions(&bindingDescriptions[1])
+        .setVertexAttributeDescriptionCount(3)
+        .setPVertexAttributeDescriptions(&attributeDescriptions[3]);
+
+    // The quads face the camera, whichever way round their corners end up on screen
+    rasterizerCreateInfo.setCullMode(vk::CullModeFlagBits::eNone);
+
+    result = logicalDevice.createGraphicsPipelines(pipelineCache, 1, &pipelineCreateInfo, nullptr, &impostorPipeline);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create impostor graphics pipeline! Error Code: " + vk::to_string(result));
+    }
+
+    logicalDevice.destroyShaderModule(fragmentShaderModule);
+    logicalDevice.destroyShaderModule(vertexShaderModule);
 }
 
 void Application::createComputeDescriptorSetLayout()
@@ -878,11 +1184,24 @@ void Application::createComputeDescriptorSetLayout()
                                                                        .setPImmutableSamplers(nullptr)
                                                                        .setStageFlags(vk::ShaderStageFlagBits::eCompute);
 
-    std::array<vk::DescriptorSetLayoutBinding, 3> layoutBindings = {
+    std::vector<vk::DescriptorSetLayoutBinding> layoutBindings = {
         uboLayoutBinding,
         lastFrameSSBOLayoutBinding,
         currentFrameSSBOLayoutBinding};
 
+    // Broadphase buffers: grid cell counts, cell starts, scatter cursors, per-body cell hash, cell-sorted bodies and BVH nodes
+    // followed by the contact header, contact list, per-body solver deltas, the physics materials, the active set
+    // and the frame's occlusion candidate transforms and header
+    for (uint32_t binding = 3; binding <= 15; binding++)
+    {
+        layoutBindings.push_back(vk::DescriptorSetLayoutBinding()
+                                     .setBinding(binding)
+                                     .setDescriptorCount(1)
+                                     .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                     .setPImmutableSamplers(nullptr)
+                                     .setStageFlags(vk::ShaderStageFlagBits::eCompute));
+    }
+
     vk::DescriptorSetLayoutCreateInfo layoutCreateInfo = vk::DescriptorSetLayoutCreateInfo()
                                                              .setBindingCount(static_cast<uint32_t>(layoutBindings.size()))
                                                              .setPBindings(layoutBindings.data());
@@ -896,15 +1215,6 @@ void Application::createComputeDescriptorSetLayout()
 
 void Application::createComputePipeline()
 {
-    auto computeShaderCode = readFile("resources/shaders/shader.comp.spv");
-
-    vk::ShaderModule computeShaderModule = createShaderModule(computeShaderCode);
-
-    vk::PipelineShaderStageCreateInfo computeShaderStageCreateInfo = vk::PipelineShaderStageCreateInfo()
-                                                                         .setStage(vk::ShaderStageFlagBits::eCompute)
-                                                                         .setModule(computeShaderModule)
-                                                                         .setPName("main");
-
     vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo = vk::PipelineLayoutCreateInfo()
                                                                 .setSetLayoutCount(1)
                                                                 .setPSetLayouts(&computeDescriptorSetLayout);
@@ -915,141 +1225,459 @@ void Application::createComputePipeline()
         throw std::runtime_error("Failed to create compute pipeline layout! Error Code: " + vk::to_string(result));
     }
 
-    vk::ComputePipelineCreateInfo computePipelineCreateInfo = vk::ComputePipelineCreateInfo()
-                                                                  .setLayout(computePipelineLayout)
-                                                                  .setStage(computeShaderStageCreateInfo);
-
-    result = logicalDevice.createComputePipelines(nullptr, 1, &computePipelineCreateInfo, nullptr, &computePipeline);
-    if (result != vk::Result::eSuccess)
-    {
-        throw std::runtime_error("Failed to create compute pipeline! Error Code: " + vk::to_string(result));
-    }
-
-    logicalDevice.destroyShaderModule(computeShaderModule);
+    createWorkgroupPipelines();
+    contactDispatchPipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/contact_dispatch.comp.spv", computePipelineLayout);
+    solveContactsPipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/solve_contacts.comp.spv", computePipelineLayout);
 }
 
-std::vector<char> Application::readFile(const std::string &fileName)
+// Per-body passes, their local_size_x is specialisation constant 0
+void Application::createWorkgroupPipelines()
 {
-    std::ifstream file(fileName, std::ios::ate | std::ios::binary);
-    if (!file.is_open())
-    {
-        throw std::runtime_error("Failed to open file!");
-    }
-
-    size_t fileSize = (size_t)file.tellg();
-    std::vector<char> buffer(fileSize);
-
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
+    std::array<vk::SpecializationMapEntry, 2> specializationEntries = {
+        vk::SpecializationMapEntry()
+            .setConstantID(0)
+            .setOffset(0)
+            .setSize(sizeof(uint32_t)),
+        vk::SpecializationMapEntry()
+            .setConstantID(1)
+            .setOffset(sizeof(uint32_t))
+            .setSize(sizeof(uint32_t))};
+
+    vk::SpecializationInfo specializationInfo = vk::SpecializationInfo()
+                                                    .setMapEntryCount(1)
+                                                    .setPMapEntries(specializationEntries.data())
+                                                    .setDataSize(sizeof(uint32_t))
+                                                    .setPData(&computeWorkgroup.size);
+
+    // collide_bvh.comp also sizes its traversal stack for the current object count, so it's rebuilt when that changes
+    std::array<uint32_t, 2> collideBVHConstants = {computeWorkgroup.size, LinearBVH::GetTraversalStackSize(physicsObjectCount)};
+    vk::SpecializationInfo collideBVHSpecializationInfo = vk::SpecializationInfo()
+                                                              .setMapEntryCount(static_cast<uint32_t>(specializationEntries.size()))
+                                                              .setPMapEntries(specializationEntries.data())
+                                                              .setDataSize(sizeof(collideBVHConstants))
+                                                              .setPData(collideBVHConstants.data());
+
+    compactActiveBodiesPipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/compact_active_bodies.comp.spv", computePipelineLayout, &specializationInfo, computeWorkgroup.subgroupSize);
+    computePipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/shader.comp.spv", computePipelineLayout, &specializationInfo, computeWorkgroup.subgroupSize);
+    gridScatterPipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/grid_scatter.comp.spv", computePipelineLayout, &specializationInfo, computeWorkgroup.subgroupSize);
+    collidePipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/collide.comp.spv", computePipelineLayout, &specializationInfo, computeWorkgroup.subgroupSize);
+    collideBVHPipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/collide_bvh.comp.spv", computePipelineLayout, &collideBVHSpecializationInfo, computeWorkgroup.subgroupSize);
+    applyContactsPipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/apply_contacts.comp.spv", computePipelineLayout, &specializationInfo, computeWorkgroup.subgroupSize);
+    instanceTransformPipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/instance_transforms.comp.spv", computePipelineLayout, &specializationInfo, computeWorkgroup.subgroupSize);
+}
 
-    return buffer;
+void Application::destroyWorkgroupPipelines()
+{
+    logicalDevice.destroyPipeline(compactActiveBodiesPipeline);
+    logicalDevice.destroyPipeline(computePipeline);
+    logicalDevice.destroyPipeline(gridScatterPipeline);
+    logicalDevice.destroyPipeline(collidePipeline);
+    logicalDevice.destroyPipeline(collideBVHPipeline);
+    logicalDevice.destroyPipeline(applyContactsPipeline);
+    logicalDevice.destroyPipeline(instanceTransformPipeline);
 }
 
-vk::ShaderModule Application::createShaderModule(const std::vector<char> &code)
+// Times whole simulation steps of the current scene for every workgroup size (and forced subgroup size when supported).
+// Every step reads the same input buffer, so the scene the application starts with is left untouched.
+void Application::autotuneComputeWorkgroup()
 {
-    vk::ShaderModuleCreateInfo shaderModuleCreateInfo = vk::ShaderModuleCreateInfo()
-                                                            .setCodeSize(code.size())
-                                                            .setPCode(reinterpret_cast<const uint32_t *>(code.data()));
+    vk::PhysicalDeviceLimits const &physicalDeviceLimits = physicalDevice.getProperties().limits;
 
-    vk::ShaderModule shaderModule;
-    vk::Result result = logicalDevice.createShaderModule(&shaderModuleCreateInfo, nullptr, &shaderModule);
-    if (result != vk::Result::eSuccess)
+    std::vector<ComputeWorkgroupConfig> candidates;
+    for (uint32_t size : {32u, 64u, 128u, 256u})
     {
-        throw std::runtime_error("Failed to create shader module! Error Code: " + vk::to_string(result));
-    }
+        if (!isComputeWorkgroupSupported({size, 0}))
+        {
+            continue;
+        }
 
-    return shaderModule;
-}
+        candidates.push_back({size, 0});
 
-void Application::createRenderPass()
-{
-    vk::AttachmentDescription colorAttachment = vk::AttachmentDescription()
-                                                    .setFormat(swapChainImageFormat)
-                                                    .setSamples(msaaSamples)
-                                                    .setLoadOp(vk::AttachmentLoadOp::eClear)
-                                                    .setStoreOp(vk::AttachmentStoreOp::eStore)
-                                                    .setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
-                                                    .setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
-                                                    .setInitialLayout(vk::ImageLayout::eUndefined)
-                                                    .setFinalLayout(vk::ImageLayout::eColorAttachmentOptimal);
+        if (isSubgroupSizeControlSupported && subgroupSizeControlProperties.minSubgroupSize < subgroupSizeControlProperties.maxSubgroupSize)
+        {
+            for (uint32_t subgroupSize = subgroupSizeControlProperties.minSubgroupSize; subgroupSize <= subgroupSizeControlProperties.maxSubgroupSize; subgroupSize *= 2)
+            {
+                if (isComputeWorkgroupSupported({size, subgroupSize}))
+                {
+                    candidates.push_back({size, subgroupSize});
+                }
+            }
+        }
+    }
 
-    vk::AttachmentReference colorAttachmentReference = vk::AttachmentReference()
-                                                           .setAttachment(0)
-                                                           .setLayout(vk::ImageLayout::eColorAttachmentOptimal);
+    updateCameraMatrices();
+    updateComputeUniformBuffer(currentFrame);
 
-    vk::AttachmentDescription depthAttachment = vk::AttachmentDescription()
-                                                    .setFormat(findDepthFormat())
-                                                    .setSamples(msaaSamples)
-                                                    .setLoadOp(vk::AttachmentLoadOp::eClear)
-                                                    .setStoreOp(vk::AttachmentStoreOp::eStore)
-                                                    .setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
-                                                    .setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
-                                                    .setInitialLayout(vk::ImageLayout::eUndefined)
-                                                    .setFinalLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
+    ComputeWorkgroupConfig fastestWorkgroup = computeWorkgroup;
+    float fastestTimeMS = std::numeric_limits<float>::max();
 
-    vk::AttachmentReference depthAttachmentReference = vk::AttachmentReference()
-                                                           .setAttachment(1)
-                                                           .setLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
+    for (const ComputeWorkgroupConfig &candidate : candidates)
+    {
+        destroyWorkgroupPipelines();
+        computeWorkgroup = candidate;
+        createWorkgroupPipelines();
 
-    vk::AttachmentDescription colorAttachmentResolve = vk::AttachmentDescription()
-                                                           .setFormat(swapChainImageFormat)
-                                                           .setSamples(vk::SampleCountFlagBits::e1)
-                                                           .setLoadOp(vk::AttachmentLoadOp::eDontCare)
-                                                           .setStoreOp(vk::AttachmentStoreOp::eStore)
-                                                           .setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
-                                                           .setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
-                                                           .setInitialLayout(vk::ImageLayout::eUndefined)
-                                                           .setFinalLayout(vk::ImageLayout::ePresentSrcKHR);
+        float totalTimeMS = 0.0f;
+        for (uint32_t step = 0; step < AUTOTUNE_WARMUP_STEPS + AUTOTUNE_TIMED_STEPS; step++)
+        {
+            // Every timed step integrates the same state, so the candidates are all measured on identical input
+            uint32_t stateBuffer = physicsStateBuffer;
+            resetTimeStamps(currentFrame);
+            computeCommandBuffers[currentFrame].reset();
+            recordComputeCommandBuffer(computeCommandBuffers[currentFrame], 1);
+            physicsStateBuffer = stateBuffer;
+
+            vk::Result result = submitCompute(computeCommandBuffers[currentFrame]);
+            if (result != vk::Result::eSuccess)
+            {
+                throw std::runtime_error("Failed to submit compute command buffer! Error Code: " + vk::to_string(result));
+            }
 
-    vk::AttachmentReference colorAttachmentResolveReference = vk::AttachmentReference()
-                                                                  .setAttachment(2)
-                                                                  .setLayout(vk::ImageLayout::eColorAttachmentOptimal);
+            frameComputeTimelineValues[currentFrame] = computeTimelineValue;
+            waitForFrameSlot(currentFrame);
 
-    vk::SubpassDescription subpass = vk::SubpassDescription()
-                                         .setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
-                                         .setColorAttachmentCount(1)
-                                         .setPColorAttachments(&colorAttachmentReference)
-                                         .setPDepthStencilAttachment(&depthAttachmentReference)
-                                         .setPResolveAttachments(&colorAttachmentResolveReference);
+            std::array<uint64_t, 2> stepTimeStamps{};
+            result = logicalDevice.getQueryPoolResults(queryPool, currentFrame * FRAME_QUERY_COUNT, 2, sizeof(stepTimeStamps), stepTimeStamps.data(), sizeof(uint64_t),
+                                                       vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+            if (result != vk::Result::eSuccess)
+            {
+                throw std::runtime_error("Failed to get autotune timestamps! Error Code: " + vk::to_string(result));
+            }
 
-    vk::SubpassDependency subpassDependency = vk::SubpassDependency()
-                                                  .setSrcSubpass(vk::SubpassExternal)
-                                                  .setDstSubpass(0)
-                                                  .setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests)
-                                                  .setSrcAccessMask(vk::AccessFlagBits::eNone)
-                                                  .setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests)
-                                                  .setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite);
+            if (step >= AUTOTUNE_WARMUP_STEPS)
+            {
+                totalTimeMS += float(stepTimeStamps[1] - stepTimeStamps[0]) * physicalDeviceLimits.timestampPeriod / 1'000'000.0f;
+            }
+        }
 
-    std::array<vk::AttachmentDescription, 3> attachments = {colorAttachment, depthAttachment, colorAttachmentResolve};
-    vk::RenderPassCreateInfo renderPassCreateInfo = vk::RenderPassCreateInfo()
-                                                        .setAttachmentCount(static_cast<uint32_t>(attachments.size()))
-                                                        .setPAttachments(attachments.data())
-                                                        .setSubpassCount(1)
-                                                        .setPSubpasses(&subpass)
-                                                        .setDependencyCount(1)
-                                                        .setPDependencies(&subpassDependency);
+        float averageTimeMS = totalTimeMS / AUTOTUNE_TIMED_STEPS;
+        std::cout << "Workgroup " << candidate.size << " (subgroup " << candidate.subgroupSize << "): " << averageTimeMS << " ms" << std::endl;
 
-    vk::Result result = logicalDevice.createRenderPass(&renderPassCreateInfo, nullptr, &renderPass);
-    if (result != vk::Result::eSuccess)
-    {
-        throw std::runtime_error("Failed to create render pass! Error Code: " + vk::to_string(result));
+        if (averageTimeMS < fastestTimeMS)
+        {
+            fastestTimeMS = averageTimeMS;
+            fastestWorkgroup = candidate;
+        }
     }
+
+    destroyWorkgroupPipelines();
+    computeWorkgroup = fastestWorkgroup;
+    createWorkgroupPipelines();
+
+    saveComputeWorkgroupCache();
 }
 
-void Application::createFramebuffers()
+// Cache lines are "<device UUID>_<driver version> <workgroup size> <subgroup size>". A matching entry is still checked against
+// the device's limits before it's specialised into the pipelines, and retuned when it doesn't fit.
+void Application::loadComputeWorkgroupCache()
 {
-    swapChainFrameBuffers.resize(swapChainImageViews.size());
+    workgroupCachePath = (cacheDirectory / WORKGROUP_CACHE_FILE_NAME).string();
+    std::ifstream cacheFile(workgroupCachePath);
+    std::string cacheKey = getComputeWorkgroupCacheKey();
 
-    for (size_t i = 0; i < swapChainImageViews.size(); i++)
+    std::string line;
+    while (std::getline(cacheFile, line))
     {
+        std::istringstream lineStream(line);
+        std::string cachedKey;
+        ComputeWorkgroupConfig cachedWorkgroup{};
 
-        std::array<vk::ImageView, 3> attachments = {colorImageView, depthImageView, swapChainImageViews[i]};
-        vk::FramebufferCreateInfo framebufferCreateInfo = vk::FramebufferCreateInfo()
-                                                              .setRenderPass(renderPass)
-                                                              .setAttachmentCount(static_cast<uint32_t>(attachments.size()))
-                                                              .setPAttachments(attachments.data())
-                                                              .setWidth(swapChainExtent.width)
+        if ((lineStream >> cachedKey >> cachedWorkgroup.size >> cachedWorkgroup.subgroupSize) && cachedKey == cacheKey)
+        {
+            if (isComputeWorkgroupSupported(cachedWorkgroup))
+            {
+                computeWorkgroup = cachedWorkgroup;
+            }
+            else
+            {
+                std::cout << "Cached workgroup size " << cachedWorkgroup.size << " (subgroup " << cachedWorkgroup.subgroupSize << ") doesn't fit this device, retuning" << std::endl;
+                isWorkgroupAutotuneEnabled = true;
+            }
+        }
+    }
+
+    // An explicitly requested size replaces the cached one, as long as the device can run it
+    if (requestedWorkgroupSize != 0)
+    {
+        if (!isComputeWorkgroupSupported({requestedWorkgroupSize, 0}))
+        {
+            throw std::runtime_error("Workgroup size " + std::to_string(requestedWorkgroupSize) + " exceeds the device's limits!");
+        }
+        computeWorkgroup = ComputeWorkgroupConfig{requestedWorkgroupSize, 0};
+        isWorkgroupAutotuneEnabled = false;
+    }
+}
+
+void Application::saveComputeWorkgroupCache()
+{
+    std::map<std::string, ComputeWorkgroupConfig> cachedWorkgroups;
+
+    std::ifstream inputFile(workgroupCachePath);
+    std::string line;
+    while (std::getline(inputFile, line))
+    {
+        std::istringstream lineStream(line);
+        std::string cachedUUID;
+        ComputeWorkgroupConfig cachedWorkgroup{};
+
+        if (lineStream >> cachedUUID >> cachedWorkgroup.size >> cachedWorkgroup.subgroupSize)
+        {
+            cachedWorkgroups[cachedUUID] = cachedWorkgroup;
+        }
+    }
+    inputFile.close();
+
+    cachedWorkgroups[getComputeWorkgroupCacheKey()] = computeWorkgroup;
+
+    std::ofstream outputFile(workgroupCachePath, std::ios::trunc);
+    if (!outputFile.is_open())
+    {
+        throw std::runtime_error("Failed to write " + workgroupCachePath + "!");
+    }
+
+    for (const auto &[cachedKey, cachedWorkgroup] : cachedWorkgroups)
+    {
+        outputFile << cachedKey << " " << cachedWorkgroup.size << " " << cachedWorkgroup.subgroupSize << "\n";
+    }
+}
+
+// A new driver can change which size is fastest, so it gets its own entry like the pipeline cache does
+std::string Application::getComputeWorkgroupCacheKey()
+{
+    return getDeviceUUIDString() + "_" + std::to_string(physicalDevice.getProperties().driverVersion);
+}
+
+bool Application::isComputeWorkgroupSupported(const ComputeWorkgroupConfig &workgroup)
+{
+    vk::PhysicalDeviceLimits const &physicalDeviceLimits = physicalDevice.getProperties().limits;
+    if (workgroup.size == 0 || workgroup.size > physicalDeviceLimits.maxComputeWorkGroupSize[0] || workgroup.size > physicalDeviceLimits.maxComputeWorkGroupInvocations)
+    {
+        return false;
+    }
+
+    // A forced subgroup size needs subgroup size control, a power of two in its range, and few enough subgroups to cover the workgroup
+    if (workgroup.subgroupSize != 0)
+    {
+        return isSubgroupSizeControlSupported && (workgroup.subgroupSize & (workgroup.subgroupSize - 1)) == 0 &&
+               workgroup.subgroupSize >= subgroupSizeControlProperties.minSubgroupSize && workgroup.subgroupSize <= subgroupSizeControlProperties.maxSubgroupSize &&
+               workgroup.size <= workgroup.subgroupSize * subgroupSizeControlProperties.maxComputeWorkgroupSubgroups;
+    }
+
+    return true;
+}
+
+std::string Application::getDeviceUUIDString()
+{
+    auto properties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceIDProperties>();
+    const auto &deviceUUID = properties.get<vk::PhysicalDeviceIDProperties>().deviceUUID;
+
+    std::ostringstream uuidStream;
+    for (uint8_t byte : deviceUUID)
+    {
+        uuidStream << std::hex << std::setw(2) << std::setfill('0') << static_cast<uint32_t>(byte);
+    }
+
+    return uuidStream.str();
+}
+
+// Drivers aren't required to reject cache data from another device or driver version, so its header is checked here
+// and a mismatched or truncated file starts an empty cache instead
+void Application::createPipelineCache()
+{
+    vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
+    pipelineCachePath = (cacheDirectory / ("pipeline_" + getDeviceUUIDString() + "_" + std::to_string(properties.driverVersion) + ".cache")).string();
+
+    std::vector<char> cacheData;
+    std::ifstream cacheFile(pipelineCachePath, std::ios::ate | std::ios::binary);
+    if (cacheFile.is_open())
+    {
+        cacheData.resize(static_cast<size_t>(cacheFile.tellg()));
+        cacheFile.seekg(0);
+        cacheFile.read(cacheData.data(), cacheData.size());
+    }
+
+    vk::PipelineCacheHeaderVersionOne header;
+    isPipelineCacheWarm = cacheFile && cacheData.size() >= sizeof(header);
+    if (isPipelineCacheWarm)
+    {
+        memcpy(&header, cacheData.data(), sizeof(header));
+        isPipelineCacheWarm = header.headerSize >= sizeof(header) && header.headerSize <= cacheData.size() &&
+                              header.headerVersion == vk::PipelineCacheHeaderVersion::eOne &&
+                              header.vendorID == properties.vendorID && header.deviceID == properties.deviceID &&
+                              header.pipelineCacheUUID == properties.pipelineCacheUUID;
+    }
+
+    vk::PipelineCacheCreateInfo pipelineCacheCreateInfo = vk::PipelineCacheCreateInfo()
+                                                              .setInitialDataSize(isPipelineCacheWarm ? cacheData.size() : 0)
+                                                              .setPInitialData(isPipelineCacheWarm ? cacheData.data() : nullptr);
+
+    vk::Result result = logicalDevice.createPipelineCache(&pipelineCacheCreateInfo, nullptr, &pipelineCache);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create pipeline cache! Error Code: " + vk::to_string(result));
+    }
+}
+
+// Written to a temporary file first so an interrupted save can't leave a truncated cache behind
+void Application::savePipelineCache()
+{
+    size_t cacheSize = 0;
+    vk::Result result = logicalDevice.getPipelineCacheData(pipelineCache, &cacheSize, nullptr);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to get pipeline cache size! Error Code: " + vk::to_string(result));
+    }
+
+    std::vector<char> cacheData(cacheSize);
+    result = logicalDevice.getPipelineCacheData(pipelineCache, &cacheSize, cacheData.data());
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to get pipeline cache data! Error Code: " + vk::to_string(result));
+    }
+
+    std::string temporaryPath = pipelineCachePath + ".tmp";
+    std::ofstream outputFile(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!outputFile.is_open())
+    {
+        throw std::runtime_error("Failed to write " + temporaryPath + "!");
+    }
+
+    outputFile.write(cacheData.data(), static_cast<std::streamsize>(cacheSize));
+    outputFile.close();
+
+    std::filesystem::rename(temporaryPath, pipelineCachePath);
+}
+
+void Application::createRenderPass()
+{
+    vk::AttachmentDescription colorAttachment = vk::AttachmentDescription()
+                                                    .setFormat(swapChainImageFormat)
+                                                    .setSamples(msaaSamples)
+                                                    .setLoadOp(vk::AttachmentLoadOp::eClear)
+                                                    .setStoreOp(vk::AttachmentStoreOp::eStore)
+                                                    .setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+                                                    .setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
+                                                    .setInitialLayout(vk::ImageLayout::eUndefined)
+                                                    .setFinalLayout(vk::ImageLayout::eColorAttachmentOptimal);
+
+    vk::AttachmentReference colorAttachmentReference = vk::AttachmentReference()
+                                                           .setAttachment(0)
+                                                           .setLayout(vk::ImageLayout::eColorAttachmentOptimal);
+
+    vk::AttachmentDescription depthAttachment = vk::AttachmentDescription()
+                                                    .setFormat(findDepthFormat())
+                                                    .setSamples(msaaSamples)
+                                                    .setLoadOp(vk::AttachmentLoadOp::eClear)
+                                                    .setStoreOp(vk::AttachmentStoreOp::eStore)
+                                                    .setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+                                                    .setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
+                                                    .setInitialLayout(vk::ImageLayout::eUndefined)
+                                                    .setFinalLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
+
+    vk::AttachmentReference depthAttachmentReference = vk::AttachmentReference()
+                                                           .setAttachment(1)
+                                                           .setLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
+
+    vk::AttachmentDescription colorAttachmentResolve = vk::AttachmentDescription()
+                                                           .setFormat(swapChainImageFormat)
+                                                           .setSamples(vk::SampleCountFlagBits::e1)
+                                                           .setLoadOp(vk::AttachmentLoadOp::eDontCare)
+                                                           .setStoreOp(vk::AttachmentStoreOp::eStore)
+                                                           .setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+                                                           .setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
+                                                           .setInitialLayout(vk::ImageLayout::eUndefined)
+                                                           .setFinalLayout(vk::ImageLayout::eColorAttachmentOptimal);
+
+    vk::AttachmentReference colorAttachmentResolveReference = vk::AttachmentReference()
+                                                                  .setAttachment(2)
+                                                                  .setLayout(vk::ImageLayout::eColorAttachmentOptimal);
+
+    // Without multisampling the frame is drawn straight into the swap chain image, the resolve attachment is left out
+    bool isResolved = msaaSamples != vk::SampleCountFlagBits::e1;
+
+    vk::SubpassDescription subpass = vk::SubpassDescription()
+                                         .setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
+                                         .setColorAttachmentCount(1)
+                                         .setPColorAttachments(&colorAttachmentReference)
+                                         .setPDepthStencilAttachment(&depthAttachmentReference)
+                                         .setPResolveAttachments(isResolved ? &colorAttachmentResolveReference : nullptr);
+
+    vk::SubpassDependency subpassDependency = vk::SubpassDependency()
+                                                  .setSrcSubpass(vk::SubpassExternal)
+                                                  .setDstSubpass(0)
+                                                  .setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests)
+                                                  .setSrcAccessMask(vk::AccessFlagBits::eNone)
+                                                  .setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests)
+                                                  .setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite);
+
+    std::array<vk::AttachmentDescription, 3> attachments = {colorAttachment, depthAttachment, colorAttachmentResolve};
+    vk::RenderPassCreateInfo renderPassCreateInfo = vk::RenderPassCreateInfo()
+                                                        .setAttachmentCount(isResolved ? 3 : 2)
+                                                        .setPAttachments(attachments.data())
+                                                        .setSubpassCount(1)
+                                                        .setPSubpasses(&subpass)
+                                                        .setDependencyCount(1)
+                                                        .setPDependencies(&subpassDependency);
+
+    vk::Result result = logicalDevice.createRenderPass(&renderPassCreateInfo, nullptr, &renderPass);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create render pass! Error Code: " + vk::to_string(result));
+    }
+
+    // The late pass keeps what the early pass drew, its depth is only tested against until the next frame clears it
+    vk::ImageLayout presentLayout = isHeadless ? vk::ImageLayout::eColorAttachmentOptimal : vk::ImageLayout::ePresentSrcKHR;
+
+    colorAttachment
+        .setLoadOp(vk::AttachmentLoadOp::eLoad)
+        .setInitialLayout(vk::ImageLayout::eColorAttachmentOptimal)
+        .setFinalLayout(isResolved ? vk::ImageLayout::eColorAttachmentOptimal : presentLayout);
+
+    depthAttachment
+        .setLoadOp(vk::AttachmentLoadOp::eLoad)
+        .setStoreOp(vk::AttachmentStoreOp::eDontCare)
+        .setInitialLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
+
+    colorAttachmentResolve
+        .setInitialLayout(vk::ImageLayout::eColorAttachmentOptimal)
+        .setFinalLayout(presentLayout);
+
+    vk::SubpassDependency lateSubpassDependency = vk::SubpassDependency()
+                                                      .setSrcSubpass(vk::SubpassExternal)
+                                                      .setDstSubpass(0)
+                                                      .setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eLateFragmentTests)
+                                                      .setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite)
+                                                      .setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests)
+                                                      .setDstAccessMask(vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite |
+                                                                        vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite);
+
+    attachments = {colorAttachment, depthAttachment, colorAttachmentResolve};
+    renderPassCreateInfo.setPDependencies(&lateSubpassDependency);
+
+    result = logicalDevice.createRenderPass(&renderPassCreateInfo, nullptr, &lateRenderPass);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create late render pass! Error Code: " + vk::to_string(result));
+    }
+}
+
+void Application::createFramebuffers()
+{
+    swapChainFrameBuffers.resize(swapChainImageViews.size());
+
+    for (size_t i = 0; i < swapChainImageViews.size(); i++)
+    {
+        // Matches createRenderPass(), a single sampled frame has no color image to resolve
+        std::vector<vk::ImageView> attachments = {colorImageView, depthImageView, swapChainImageViews[i]};
+        if (msaaSamples == vk::SampleCountFlagBits::e1)
+        {
+            attachments = {swapChainImageViews[i], depthImageView};
+        }
+        vk::FramebufferCreateInfo framebufferCreateInfo = vk::FramebufferCreateInfo()
+                                                              .setRenderPass(renderPass)
+                                                              .setAttachmentCount(static_cast<uint32_t>(attachments.size()))
+                                                              .setPAttachments(attachments.data())
+                                                              .setWidth(swapChainExtent.width)
                                                               .setHeight(swapChainExtent.height)
                                                               .setLayers(1);
 
@@ -1076,13 +1704,19 @@ void Application::createCommandPool()
     }
 }
 
-void Application::createComputeCommandPool()
+// Uploads are batched per queue, the physics buffers are uploaded on the queue that owns them
+void Application::createStagingRings()
 {
-    QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+    graphicsStagingRing.Create(memoryAllocator, logicalDevice, graphicsQueue, graphicsQueueFamily, STAGING_RING_SIZE);
+    computeStagingRing.Create(memoryAllocator, logicalDevice, computeQueue, computeQueueFamily, STAGING_RING_SIZE);
+    transferStagingRing.Create(memoryAllocator, logicalDevice, transferQueue, transferQueueFamily, STAGING_RING_SIZE);
+}
 
+void Application::createComputeCommandPool()
+{
     vk::CommandPoolCreateInfo commandPoolCreateInfo = vk::CommandPoolCreateInfo()
                                                           .setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer)
-                                                          .setQueueFamilyIndex(queueFamilyIndices.graphicsAndComputeFamily.value());
+                                                          .setQueueFamilyIndex(computeQueueFamily);
 
     vk::Result result = logicalDevice.createCommandPool(&commandPoolCreateInfo, nullptr, &computeCommandPool);
     if (result != vk::Result::eSuccess)
@@ -1093,7 +1727,7 @@ void Application::createComputeCommandPool()
 
 void Application::createCommandBuffers()
 {
-    commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    commandBuffers.resize(framesInFlight);
 
     vk::CommandBufferAllocateInfo allocateCreateInfo = vk::CommandBufferAllocateInfo()
                                                            .setCommandPool(commandPool)
@@ -1117,7 +1751,37 @@ void Application::recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t
         throw std::runtime_error("Failed to allocate command buffers! Error Code: " + vk::to_string(result));
     }
 
-    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, queryPool, 2);
+    uint32_t firstQuery = currentFrame * FRAME_QUERY_COUNT;
+    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, queryPool, firstQuery + 2);
+
+    // Acquire half of the occlusion candidates' transfer, the wait on the compute timeline covers the stages reading them
+    recordBufferOwnershipBarrier(commandBuffer, occlusionCuller.GetCandidateBuffer(currentFrame),
+                                 vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlags(),
+                                 vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead);
+    recordBufferOwnershipBarrier(commandBuffer, occlusionCuller.GetCandidateHeaderBuffer(currentFrame),
+                                 vk::PipelineStageFlagBits::eDrawIndirect, vk::AccessFlags(),
+                                 vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+                                 vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eTransferRead);
+
+    recordStreamedAssetAcquires(commandBuffer);
+
+    // Splats are composited straight from the candidates, occlusion culling and the sphere draws are skipped
+    bool isSplatted = sphereRenderMode == SphereRenderMode::eSplat;
+    if (isSplatted)
+    {
+        splatRenderer.RecordSplat(commandBuffer, currentFrame, cameraView, cameraProjection);
+    }
+    else
+    {
+        // Candidates visible in the previous frame's depth pyramid go to the first draw, the rest wait for the late cull
+        OcclusionCuller::CullSettings cullSettings{};
+        cullSettings.viewProjection = cameraProjection * cameraView;
+        // Pixels covered by a unit of LOD error at unit view depth, over the error allowed
+        cullSettings.lodScale = std::abs(cameraProjection[1][1]) * 0.5f * static_cast<float>(swapChainExtent.height) / lodPixelError;
+        cullSettings.isOcclusionEnabled = isOcclusionCullingEnabled;
+        cullSettings.isQuadDrawn = sphereRenderMode == SphereRenderMode::eImpostor;
+        occlusionCuller.RecordEarlyCull(commandBuffer, currentFrame, cullSettings);
+    }
 
     std::array<vk::ClearValue, 2> clearValues{};
     clearValues[0].color = vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f});
@@ -1131,7 +1795,55 @@ void Application::recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t
                                                             .setRenderArea(vk::Rect2D({0, 0}, swapChainExtent));
 
     commandBuffer.beginRenderPass(&renderPassBeginCreateInfo, vk::SubpassContents::eInline);
-    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline);
+    if (isSplatted)
+    {
+        splatRenderer.RecordComposite(commandBuffer);
+    }
+    else
+    {
+        recordSphereDraw(commandBuffer, OcclusionCuller::eEarly);
+    }
+    commandBuffer.endRenderPass();
+
+    if (!isSplatted)
+    {
+        // Rebuild the pyramid from the early draw's depth and re-test the early rejects against it
+        occlusionCuller.RecordDepthPyramid(commandBuffer);
+        occlusionCuller.RecordLateCull(commandBuffer, currentFrame);
+    }
+
+    renderPassBeginCreateInfo
+        .setClearValueCount(0)
+        .setPClearValues(nullptr)
+        .setRenderPass(lateRenderPass);
+
+    commandBuffer.beginRenderPass(&renderPassBeginCreateInfo, vk::SubpassContents::eInline);
+    if (!isSplatted)
+    {
+        recordSphereDraw(commandBuffer, OcclusionCuller::eLate);
+    }
+
+    if (!isHeadless)
+    {
+        drawUI(commandBuffer);
+    }
+
+    commandBuffer.endRenderPass();
+
+    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, queryPool, firstQuery + 3);
+    commandBuffer.end();
+}
+
+// Draws the spheres one occlusion culling phase let through
+void Application::recordSphereDraw(vk::CommandBuffer commandBuffer, OcclusionCuller::Phase phase)
+{
+    // The window is up before the mesh has streamed in, the spheres appear once it is resident
+    if (!isModelResident)
+    {
+        return;
+    }
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, sphereRenderMode == SphereRenderMode::eImpostor ? impostorPipeline : graphicsPipeline);
 
     vk::Viewport viewport = vk::Viewport()
                                 .setX(0.0f)
@@ -1150,141 +1862,222 @@ void Application::recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t
     commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, graphicsPipelineLayout, 0, 1,
                                      &graphicsDescriptorSets[currentFrame], 0, nullptr);
 
-    footballModel.DrawInstanced(commandBuffer, PHYSICS_OBJECT_COUNT);
-
-    drawUI(commandBuffer);
-
-    commandBuffer.endRenderPass();
-
-    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, queryPool, 3);
-    commandBuffer.end();
+    footballModel.DrawInstancedIndirect(commandBuffer, currentFrame, phase);
 }
 
-void Application::drawFrame()
+// Blocks only while the slot's previous compute or graphics submission is still executing, i.e. when every frame slot is in flight
+void Application::waitForFrameSlot(uint32_t frame)
 {
-    // Compute submission
-    vk::Result result = logicalDevice.waitForFences(1, &computeInFlightFences[currentFrame], vk::True, UINT64_MAX);
-    if (result != vk::Result::eSuccess)
-    {
-        throw std::runtime_error("Failed to wait for in-flight fence! Error Code: " + vk::to_string(result));
-    }
+    std::array<vk::Semaphore, 2> semaphores = {computeTimeline, graphicsTimeline};
+    std::array<uint64_t, 2> values = {frameComputeTimelineValues[frame], frameGraphicsTimelineValues[frame]};
 
-    updateComputeUniformBuffer(currentFrame);
+    vk::SemaphoreWaitInfo waitInfo = vk::SemaphoreWaitInfo()
+                                         .setSemaphoreCount(static_cast<uint32_t>(semaphores.size()))
+                                         .setPSemaphores(semaphores.data())
+                                         .setPValues(values.data());
 
-    result = logicalDevice.resetFences(1, &computeInFlightFences[currentFrame]);
+    vk::Result result = logicalDevice.waitSemaphores(&waitInfo, UINT64_MAX);
     if (result != vk::Result::eSuccess)
     {
-        throw std::runtime_error("Failed to reset in-flight fence! Error Code: " + vk::to_string(result));
+        throw std::runtime_error("Failed to wait for frame timeline values! Error Code: " + vk::to_string(result));
     }
+}
 
-    computeCommandBuffers[currentFrame].reset();
-    recordComputeCommandBuffer(computeCommandBuffers[currentFrame]);
+// Submits to the physics queue, which signals the next value of the compute timeline once the command buffer completes
+vk::Result Application::submitCompute(vk::CommandBuffer commandBuffer)
+{
+    computeTimelineValue++;
+
+    vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo = vk::TimelineSemaphoreSubmitInfo()
+                                                             .setSignalSemaphoreValueCount(1)
+                                                             .setPSignalSemaphoreValues(&computeTimelineValue);
 
     vk::SubmitInfo submitInfo = vk::SubmitInfo()
+                                    .setPNext(&timelineSubmitInfo)
                                     .setCommandBufferCount(1)
-                                    .setPCommandBuffers(&computeCommandBuffers[currentFrame])
+                                    .setPCommandBuffers(&commandBuffer)
                                     .setSignalSemaphoreCount(1)
-                                    .setPSignalSemaphores(&computeFinishedSemaphores[currentFrame]);
+                                    .setPSignalSemaphores(&computeTimeline);
 
-    result = computeQueue.submit(1, &submitInfo, computeInFlightFences[currentFrame]);
-    if (result != vk::Result::eSuccess)
+    return computeQueue.submit(1, &submitInfo, nullptr);
+}
+
+void Application::drawFrame()
+{
+    if (requestedPhysicsObjectCount != physicsObjectCount)
     {
-        throw std::runtime_error("Failed to submit compute command buffer! Error Code: " + vk::to_string(result));
+        recreatePhysicsResources();
     }
 
-    // Graphics submission
-    result = logicalDevice.waitForFences(1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
-    if (result != vk::Result::eSuccess)
+    // Both of this frame slot's previous submissions must be done: the compute queue is about to overwrite the
+    // occlusion candidates that frame was culled from. The other slot's graphics work can still be running alongside this frame's compute.
+    waitForFrameSlot(currentFrame);
+
+    // The image is acquired before anything is submitted: the compute submission releases the body buffers to the graphics
+    // queue, and returning for an out of date swap chain after it would leave that release without its acquire.
+    // A headless frame renders to its slot's offscreen image which the slot's wait has already freed.
+    uint32_t imageIndex = currentFrame;
+    if (!isHeadless)
     {
-        throw std::runtime_error("Failed to wait for in-flight fence! Error Code: " + vk::to_string(result));
+        vk::Result result = logicalDevice.acquireNextImageKHR(swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame],
+                                                              VK_NULL_HANDLE, &imageIndex);
+        if (result == vk::Result::eErrorOutOfDateKHR)
+        {
+            recreateSwapChain();
+            return;
+        }
+        else if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR)
+        {
+            throw std::runtime_error("failed to acquire swap chain image!");
+        }
     }
 
-    uint32_t imageIndex;
-    result = logicalDevice.acquireNextImageKHR(swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame],
-                                               VK_NULL_HANDLE, &imageIndex);
-    if (result == vk::Result::eErrorOutOfDateKHR)
+    updateStreamedAssets();
+
+    // The previous submissions have finished, so their readback copy and timestamps are complete
+    PhysicsReadback *physicsReadback = static_cast<PhysicsReadback *>(physicsReadbackBuffersMapped[currentFrame]);
+    contactCount = physicsReadback->contactHeader.contactCount;
+    bvhStackOverflowCount = physicsReadback->contactHeader.bvhStackOverflowCount;
+    activeBodyCount = physicsReadback->activeBodyHeader.activeCount;
+    occlusionStatistics = occlusionCuller.GetStatistics(currentFrame);
+
+    bool areTimeStampsReady = getTimeStampResults(currentFrame);
+    if (isHeadless)
     {
-        recreateSwapChain();
-        return;
+        recordBenchmarkTimeStamps(currentFrame, areTimeStampsReady);
     }
-    else if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR)
+    resetTimeStamps(currentFrame);
+
+    // Compute submission
+
+    // Fixed timestep: step the simulation once for every whole physicsTimeStep of wall-clock time that has built up
+    auto currentTime = std::chrono::high_resolution_clock::now();
+    physicsTimeAccumulator += isHeadless ? BENCHMARK_FRAME_TIME : std::chrono::duration<float, std::chrono::seconds::period>(currentTime - lastFrameTime).count();
+    lastFrameTime = currentTime;
+
+    physicsSubstepCount = std::min(static_cast<uint32_t>(physicsTimeAccumulator / physicsTimeStep), maxPhysicsSubsteps);
+    physicsTimeAccumulator -= physicsSubstepCount * physicsTimeStep;
+
+    // Drop the backlog when the GPU can't keep up, otherwise every later frame would try to catch up and fall further behind
+    if (physicsSubstepCount == maxPhysicsSubsteps)
     {
-        throw std::runtime_error("failed to acquire swap chain image!");
+        physicsTimeAccumulator = std::min(physicsTimeAccumulator, physicsTimeStep);
     }
 
-    updateUniformBuffer(currentFrame);
+    updateCameraMatrices();
+    updateComputeUniformBuffer(currentFrame);
+
+    computeCommandBuffers[currentFrame].reset();
+    recordComputeCommandBuffer(computeCommandBuffers[currentFrame], physicsSubstepCount);
 
-    result = logicalDevice.resetFences(1, &inFlightFences[currentFrame]);
+    vk::Result result = submitCompute(computeCommandBuffers[currentFrame]);
     if (result != vk::Result::eSuccess)
     {
-        throw std::runtime_error("Failed to reset in-flight fence! Error Code: " + vk::to_string(result));
+        throw std::runtime_error("Failed to submit compute command buffer! Error Code: " + vk::to_string(result));
     }
+    frameComputeTimelineValues[currentFrame] = computeTimelineValue;
+
+    // Graphics submission
+    updateUniformBuffer(currentFrame);
 
     commandBuffers[currentFrame].reset();
     recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
 
-    vk::Semaphore waitSemaphores[] = {computeFinishedSemaphores[currentFrame], imageAvailableSemaphores[currentFrame]};
-    vk::PipelineStageFlags waitStages[] = {vk::PipelineStageFlagBits::eVertexInput, vk::PipelineStageFlagBits::eColorAttachmentOutput};
+    // The draw waits on the GPU for the compute submission above, the binary semaphores' values are ignored.
+    // Headless frames only use the timelines, which come first.
+    graphicsTimelineValue++;
+    uint32_t semaphoreCount = isHeadless ? 1 : 2;
 
-    vk::Semaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
+    vk::Semaphore waitSemaphores[] = {computeTimeline, imageAvailableSemaphores[currentFrame]};
+    uint64_t waitValues[] = {computeTimelineValue, 0};
+    vk::PipelineStageFlags waitStages[] = {vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+                                           vk::PipelineStageFlagBits::eColorAttachmentOutput};
 
-    submitInfo = vk::SubmitInfo()
-                     .setWaitSemaphoreCount(2)
-                     .setPWaitSemaphores(waitSemaphores)
-                     .setPWaitDstStageMask(waitStages)
-                     .setCommandBufferCount(1)
-                     .setPCommandBuffers(&commandBuffers[currentFrame])
-                     .setSignalSemaphoreCount(1)
-                     .setPSignalSemaphores(signalSemaphores);
+    vk::Semaphore signalSemaphores[] = {graphicsTimeline, renderFinishedSemaphores[currentFrame]};
+    uint64_t signalValues[] = {graphicsTimelineValue, 0};
 
-    result = graphicsQueue.submit(1, &submitInfo, inFlightFences[currentFrame]);
+    vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo = vk::TimelineSemaphoreSubmitInfo()
+                                                             .setWaitSemaphoreValueCount(semaphoreCount)
+                                                             .setPWaitSemaphoreValues(waitValues)
+                                                             .setSignalSemaphoreValueCount(semaphoreCount)
+                                                             .setPSignalSemaphoreValues(signalValues);
+
+    vk::SubmitInfo submitInfo = vk::SubmitInfo()
+                                    .setPNext(&timelineSubmitInfo)
+                                    .setWaitSemaphoreCount(semaphoreCount)
+                                    .setPWaitSemaphores(waitSemaphores)
+                                    .setPWaitDstStageMask(waitStages)
+                                    .setCommandBufferCount(1)
+                                    .setPCommandBuffers(&commandBuffers[currentFrame])
+                                    .setSignalSemaphoreCount(semaphoreCount)
+                                    .setPSignalSemaphores(signalSemaphores);
+
+    result = graphicsQueue.submit(1, &submitInfo, nullptr);
     if (result != vk::Result::eSuccess)
     {
         throw std::runtime_error("Failed to submit draw command buffer! Error Code: " + vk::to_string(result));
     }
+    frameGraphicsTimelineValues[currentFrame] = graphicsTimelineValue;
 
-    vk::SwapchainKHR swapChains[] = {swapChain};
-
-    vk::PresentInfoKHR presentInfo = vk::PresentInfoKHR()
-                                         .setWaitSemaphoreCount(1)
-                                         .setPWaitSemaphores(signalSemaphores)
-                                         .setSwapchainCount(1)
-                                         .setPSwapchains(swapChains)
-                                         .setPImageIndices(&imageIndex)
-                                         .setPResults(nullptr);
-
-    result = presentQueue.presentKHR(&presentInfo);
-    if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR || framebufferResized)
-    {
-        framebufferResized = false;
-        recreateSwapChain();
-    }
-    else if (result != vk::Result::eSuccess)
+    if (!isHeadless)
     {
-        throw std::runtime_error("Failed to present: present queue! Error Code: " + vk::to_string(result));
+        vk::SwapchainKHR swapChains[] = {swapChain};
+
+        vk::PresentInfoKHR presentInfo = vk::PresentInfoKHR()
+                                             .setWaitSemaphoreCount(1)
+                                             .setPWaitSemaphores(&renderFinishedSemaphores[currentFrame])
+                                             .setSwapchainCount(1)
+                                             .setPSwapchains(swapChains)
+                                             .setPImageIndices(&imageIndex)
+                                             .setPResults(nullptr);
+
+        result = presentQueue.presentKHR(&presentInfo);
+        if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR || framebufferResized)
+        {
+            framebufferResized = false;
+            recreateSwapChain();
+        }
+        else if (result != vk::Result::eSuccess)
+        {
+            throw std::runtime_error("Failed to present: present queue! Error Code: " + vk::to_string(result));
+        }
     }
 
-    getTimeStampResults();
-
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    currentFrame = (currentFrame + 1) % framesInFlight;
 }
 
 void Application::createSyncObjects()
 {
-    imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    computeFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+    imageAvailableSemaphores.resize(framesInFlight);
+    renderFinishedSemaphores.resize(framesInFlight);
 
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-    computeInFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+    // Both timelines start at 0, which is also what every frame slot waits for before its first use
+    frameComputeTimelineValues.assign(framesInFlight, 0);
+    frameGraphicsTimelineValues.assign(framesInFlight, 0);
 
     vk::SemaphoreCreateInfo semaphoreCreateInfo = vk::SemaphoreCreateInfo();
-    vk::FenceCreateInfo fenceCreateInfo = vk::FenceCreateInfo()
-                                              .setFlags(vk::FenceCreateFlagBits::eSignaled);
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    vk::SemaphoreTypeCreateInfo timelineTypeCreateInfo = vk::SemaphoreTypeCreateInfo()
+                                                             .setSemaphoreType(vk::SemaphoreType::eTimeline)
+                                                             .setInitialValue(0);
+    vk::SemaphoreCreateInfo timelineCreateInfo = vk::SemaphoreCreateInfo()
+                                                     .setPNext(&timelineTypeCreateInfo);
+
+    vk::Result result = logicalDevice.createSemaphore(&timelineCreateInfo, nullptr, &computeTimeline);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create compute timeline semaphore! Error Code: " + vk::to_string(result));
+    }
+
+    result = logicalDevice.createSemaphore(&timelineCreateInfo, nullptr, &graphicsTimeline);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create graphics timeline semaphore! Error Code: " + vk::to_string(result));
+    }
+
+    for (size_t i = 0; i < framesInFlight; i++)
     {
-        vk::Result result = logicalDevice.createSemaphore(&semaphoreCreateInfo, nullptr, &imageAvailableSemaphores[i]);
+        result = logicalDevice.createSemaphore(&semaphoreCreateInfo, nullptr, &imageAvailableSemaphores[i]);
         if (result != vk::Result::eSuccess)
         {
             throw std::runtime_error(
@@ -1297,25 +2090,6 @@ void Application::createSyncObjects()
             throw std::runtime_error(
                 "Failed to create render finished semaphore! Error Code: " + vk::to_string(result));
         }
-
-        result = logicalDevice.createFence(&fenceCreateInfo, nullptr, &inFlightFences[i]);
-        if (result != vk::Result::eSuccess)
-        {
-            throw std::runtime_error("Failed to create in-flight fence! Error Code: " + vk::to_string(result));
-        }
-
-        result = logicalDevice.createSemaphore(&semaphoreCreateInfo, nullptr, &computeFinishedSemaphores[i]);
-        if (result != vk::Result::eSuccess)
-        {
-            throw std::runtime_error(
-                "failed to create compute synchronization objects for a frame! Error Code: " + vk::to_string(result));
-        }
-
-        result = logicalDevice.createFence(&fenceCreateInfo, nullptr, &computeInFlightFences[i]);
-        if (result != vk::Result::eSuccess)
-        {
-            throw std::runtime_error("failed to create compute synchronization objects for a frame  ! Error Code: " + vk::to_string(result));
-        }
     }
 }
 
@@ -1340,17 +2114,25 @@ void Application::recreateSwapChain()
     createColorResources();
     createDepthResources();
     createFramebuffers();
+    createDepthPyramid();
+    createSplatTarget();
 }
 
 void Application::cleanupSwapChain()
 {
     logicalDevice.destroyImageView(colorImageView);
     logicalDevice.destroyImage(colorImage);
-    logicalDevice.freeMemory(colorImageMemory);
+    memoryAllocator.Free(logicalDevice, colorImageMemory);
+
+    occlusionCuller.DestroyDepthPyramid(memoryAllocator, logicalDevice);
+    if (isSplatRenderingSupported)
+    {
+        splatRenderer.DestroyTarget(memoryAllocator, logicalDevice);
+    }
 
     logicalDevice.destroyImageView(depthImageView);
     logicalDevice.destroyImage(depthImage);
-    logicalDevice.freeMemory(depthImageMemory);
+    memoryAllocator.Free(logicalDevice, depthImageMemory);
 
     for (auto swapChainFrameBuffer : swapChainFrameBuffers)
     {
@@ -1362,79 +2144,77 @@ void Application::cleanupSwapChain()
         logicalDevice.destroyImageView(swapChainImageView);
     }
 
-    logicalDevice.destroySwapchainKHR(swapChain);
-}
-
-void Application::framebufferResizeCallback(GLFWwindow *window, int width, int height)
-{
-    auto app = reinterpret_cast<Application *>(glfwGetWindowUserPointer(window));
-    app->framebufferResized = true;
-}
-
-uint32_t Application::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties)
-{
-    vk::PhysicalDeviceMemoryProperties physicalDeviceMemoryProperties;
-    physicalDevice.getMemoryProperties(&physicalDeviceMemoryProperties);
-
-    for (uint32_t i = 0; i < physicalDeviceMemoryProperties.memoryTypeCount; i++)
+    if (isHeadless)
     {
-        if ((typeFilter & (1 << i)) &&
-            (physicalDeviceMemoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        for (size_t i = 0; i < swapChainImages.size(); i++)
         {
-            return i;
+            logicalDevice.destroyImage(swapChainImages[i]);
+            memoryAllocator.Free(logicalDevice, offscreenImagesMemory[i]);
         }
     }
-
-    throw std::runtime_error("Failed to find suitable memory type!");
-}
-
-void Application::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
-                               vk::Buffer &buffer, vk::DeviceMemory &bufferMemory)
-{
-    vk::BufferCreateInfo bufferCreateInfo = vk::BufferCreateInfo()
-                                                .setSize(size)
-                                                .setUsage(usage)
-                                                .setSharingMode(vk::SharingMode::eExclusive);
-
-    vk::Result result = logicalDevice.createBuffer(&bufferCreateInfo, nullptr, &buffer);
-    if (result != vk::Result::eSuccess)
+    else
     {
-        throw std::runtime_error("Failed to create buffer! Error Code: " + vk::to_string(result));
+        logicalDevice.destroySwapchainKHR(swapChain);
     }
+}
 
-    vk::MemoryRequirements memoryRequirements;
-    logicalDevice.getBufferMemoryRequirements(buffer, &memoryRequirements);
+// Stands in for the swap chain when headless. Each frame slot renders to its own image, so the wait for the slot
+// covers the image too and nothing has to be acquired.
+void Application::createOffscreenTargets()
+{
+    swapChainImageFormat = vk::Format::eR8G8B8A8Srgb;
+    swapChainExtent = BENCHMARK_EXTENT;
 
-    vk::MemoryAllocateInfo memoryAllocateInfo = vk::MemoryAllocateInfo()
-                                                    .setAllocationSize(memoryRequirements.size)
-                                                    .setMemoryTypeIndex(findMemoryType(memoryRequirements.memoryTypeBits, properties));
+    swapChainImages.resize(framesInFlight);
+    offscreenImagesMemory.resize(framesInFlight);
 
-    result = logicalDevice.allocateMemory(&memoryAllocateInfo, nullptr, &bufferMemory);
-    if (result != vk::Result::eSuccess)
+    for (size_t i = 0; i < framesInFlight; i++)
     {
-        throw std::runtime_error("Failed to allocate buffer memory! Error Code: " + vk::to_string(result));
+        createImage(swapChainExtent.width, swapChainExtent.height, 1, vk::SampleCountFlagBits::e1, swapChainImageFormat, vk::ImageTiling::eOptimal,
+                    vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eDeviceLocal,
+                    swapChainImages[i], offscreenImagesMemory[i]);
     }
+}
 
-    logicalDevice.bindBufferMemory(buffer, bufferMemory, 0);
+void Application::framebufferResizeCallback(GLFWwindow *window, int width, int height)
+{
+    auto app = reinterpret_cast<Application *>(glfwGetWindowUserPointer(window));
+    app->framebufferResized = true;
 }
 
-void Application::copyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size)
+void Application::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
+                               vk::Buffer &buffer, MemoryAllocator::Allocation &bufferMemory, MemoryAllocator::Strategy strategy)
 {
-    vk::CommandBuffer commandBuffer = beginSingleTimeCommands(commandPool);
+    Utilities::createBuffer(memoryAllocator, logicalDevice, size, usage, properties, buffer, bufferMemory, strategy);
+}
 
-    vk::BufferCopy copyRegion = vk::BufferCopy().setSize(size);
-    commandBuffer.copyBuffer(srcBuffer, dstBuffer, 1, &copyRegion);
+// One half of a compute to graphics queue family ownership transfer, recorded as the release on the compute queue and
+// again as the acquire on the graphics queue. Only a plain barrier is needed when both queues are from the same family.
+// Nothing is transferred back: each copy overwrites the whole buffer, so the graphics family's contents can be discarded.
+void Application::recordBufferOwnershipBarrier(vk::CommandBuffer commandBuffer, vk::Buffer buffer, vk::PipelineStageFlags srcStage, vk::AccessFlags srcAccess, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess)
+{
+    bool isTransferNeeded = computeQueueFamily != graphicsQueueFamily;
+
+    vk::BufferMemoryBarrier bufferMemoryBarrier = vk::BufferMemoryBarrier()
+                                                      .setSrcAccessMask(srcAccess)
+                                                      .setDstAccessMask(dstAccess)
+                                                      .setSrcQueueFamilyIndex(isTransferNeeded ? computeQueueFamily : vk::QueueFamilyIgnored)
+                                                      .setDstQueueFamilyIndex(isTransferNeeded ? graphicsQueueFamily : vk::QueueFamilyIgnored)
+                                                      .setBuffer(buffer)
+                                                      .setOffset(0)
+                                                      .setSize(vk::WholeSize);
 
-    endSingleTimeCommands(commandBuffer, commandPool);
+    commandBuffer.pipelineBarrier(srcStage, dstStage, vk::DependencyFlags(), 0, nullptr, 1, &bufferMemoryBarrier, 0, nullptr);
 }
 
 void Application::createGraphicsDescriptorSetLayout()
 {
+    // The impostor fragment shader projects its ray hits itself
     vk::DescriptorSetLayoutBinding uboLayoutBinding = vk::DescriptorSetLayoutBinding()
                                                           .setBinding(0)
                                                           .setDescriptorType(vk::DescriptorType::eUniformBuffer)
                                                           .setDescriptorCount(1)
-                                                          .setStageFlags(vk::ShaderStageFlagBits::eVertex)
+                                                          .setStageFlags(vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment)
                                                           .setPImmutableSamplers(nullptr);
 
     vk::DescriptorSetLayoutBinding samplerLayoutBinding = vk::DescriptorSetLayoutBinding()
@@ -1444,14 +2224,7 @@ void Application::createGraphicsDescriptorSetLayout()
                                                               .setPImmutableSamplers(nullptr)
                                                               .setStageFlags(vk::ShaderStageFlagBits::eFragment);
 
-    vk::DescriptorSetLayoutBinding ssboLayoutBinding = vk::DescriptorSetLayoutBinding()
-                                                           .setBinding(2)
-                                                           .setDescriptorType(vk::DescriptorType::eStorageBuffer)
-                                                           .setDescriptorCount(1)
-                                                           .setStageFlags(vk::ShaderStageFlagBits::eVertex)
-                                                           .setPImmutableSamplers(nullptr);
-
-    std::array<vk::DescriptorSetLayoutBinding, 3> bindings = {uboLayoutBinding, samplerLayoutBinding, ssboLayoutBinding};
+    std::array<vk::DescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
     vk::DescriptorSetLayoutCreateInfo layoutCreateInfo = vk::DescriptorSetLayoutCreateInfo()
                                                              .setBindingCount(static_cast<uint32_t>(bindings.size()))
                                                              .setPBindings(bindings.data());
@@ -1463,11 +2236,12 @@ void Application::createGraphicsDescriptorSetLayout()
     }
 }
 
-std::vector<Application::PhysicsObject> Application::createSphereBox(uint32_t objectCount, float sphereRadius)
+void Application::createSphereBox(uint32_t objectCount, float sphereRadius, std::vector<glm::vec4> &streams, std::vector<PhysicsMaterial> &materials)
 {
     // Calculate the size of the box to fit all spheres in a cube
     uint32_t boxSize = std::ceil(std::cbrt(objectCount));
-    std::vector<PhysicsObject> physicsObjects(objectCount);
+    streams.assign(PHYSICS_STREAM_COUNT * objectCount, glm::vec4(0.0f));
+    materials.resize(objectCount);
 
     // Calculate box dimensions based on sphere radius and count
     float boxWidth = (boxSize - 1) * sphereRadius * 2.0f;
@@ -1487,83 +2261,211 @@ std::vector<Application::PhysicsObject> Application::createSphereBox(uint32_t ob
                 float yPos = -boxHeight / 2.0f + y * sphereRadius * 2.0f + sphereRadius;
                 float zPos = -boxDepth / 2.0f + z * sphereRadius * 2.0f + sphereRadius;
 
-                // Initialize physics object
-                PhysicsObject obj;
-                obj.position = glm::vec3(xPos, yPos + 2.0f, zPos);
-                obj.rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
-                obj.velocity = glm::vec3(0.0f);
-                obj.angularVelocity = glm::vec3(0.0f);
-                obj.radius = sphereRadius;
-                obj.mass = 0.45f;
-                obj.elasticity = 0.8f;
-                obj.momentOfInertia = (2.0f / 5.0f) * obj.mass * (obj.radius * obj.radius);
-
-                physicsObjects[index] = obj;
+                // Initialize physics object, velocities start at zero
+                streams[PHYSICS_STREAM_INDEX(PHYSICS_STREAM_POSITION_RADIUS, index, objectCount)] = glm::vec4(xPos, yPos + 2.0f, zPos, sphereRadius);
+                streams[PHYSICS_STREAM_INDEX(PHYSICS_STREAM_ROTATION, index, objectCount)] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+                PhysicsMaterial material;
+                material.mass = 0.45f;
+                material.inverseMass = 1.0f / material.mass;
+                material.elasticity = 0.8f;
+                material.momentOfInertia = (2.0f / 5.0f) * material.mass * (sphereRadius * sphereRadius);
+
+                materials[index] = material;
                 index++;
             }
         }
     }
-
-    return physicsObjects;
 }
 
 void Application::createShaderStorageBuffers()
 {
-    std::vector<PhysicsObject> objects = createSphereBox(PHYSICS_OBJECT_COUNT, 0.115f);
+    std::vector<glm::vec4> streams;
+    std::vector<PhysicsMaterial> materials;
+    createSphereBox(physicsObjectCount, 0.115f, streams, materials);
 
-    vk::DeviceSize bufferSize = sizeof(PhysicsObject) * PHYSICS_OBJECT_COUNT;
+    vk::DeviceSize bufferSize = sizeof(glm::vec4) * streams.size();
 
-    // Creating a staging buffer to upload data to the GPU
-    vk::Buffer stagingBuffer;
-    vk::DeviceMemory stagingBufferMemory;
+    shaderStorageBuffers.resize(PHYSICS_BUFFER_COUNT);
+    shaderStorageBuffersMemory.resize(PHYSICS_BUFFER_COUNT);
 
-    createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostVisible, stagingBuffer, stagingBufferMemory);
+    // Copy initial particle data to all storage buffers.
+    // Uploaded on the physics queue, which owns these buffers, so no queue family ownership transfer is needed.
+    // The copies join the physics staging ring's current batch, submitted by initVulkan() or recreatePhysicsResources().
+    for (size_t i = 0; i < PHYSICS_BUFFER_COUNT; i++)
+    {
+        createBuffer(bufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal, shaderStorageBuffers[i], shaderStorageBuffersMemory[i]);
+        computeStagingRing.CopyToBuffer(memoryAllocator, logicalDevice, streams.data(), bufferSize, shaderStorageBuffers[i]);
+    }
 
-    void *data;
-    vk::Result result = logicalDevice.mapMemory(stagingBufferMemory, 0, bufferSize, vk::MemoryMapFlags(), &data);
-    if (result != vk::Result::eSuccess)
+    // Materials never change during the simulation so they are uploaded once and shared by every frame
+    vk::DeviceSize materialBufferSize = sizeof(PhysicsMaterial) * materials.size();
+
+    createBuffer(materialBufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal, physicsMaterialBuffer, physicsMaterialBufferMemory);
+    computeStagingRing.CopyToBuffer(memoryAllocator, logicalDevice, materials.data(), materialBufferSize, physicsMaterialBuffer);
+}
+
+// Everything sized by the physics object count
+void Application::createPhysicsResources()
+{
+    createShaderStorageBuffers();
+    createGridBuffers();
+    gridPrefixSum.Create(memoryAllocator, logicalDevice, pipelineCache, gridCellCountBuffer, gridCellStartBuffer, gridHashSize);
+    createContactBuffers();
+    physicsBVH.Create(memoryAllocator, logicalDevice, pipelineCache, shaderStorageBuffers, physicsObjectCount);
+    occlusionCuller.CreateInstanceResources(memoryAllocator, logicalDevice, physicsObjectCount, framesInFlight, footballModel);
+    if (isSplatRenderingSupported)
     {
-        throw std::runtime_error("Failed to map uniform buffer memory! Error Code: " + vk::to_string(result));
+        splatRenderer.CreateInstanceResources(logicalDevice, occlusionCuller, framesInFlight, footballModel);
     }
 
-    memcpy(data, objects.data(), (size_t)bufferSize);
-    logicalDevice.unmapMemory(stagingBufferMemory);
+    objectString = "Number of Physics Objects: " + formatIntStringWithCommas(physicsObjectCount);
+    objectCountInput = static_cast<int>(physicsObjectCount);
+}
 
-    shaderStorageBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    shaderStorageBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+void Application::destroyPhysicsResources()
+{
+    for (size_t i = 0; i < PHYSICS_BUFFER_COUNT; i++)
+    {
+        logicalDevice.destroyBuffer(shaderStorageBuffers[i]);
+        memoryAllocator.Free(logicalDevice, shaderStorageBuffersMemory[i]);
+    }
 
-    // Copy initial particle data to all storage buffers
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    logicalDevice.destroyBuffer(physicsMaterialBuffer);
+    memoryAllocator.Free(logicalDevice, physicsMaterialBufferMemory);
+
+    gridPrefixSum.Destroy(memoryAllocator, logicalDevice);
+    logicalDevice.destroyBuffer(gridCellCountBuffer);
+    memoryAllocator.Free(logicalDevice, gridCellCountBufferMemory);
+    logicalDevice.destroyBuffer(gridCellStartBuffer);
+    memoryAllocator.Free(logicalDevice, gridCellStartBufferMemory);
+    logicalDevice.destroyBuffer(gridCellCursorBuffer);
+    memoryAllocator.Free(logicalDevice, gridCellCursorBufferMemory);
+    logicalDevice.destroyBuffer(gridBodyCellBuffer);
+    memoryAllocator.Free(logicalDevice, gridBodyCellBufferMemory);
+    logicalDevice.destroyBuffer(gridSortedBodyBuffer);
+    memoryAllocator.Free(logicalDevice, gridSortedBodyBufferMemory);
+
+    logicalDevice.destroyBuffer(contactHeaderBuffer);
+    memoryAllocator.Free(logicalDevice, contactHeaderBufferMemory);
+    logicalDevice.destroyBuffer(contactListBuffer);
+    memoryAllocator.Free(logicalDevice, contactListBufferMemory);
+    logicalDevice.destroyBuffer(bodyDeltaBuffer);
+    memoryAllocator.Free(logicalDevice, bodyDeltaBufferMemory);
+
+    logicalDevice.destroyBuffer(activeBodyBuffer);
+    memoryAllocator.Free(logicalDevice, activeBodyBufferMemory);
+
+    for (size_t i = 0; i < framesInFlight; i++)
     {
-        createBuffer(bufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal, shaderStorageBuffers[i], shaderStorageBuffersMemory[i]);
-        copyBuffer(stagingBuffer, shaderStorageBuffers[i], bufferSize);
+        logicalDevice.destroyBuffer(physicsReadbackBuffers[i]);
+        memoryAllocator.Free(logicalDevice, physicsReadbackBuffersMemory[i]);
+    }
+
+    physicsBVH.Destroy(memoryAllocator, logicalDevice);
+    occlusionCuller.DestroyInstanceResources(memoryAllocator, logicalDevice);
+    if (isSplatRenderingSupported)
+    {
+        splatRenderer.DestroyInstanceResources(logicalDevice);
+    }
+}
+
+void Application::recreatePhysicsResources()
+{
+    logicalDevice.waitIdle();
+
+    // The descriptor sets reference the old buffers, so their pools are rebuilt along with them
+    logicalDevice.destroyDescriptorPool(graphicsDescriptorPool);
+    logicalDevice.destroyDescriptorPool(computeDescriptorPool);
+    destroyPhysicsResources();
+
+    physicsObjectCount = std::clamp(requestedPhysicsObjectCount, MIN_PHYSICS_OBJECT_COUNT, maxPhysicsObjectCount);
+    requestedPhysicsObjectCount = physicsObjectCount;
+    contactCount = 0;
+    bvhStackOverflowCount = 0;
+    activeBodyCount = 0;
+    occlusionStatistics = OcclusionCuller::Statistics{};
+    physicsStateBuffer = 0;
+    physicsTimeAccumulator = 0.0f;
+
+    // collide_bvh.comp's traversal stack is sized for the object count
+    destroyWorkgroupPipelines();
+    createWorkgroupPipelines();
+
+    footballModel.DestroyInstanceBuffers(memoryAllocator, logicalDevice);
+    footballModel.CreateInstanceBuffers(physicsObjectCount, OcclusionCuller::ePhaseCount, framesInFlight, memoryAllocator, logicalDevice);
+
+    createPhysicsResources();
+    computeStagingRing.Flush();
+    createGraphicsDescriptorPool();
+    createComputeDescriptorPool();
+    createGraphicsDescriptorSets();
+    createComputeDescriptorSets();
+}
+
+void Application::createGridBuffers()
+{
+    // At least two hash buckets per body keeps unrelated cells from sharing a bucket
+    gridHashSize = 1;
+    while (gridHashSize < physicsObjectCount * 2)
+    {
+        gridHashSize <<= 1;
     }
 
-    logicalDevice.destroyBuffer(stagingBuffer);
-    logicalDevice.freeMemory(stagingBufferMemory);
+    vk::DeviceSize cellBufferSize = sizeof(uint32_t) * gridHashSize;
+    vk::DeviceSize bodyBufferSize = sizeof(uint32_t) * physicsObjectCount;
+
+    createBuffer(cellBufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal, gridCellCountBuffer, gridCellCountBufferMemory);
+    createBuffer(cellBufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eDeviceLocal, gridCellStartBuffer, gridCellStartBufferMemory);
+    createBuffer(cellBufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal, gridCellCursorBuffer, gridCellCursorBufferMemory);
+    createBuffer(bodyBufferSize, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, gridBodyCellBuffer, gridBodyCellBufferMemory);
+    createBuffer(bodyBufferSize, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, gridSortedBodyBuffer, gridSortedBodyBufferMemory);
+}
+
+void Application::createContactBuffers()
+{
+    contactCapacity = physicsObjectCount * CONTACTS_PER_OBJECT;
+
+    createBuffer(sizeof(ContactHeader),
+                 vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
+                 vk::MemoryPropertyFlagBits::eDeviceLocal, contactHeaderBuffer, contactHeaderBufferMemory);
+    createBuffer(sizeof(Contact) * contactCapacity, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, contactListBuffer, contactListBufferMemory);
+    createBuffer(sizeof(BodyDelta) * physicsObjectCount, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal, bodyDeltaBuffer, bodyDeltaBufferMemory);
+
+    // Doubles as the indirect dispatch of the per-body passes, see compact_active_bodies.comp
+    createBuffer(sizeof(ActiveBodyHeader) + sizeof(uint32_t) * physicsObjectCount,
+                 vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
+                 vk::MemoryPropertyFlagBits::eDeviceLocal, activeBodyBuffer, activeBodyBufferMemory);
+
+    physicsReadbackBuffers.resize(framesInFlight);
+    physicsReadbackBuffersMemory.resize(framesInFlight);
+    physicsReadbackBuffersMapped.resize(framesInFlight);
+
+    for (size_t i = 0; i < framesInFlight; i++)
+    {
+        createBuffer(sizeof(PhysicsReadback), vk::BufferUsageFlagBits::eTransferDst,
+                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                     physicsReadbackBuffers[i], physicsReadbackBuffersMemory[i]);
+
+        physicsReadbackBuffersMapped[i] = physicsReadbackBuffersMemory[i].mapped;
+        memset(physicsReadbackBuffersMapped[i], 0, sizeof(PhysicsReadback));
+    }
 }
 
 void Application::createUniformBuffers()
 {
     vk::DeviceSize bufferSize = sizeof(UniformBufferObject);
 
-    uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
-    uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+    uniformBuffers.resize(framesInFlight);
+    uniformBuffersMemory.resize(framesInFlight);
+    uniformBuffersMapped.resize(framesInFlight);
 
-    vk::Result result;
-
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (size_t i = 0; i < framesInFlight; i++)
     {
         createBuffer(bufferSize, vk::BufferUsageFlagBits::eUniformBuffer,
                      vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
                      uniformBuffers[i], uniformBuffersMemory[i]);
-        result = logicalDevice.mapMemory(uniformBuffersMemory[i], 0, bufferSize, vk::MemoryMapFlags(),
-                                         &uniformBuffersMapped[i]);
-        if (result != vk::Result::eSuccess)
-        {
-            throw std::runtime_error("Failed to map graphics uniform buffer memory! Error Code: " + vk::to_string(result));
-        }
+        uniformBuffersMapped[i] = uniformBuffersMemory[i].mapped;
     }
 }
 
@@ -1571,33 +2473,21 @@ void Application::createComputeUniformBuffers()
 {
     vk::DeviceSize bufferSize = sizeof(ComputeUniformBufferObject);
 
-    computeUniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    computeUniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
-    computeUniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+    computeUniformBuffers.resize(framesInFlight);
+    computeUniformBuffersMemory.resize(framesInFlight);
+    computeUniformBuffersMapped.resize(framesInFlight);
 
-    vk::Result result;
-
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (size_t i = 0; i < framesInFlight; i++)
     {
         createBuffer(bufferSize, vk::BufferUsageFlagBits::eUniformBuffer,
                      vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
                      computeUniformBuffers[i], computeUniformBuffersMemory[i]);
-        result = logicalDevice.mapMemory(computeUniformBuffersMemory[i], 0, bufferSize, vk::MemoryMapFlags(),
-                                         &computeUniformBuffersMapped[i]);
-        if (result != vk::Result::eSuccess)
-        {
-            throw std::runtime_error("Failed to map compute uniform buffer memory! Error Code: " + vk::to_string(result));
-        }
+        computeUniformBuffersMapped[i] = computeUniformBuffersMemory[i].mapped;
     }
 }
 
-void Application::updateUniformBuffer(uint32_t currentImage)
+void Application::updateCameraMatrices()
 {
-    static auto startTime = std::chrono::high_resolution_clock::now();
-    auto currentTime = std::chrono::high_resolution_clock::now();
-
-    float deltaTime = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
-
     glm::vec3 cameraPosition(0.0f, 5.0f, -5.0f);
     glm::vec3 cameraLookPosition(0.0f, 2.5f, 0.0f);
     glm::vec3 cameraUp(0.0f, 1.0f, 0.0f);
@@ -1607,50 +2497,75 @@ void Application::updateUniformBuffer(uint32_t currentImage)
     float nearPlane = 0.1f;
     float farPlane = 100.0f;
 
-    UniformBufferObject ubo;
-    ubo.model = glm::mat4(1.0f);
-    ubo.view = glm::lookAt(cameraPosition, cameraLookPosition, cameraUp);
-    ubo.projection = glm::perspective(glm::radians(fov), aspectRatio, nearPlane, farPlane);
+    cameraView = glm::lookAt(cameraPosition, cameraLookPosition, cameraUp);
+    cameraProjection = glm::perspective(glm::radians(fov), aspectRatio, nearPlane, farPlane);
 
     // Flipping Y axis to comply with Vulkan's -1:1 viewport mapping
-    ubo.projection[1][1] *= -1;
+    cameraProjection[1][1] *= -1;
+}
+
+void Application::updateUniformBuffer(uint32_t currentImage)
+{
+    UniformBufferObject ubo;
+    ubo.model = glm::mat4(1.0f);
+    ubo.view = cameraView;
+    ubo.projection = cameraProjection;
 
     memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
 }
 
 void Application::updateComputeUniformBuffer(uint32_t currentImage)
 {
-    static auto startTime = std::chrono::high_resolution_clock::now();
-    auto currentTime = std::chrono::high_resolution_clock::now();
+    ComputeUniformBufferObject computeUBO;
+    computeUBO.physicsTimeStep = physicsTimeStep;
+    computeUBO.gridCellSize = GRID_CELL_SIZE;
+    computeUBO.gridHashSize = gridHashSize;
+    computeUBO.objectCount = physicsObjectCount;
+    computeUBO.contactCapacity = contactCapacity;
+    computeUBO.sleepVelocity = SLEEP_VELOCITY;
+    // Out of reach of the step counters, so every body stays in the active set
+    computeUBO.sleepStepCount = isSleepingEnabled ? SLEEP_STEP_COUNT : std::numeric_limits<uint32_t>::max();
+    computeUBO.isGridBinned = broadphaseMode == BroadphaseMode::eUniformGrid ? 1 : 0;
+
+    // Gribb-Hartmann plane extraction from the rows of the view projection matrix, normals point into the frustum.
+    // Depth is zero to one, so the near plane is the third row on its own.
+    glm::mat4 viewProjection = cameraProjection * cameraView;
+    glm::vec4 rows[4];
+    for (int row = 0; row < 4; row++)
+    {
+        rows[row] = glm::vec4(viewProjection[0][row], viewProjection[1][row], viewProjection[2][row], viewProjection[3][row]);
+    }
 
-    float deltaTime = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
-    startTime = currentTime;
+    computeUBO.frustumPlanes[0] = rows[3] + rows[0];
+    computeUBO.frustumPlanes[1] = rows[3] - rows[0];
+    computeUBO.frustumPlanes[2] = rows[3] + rows[1];
+    computeUBO.frustumPlanes[3] = rows[3] - rows[1];
+    computeUBO.frustumPlanes[4] = rows[2];
+    computeUBO.frustumPlanes[5] = rows[3] - rows[2];
 
-    ComputeUniformBufferObject computeUBO;
-    computeUBO.physicsTimeStep = deltaTime;
+    for (glm::vec4 &plane : computeUBO.frustumPlanes)
+    {
+        // A plane every point is in front of, culling is disabled without another shader variant
+        plane = isFrustumCullingEnabled ? plane / glm::length(glm::vec3(plane)) : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
 
     memcpy(computeUniformBuffersMapped[currentImage], &computeUBO, sizeof(computeUBO));
 }
 
 void Application::createGraphicsDescriptorPool()
 {
-    std::array<vk::DescriptorPoolSize, 3> poolSizes{};
+    std::array<vk::DescriptorPoolSize, 2> poolSizes{};
     poolSizes[0] = vk::DescriptorPoolSize()
                        .setType(vk::DescriptorType::eUniformBuffer)
-                       .setDescriptorCount(static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+                       .setDescriptorCount(framesInFlight);
     poolSizes[1] = vk::DescriptorPoolSize()
                        .setType(vk::DescriptorType::eCombinedImageSampler)
-                       .setDescriptorCount(static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
-
-    // Needed so that the vertex shader can access the SSBO output buffer
-    poolSizes[2] = vk::DescriptorPoolSize()
-                       .setType(vk::DescriptorType::eStorageBuffer)
-                       .setDescriptorCount(static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+                       .setDescriptorCount(framesInFlight);
 
     vk::DescriptorPoolCreateInfo poolCreateInfo = vk::DescriptorPoolCreateInfo()
                                                       .setPoolSizeCount(static_cast<uint32_t>(poolSizes.size()))
                                                       .setPPoolSizes(poolSizes.data())
-                                                      .setMaxSets(static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+                                                      .setMaxSets(framesInFlight);
 
     vk::Result result = logicalDevice.createDescriptorPool(&poolCreateInfo, nullptr, &graphicsDescriptorPool);
     if (result != vk::Result::eSuccess)
@@ -1661,18 +2576,21 @@ void Application::createGraphicsDescriptorPool()
 
 void Application::createComputeDescriptorPool()
 {
+    uint32_t setCount = framesInFlight * PHYSICS_BUFFER_COUNT;
+
     std::array<vk::DescriptorPoolSize, 2> poolSizes;
     poolSizes[0] = vk::DescriptorPoolSize()
                        .setType(vk::DescriptorType::eUniformBuffer)
-                       .setDescriptorCount(static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+                       .setDescriptorCount(setCount);
+    // Two physics SSBOs, six broadphase, three contact, the material, active set, occlusion candidate and candidate header buffers per set
     poolSizes[1] = vk::DescriptorPoolSize()
                        .setType(vk::DescriptorType::eStorageBuffer)
-                       .setDescriptorCount(static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT) * 2);
+                       .setDescriptorCount(setCount * 15);
 
     vk::DescriptorPoolCreateInfo poolCreateInfo = vk::DescriptorPoolCreateInfo()
                                                       .setPoolSizeCount(static_cast<uint32_t>(poolSizes.size()))
                                                       .setPPoolSizes(poolSizes.data())
-                                                      .setMaxSets(static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+                                                      .setMaxSets(setCount);
 
     vk::Result result = logicalDevice.createDescriptorPool(&poolCreateInfo, nullptr, &computeDescriptorPool);
     if (result != vk::Result::eSuccess)
@@ -1683,14 +2601,14 @@ void Application::createComputeDescriptorPool()
 
 void Application::createGraphicsDescriptorSets()
 {
-    std::vector<vk::DescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, graphicsDescriptorSetLayout);
+    std::vector<vk::DescriptorSetLayout> layouts(framesInFlight, graphicsDescriptorSetLayout);
 
     vk::DescriptorSetAllocateInfo allocateInfo = vk::DescriptorSetAllocateInfo()
                                                      .setDescriptorPool(graphicsDescriptorPool)
-                                                     .setDescriptorSetCount(static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT))
+                                                     .setDescriptorSetCount(framesInFlight)
                                                      .setPSetLayouts(layouts.data());
 
-    graphicsDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+    graphicsDescriptorSets.resize(framesInFlight);
 
     vk::Result result = logicalDevice.allocateDescriptorSets(&allocateInfo, graphicsDescriptorSets.data());
     if (result != vk::Result::eSuccess)
@@ -1698,7 +2616,9 @@ void Application::createGraphicsDescriptorSets()
         throw std::runtime_error("Failed to allocate descriptor sets! Error Code: " + vk::to_string(result));
     }
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    frameTextureImageViews.assign(framesInFlight, isTextureResident ? textureImageView : placeholderTextureImageView);
+
+    for (size_t i = 0; i < framesInFlight; i++)
     {
         vk::DescriptorBufferInfo bufferInfo = vk::DescriptorBufferInfo()
                                                   .setBuffer(uniformBuffers[i])
@@ -1707,15 +2627,10 @@ void Application::createGraphicsDescriptorSets()
 
         vk::DescriptorImageInfo imageInfo = vk::DescriptorImageInfo()
                                                 .setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
-                                                .setImageView(textureImageView)
+                                                .setImageView(frameTextureImageViews[i])
                                                 .setSampler(textureSampler);
 
-        vk::DescriptorBufferInfo ssboBufferInfo = vk::DescriptorBufferInfo()
-                                                      .setBuffer(shaderStorageBuffers[i])
-                                                      .setOffset(0)
-                                                      .setRange(vk::WholeSize);
-
-        std::array<vk::WriteDescriptorSet, 3> descriptorWrites{};
+        std::array<vk::WriteDescriptorSet, 2> descriptorWrites{};
 
         descriptorWrites[0] = vk::WriteDescriptorSet()
                                   .setDstSet(graphicsDescriptorSets[i])
@@ -1733,69 +2648,315 @@ void Application::createGraphicsDescriptorSets()
                                   .setDescriptorCount(1)
                                   .setPImageInfo(&imageInfo);
 
-        descriptorWrites[2] = vk::WriteDescriptorSet()
-                                  .setDstSet(graphicsDescriptorSets[i])
-                                  .setDstBinding(2)
-                                  .setDstArrayElement(0)
-                                  .setDescriptorType(vk::DescriptorType::eStorageBuffer)
-                                  .setDescriptorCount(1)
-                                  .setPBufferInfo(&ssboBufferInfo);
-
         logicalDevice.updateDescriptorSets(static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
     }
 }
 
-void Application::createTextureImage(const char *texturePath)
+// Nothing here needs the device, so both jobs overlap the pipeline creation that follows
+void Application::startAssetLoads()
+{
+    assetLoader.Create();
+
+    modelLoad = assetLoader.Submit([this]()
+                                   { footballModel.LoadMeshData(MODEL_PATH.c_str()); });
+    textureLoad = assetLoader.Submit([this]()
+                                     { return readTexture(); });
+}
+
+// Called once the current frame slot is free, so its descriptor set can be rewritten
+void Application::updateStreamedAssets()
+{
+    if (AssetLoader::IsReady(textureLoad))
+    {
+        uploadTexture(textureLoad.get());
+    }
+
+    if (isTextureResident && frameTextureImageViews[currentFrame] != textureImageView)
+    {
+        frameTextureImageViews[currentFrame] = textureImageView;
+
+        vk::DescriptorImageInfo imageInfo = vk::DescriptorImageInfo()
+                                                .setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+                                                .setImageView(textureImageView)
+                                                .setSampler(textureSampler);
+
+        vk::WriteDescriptorSet descriptorWrite = vk::WriteDescriptorSet()
+                                                     .setDstSet(graphicsDescriptorSets[currentFrame])
+                                                     .setDstBinding(1)
+                                                     .setDstArrayElement(0)
+                                                     .setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+                                                     .setDescriptorCount(1)
+                                                     .setPImageInfo(&imageInfo);
+
+        logicalDevice.updateDescriptorSets(1, &descriptorWrite, 0, nullptr);
+    }
+}
+
+// The upload batches are only checked on the host, so the graphics queue never waits on the transfer queue. Once one
+// has completed, its acquire half is recorded here and everything recorded after it may use the asset.
+void Application::recordStreamedAssetAcquires(vk::CommandBuffer commandBuffer)
+{
+    if (!isModelResident && transferStagingRing.IsComplete(logicalDevice, modelUploadValue))
+    {
+        footballModel.RecordMeshAcquire(commandBuffer, transferQueueFamily, graphicsQueueFamily);
+        isModelResident = true;
+    }
+
+    if (!isTextureResident && textureUploadRing && textureUploadRing->IsComplete(logicalDevice, textureUploadValue))
+    {
+        if (textureUploadQueueFamily != graphicsQueueFamily)
+        {
+            recordTextureOwnershipBarrier(commandBuffer, vk::PipelineStageFlagBits::eTopOfPipe, vk::AccessFlags(),
+                                          vk::PipelineStageFlagBits::eFragmentShader, vk::AccessFlagBits::eShaderRead);
+        }
+        isTextureResident = true;
+    }
+}
+
+// Runs on an asset loader thread: the first of COMPRESSED_TEXTURE_PATHS the device can sample, otherwise the decoded PNG,
+// whose mips are generated after upload
+Application::TextureData Application::readTexture()
 {
+    TextureData textureData{};
+    if (readCompressedTexture(textureData))
+    {
+        return textureData;
+    }
+
     int textureWidth;
     int textureHeight;
     int textureChannels;
 
-    stbi_uc *pixels = stbi_load(texturePath, &textureWidth, &textureHeight, &textureChannels,
+    stbi_uc *pixels = stbi_load(TEXTURE_PATH.c_str(), &textureWidth, &textureHeight, &textureChannels,
                                 STBI_rgb_alpha);
-    vk::DeviceSize imageSize = textureWidth * textureHeight * 4;
-    mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(textureWidth, textureHeight)))) + 1;
-
     if (!pixels)
     {
         throw std::runtime_error("Failed to load texture image!");
     }
 
-    vk::Buffer stagingBuffer;
-    vk::DeviceMemory stagingBufferMemory;
-
-    createBuffer(imageSize, vk::BufferUsageFlagBits::eTransferSrc,
-                 vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer,
-                 stagingBufferMemory);
-
-    void *data;
-    vk::Result result = logicalDevice.mapMemory(stagingBufferMemory, 0, imageSize, vk::MemoryMapFlags(), &data);
-    if (result != vk::Result::eSuccess)
-    {
-        throw std::runtime_error("Failed to map image texture buffer memory! Error Code: " + vk::to_string(result));
-    }
+    textureData.path = TEXTURE_PATH;
+    textureData.format = vk::Format::eR8G8B8A8Srgb;
+    textureData.width = static_cast<uint32_t>(textureWidth);
+    textureData.height = static_cast<uint32_t>(textureHeight);
+    textureData.levelCount = static_cast<uint32_t>(std::floor(std::log2(std::max(textureWidth, textureHeight)))) + 1;
+    textureData.isMipGenerationNeeded = true;
+    textureData.data.assign(pixels, pixels + textureData.width * textureData.height * 4);
+    textureData.levelOffsets = {0};
+
+    stbi_image_free(pixels);
+
+    return textureData;
+}
+
+// Reads every mip level straight from the file with no decoding or mip generation. Returns false when none of
+// COMPRESSED_TEXTURE_PATHS is usable so the PNG can be loaded instead.
+bool Application::readCompressedTexture(TextureData &textureData)
+{
+    const vk::FormatFeatureFlags REQUIRED_FORMAT_FEATURES = vk::FormatFeatureFlagBits::eSampledImage | vk::FormatFeatureFlagBits::eSampledImageFilterLinear | vk::FormatFeatureFlagBits::eTransferDst;
+
+    for (const std::string &texturePath : COMPRESSED_TEXTURE_PATHS)
+    {
+        std::ifstream file(texturePath, std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+        {
+            continue;
+        }
+
+        uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+        file.seekg(0);
+
+        Ktx2::Header header{};
+        if (fileSize < sizeof(header) || !file.read(reinterpret_cast<char *>(&header), sizeof(header)))
+        {
+            continue;
+        }
+
+        // A level count of 0 asks for the mip chain to be generated at load time, which is what this path avoids
+        if (memcmp(header.identifier, Ktx2::IDENTIFIER, sizeof(header.identifier)) != 0 || header.supercompressionScheme != 0 ||
+            header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1 || header.levelCount == 0)
+        {
+            std::cerr << "Skipping " << texturePath << ", only uncompressed 2D KTX2 textures with a mip chain are supported" << std::endl;
+            continue;
+        }
+
+        vk::Format format = static_cast<vk::Format>(header.vkFormat);
+        if ((physicalDevice.getFormatProperties(format).optimalTilingFeatures & REQUIRED_FORMAT_FEATURES) != REQUIRED_FORMAT_FEATURES)
+        {
+            continue;
+        }
+
+        std::vector<Ktx2::LevelIndex> levelIndices(header.levelCount);
+        if (!file.read(reinterpret_cast<char *>(levelIndices.data()), sizeof(Ktx2::LevelIndex) * levelIndices.size()))
+        {
+            continue;
+        }
+
+        vk::DeviceSize dataSize = 0;
+        std::vector<vk::DeviceSize> levelOffsets(header.levelCount);
+        bool areLevelsValid = true;
+        for (uint32_t level = 0; level < header.levelCount; level++)
+        {
+            areLevelsValid = areLevelsValid && levelIndices[level].byteLength > 0 &&
+                             levelIndices[level].byteOffset + levelIndices[level].byteLength <= fileSize;
+
+            levelOffsets[level] = (dataSize + TEXTURE_LEVEL_ALIGNMENT - 1) / TEXTURE_LEVEL_ALIGNMENT * TEXTURE_LEVEL_ALIGNMENT;
+            dataSize = levelOffsets[level] + levelIndices[level].byteLength;
+        }
+
+        if (!areLevelsValid)
+        {
+            std::cerr << "Skipping " << texturePath << ", its level index is out of bounds" << std::endl;
+            continue;
+        }
+
+        std::vector<char> data(dataSize);
+        for (uint32_t level = 0; level < header.levelCount; level++)
+        {
+            file.seekg(static_cast<std::streamoff>(levelIndices[level].byteOffset));
+            file.read(data.data() + levelOffsets[level], static_cast<std::streamsize>(levelIndices[level].byteLength));
+        }
+
+        if (!file)
+        {
+            std::cerr << "Skipping " << texturePath << ", failed to read its levels" << std::endl;
+            continue;
+        }
+
+        textureData.path = texturePath;
+        textureData.format = format;
+        textureData.width = header.pixelWidth;
+        textureData.height = header.pixelHeight;
+        textureData.levelCount = header.levelCount;
+        textureData.isMipGenerationNeeded = false;
+        textureData.data = std::move(data);
+        textureData.levelOffsets = std::move(levelOffsets);
+        return true;
+    }
+
+    return false;
+}
+
+// Complete mip chains go through the transfer queue and are released to the graphics queue family. Mip generation
+// needs blits, which transfer-only queues lack, so the PNG's copy and blits are recorded on the graphics queue instead.
+// Either way the texture is only bound once recordStreamedAssetAcquires() has seen its upload complete.
+void Application::uploadTexture(const TextureData &textureData)
+{
+    bool isTransferQueueUsed = !textureData.isMipGenerationNeeded;
+    StagingRing &stagingRing = isTransferQueueUsed ? transferStagingRing : graphicsStagingRing;
+
+    StagingRing::Region stagingRegion = stagingRing.Stage(memoryAllocator, logicalDevice, textureData.data.size(), TEXTURE_LEVEL_ALIGNMENT);
+    memcpy(stagingRegion.mapped, textureData.data.data(), textureData.data.size());
+
+    mipLevels = textureData.levelCount;
+    textureFormat = textureData.format;
+
+    vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+    if (textureData.isMipGenerationNeeded)
+    {
+        usage |= vk::ImageUsageFlagBits::eTransferSrc;
+    }
+
+    createImage(textureData.width, textureData.height, mipLevels, vk::SampleCountFlagBits::e1, textureFormat, vk::ImageTiling::eOptimal, usage,
+                vk::MemoryPropertyFlagBits::eDeviceLocal, textureImage, textureImageMemory);
+    textureImageView = createImageView(textureImage, textureFormat, vk::ImageAspectFlagBits::eColor, mipLevels);
+
+    vk::CommandBuffer commandBuffer = stagingRing.GetCommandBuffer(logicalDevice);
+    transitionImageLayout(commandBuffer, textureImage, textureFormat, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, mipLevels);
+
+    if (textureData.isMipGenerationNeeded)
+    {
+        copyBufferToImage(commandBuffer, stagingRegion.buffer, stagingRegion.offset, textureImage, textureData.width, textureData.height);
+        generateMipmaps(commandBuffer, textureImage, textureFormat, static_cast<int32_t>(textureData.width), static_cast<int32_t>(textureData.height), mipLevels);
+
+        textureUploadQueueFamily = graphicsQueueFamily;
+    }
+    else
+    {
+        std::vector<vk::BufferImageCopy> regions;
+        for (uint32_t level = 0; level < mipLevels; level++)
+        {
+            regions.push_back(vk::BufferImageCopy()
+                                  .setBufferOffset(stagingRegion.offset + textureData.levelOffsets[level])
+                                  .setBufferRowLength(0)
+                                  .setBufferImageHeight(0)
+                                  .setImageSubresource(
+                                      vk::ImageSubresourceLayers()
+                                          .setAspectMask(vk::ImageAspectFlagBits::eColor)
+                                          .setMipLevel(level)
+                                          .setBaseArrayLayer(0)
+                                          .setLayerCount(1))
+                                  .setImageOffset(vk::Offset3D(0, 0, 0))
+                                  .setImageExtent(vk::Extent3D(std::max(textureData.width >> level, 1u), std::max(textureData.height >> level, 1u), 1)));
+        }
+        commandBuffer.copyBufferToImage(stagingRegion.buffer, textureImage, vk::ImageLayout::eTransferDstOptimal, static_cast<uint32_t>(regions.size()), regions.data());
+
+        textureUploadQueueFamily = transferQueueFamily;
+        if (textureUploadQueueFamily != graphicsQueueFamily)
+        {
+            // Release half, the transfer queue may not support the fragment shader stage
+            recordTextureOwnershipBarrier(commandBuffer, vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite,
+                                          vk::PipelineStageFlagBits::eBottomOfPipe, vk::AccessFlags());
+        }
+        else
+        {
+            transitionImageLayout(commandBuffer, textureImage, textureFormat, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, mipLevels);
+        }
+    }
+
+    textureUploadRing = &stagingRing;
+    textureUploadValue = stagingRing.Flush();
 
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
+    std::cout << "Streaming " << textureData.path << " (" << vk::to_string(textureFormat) << ", " << mipLevels << " levels)" << std::endl;
+}
 
-    logicalDevice.unmapMemory(stagingBufferMemory);
+// One half of the texture's transfer queue to graphics queue family ownership transfer, recorded as the release on the
+// transfer queue and again as the acquire on the graphics queue. The layout changes once, between the two.
+void Application::recordTextureOwnershipBarrier(vk::CommandBuffer commandBuffer, vk::PipelineStageFlags srcStage, vk::AccessFlags srcAccess, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess)
+{
+    vk::ImageMemoryBarrier imageMemoryBarrier = vk::ImageMemoryBarrier()
+                                                    .setSrcAccessMask(srcAccess)
+                                                    .setDstAccessMask(dstAccess)
+                                                    .setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+                                                    .setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+                                                    .setSrcQueueFamilyIndex(textureUploadQueueFamily)
+                                                    .setDstQueueFamilyIndex(graphicsQueueFamily)
+                                                    .setImage(textureImage)
+                                                    .setSubresourceRange(
+                                                        vk::ImageSubresourceRange()
+                                                            .setAspectMask(vk::ImageAspectFlagBits::eColor)
+                                                            .setBaseMipLevel(0)
+                                                            .setLevelCount(mipLevels)
+                                                            .setBaseArrayLayer(0)
+                                                            .setLayerCount(1));
 
-    stbi_image_free(pixels);
+    commandBuffer.pipelineBarrier(srcStage, dstStage,
+                                  vk::DependencyFlags(),
+                                  0, nullptr,
+                                  0, nullptr,
+                                  1, &imageMemoryBarrier);
+}
 
-    createImage(textureWidth, textureHeight, mipLevels, vk::SampleCountFlagBits::e1, vk::Format::eR8G8B8A8Srgb, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
-                vk::MemoryPropertyFlagBits::eDeviceLocal, textureImage, textureImageMemory);
+// Bound until the streamed texture is resident, a single grey texel uploaded with the startup batch
+void Application::createPlaceholderTexture()
+{
+    const std::array<uint8_t, 4> PLACEHOLDER_TEXEL = {128, 128, 128, 255};
 
-    transitionImageLayout(textureImage, vk::Format::eR8G8B8A8Srgb, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, mipLevels);
-    copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(textureWidth), static_cast<uint32_t>(textureHeight));
+    StagingRing::Region stagingRegion = graphicsStagingRing.Stage(memoryAllocator, logicalDevice, PLACEHOLDER_TEXEL.size());
+    memcpy(stagingRegion.mapped, PLACEHOLDER_TEXEL.data(), PLACEHOLDER_TEXEL.size());
 
-    logicalDevice.destroyBuffer(stagingBuffer);
-    logicalDevice.freeMemory(stagingBufferMemory);
+    createImage(1, 1, 1, vk::SampleCountFlagBits::e1, vk::Format::eR8G8B8A8Srgb, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+                vk::MemoryPropertyFlagBits::eDeviceLocal, placeholderTextureImage, placeholderTextureImageMemory);
+    placeholderTextureImageView = createImageView(placeholderTextureImage, vk::Format::eR8G8B8A8Srgb, vk::ImageAspectFlagBits::eColor, 1);
 
-    generateMipmaps(textureImage, vk::Format::eR8G8B8A8Srgb, textureWidth, textureHeight, mipLevels);
+    vk::CommandBuffer commandBuffer = graphicsStagingRing.GetCommandBuffer(logicalDevice);
+    transitionImageLayout(commandBuffer, placeholderTextureImage, vk::Format::eR8G8B8A8Srgb, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, 1);
+    copyBufferToImage(commandBuffer, stagingRegion.buffer, stagingRegion.offset, placeholderTextureImage, 1, 1);
+    transitionImageLayout(commandBuffer, placeholderTextureImage, vk::Format::eR8G8B8A8Srgb, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, 1);
 }
 
 void Application::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, vk::SampleCountFlagBits numSamples,
                               vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage,
-                              vk::MemoryPropertyFlags properties, vk::Image &image, vk::DeviceMemory &imageMemory)
+                              vk::MemoryPropertyFlags properties, vk::Image &image, MemoryAllocator::Allocation &imageMemory)
 {
     vk::ImageCreateInfo imageCreateInfo = vk::ImageCreateInfo()
                                               .setImageType(vk::ImageType::e2D)
@@ -1819,70 +2980,11 @@ void Application::createImage(uint32_t width, uint32_t height, uint32_t mipLevel
         throw std::runtime_error("Failed to create image! Error Code: " + vk::to_string(result));
     }
 
-    vk::MemoryRequirements memoryRequirements;
-    logicalDevice.getImageMemoryRequirements(image, &memoryRequirements);
-
-    vk::MemoryAllocateInfo allocateInfo = vk::MemoryAllocateInfo()
-                                              .setAllocationSize(memoryRequirements.size)
-                                              .setMemoryTypeIndex(findMemoryType(memoryRequirements.memoryTypeBits, properties));
-
-    result = logicalDevice.allocateMemory(&allocateInfo, nullptr, &imageMemory);
-    if (result != vk::Result::eSuccess)
-    {
-        throw std::runtime_error("Failed to allocate image memory! Error Code: " + vk::to_string(result));
-    }
-
-    logicalDevice.bindImageMemory(image, imageMemory, 0);
-}
-
-vk::CommandBuffer Application::beginSingleTimeCommands(vk::CommandPool commandPool)
-{
-    vk::CommandBufferAllocateInfo allocateInfo = vk::CommandBufferAllocateInfo()
-                                                     .setLevel(vk::CommandBufferLevel::ePrimary)
-                                                     .setCommandPool(commandPool)
-                                                     .setCommandBufferCount(1);
-
-    vk::CommandBuffer commandBuffer;
-    vk::Result result = logicalDevice.allocateCommandBuffers(&allocateInfo, &commandBuffer);
-    if (result != vk::Result::eSuccess)
-    {
-        throw std::runtime_error("Failed to allocate command buffers! Error Code: " + vk::to_string(result));
-    }
-
-    vk::CommandBufferBeginInfo commandBufferBeginInfo = vk::CommandBufferBeginInfo()
-                                                            .setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-
-    result = commandBuffer.begin(&commandBufferBeginInfo);
-    if (result != vk::Result::eSuccess)
-    {
-        throw std::runtime_error("Failed to begin command buffer! Error Code: " + vk::to_string(result));
-    }
-
-    return commandBuffer;
-}
-
-void Application::endSingleTimeCommands(vk::CommandBuffer commandBuffer, vk::CommandPool commandPool)
-{
-    commandBuffer.end();
-
-    vk::SubmitInfo submitInfo = vk::SubmitInfo()
-                                    .setCommandBufferCount(1)
-                                    .setPCommandBuffers(&commandBuffer);
-
-    vk::Result result = graphicsQueue.submit(1, &submitInfo, VK_NULL_HANDLE);
-    if (result != vk::Result::eSuccess)
-    {
-        throw std::runtime_error("Failed to submit command buffer to graphics queue! Error Code: " + vk::to_string(result));
-    }
-    graphicsQueue.waitIdle();
-
-    logicalDevice.freeCommandBuffers(commandPool, 1, &commandBuffer);
+    imageMemory = memoryAllocator.AllocateImage(logicalDevice, image, properties);
 }
 
-void Application::transitionImageLayout(vk::Image image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, uint32_t mipLevels)
+void Application::transitionImageLayout(vk::CommandBuffer commandBuffer, vk::Image image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, uint32_t mipLevels)
 {
-    vk::CommandBuffer commandBuffer = beginSingleTimeCommands(commandPool);
-
     vk::ImageMemoryBarrier imageMemoryBarrier = vk::ImageMemoryBarrier()
                                                     .setOldLayout(oldLayout)
                                                     .setNewLayout(newLayout)
@@ -1926,16 +3028,12 @@ void Application::transitionImageLayout(vk::Image image, vk::Format format, vk::
                                   0, nullptr,
                                   0, nullptr,
                                   1, &imageMemoryBarrier);
-
-    endSingleTimeCommands(commandBuffer, commandPool);
 }
 
-void Application::copyBufferToImage(vk::Buffer buffer, vk::Image image, uint32_t width, uint32_t height)
+void Application::copyBufferToImage(vk::CommandBuffer commandBuffer, vk::Buffer buffer, vk::DeviceSize bufferOffset, vk::Image image, uint32_t width, uint32_t height)
 {
-    vk::CommandBuffer commandBuffer = beginSingleTimeCommands(commandPool);
-
     vk::BufferImageCopy region = vk::BufferImageCopy()
-                                     .setBufferOffset(0)
+                                     .setBufferOffset(bufferOffset)
                                      .setBufferRowLength(0)
                                      .setBufferImageHeight(0)
                                      .setImageSubresource(
@@ -1948,7 +3046,6 @@ void Application::copyBufferToImage(vk::Buffer buffer, vk::Image image, uint32_t
                                      .setImageExtent(vk::Extent3D(width, height, 1));
 
     commandBuffer.copyBufferToImage(buffer, image, vk::ImageLayout::eTransferDstOptimal, 1, &region);
-    endSingleTimeCommands(commandBuffer, commandPool);
 }
 
 vk::ImageView Application::createImageView(vk::Image image, vk::Format format, vk::ImageAspectFlags aspectFlags, uint32_t mipLevels)
@@ -1971,11 +3068,6 @@ vk::ImageView Application::createImageView(vk::Image image, vk::Format format, v
     return imageView;
 }
 
-void Application::createTextureImageView()
-{
-    textureImageView = createImageView(textureImage, vk::Format::eR8G8B8A8Srgb, vk::ImageAspectFlagBits::eColor, mipLevels);
-}
-
 void Application::createTextureSampler()
 {
     vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
@@ -1995,7 +3087,8 @@ void Application::createTextureSampler()
                                                   .setMipmapMode(vk::SamplerMipmapMode::eLinear)
                                                   .setMipLodBias(0.0f)
                                                   .setMinLod(0.0f)
-                                                  .setMaxLod(static_cast<float>(mipLevels));
+                                                  // Created before the streamed texture's level count is known, each view clamps to its own levels
+                                                  .setMaxLod(vk::LodClampNone);
 
     vk::Result result = logicalDevice.createSampler(&samplerCreateInfo, nullptr, &textureSampler);
     if (result != vk::Result::eSuccess)
@@ -2008,12 +3101,38 @@ void Application::createDepthResources()
 {
     vk::Format depthFormat = findDepthFormat();
 
+    vk::ImageUsageFlags depthUsage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
+    if (isDepthAttachmentSampled)
+    {
+        depthUsage |= vk::ImageUsageFlagBits::eSampled;
+    }
+
     createImage(swapChainExtent.width, swapChainExtent.height, 1, msaaSamples, depthFormat, vk::ImageTiling::eOptimal,
-                vk::ImageUsageFlagBits::eDepthStencilAttachment, vk::MemoryPropertyFlagBits::eDeviceLocal, depthImage,
-                depthImageMemory);
+                depthUsage, vk::MemoryPropertyFlagBits::eDeviceLocal, depthImage, depthImageMemory);
     depthImageView = createImageView(depthImage, depthFormat, vk::ImageAspectFlagBits::eDepth, 1);
 }
 
+// The occlusion culling pyramid follows the depth attachment's size
+void Application::createDepthPyramid()
+{
+    vk::ImageAspectFlags depthAspect = vk::ImageAspectFlagBits::eDepth;
+    if (hasStencilComponent(findDepthFormat()))
+    {
+        depthAspect |= vk::ImageAspectFlagBits::eStencil;
+    }
+
+    occlusionCuller.CreateDepthPyramid(memoryAllocator, logicalDevice, depthImage, isDepthAttachmentSampled ? depthImageView : nullptr, depthAspect, msaaSamples,
+                                       swapChainExtent);
+}
+
+void Application::createSplatTarget()
+{
+    if (isSplatRenderingSupported)
+    {
+        splatRenderer.CreateTarget(memoryAllocator, logicalDevice, swapChainExtent);
+    }
+}
+
 vk::Format Application::findSupportedFormat(const std::vector<vk::Format> &candidates, vk::ImageTiling tiling, vk::FormatFeatureFlags features)
 {
     for (vk::Format format : candidates)
@@ -2047,8 +3166,8 @@ bool Application::hasStencilComponent(vk::Format format)
     return format == vk::Format::eD32SfloatS8Uint || format == vk::Format::eD24UnormS8Uint;
 }
 
-// Create a way to pre-generate mipmap levels as a way to cache them for faster runtime texture loading...
-void Application::generateMipmaps(vk::Image image, vk::Format imageFormat, int32_t textureWidth, int32_t textureHeight, uint32_t mipLevels)
+// Runtime mip generation for textures without a pre-compressed copy, see uploadTexture()
+void Application::generateMipmaps(vk::CommandBuffer commandBuffer, vk::Image image, vk::Format imageFormat, int32_t textureWidth, int32_t textureHeight, uint32_t mipLevels)
 {
     // Check if linear blitting is supported
     vk::FormatProperties formatProperties;
@@ -2059,8 +3178,6 @@ void Application::generateMipmaps(vk::Image image, vk::Format imageFormat, int32
         throw std::runtime_error("Texture image format does not support linear blitting!");
     }
 
-    vk::CommandBuffer commandBuffer = beginSingleTimeCommands(commandPool);
-
     vk::ImageMemoryBarrier barrier = vk::ImageMemoryBarrier()
                                          .setImage(image)
                                          .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
@@ -2145,8 +3262,6 @@ void Application::generateMipmaps(vk::Image image, vk::Format imageFormat, int32
                                   0, nullptr,
                                   0, nullptr,
                                   1, &barrier);
-
-    endSingleTimeCommands(commandBuffer, commandPool);
 }
 
 vk::SampleCountFlagBits Application::getMaxUsableSampleCount()
@@ -2183,8 +3298,55 @@ vk::SampleCountFlagBits Application::getMaxUsableSampleCount()
     return vk::SampleCountFlagBits::e1;
 }
 
+// Every per-object storage buffer has to fit in maxStorageBufferRange, and roughly what the physics resources, the
+// instance buffers and the culling candidates take per object has to fit in half the largest device local heap.
+uint32_t Application::getMaxPhysicsObjectCount()
+{
+    vk::PhysicalDeviceLimits physicalDeviceLimits = physicalDevice.getProperties().limits;
+    vk::PhysicalDeviceMemoryProperties memoryProperties = physicalDevice.getMemoryProperties();
+
+    vk::DeviceSize streamBytes = sizeof(glm::vec4) * PHYSICS_STREAM_COUNT;
+    // Up to four hash buckets per object once rounded up to a power of two
+    vk::DeviceSize gridCellBytes = sizeof(uint32_t) * 4;
+    vk::DeviceSize contactBytes = sizeof(Contact) * CONTACTS_PER_OBJECT;
+    // Every LOD of both culling phases shares one transform per object
+    vk::DeviceSize instanceBytes = sizeof(Model::InstanceTransform);
+    vk::DeviceSize bvhNodeBytes = sizeof(LinearBVH::Node) * 2;
+
+    vk::DeviceSize largestBufferBytes = std::max({streamBytes, gridCellBytes, contactBytes, instanceBytes, bvhNodeBytes});
+
+    vk::DeviceSize physicsBytes = PHYSICS_BUFFER_COUNT * streamBytes + sizeof(PhysicsMaterial) + 3 * gridCellBytes + 2 * sizeof(uint32_t) +
+                                  contactBytes + sizeof(BodyDelta) + sizeof(uint32_t);
+    // Morton keys and values twice, the nodes, their parents and refit counters
+    vk::DeviceSize bvhBytes = 4 * sizeof(uint32_t) + bvhNodeBytes + 3 * sizeof(uint32_t);
+    // Instance transforms, the candidate transforms, both candidate lists and the draw slots
+    vk::DeviceSize frameBytes = instanceBytes + sizeof(Model::InstanceTransform) + 3 * sizeof(uint32_t);
+    vk::DeviceSize objectBytes = physicsBytes + bvhBytes + framesInFlight * frameBytes;
+
+    vk::DeviceSize deviceLocalHeapSize = 0;
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+    {
+        if (memoryProperties.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal)
+        {
+            deviceLocalHeapSize = std::max(deviceLocalHeapSize, memoryProperties.memoryHeaps[i].size);
+        }
+    }
+
+    vk::DeviceSize maxObjectCount = std::min({static_cast<vk::DeviceSize>(MAX_PHYSICS_OBJECT_COUNT),
+                                              physicalDeviceLimits.maxStorageBufferRange / largestBufferBytes,
+                                              deviceLocalHeapSize / 2 / objectBytes});
+
+    return static_cast<uint32_t>(maxObjectCount);
+}
+
 void Application::createColorResources()
 {
+    // Only the multisampled frame needs a color image of its own, see createRenderPass()
+    if (msaaSamples == vk::SampleCountFlagBits::e1)
+    {
+        return;
+    }
+
     vk::Format colorFormat = swapChainImageFormat;
 
     createImage(swapChainExtent.width, swapChainExtent.height, 1, msaaSamples, colorFormat, vk::ImageTiling::eOptimal,
@@ -2196,14 +3358,16 @@ void Application::createColorResources()
 
 void Application::createComputeDescriptorSets()
 {
-    std::vector<vk::DescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, computeDescriptorSetLayout);
+    // One set per frame in flight and physics buffer written, the other physics buffer is the substep's input
+    uint32_t setCount = framesInFlight * PHYSICS_BUFFER_COUNT;
+    std::vector<vk::DescriptorSetLayout> layouts(setCount, computeDescriptorSetLayout);
 
     vk::DescriptorSetAllocateInfo allocateInfo = vk::DescriptorSetAllocateInfo()
                                                      .setDescriptorPool(computeDescriptorPool)
-                                                     .setDescriptorSetCount(static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT))
+                                                     .setDescriptorSetCount(setCount)
                                                      .setPSetLayouts(layouts.data());
 
-    computeDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+    computeDescriptorSets.resize(setCount);
 
     vk::Result result = logicalDevice.allocateDescriptorSets(&allocateInfo, computeDescriptorSets.data());
     if (result != vk::Result::eSuccess)
@@ -2211,24 +3375,42 @@ void Application::createComputeDescriptorSets()
         throw std::runtime_error("Failed to allocate compute descriptor sets! Error Code: " + vk::to_string(result));
     }
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (uint32_t i = 0; i < setCount; i++)
     {
+        uint32_t frame = i / PHYSICS_BUFFER_COUNT;
+        uint32_t physicsBuffer = i % PHYSICS_BUFFER_COUNT;
+
         vk::DescriptorBufferInfo uniformBufferInfo = vk::DescriptorBufferInfo()
-                                                         .setBuffer(computeUniformBuffers[i])
+                                                         .setBuffer(computeUniformBuffers[frame])
                                                          .setOffset(0)
                                                          .setRange(sizeof(ComputeUniformBufferObject));
 
-        vk::DescriptorBufferInfo storageBufferInfoLastFrame = vk::DescriptorBufferInfo()
-                                                                  .setBuffer(shaderStorageBuffers[(i - 1) % MAX_FRAMES_IN_FLIGHT])
+        vk::DescriptorBufferInfo storageBufferInfoPreviousStep = vk::DescriptorBufferInfo()
+                                                                  .setBuffer(shaderStorageBuffers[(physicsBuffer + 1) % PHYSICS_BUFFER_COUNT])
                                                                   .setOffset(0)
-                                                                  .setRange(sizeof(PhysicsObject) * PHYSICS_OBJECT_COUNT);
+                                                                  .setRange(sizeof(glm::vec4) * PHYSICS_STREAM_COUNT * physicsObjectCount);
 
-        vk::DescriptorBufferInfo storageBufferInfoCurrentFrame = vk::DescriptorBufferInfo()
-                                                                     .setBuffer(shaderStorageBuffers[i])
+        vk::DescriptorBufferInfo storageBufferInfoCurrentStep = vk::DescriptorBufferInfo()
+                                                                     .setBuffer(shaderStorageBuffers[physicsBuffer])
                                                                      .setOffset(0)
-                                                                     .setRange(sizeof(PhysicsObject) * PHYSICS_OBJECT_COUNT);
-
-        std::array<vk::WriteDescriptorSet, 3> descriptorWrites;
+                                                                     .setRange(sizeof(glm::vec4) * PHYSICS_STREAM_COUNT * physicsObjectCount);
+
+        std::array<vk::DescriptorBufferInfo, 13> broadphaseBufferInfos = {
+            vk::DescriptorBufferInfo().setBuffer(gridCellCountBuffer).setOffset(0).setRange(vk::WholeSize),
+            vk::DescriptorBufferInfo().setBuffer(gridCellStartBuffer).setOffset(0).setRange(vk::WholeSize),
+            vk::DescriptorBufferInfo().setBuffer(gridCellCursorBuffer).setOffset(0).setRange(vk::WholeSize),
+            vk::DescriptorBufferInfo().setBuffer(gridBodyCellBuffer).setOffset(0).setRange(vk::WholeSize),
+            vk::DescriptorBufferInfo().setBuffer(gridSortedBodyBuffer).setOffset(0).setRange(vk::WholeSize),
+            vk::DescriptorBufferInfo().setBuffer(physicsBVH.GetNodeBuffer()).setOffset(0).setRange(vk::WholeSize),
+            vk::DescriptorBufferInfo().setBuffer(contactHeaderBuffer).setOffset(0).setRange(vk::WholeSize),
+            vk::DescriptorBufferInfo().setBuffer(contactListBuffer).setOffset(0).setRange(vk::WholeSize),
+            vk::DescriptorBufferInfo().setBuffer(bodyDeltaBuffer).setOffset(0).setRange(vk::WholeSize),
+            vk::DescriptorBufferInfo().setBuffer(physicsMaterialBuffer).setOffset(0).setRange(vk::WholeSize),
+            vk::DescriptorBufferInfo().setBuffer(activeBodyBuffer).setOffset(0).setRange(vk::WholeSize),
+            vk::DescriptorBufferInfo().setBuffer(occlusionCuller.GetCandidateBuffer(frame)).setOffset(0).setRange(vk::WholeSize),
+            vk::DescriptorBufferInfo().setBuffer(occlusionCuller.GetCandidateHeaderBuffer(frame)).setOffset(0).setRange(vk::WholeSize)};
+
+        std::array<vk::WriteDescriptorSet, 16> descriptorWrites;
         descriptorWrites[0] = vk::WriteDescriptorSet()
                                   .setDstSet(computeDescriptorSets[i])
                                   .setDstBinding(0)
@@ -2243,7 +3425,7 @@ void Application::createComputeDescriptorSets()
                                   .setDstArrayElement(0)
                                   .setDescriptorType(vk::DescriptorType::eStorageBuffer)
                                   .setDescriptorCount(1)
-                                  .setPBufferInfo(&storageBufferInfoLastFrame);
+                                  .setPBufferInfo(&storageBufferInfoPreviousStep);
 
         descriptorWrites[2] = vk::WriteDescriptorSet()
                                   .setDstSet(computeDescriptorSets[i])
@@ -2251,15 +3433,26 @@ void Application::createComputeDescriptorSets()
                                   .setDstArrayElement(0)
                                   .setDescriptorType(vk::DescriptorType::eStorageBuffer)
                                   .setDescriptorCount(1)
-                                  .setPBufferInfo(&storageBufferInfoCurrentFrame);
+                                  .setPBufferInfo(&storageBufferInfoCurrentStep);
+
+        for (uint32_t j = 0; j < broadphaseBufferInfos.size(); j++)
+        {
+            descriptorWrites[3 + j] = vk::WriteDescriptorSet()
+                                          .setDstSet(computeDescriptorSets[i])
+                                          .setDstBinding(3 + j)
+                                          .setDstArrayElement(0)
+                                          .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                          .setDescriptorCount(1)
+                                          .setPBufferInfo(&broadphaseBufferInfos[j]);
+        }
 
-        logicalDevice.updateDescriptorSets(3, descriptorWrites.data(), 0, nullptr);
+        logicalDevice.updateDescriptorSets(static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
     }
 }
 
 void Application::createComputeCommandBuffers()
 {
-    computeCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    computeCommandBuffers.resize(framesInFlight);
 
     vk::CommandBufferAllocateInfo commandBufferAllocateInfo = vk::CommandBufferAllocateInfo()
                                                                   .setCommandPool(computeCommandPool)
@@ -2273,7 +3466,13 @@ void Application::createComputeCommandBuffers()
     }
 }
 
-void Application::recordComputeCommandBuffer(vk::CommandBuffer commandBuffer)
+// Compute descriptor sets are laid out frame-major, one per physics buffer the set writes to
+uint32_t Application::getPhysicsDescriptorSetIndex(uint32_t frame, uint32_t physicsBuffer)
+{
+    return frame * PHYSICS_BUFFER_COUNT + physicsBuffer;
+}
+
+void Application::recordComputeCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t substepCount)
 {
     vk::CommandBufferBeginInfo commandBufferBeginInfo;
 
@@ -2282,18 +3481,183 @@ void Application::recordComputeCommandBuffer(vk::CommandBuffer commandBuffer)
     {
         throw std::runtime_error("Failed to begin recording compute command buffer! Error Code: " + vk::to_string(result));
     }
-    logicalDevice.resetQueryPool(queryPool, 0, static_cast<uint32_t>(timeStamps.size()));
-    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, queryPool, 0);
+    uint32_t firstQuery = currentFrame * FRAME_QUERY_COUNT;
+    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, queryPool, firstQuery);
 
-    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, computePipeline);
-    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, computePipelineLayout, 0, 1, &computeDescriptorSets[currentFrame], 0, nullptr);
-    commandBuffer.dispatch(PHYSICS_OBJECT_COUNT / WORKGROUP_SIZE_X, 1, 1);
+    // Each substep writes the physics buffer that doesn't hold the latest state, so the state ping-pongs between the two
+    for (uint32_t substep = 0; substep < substepCount; substep++)
+    {
+        uint32_t targetBuffer = (physicsStateBuffer + 1) % PHYSICS_BUFFER_COUNT;
+        vk::DescriptorSet descriptorSet = computeDescriptorSets[getPhysicsDescriptorSetIndex(currentFrame, targetBuffer)];
+
+        recordPhysicsSubstep(commandBuffer, descriptorSet, targetBuffer, substep == 0);
+        physicsStateBuffer = targetBuffer;
+    }
 
-    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, queryPool, 1);
+    // The frustum culling pass appends to this frame's occlusion candidates and sizes the early occlusion cull's dispatch
+    OcclusionCuller::CandidateHeader candidateHeader{0, 1, 1, 0};
+    commandBuffer.updateBuffer(occlusionCuller.GetCandidateHeaderBuffer(currentFrame), 0, sizeof(candidateHeader), &candidateHeader);
+
+    // Bake the visible part of the latest state into this frame's candidate transforms. The graphics queue only ever reads the transforms,
+    // so the next frame's substeps are free to overwrite the physics buffers while this frame is still being drawn.
+    recordMemoryBarrier(commandBuffer,
+                        vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite,
+                        vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eHost, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eHostRead);
+
+    // Runs even without a substep, every frame in flight has its own candidate buffer to fill
+    vk::DescriptorSet stateDescriptorSet = computeDescriptorSets[getPhysicsDescriptorSetIndex(currentFrame, physicsStateBuffer)];
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, instanceTransformPipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, computePipelineLayout, 0, 1, &stateDescriptorSet, 0, nullptr);
+    commandBuffer.dispatch((physicsObjectCount + computeWorkgroup.size - 1) / computeWorkgroup.size, 1, 1);
+
+    // Release half of the candidate buffers' transfer to the graphics queue family, acquired in recordCommandBuffer()
+    recordBufferOwnershipBarrier(commandBuffer, occlusionCuller.GetCandidateBuffer(currentFrame),
+                                 vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderWrite,
+                                 vk::PipelineStageFlagBits::eBottomOfPipe, vk::AccessFlags());
+    recordBufferOwnershipBarrier(commandBuffer, occlusionCuller.GetCandidateHeaderBuffer(currentFrame),
+                                 vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderWrite,
+                                 vk::PipelineStageFlagBits::eBottomOfPipe, vk::AccessFlags());
+
+    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, queryPool, firstQuery + 1);
 
     commandBuffer.end();
 }
 
+// One fixed timestep of the whole simulation, reading the other physics buffer and writing physicsBuffer
+void Application::recordPhysicsSubstep(vk::CommandBuffer commandBuffer, vk::DescriptorSet descriptorSet, uint32_t physicsBuffer, bool isFirstSubstep)
+{
+    // Rounded up, the shaders discard the threads past the last body
+    uint32_t groupCount = (physicsObjectCount + computeWorkgroup.size - 1) / computeWorkgroup.size;
+
+    // The previous substep's output is this substep's input, and it last touched the shared grid and contact buffers.
+    // The indirect reads cover the headers the previous substep dispatched from.
+    recordMemoryBarrier(commandBuffer,
+                        vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eTransfer,
+                        vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite,
+                        vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eTransferWrite);
+
+    // The BVH broadphase leaves the grid cells alone, so its timings don't include the binning atomics
+    if (broadphaseMode == BroadphaseMode::eUniformGrid)
+    {
+        commandBuffer.fillBuffer(gridCellCountBuffer, 0, vk::WholeSize, 0);
+    }
+    commandBuffer.fillBuffer(contactHeaderBuffer, 0, vk::WholeSize, 0);
+    commandBuffer.fillBuffer(bodyDeltaBuffer, 0, vk::WholeSize, 0);
+
+    ActiveBodyHeader activeBodyHeader{0, 1, 1, 0};
+    commandBuffer.updateBuffer(activeBodyBuffer, 0, sizeof(ActiveBodyHeader), &activeBodyHeader);
+
+    recordMemoryBarrier(commandBuffer,
+                        vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite,
+                        vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+
+    // Sleep test over every body, awake ones are compacted into the active set the rest of the substep is dispatched over
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, compactActiveBodiesPipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, computePipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+    commandBuffer.dispatch(groupCount, 1, 1);
+
+    recordMemoryBarrier(commandBuffer,
+                        vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderWrite,
+                        vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader,
+                        vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+
+    // Integration, plane collisions and, for the grid broadphase, cell counting
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, computePipeline);
+    commandBuffer.dispatchIndirect(activeBodyBuffer, 0);
+
+    recordMemoryBarrier(commandBuffer,
+                        vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderWrite,
+                        vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+
+    if (broadphaseMode == BroadphaseMode::eLinearBVH)
+    {
+        // Build over this substep's integrated bodies, then traverse the tree for the narrowphase.
+        // Only the first substep's build phases are timed, queries can't be written twice without a reset.
+        physicsBVH.Record(commandBuffer, physicsBuffer, isFirstSubstep ? queryPool : vk::QueryPool(), currentFrame * FRAME_QUERY_COUNT + BVH_FIRST_TIMESTAMP);
+
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, collideBVHPipeline);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, computePipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+        commandBuffer.dispatchIndirect(activeBodyBuffer, 0);
+    }
+    else
+    {
+        // Cell counts -> cell start offsets
+        gridPrefixSum.Record(commandBuffer);
+
+        recordMemoryBarrier(commandBuffer,
+                            vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderWrite,
+                            vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferRead);
+
+        vk::BufferCopy cursorCopyRegion = vk::BufferCopy().setSize(sizeof(uint32_t) * gridHashSize);
+        commandBuffer.copyBuffer(gridCellStartBuffer, gridCellCursorBuffer, 1, &cursorCopyRegion);
+
+        recordMemoryBarrier(commandBuffer,
+                            vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite,
+                            vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+
+        // Counting sort of all bodies into their cells, sleeping ones included
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, gridScatterPipeline);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, computePipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+        commandBuffer.dispatch(groupCount, 1, 1);
+
+        recordMemoryBarrier(commandBuffer,
+                            vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderWrite,
+                            vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+
+        // Contact generation against the 27 neighbouring cells only
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, collidePipeline);
+        commandBuffer.dispatchIndirect(activeBodyBuffer, 0);
+    }
+
+    recordMemoryBarrier(commandBuffer,
+                        vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderWrite,
+                        vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+
+    // Size the solver from the number of contacts that were generated
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, contactDispatchPipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, computePipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+    commandBuffer.dispatch(1, 1, 1);
+
+    recordMemoryBarrier(commandBuffer,
+                        vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderWrite,
+                        vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+                        vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eTransferRead);
+
+    // One thread per contact, impulses are accumulated per body rather than written into other threads' bodies
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, solveContactsPipeline);
+    commandBuffer.dispatchIndirect(contactHeaderBuffer, 0);
+
+    vk::BufferCopy contactHeaderCopyRegion = vk::BufferCopy()
+                                                 .setDstOffset(offsetof(PhysicsReadback, contactHeader))
+                                                 .setSize(sizeof(ContactHeader));
+    commandBuffer.copyBuffer(contactHeaderBuffer, physicsReadbackBuffers[currentFrame], 1, &contactHeaderCopyRegion);
+
+    vk::BufferCopy activeBodyHeaderCopyRegion = vk::BufferCopy()
+                                                    .setDstOffset(offsetof(PhysicsReadback, activeBodyHeader))
+                                                    .setSize(sizeof(ActiveBodyHeader));
+    commandBuffer.copyBuffer(activeBodyBuffer, physicsReadbackBuffers[currentFrame], 1, &activeBodyHeaderCopyRegion);
+
+    recordMemoryBarrier(commandBuffer,
+                        vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderWrite,
+                        vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, applyContactsPipeline);
+    commandBuffer.dispatchIndirect(activeBodyBuffer, 0);
+}
+
+void Application::recordMemoryBarrier(vk::CommandBuffer commandBuffer, vk::PipelineStageFlags srcStage, vk::AccessFlags srcAccess, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess)
+{
+    vk::MemoryBarrier memoryBarrier = vk::MemoryBarrier()
+                                          .setSrcAccessMask(srcAccess)
+                                          .setDstAccessMask(dstAccess);
+
+    commandBuffer.pipelineBarrier(srcStage, dstStage,
+                                  vk::DependencyFlags(),
+                                  1, &memoryBarrier,
+                                  0, nullptr,
+                                  0, nullptr);
+}
+
 std::string Application::formatIntStringWithCommas(int number)
 {
     std::string numberString = std::to_string(number);
@@ -2325,19 +3689,19 @@ void Application::initImGui()
     imguiInitInfo.Device = logicalDevice;
     imguiInitInfo.QueueFamily = indices.graphicsAndComputeFamily.value();
     imguiInitInfo.Queue = graphicsQueue;
-    imguiInitInfo.PipelineCache = nullptr;
+    imguiInitInfo.PipelineCache = pipelineCache;
     imguiInitInfo.DescriptorPool = imguiDescriptorPool;
     imguiInitInfo.RenderPass = renderPass;
     imguiInitInfo.Subpass = 0;
-    imguiInitInfo.MinImageCount = MAX_FRAMES_IN_FLIGHT;
-    imguiInitInfo.ImageCount = MAX_FRAMES_IN_FLIGHT;
+    // ImGui needs at least two, it doesn't use the counts for anything else here
+    imguiInitInfo.MinImageCount = std::max(framesInFlight, 2u);
+    imguiInitInfo.ImageCount = std::max(framesInFlight, 2u);
     imguiInitInfo.MSAASamples = (VkSampleCountFlagBits)msaaSamples;
     imguiInitInfo.Allocator = nullptr;
     imguiInitInfo.CheckVkResultFn = nullptr;
 
     ImGui_ImplVulkan_Init(&imguiInitInfo);
 
-    objectString = "Number of Physics Objects: " + formatIntStringWithCommas(PHYSICS_OBJECT_COUNT);
 }
 
 void Application::createImGuiDescriptorPool()
@@ -2399,10 +3763,111 @@ void Application::drawOverlay()
         ImGui::Text(objectString.c_str());
         ImGui::Separator();
         ImGui::Text("Compute:                   %.3f ms", computePipelineTimeMS);
+        if (broadphaseMode == BroadphaseMode::eLinearBVH)
+        {
+            for (uint32_t i = 0; i < LinearBVH::eBuildPhaseCount; i++)
+            {
+                ImGui::Text("  BVH %-10s             %.3f ms", LinearBVH::GetPhaseName(static_cast<LinearBVH::BuildPhase>(i)), bvhPhaseTimesMS[i]);
+            }
+        }
+        ImGui::Text("Contacts:                  %u", contactCount);
+        if (bvhStackOverflowCount != 0)
+        {
+            ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "BVH stack overflows:       %u", bvhStackOverflowCount);
+        }
+        ImGui::Text("Active bodies:             %u", activeBodyCount);
+        // Only gathered by the occlusion culling passes, which splats skip
+        if (sphereRenderMode != SphereRenderMode::eSplat)
+        {
+            ImGui::Text("Visible bodies:            %u", occlusionStatistics.candidateCount);
+            ImGui::Text("Occluded (early / late):   %u / %u", occlusionStatistics.rejectedCounts[OcclusionCuller::eEarly],
+                        occlusionStatistics.rejectedCounts[OcclusionCuller::eLate]);
+            ImGui::Text("Drawn bodies:              %u", occlusionStatistics.candidateCount - occlusionStatistics.rejectedCounts[OcclusionCuller::eLate]);
+        }
+        if (sphereRenderMode == SphereRenderMode::eMesh)
+        {
+            for (uint32_t lod = 0; lod < footballModel.GetLodCount(); lod++)
+            {
+                uint32_t drawnCount = occlusionStatistics.drawnCounts[OcclusionCuller::eEarly][lod] + occlusionStatistics.drawnCounts[OcclusionCuller::eLate][lod];
+                ImGui::Text("  LOD %u (%5u triangles):   %u", lod, footballModel.GetLod(lod).indexCount / 3, drawnCount);
+            }
+        }
+        ImGui::Text("Physics substeps:          %u (%.0f Hz)", physicsSubstepCount, 1.0f / physicsTimeStep);
+        if (computeWorkgroup.subgroupSize != 0)
+        {
+            ImGui::Text("Workgroup size:            %u (subgroup %u)", computeWorkgroup.size, computeWorkgroup.subgroupSize);
+        }
+        else
+        {
+            ImGui::Text("Workgroup size:            %u", computeWorkgroup.size);
+        }
         ImGui::Text("Graphics:                  %.3f ms", graphicsPipelineTimeMS);
+        if (computeQueueFamily != graphicsQueueFamily)
+        {
+            ImGui::Text("Compute queue:             async (family %u)", computeQueueFamily);
+        }
+        else if (computeQueueIndex != 0)
+        {
+            ImGui::Text("Compute queue:             async (queue %u)", computeQueueIndex);
+        }
+        else
+        {
+            ImGui::Text("Compute queue:             shared with graphics");
+        }
+        ImGui::Text("Transfer queue:            %s", transferQueueFamily != graphicsQueueFamily ? "dedicated" : "shared with graphics");
+        if (!isModelResident || !isTextureResident)
+        {
+            ImGui::Text("Streaming assets...");
+        }
         ImGui::Text("Application:               %.3f ms", 1000.0f / io.Framerate);
         ImGui::Separator();
+        MemoryAllocator::Statistics memoryStatistics = memoryAllocator.GetStatistics();
+        ImGui::Text("GPU memory:                %.1f / %.1f MiB", memoryStatistics.allocatedBytes / (1024.0f * 1024.0f), memoryStatistics.blockBytes / (1024.0f * 1024.0f));
+        ImGui::Text("Allocations (blocks):      %u (%u)", memoryStatistics.allocationCount, memoryStatistics.blockCount);
+        ImGui::Separator();
         ImGui::Text("Framerate:                 %.1f FPS", io.Framerate);
+        ImGui::Separator();
+
+        int broadphase = static_cast<int>(broadphaseMode);
+        ImGui::RadioButton("Uniform grid", &broadphase, static_cast<int>(BroadphaseMode::eUniformGrid));
+        ImGui::SameLine();
+        ImGui::RadioButton("Linear BVH", &broadphase, static_cast<int>(BroadphaseMode::eLinearBVH));
+        broadphaseMode = static_cast<BroadphaseMode>(broadphase);
+
+        int renderMode = static_cast<int>(sphereRenderMode);
+        ImGui::RadioButton("Mesh", &renderMode, static_cast<int>(SphereRenderMode::eMesh));
+        ImGui::SameLine();
+        ImGui::RadioButton("Impostors", &renderMode, static_cast<int>(SphereRenderMode::eImpostor));
+        if (isSplatRenderingSupported)
+        {
+            ImGui::SameLine();
+            ImGui::RadioButton("Splats", &renderMode, static_cast<int>(SphereRenderMode::eSplat));
+        }
+        sphereRenderMode = static_cast<SphereRenderMode>(renderMode);
+
+        ImGui::Checkbox("Sleeping", &isSleepingEnabled);
+        ImGui::SameLine();
+        ImGui::Checkbox("Frustum Culling", &isFrustumCullingEnabled);
+        ImGui::SameLine();
+        ImGui::Checkbox("Occlusion Culling", &isOcclusionCullingEnabled);
+
+        ImGui::SetNextItemWidth(120.0f);
+        ImGui::SliderFloat("LOD Pixel Error", &lodPixelError, 0.25f, 8.0f, "%.2f");
+
+        int maxSubsteps = static_cast<int>(maxPhysicsSubsteps);
+        ImGui::SetNextItemWidth(120.0f);
+        ImGui::SliderInt("Max Substeps", &maxSubsteps, 1, static_cast<int>(MAX_PHYSICS_SUBSTEPS));
+        maxPhysicsSubsteps = static_cast<uint32_t>(maxSubsteps);
+
+        // Applied before the next frame is recorded
+        ImGui::SetNextItemWidth(120.0f);
+        ImGui::InputInt("##ObjectCount", &objectCountInput, 256, 4096);
+        ImGui::SameLine();
+        if (ImGui::Button("Set Object Count"))
+        {
+            objectCountInput = std::clamp(objectCountInput, static_cast<int>(MIN_PHYSICS_OBJECT_COUNT), static_cast<int>(maxPhysicsObjectCount));
+            requestedPhysicsObjectCount = static_cast<uint32_t>(objectCountInput);
+        }
     }
     ImGui::End();
 }
@@ -2447,31 +3912,218 @@ void Application::createTimeStampQueryPool()
         }
     }
 
-    timeStamps.resize(4);
+    timeStamps.resize(FRAME_QUERY_COUNT);
 
     vk::QueryPoolCreateInfo queryPoolCreateInfo = vk::QueryPoolCreateInfo()
                                                       .setQueryType(vk::QueryType::eTimestamp)
-                                                      .setQueryCount(static_cast<uint32_t>(timeStamps.size()));
+                                                      .setQueryCount(FRAME_QUERY_COUNT * framesInFlight);
 
     vk::Result result = logicalDevice.createQueryPool(&queryPoolCreateInfo, nullptr, &queryPool);
     if (result != vk::Result::eSuccess)
     {
         throw std::runtime_error("Failed to create query pool. Error code: " + vk::to_string(result));
     }
+
+    // Queries start out uninitialised, reading a frame's results before its first use requires them to have been reset
+    logicalDevice.resetQueryPool(queryPool, 0, FRAME_QUERY_COUNT * framesInFlight);
 }
 
-void Application::getTimeStampResults()
+void Application::resetTimeStamps(uint32_t frame)
 {
-    vk::Result result = logicalDevice.getQueryPoolResults(
-        queryPool,
-        0,
-        static_cast<uint32_t>(timeStamps.size()),
-        timeStamps.size() * sizeof(uint64_t),
-        timeStamps.data(),
-        sizeof(uint64_t),
-        vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+    logicalDevice.resetQueryPool(queryPool, frame * FRAME_QUERY_COUNT, FRAME_QUERY_COUNT);
+}
 
+// Only called once the frame's submissions have completed, so nothing here waits on the GPU.
+// Queries that were never written (no BVH this frame, or a skipped graphics submission) report eNotReady and keep the last value.
+// Returns whether both the compute and the graphics times are this frame's.
+bool Application::getTimeStampResults(uint32_t frame)
+{
+    uint32_t firstQuery = frame * FRAME_QUERY_COUNT;
     vk::PhysicalDeviceLimits const &physicalDeviceLimits = physicalDevice.getProperties().limits;
-    computePipelineTimeMS = float(timeStamps[1] - timeStamps[0]) * physicalDeviceLimits.timestampPeriod / 1'000'000.0f;
-    graphicsPipelineTimeMS = float(timeStamps[3] - timeStamps[2]) * physicalDeviceLimits.timestampPeriod / 1'000'000.0f;
-}
\ No newline at end of file
+
+    vk::Result result = logicalDevice.getQueryPoolResults(queryPool, firstQuery, 2, 2 * sizeof(uint64_t), &timeStamps[0], sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+    bool areTimeStampsReady = result == vk::Result::eSuccess;
+    if (result == vk::Result::eSuccess)
+    {
+        computePipelineTimeMS = float(timeStamps[1] - timeStamps[0]) * physicalDeviceLimits.timestampPeriod / 1'000'000.0f;
+    }
+
+    result = logicalDevice.getQueryPoolResults(queryPool, firstQuery + 2, 2, 2 * sizeof(uint64_t), &timeStamps[2], sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+    areTimeStampsReady = areTimeStampsReady && result == vk::Result::eSuccess;
+    if (result == vk::Result::eSuccess)
+    {
+        graphicsPipelineTimeMS = float(timeStamps[3] - timeStamps[2]) * physicalDeviceLimits.timestampPeriod / 1'000'000.0f;
+    }
+
+    result = logicalDevice.getQueryPoolResults(queryPool, firstQuery + BVH_FIRST_TIMESTAMP, LinearBVH::TIMESTAMP_COUNT, LinearBVH::TIMESTAMP_COUNT * sizeof(uint64_t),
+                                               &timeStamps[BVH_FIRST_TIMESTAMP], sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+    if (result == vk::Result::eSuccess)
+    {
+        bvhPhaseTimesMS = LinearBVH::GetPhaseTimesMS(&timeStamps[BVH_FIRST_TIMESTAMP], physicalDeviceLimits.timestampPeriod);
+    }
+
+    return areTimeStampsReady;
+}
+
+// Runs the frames without a window, then writes every measured frame's CPU time and GPU timestamps as percentiles.
+// Frames are only measured once the streamed assets are resident and the warm-up frames have run.
+void Application::runBenchmark()
+{
+    measuredFrameSlots.assign(framesInFlight, false);
+
+    uint32_t warmupFramesLeft = benchmarkWarmupFrameCount;
+    uint32_t measuredFrameCount = 0;
+    uint64_t measuredPhysicsStepCount = 0;
+
+    while (true)
+    {
+        bool isMeasured = isModelResident && isTextureResident && warmupFramesLeft == 0;
+        bool isFinished = benchmarkDuration > 0.0f ? measuredPhysicsStepCount * physicsTimeStep >= benchmarkDuration : measuredFrameCount >= benchmarkFrameCount;
+        if (isMeasured && isFinished)
+        {
+            break;
+        }
+
+        uint32_t frame = currentFrame;
+        auto frameStartTime = std::chrono::high_resolution_clock::now();
+        drawFrame();
+        float frameTimeMS = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - frameStartTime).count();
+
+        if (isMeasured)
+        {
+            benchmarkFrameTimesMS.push_back(frameTimeMS);
+            measuredFrameSlots[frame] = true;
+            measuredFrameCount++;
+            measuredPhysicsStepCount += physicsSubstepCount;
+        }
+        else if (isModelResident && isTextureResident && warmupFramesLeft > 0)
+        {
+            warmupFramesLeft--;
+        }
+    }
+
+    // The last frames' timestamps are only read here, every slot's submissions have completed after the wait
+    logicalDevice.waitIdle();
+    for (uint32_t i = 0; i < framesInFlight; i++)
+    {
+        uint32_t frame = (currentFrame + i) % framesInFlight;
+        recordBenchmarkTimeStamps(frame, getTimeStampResults(frame));
+    }
+
+    if (benchmarkResultsPath.empty())
+    {
+        writeBenchmarkResults(std::cout, measuredFrameCount, measuredPhysicsStepCount);
+        return;
+    }
+
+    std::ofstream resultsFile(benchmarkResultsPath);
+    if (!resultsFile.is_open())
+    {
+        throw std::runtime_error("Failed to open benchmark results file " + benchmarkResultsPath + "!");
+    }
+    writeBenchmarkResults(resultsFile, measuredFrameCount, measuredPhysicsStepCount);
+    std::cout << "Wrote the benchmark results to " << benchmarkResultsPath << std::endl;
+}
+
+// Called with the results getTimeStampResults() just read for the frame slot, before its queries are reset
+void Application::recordBenchmarkTimeStamps(uint32_t frame, bool areTimeStampsReady)
+{
+    if (!measuredFrameSlots[frame])
+    {
+        return;
+    }
+    measuredFrameSlots[frame] = false;
+
+    if (!areTimeStampsReady)
+    {
+        return;
+    }
+
+    benchmarkComputeTimesMS.push_back(computePipelineTimeMS);
+    benchmarkGraphicsTimesMS.push_back(graphicsPipelineTimeMS);
+
+    if (broadphaseMode == BroadphaseMode::eLinearBVH)
+    {
+        for (uint32_t i = 0; i < LinearBVH::eBuildPhaseCount; i++)
+        {
+            benchmarkBVHPhaseTimesMS[i].push_back(bvhPhaseTimesMS[i]);
+        }
+    }
+}
+
+// The throughput is every body stepped once per physics step, over the wall-clock time of the measured frames
+void Application::writeBenchmarkResults(std::ostream &stream, uint32_t frameCount, uint64_t physicsStepCount)
+{
+    double measuredSeconds = 0.0;
+    for (float frameTimeMS : benchmarkFrameTimesMS)
+    {
+        measuredSeconds += frameTimeMS / 1000.0;
+    }
+    double bodyStepsPerSecond = measuredSeconds > 0.0 ? static_cast<double>(physicsObjectCount) * physicsStepCount / measuredSeconds : 0.0;
+
+    stream << std::fixed << std::setprecision(4);
+    stream << "{\n";
+    stream << "  \"device\": \"" << physicalDevice.getProperties().deviceName << "\",\n";
+    stream << "  \"objects\": " << physicsObjectCount << ",\n";
+    stream << "  \"broadphase\": \"" << (broadphaseMode == BroadphaseMode::eLinearBVH ? "bvh" : "grid") << "\",\n";
+    stream << "  \"workgroup_size\": " << computeWorkgroup.size << ",\n";
+    stream << "  \"subgroup_size\": " << computeWorkgroup.subgroupSize << ",\n";
+    stream << "  \"msaa_samples\": " << static_cast<uint32_t>(msaaSamples) << ",\n";
+    // False when the depth attachment can't be sampled at this sample count, see pickPhysicalDevice()
+    stream << "  \"occlusion_culling\": " << (isOcclusionCullingEnabled && occlusionCuller.IsOcclusionSupported() ? "true" : "false") << ",\n";
+    stream << "  \"frames_in_flight\": " << framesInFlight << ",\n";
+    stream << "  \"extent\": [" << swapChainExtent.width << ", " << swapChainExtent.height << "],\n";
+    stream << "  \"physics_hz\": " << 1.0f / physicsTimeStep << ",\n";
+    stream << "  \"warmup_frames\": " << benchmarkWarmupFrameCount << ",\n";
+    stream << "  \"frames\": " << frameCount << ",\n";
+    stream << "  \"physics_steps\": " << physicsStepCount << ",\n";
+    stream << "  \"simulated_seconds\": " << physicsStepCount * physicsTimeStep << ",\n";
+    stream << "  \"measured_seconds\": " << measuredSeconds << ",\n";
+    stream << "  \"body_steps_per_second\": " << bodyStepsPerSecond << ",\n";
+
+    stream << "  \"cpu_frame_ms\": ";
+    writeBenchmarkStatistics(stream, benchmarkFrameTimesMS);
+    stream << ",\n  \"compute_ms\": ";
+    writeBenchmarkStatistics(stream, benchmarkComputeTimesMS);
+    stream << ",\n  \"graphics_ms\": ";
+    writeBenchmarkStatistics(stream, benchmarkGraphicsTimesMS);
+
+    stream << ",\n  \"bvh_phase_ms\": {";
+    if (broadphaseMode == BroadphaseMode::eLinearBVH)
+    {
+        for (uint32_t i = 0; i < LinearBVH::eBuildPhaseCount; i++)
+        {
+            stream << (i == 0 ? "\n" : ",\n") << "    \"" << LinearBVH::GetPhaseName(static_cast<LinearBVH::BuildPhase>(i)) << "\": ";
+            writeBenchmarkStatistics(stream, benchmarkBVHPhaseTimesMS[i]);
+        }
+        stream << "\n  ";
+    }
+    stream << "}\n";
+    stream << "}" << std::endl;
+}
+
+// Nearest-rank percentiles, all zero without samples
+void Application::writeBenchmarkStatistics(std::ostream &stream, std::vector<float> samples)
+{
+    std::sort(samples.begin(), samples.end());
+
+    auto getPercentile = [&samples](float percentile)
+    {
+        if (samples.empty())
+        {
+            return 0.0f;
+        }
+        size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0f * samples.size()));
+        return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+    };
+
+    float mean = 0.0f;
+    for (float sample : samples)
+    {
+        mean += sample;
+    }
+    mean = samples.empty() ? 0.0f : mean / samples.size();
+
+    stream << "{\"samples\": " << samples.size() << ", \"mean\": " << mean << ", \"p50\": " << getPercentile(50.0f) << ", \"p90\": " << getPercentile(90.0f)
+           << ", \"p99\": " << getPercentile(99.0f) << ", \"max\": " << getPercentile(100.0f) << "}";
+}
@@ -0,0 +1,56 @@
+#include "asset_loader.hpp"
+
+#include <algorithm>
+
+void AssetLoader::Create(uint32_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+
+    isStopping = false;
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        workers.emplace_back(&AssetLoader::work, this);
+    }
+}
+
+void AssetLoader::Destroy()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isStopping = true;
+    }
+    jobAvailable.notify_all();
+
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+    workers.clear();
+}
+
+void AssetLoader::work()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobAvailable.wait(lock, [this]()
+                              { return isStopping || !jobs.empty(); });
+
+            if (jobs.empty())
+            {
+                return;
+            }
+
+            job = std::move(jobs.front());
+            jobs.pop();
+        }
+
+        // Exceptions end up in the job's future
+        job();
+    }
+}
@@ -0,0 +1,337 @@
+#include "linear_bvh.hpp"
+
+void LinearBVH::Create(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, vk::PipelineCache pipelineCache, const std::vector<vk::Buffer> &physicsObjectBuffers, uint32_t objectCount)
+{
+    if (objectCount < 2)
+    {
+        throw std::invalid_argument("A linear BVH needs at least two objects!");
+    }
+
+    this->objectCount = objectCount;
+    blockCount = (objectCount + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    createBuffers(memoryAllocator, logicalDevice);
+    createDescriptorSetLayouts(logicalDevice);
+    createPipelines(logicalDevice, pipelineCache);
+    createDescriptorSets(logicalDevice, physicsObjectBuffers);
+    histogramPrefixSum.Create(memoryAllocator, logicalDevice, pipelineCache, histogramBuffer, histogramOffsetBuffer, RADIX_SIZE * blockCount);
+}
+
+void LinearBVH::Record(vk::CommandBuffer commandBuffer, uint32_t physicsObjectBufferIndex, vk::QueryPool queryPool, uint32_t firstQuery)
+{
+    currentDescriptorSet = physicsObjectBufferIndex;
+    uint32_t query = firstQuery;
+
+    recordTimestamp(commandBuffer, vk::PipelineStageFlagBits::eTopOfPipe, queryPool, query++);
+
+    // Empty scene bounds (ordered uint encoding) and zeroed refit arrival counters
+    commandBuffer.fillBuffer(sceneBoundsBuffer, 0, sizeof(uint32_t) * 4, 0xFFFFFFFF);
+    commandBuffer.fillBuffer(sceneBoundsBuffer, sizeof(uint32_t) * 4, sizeof(uint32_t) * 4, 0);
+    commandBuffer.fillBuffer(refitCounterBuffer, 0, vk::WholeSize, 0);
+
+    vk::MemoryBarrier fillBarrier = vk::MemoryBarrier()
+                                        .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+                                        .setDstAccessMask(vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader,
+                                  vk::DependencyFlags(),
+                                  1, &fillBarrier,
+                                  0, nullptr,
+                                  0, nullptr);
+
+    dispatchPass(commandBuffer, boundsPipeline, objectCount, 0);
+    recordComputeBarrier(commandBuffer);
+    recordTimestamp(commandBuffer, vk::PipelineStageFlagBits::eBottomOfPipe, queryPool, query++);
+
+    dispatchPass(commandBuffer, mortonPipeline, objectCount, 0);
+    recordComputeBarrier(commandBuffer);
+    recordTimestamp(commandBuffer, vk::PipelineStageFlagBits::eBottomOfPipe, queryPool, query++);
+
+    // An even number of passes leaves the sorted keys and values back in the A buffers
+    for (uint32_t radixShift = 0; radixShift < KEY_BITS; radixShift += RADIX_BITS)
+    {
+        dispatchPass(commandBuffer, radixHistogramPipeline, objectCount, radixShift);
+        recordComputeBarrier(commandBuffer);
+
+        histogramPrefixSum.Record(commandBuffer);
+        recordComputeBarrier(commandBuffer);
+
+        dispatchPass(commandBuffer, radixScatterPipeline, objectCount, radixShift);
+        recordComputeBarrier(commandBuffer);
+    }
+    recordTimestamp(commandBuffer, vk::PipelineStageFlagBits::eBottomOfPipe, queryPool, query++);
+
+    dispatchPass(commandBuffer, hierarchyPipeline, objectCount - 1, 0);
+    recordComputeBarrier(commandBuffer);
+    recordTimestamp(commandBuffer, vk::PipelineStageFlagBits::eBottomOfPipe, queryPool, query++);
+
+    dispatchPass(commandBuffer, refitPipeline, objectCount, 0);
+    recordComputeBarrier(commandBuffer);
+    recordTimestamp(commandBuffer, vk::PipelineStageFlagBits::eBottomOfPipe, queryPool, query++);
+}
+
+void LinearBVH::recordTimestamp(vk::CommandBuffer commandBuffer, vk::PipelineStageFlagBits stage, vk::QueryPool queryPool, uint32_t query)
+{
+    if (queryPool)
+    {
+        commandBuffer.writeTimestamp(stage, queryPool, query);
+    }
+}
+
+void LinearBVH::Destroy(MemoryAllocator &memoryAllocator, vk::Device logicalDevice)
+{
+    histogramPrefixSum.Destroy(memoryAllocator, logicalDevice);
+
+    logicalDevice.destroyPipeline(boundsPipeline);
+    logicalDevice.destroyPipeline(mortonPipeline);
+    logicalDevice.destroyPipeline(radixHistogramPipeline);
+    logicalDevice.destroyPipeline(radixScatterPipeline);
+    logicalDevice.destroyPipeline(hierarchyPipeline);
+    logicalDevice.destroyPipeline(refitPipeline);
+
+    logicalDevice.destroyPipelineLayout(pipelineLayout);
+
+    logicalDevice.destroyDescriptorPool(descriptorPool);
+    logicalDevice.destroyDescriptorSetLayout(descriptorSetLayout);
+
+    logicalDevice.destroyBuffer(sceneBoundsBuffer);
+    memoryAllocator.Free(logicalDevice, sceneBoundsBufferMemory);
+
+    for (size_t i = 0; i < sortBuffers.size(); i++)
+    {
+        logicalDevice.destroyBuffer(sortBuffers[i]);
+        memoryAllocator.Free(logicalDevice, sortBuffersMemory[i]);
+    }
+
+    logicalDevice.destroyBuffer(histogramBuffer);
+    memoryAllocator.Free(logicalDevice, histogramBufferMemory);
+    logicalDevice.destroyBuffer(histogramOffsetBuffer);
+    memoryAllocator.Free(logicalDevice, histogramOffsetBufferMemory);
+    logicalDevice.destroyBuffer(nodeBuffer);
+    memoryAllocator.Free(logicalDevice, nodeBufferMemory);
+    logicalDevice.destroyBuffer(parentBuffer);
+    memoryAllocator.Free(logicalDevice, parentBufferMemory);
+    logicalDevice.destroyBuffer(refitCounterBuffer);
+    memoryAllocator.Free(logicalDevice, refitCounterBufferMemory);
+}
+
+vk::Buffer LinearBVH::GetNodeBuffer() const
+{
+    return nodeBuffer;
+}
+
+uint32_t LinearBVH::GetObjectCount() const
+{
+    return objectCount;
+}
+
+// Every internal node's common key prefix is longer than its parent's. Duplicate Morton codes fall back to their sorted
+// indices in bvh_hierarchy.comp, so a path from the root splits on at most MORTON_BITS code bits and then on the index
+// bits of a contiguous run of at most objectCount keys. Each level leaves one sibling on the stack, plus the root.
+uint32_t LinearBVH::GetTraversalStackSize(uint32_t objectCount)
+{
+    uint32_t indexBits = 0;
+    while (indexBits < 32 && (1ull << indexBits) < objectCount)
+    {
+        indexBits++;
+    }
+
+    return MORTON_BITS + indexBits + 2;
+}
+
+std::array<float, LinearBVH::eBuildPhaseCount> LinearBVH::GetPhaseTimesMS(const uint64_t *timeStamps, float timestampPeriod)
+{
+    std::array<float, eBuildPhaseCount> phaseTimesMS{};
+
+    for (uint32_t i = 0; i < eBuildPhaseCount; i++)
+    {
+        phaseTimesMS[i] = float(timeStamps[i + 1] - timeStamps[i]) * timestampPeriod / 1'000'000.0f;
+    }
+
+    return phaseTimesMS;
+}
+
+const char *LinearBVH::GetPhaseName(BuildPhase phase)
+{
+    switch (phase)
+    {
+    case eBounds:
+        return "Bounds";
+    case eMortonCodes:
+        return "Morton";
+    case eRadixSort:
+        return "Sort";
+    case eHierarchy:
+        return "Hierarchy";
+    case eRefit:
+        return "Refit";
+    default:
+        return "Unknown";
+    }
+}
+
+void LinearBVH::createBuffers(MemoryAllocator &memoryAllocator, vk::Device logicalDevice)
+{
+    uint32_t nodeCount = 2 * objectCount - 1;
+
+    Utilities::createBuffer(memoryAllocator, logicalDevice, sizeof(uint32_t) * 8, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                            vk::MemoryPropertyFlagBits::eDeviceLocal, sceneBoundsBuffer, sceneBoundsBufferMemory);
+
+    // Keys A, values A, keys B, values B
+    for (size_t i = 0; i < sortBuffers.size(); i++)
+    {
+        Utilities::createBuffer(memoryAllocator, logicalDevice, sizeof(uint32_t) * objectCount, vk::BufferUsageFlagBits::eStorageBuffer,
+                                vk::MemoryPropertyFlagBits::eDeviceLocal, sortBuffers[i], sortBuffersMemory[i]);
+    }
+
+    Utilities::createBuffer(memoryAllocator, logicalDevice, sizeof(uint32_t) * RADIX_SIZE * blockCount, vk::BufferUsageFlagBits::eStorageBuffer,
+                            vk::MemoryPropertyFlagBits::eDeviceLocal, histogramBuffer, histogramBufferMemory);
+    Utilities::createBuffer(memoryAllocator, logicalDevice, sizeof(uint32_t) * RADIX_SIZE * blockCount, vk::BufferUsageFlagBits::eStorageBuffer,
+                            vk::MemoryPropertyFlagBits::eDeviceLocal, histogramOffsetBuffer, histogramOffsetBufferMemory);
+
+    Utilities::createBuffer(memoryAllocator, logicalDevice, sizeof(Node) * nodeCount, vk::BufferUsageFlagBits::eStorageBuffer,
+                            vk::MemoryPropertyFlagBits::eDeviceLocal, nodeBuffer, nodeBufferMemory);
+    Utilities::createBuffer(memoryAllocator, logicalDevice, sizeof(uint32_t) * nodeCount, vk::BufferUsageFlagBits::eStorageBuffer,
+                            vk::MemoryPropertyFlagBits::eDeviceLocal, parentBuffer, parentBufferMemory);
+    Utilities::createBuffer(memoryAllocator, logicalDevice, sizeof(uint32_t) * (objectCount - 1), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                            vk::MemoryPropertyFlagBits::eDeviceLocal, refitCounterBuffer, refitCounterBufferMemory);
+}
+
+void LinearBVH::createDescriptorSetLayouts(vk::Device logicalDevice)
+{
+    // Bindings match bvh_build_common.glsl
+    std::vector<vk::DescriptorSetLayoutBinding> layoutBindings;
+    for (uint32_t binding = 0; binding <= 10; binding++)
+    {
+        layoutBindings.push_back(vk::DescriptorSetLayoutBinding()
+                                     .setBinding(binding)
+                                     .setDescriptorCount(1)
+                                     .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                     .setPImmutableSamplers(nullptr)
+                                     .setStageFlags(vk::ShaderStageFlagBits::eCompute));
+    }
+
+    vk::DescriptorSetLayoutCreateInfo layoutCreateInfo = vk::DescriptorSetLayoutCreateInfo()
+                                                             .setBindingCount(static_cast<uint32_t>(layoutBindings.size()))
+                                                             .setPBindings(layoutBindings.data());
+
+    vk::Result result = logicalDevice.createDescriptorSetLayout(&layoutCreateInfo, nullptr, &descriptorSetLayout);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create BVH descriptor set layout! Error Code: " + vk::to_string(result));
+    }
+}
+
+void LinearBVH::createPipelines(vk::Device logicalDevice, vk::PipelineCache pipelineCache)
+{
+    vk::PushConstantRange pushConstantRange = vk::PushConstantRange()
+                                                  .setStageFlags(vk::ShaderStageFlagBits::eCompute)
+                                                  .setOffset(0)
+                                                  .setSize(sizeof(PushConstants));
+
+    vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo = vk::PipelineLayoutCreateInfo()
+                                                                .setSetLayoutCount(1)
+                                                                .setPSetLayouts(&descriptorSetLayout)
+                                                                .setPushConstantRangeCount(1)
+                                                                .setPPushConstantRanges(&pushConstantRange);
+
+    vk::Result result = logicalDevice.createPipelineLayout(&pipelineLayoutCreateInfo, nullptr, &pipelineLayout);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create BVH pipeline layout! Error Code: " + vk::to_string(result));
+    }
+
+    boundsPipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/bvh_bounds.comp.spv", pipelineLayout);
+    mortonPipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/bvh_morton.comp.spv", pipelineLayout);
+    radixHistogramPipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/bvh_radix_histogram.comp.spv", pipelineLayout);
+    radixScatterPipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/bvh_radix_scatter.comp.spv", pipelineLayout);
+    hierarchyPipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/bvh_hierarchy.comp.spv", pipelineLayout);
+    refitPipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/bvh_refit.comp.spv", pipelineLayout);
+}
+
+void LinearBVH::createDescriptorSets(vk::Device logicalDevice, const std::vector<vk::Buffer> &physicsObjectBuffers)
+{
+    uint32_t setCount = static_cast<uint32_t>(physicsObjectBuffers.size());
+
+    vk::DescriptorPoolSize poolSize = vk::DescriptorPoolSize()
+                                          .setType(vk::DescriptorType::eStorageBuffer)
+                                          .setDescriptorCount(setCount * 11);
+
+    vk::DescriptorPoolCreateInfo poolCreateInfo = vk::DescriptorPoolCreateInfo()
+                                                      .setPoolSizeCount(1)
+                                                      .setPPoolSizes(&poolSize)
+                                                      .setMaxSets(setCount);
+
+    vk::Result result = logicalDevice.createDescriptorPool(&poolCreateInfo, nullptr, &descriptorPool);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create BVH descriptor pool! Error Code: " + vk::to_string(result));
+    }
+
+    std::vector<vk::DescriptorSetLayout> layouts(setCount, descriptorSetLayout);
+    vk::DescriptorSetAllocateInfo allocateInfo = vk::DescriptorSetAllocateInfo()
+                                                     .setDescriptorPool(descriptorPool)
+                                                     .setDescriptorSetCount(setCount)
+                                                     .setPSetLayouts(layouts.data());
+
+    descriptorSets.resize(setCount);
+    result = logicalDevice.allocateDescriptorSets(&allocateInfo, descriptorSets.data());
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to allocate BVH descriptor sets! Error Code: " + vk::to_string(result));
+    }
+
+    for (uint32_t i = 0; i < setCount; i++)
+    {
+        std::array<vk::Buffer, 11> buffers = {
+            physicsObjectBuffers[i], sceneBoundsBuffer,
+            sortBuffers[0], sortBuffers[1], sortBuffers[2], sortBuffers[3],
+            histogramBuffer, histogramOffsetBuffer,
+            nodeBuffer, parentBuffer, refitCounterBuffer};
+
+        std::array<vk::DescriptorBufferInfo, 11> bufferInfos;
+        std::array<vk::WriteDescriptorSet, 11> descriptorWrites;
+
+        for (uint32_t binding = 0; binding < buffers.size(); binding++)
+        {
+            bufferInfos[binding] = vk::DescriptorBufferInfo()
+                                       .setBuffer(buffers[binding])
+                                       .setOffset(0)
+                                       .setRange(vk::WholeSize);
+
+            descriptorWrites[binding] = vk::WriteDescriptorSet()
+                                            .setDstSet(descriptorSets[i])
+                                            .setDstBinding(binding)
+                                            .setDstArrayElement(0)
+                                            .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                            .setDescriptorCount(1)
+                                            .setPBufferInfo(&bufferInfos[binding]);
+        }
+
+        logicalDevice.updateDescriptorSets(static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+
+}
+
+void LinearBVH::recordComputeBarrier(vk::CommandBuffer commandBuffer)
+{
+    vk::MemoryBarrier memoryBarrier = vk::MemoryBarrier()
+                                          .setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+                                          .setDstAccessMask(vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+                                  vk::DependencyFlags(),
+                                  1, &memoryBarrier,
+                                  0, nullptr,
+                                  0, nullptr);
+}
+
+void LinearBVH::dispatchPass(vk::CommandBuffer commandBuffer, vk::Pipeline pipeline, uint32_t invocationCount, uint32_t radixShift)
+{
+    PushConstants pushConstants{objectCount, radixShift};
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, 1, &descriptorSets[currentDescriptorSet], 0, nullptr);
+    commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(PushConstants), &pushConstants);
+    commandBuffer.dispatch((invocationCount + BLOCK_SIZE - 1) / BLOCK_SIZE, 1, 1);
+}
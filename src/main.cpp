@@ -1,10 +1,99 @@
 #include "application.hpp"
 
-int main()
+#include <cstring>
+#include <limits>
+#include <string>
+
+// std::stoul() accepts a leading minus sign and wraps, and a cast to uint32_t would silently wrap again
+static uint32_t parseCount(const char *text)
+{
+    unsigned long long value = std::stoull(text);
+    if (std::strchr(text, '-') || value > std::numeric_limits<uint32_t>::max())
+    {
+        throw std::out_of_range(std::string("Invalid count: ") + text);
+    }
+
+    return static_cast<uint32_t>(value);
+}
+
+// The value following the flag at argv[i], a flag given last without one is an error rather than being skipped
+static const char *nextValue(int argc, char *argv[], int &i)
+{
+    if (i + 1 >= argc)
+    {
+        throw std::invalid_argument(std::string("Missing value for ") + argv[i]);
+    }
+
+    return argv[++i];
+}
+
+int main(int argc, char *argv[])
 {
     Application app;
     try
     {
+        app.SetCacheDirectory(std::filesystem::absolute(argv[0]).parent_path());
+
+        for (int i = 1; i < argc; i++)
+        {
+            if (std::strcmp(argv[i], "--objects") == 0)
+            {
+                app.SetPhysicsObjectCount(parseCount(nextValue(argc, argv, i)));
+            }
+            else if (std::strcmp(argv[i], "--autotune") == 0)
+            {
+                app.EnableWorkgroupAutotune();
+            }
+            else if (std::strcmp(argv[i], "--physics-hz") == 0)
+            {
+                app.SetPhysicsRate(std::stof(nextValue(argc, argv, i)));
+            }
+            else if (std::strcmp(argv[i], "--max-substeps") == 0)
+            {
+                app.SetMaxPhysicsSubsteps(parseCount(nextValue(argc, argv, i)));
+            }
+            else if (std::strcmp(argv[i], "--bvh") == 0)
+            {
+                app.UseLinearBVHBroadphase();
+            }
+            else if (std::strcmp(argv[i], "--headless") == 0)
+            {
+                app.EnableHeadless();
+            }
+            else if (std::strcmp(argv[i], "--frames") == 0)
+            {
+                app.SetBenchmarkFrameCount(parseCount(nextValue(argc, argv, i)));
+            }
+            else if (std::strcmp(argv[i], "--seconds") == 0)
+            {
+                app.SetBenchmarkDuration(std::stof(nextValue(argc, argv, i)));
+            }
+            else if (std::strcmp(argv[i], "--warmup-frames") == 0)
+            {
+                app.SetBenchmarkWarmupFrameCount(parseCount(nextValue(argc, argv, i)));
+            }
+            else if (std::strcmp(argv[i], "--results") == 0)
+            {
+                app.SetBenchmarkResultsPath(nextValue(argc, argv, i));
+            }
+            else if (std::strcmp(argv[i], "--frames-in-flight") == 0)
+            {
+                app.SetFramesInFlight(parseCount(nextValue(argc, argv, i)));
+            }
+            else if (std::strcmp(argv[i], "--workgroup-size") == 0)
+            {
+                app.SetComputeWorkgroupSize(parseCount(nextValue(argc, argv, i)));
+            }
+            else if (std::strcmp(argv[i], "--msaa") == 0)
+            {
+                app.SetMSAASampleCount(parseCount(nextValue(argc, argv, i)));
+            }
+            else
+            {
+                throw std::invalid_argument(std::string("Unknown argument: ") + argv[i]);
+            }
+        }
+
         app.Run();
     }
     catch(const std::exception& e)
@@ -14,4 +103,4 @@ int main()
     }
 
     return 0;
-}
\ No newline at end of file
+}
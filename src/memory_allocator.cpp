@@ -0,0 +1,491 @@
+#include "memory_allocator.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace
+{
+    const vk::DeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+    // Heaps up to this size get blocks of an eighth of the heap instead
+    const vk::DeviceSize SMALL_HEAP_SIZE = 1024ull * 1024 * 1024;
+
+    vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+void MemoryAllocator::Create(vk::PhysicalDevice physicalDevice)
+{
+    memoryProperties = physicalDevice.getMemoryProperties();
+    bufferImageGranularity = std::max<vk::DeviceSize>(physicalDevice.getProperties().limits.bufferImageGranularity, 1);
+
+    pools.resize(memoryProperties.memoryTypeCount);
+}
+
+void MemoryAllocator::Destroy(vk::Device logicalDevice)
+{
+    for (auto &pool : pools)
+    {
+        for (auto &block : pool)
+        {
+            logicalDevice.freeMemory(block->memory);
+        }
+        pool.clear();
+    }
+}
+
+MemoryAllocator::Allocation MemoryAllocator::AllocateBuffer(vk::Device logicalDevice, vk::Buffer buffer, vk::MemoryPropertyFlags properties, Strategy strategy)
+{
+    vk::MemoryRequirements memoryRequirements;
+    logicalDevice.getBufferMemoryRequirements(buffer, &memoryRequirements);
+
+    Allocation allocation = allocate(logicalDevice, memoryRequirements, properties, strategy);
+
+    vk::Result result = logicalDevice.bindBufferMemory(buffer, allocation.memory, allocation.offset);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to bind buffer memory! Error Code: " + vk::to_string(result));
+    }
+
+    return allocation;
+}
+
+// Optimal images are placed on whole pages of bufferImageGranularity, so no buffer can share a page with one
+MemoryAllocator::Allocation MemoryAllocator::AllocateImage(vk::Device logicalDevice, vk::Image image, vk::MemoryPropertyFlags properties)
+{
+    vk::MemoryRequirements memoryRequirements;
+    logicalDevice.getImageMemoryRequirements(image, &memoryRequirements);
+
+    memoryRequirements.alignment = std::max(memoryRequirements.alignment, bufferImageGranularity);
+    memoryRequirements.size = alignUp(memoryRequirements.size, bufferImageGranularity);
+
+    Allocation allocation = allocate(logicalDevice, memoryRequirements, properties, Strategy::eFreeList);
+
+    vk::Result result = logicalDevice.bindImageMemory(image, allocation.memory, allocation.offset);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to bind image memory! Error Code: " + vk::to_string(result));
+    }
+
+    return allocation;
+}
+
+void MemoryAllocator::Free(vk::Device logicalDevice, Allocation &allocation)
+{
+    Block *block = allocation.block;
+    if (!block)
+    {
+        return;
+    }
+
+    if (block->strategy == Strategy::eFreeList && !block->isDedicated)
+    {
+        freeFreeList(*block, allocation.range);
+    }
+
+    block->allocationCount--;
+    block->allocatedBytes -= allocation.size;
+
+    if (block->allocationCount == 0)
+    {
+        block->linearOffset = 0;
+
+        // Keep one empty block of each strategy around so alternating allocations and frees don't thrash the driver
+        const auto &pool = pools[block->memoryTypeIndex];
+        size_t emptyBlockCount = std::count_if(pool.begin(), pool.end(), [block](const auto &pooledBlock)
+                                               { return pooledBlock->strategy == block->strategy && pooledBlock->allocationCount == 0 && !pooledBlock->isDedicated; });
+        if (block->isDedicated || emptyBlockCount > 1)
+        {
+            destroyBlock(logicalDevice, block);
+        }
+    }
+
+    allocation = Allocation{};
+}
+
+uint32_t MemoryAllocator::FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const
+{
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+    {
+        if ((typeFilter & (1 << i)) &&
+            (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find suitable memory type!");
+}
+
+MemoryAllocator::Statistics MemoryAllocator::GetStatistics() const
+{
+    Statistics statistics;
+    for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < GetMemoryTypeCount(); memoryTypeIndex++)
+    {
+        Statistics memoryTypeStatistics = GetStatistics(memoryTypeIndex);
+        statistics.blockCount += memoryTypeStatistics.blockCount;
+        statistics.allocationCount += memoryTypeStatistics.allocationCount;
+        statistics.blockBytes += memoryTypeStatistics.blockBytes;
+        statistics.allocatedBytes += memoryTypeStatistics.allocatedBytes;
+    }
+
+    return statistics;
+}
+
+MemoryAllocator::Statistics MemoryAllocator::GetStatistics(uint32_t memoryTypeIndex) const
+{
+    Statistics statistics;
+    for (const auto &block : pools[memoryTypeIndex])
+    {
+        statistics.blockCount++;
+        statistics.allocationCount += block->allocationCount;
+        statistics.blockBytes += block->size;
+        statistics.allocatedBytes += block->allocatedBytes;
+    }
+
+    return statistics;
+}
+
+uint32_t MemoryAllocator::GetMemoryTypeCount() const
+{
+    return static_cast<uint32_t>(pools.size());
+}
+
+MemoryAllocator::Allocation MemoryAllocator::allocate(vk::Device logicalDevice, const vk::MemoryRequirements &memoryRequirements, vk::MemoryPropertyFlags properties, Strategy strategy)
+{
+    uint32_t memoryTypeIndex = FindMemoryType(memoryRequirements.memoryTypeBits, properties);
+    vk::DeviceSize blockSize = getBlockSize(memoryTypeIndex);
+
+    Allocation allocation;
+
+    if (memoryRequirements.size > blockSize / 2)
+    {
+        Block *block = createBlock(logicalDevice, memoryTypeIndex, memoryRequirements.size, strategy, true);
+        allocation.block = block;
+    }
+    else
+    {
+        for (const auto &block : pools[memoryTypeIndex])
+        {
+            if (block->strategy != strategy || block->isDedicated)
+            {
+                continue;
+            }
+
+            bool isAllocated = strategy == Strategy::eLinear ? allocateLinear(*block, memoryRequirements.size, memoryRequirements.alignment, allocation)
+                                                             : allocateFreeList(*block, memoryRequirements.size, memoryRequirements.alignment, allocation);
+            if (isAllocated)
+            {
+                allocation.block = block.get();
+                break;
+            }
+        }
+
+        if (!allocation.block)
+        {
+            Block *block = createBlock(logicalDevice, memoryTypeIndex, blockSize, strategy, false);
+            if (strategy == Strategy::eLinear)
+            {
+                allocateLinear(*block, memoryRequirements.size, memoryRequirements.alignment, allocation);
+            }
+            else
+            {
+                allocateFreeList(*block, memoryRequirements.size, memoryRequirements.alignment, allocation);
+            }
+            allocation.block = block;
+        }
+    }
+
+    Block *block = allocation.block;
+    block->allocationCount++;
+    block->allocatedBytes += memoryRequirements.size;
+
+    allocation.memory = block->memory;
+    allocation.size = memoryRequirements.size;
+    allocation.mapped = block->mapped ? block->mapped + allocation.offset : nullptr;
+
+    return allocation;
+}
+
+MemoryAllocator::Block *MemoryAllocator::createBlock(vk::Device logicalDevice, uint32_t memoryTypeIndex, vk::DeviceSize size, Strategy strategy, bool isDedicated)
+{
+    vk::MemoryAllocateInfo memoryAllocateInfo = vk::MemoryAllocateInfo()
+                                                    .setAllocationSize(size)
+                                                    .setMemoryTypeIndex(memoryTypeIndex);
+
+    vk::DeviceMemory memory;
+    vk::Result result = logicalDevice.allocateMemory(&memoryAllocateInfo, nullptr, &memory);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to allocate memory block! Error Code: " + vk::to_string(result));
+    }
+
+    void *mapped = nullptr;
+    if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible)
+    {
+        result = logicalDevice.mapMemory(memory, 0, VK_WHOLE_SIZE, vk::MemoryMapFlags(), &mapped);
+        if (result != vk::Result::eSuccess)
+        {
+            throw std::runtime_error("Failed to map memory block! Error Code: " + vk::to_string(result));
+        }
+    }
+
+    auto block = std::make_unique<Block>();
+    block->memory = memory;
+    block->size = size;
+    block->mapped = static_cast<uint8_t *>(mapped);
+    block->memoryTypeIndex = memoryTypeIndex;
+    block->strategy = strategy;
+    block->isDedicated = isDedicated;
+
+    if (strategy == Strategy::eFreeList && !isDedicated)
+    {
+        block->freeHeads.fill(NO_RANGE);
+
+        uint32_t rangeIndex = createRange(*block);
+        block->ranges[rangeIndex] = Range{0, size, NO_RANGE, NO_RANGE, NO_RANGE, NO_RANGE, true};
+        insertFreeRange(*block, rangeIndex);
+    }
+
+    pools[memoryTypeIndex].push_back(std::move(block));
+    return pools[memoryTypeIndex].back().get();
+}
+
+void MemoryAllocator::destroyBlock(vk::Device logicalDevice, Block *block)
+{
+    // Freeing the memory unmaps it
+    logicalDevice.freeMemory(block->memory);
+
+    auto &pool = pools[block->memoryTypeIndex];
+    pool.erase(std::find_if(pool.begin(), pool.end(), [block](const auto &pooledBlock)
+                            { return pooledBlock.get() == block; }));
+}
+
+vk::DeviceSize MemoryAllocator::getBlockSize(uint32_t memoryTypeIndex) const
+{
+    vk::DeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+    return heapSize <= SMALL_HEAP_SIZE ? alignUp(heapSize / 8, 256) : DEFAULT_BLOCK_SIZE;
+}
+
+bool MemoryAllocator::allocateLinear(Block &block, vk::DeviceSize size, vk::DeviceSize alignment, Allocation &allocation)
+{
+    vk::DeviceSize offset = alignUp(block.linearOffset, alignment);
+    if (offset + size > block.size)
+    {
+        return false;
+    }
+
+    block.linearOffset = offset + size;
+    allocation.offset = offset;
+    return true;
+}
+
+// Searching one size class up from size plus the worst case alignment padding makes any range found fit, so the
+// search never walks a free list
+bool MemoryAllocator::allocateFreeList(Block &block, vk::DeviceSize size, vk::DeviceSize alignment, Allocation &allocation)
+{
+    uint32_t rangeIndex = findFreeRange(block, size + alignment - 1);
+    if (rangeIndex == NO_RANGE)
+    {
+        return false;
+    }
+
+    removeFreeRange(block, rangeIndex);
+
+    // Alignment padding goes back to the previous range, or becomes a free range of its own
+    vk::DeviceSize padding = alignUp(block.ranges[rangeIndex].offset, alignment) - block.ranges[rangeIndex].offset;
+    if (padding > 0)
+    {
+        uint32_t previousIndex = block.ranges[rangeIndex].previousPhysical;
+        if (previousIndex != NO_RANGE && block.ranges[previousIndex].isFree)
+        {
+            removeFreeRange(block, previousIndex);
+            block.ranges[previousIndex].size += padding;
+            insertFreeRange(block, previousIndex);
+        }
+        else
+        {
+            uint32_t paddingIndex = createRange(block);
+            block.ranges[paddingIndex] = Range{block.ranges[rangeIndex].offset, padding, previousIndex, rangeIndex, NO_RANGE, NO_RANGE, true};
+            if (previousIndex != NO_RANGE)
+            {
+                block.ranges[previousIndex].nextPhysical = paddingIndex;
+            }
+            block.ranges[rangeIndex].previousPhysical = paddingIndex;
+            insertFreeRange(block, paddingIndex);
+        }
+
+        block.ranges[rangeIndex].offset += padding;
+        block.ranges[rangeIndex].size -= padding;
+    }
+
+    // The rest is split off, the next range can't be free as free neighbours are always merged
+    vk::DeviceSize remainder = block.ranges[rangeIndex].size - size;
+    if (remainder > 0)
+    {
+        uint32_t nextIndex = block.ranges[rangeIndex].nextPhysical;
+        uint32_t remainderIndex = createRange(block);
+        block.ranges[remainderIndex] = Range{block.ranges[rangeIndex].offset + size, remainder, rangeIndex, nextIndex, NO_RANGE, NO_RANGE, true};
+        if (nextIndex != NO_RANGE)
+        {
+            block.ranges[nextIndex].previousPhysical = remainderIndex;
+        }
+        block.ranges[rangeIndex].nextPhysical = remainderIndex;
+        block.ranges[rangeIndex].size = size;
+        insertFreeRange(block, remainderIndex);
+    }
+
+    block.ranges[rangeIndex].isFree = false;
+    allocation.offset = block.ranges[rangeIndex].offset;
+    allocation.range = rangeIndex;
+    return true;
+}
+
+void MemoryAllocator::freeFreeList(Block &block, uint32_t rangeIndex)
+{
+    block.ranges[rangeIndex].isFree = true;
+
+    uint32_t nextIndex = block.ranges[rangeIndex].nextPhysical;
+    if (nextIndex != NO_RANGE && block.ranges[nextIndex].isFree)
+    {
+        removeFreeRange(block, nextIndex);
+        block.ranges[rangeIndex].size += block.ranges[nextIndex].size;
+        block.ranges[rangeIndex].nextPhysical = block.ranges[nextIndex].nextPhysical;
+        if (block.ranges[rangeIndex].nextPhysical != NO_RANGE)
+        {
+            block.ranges[block.ranges[rangeIndex].nextPhysical].previousPhysical = rangeIndex;
+        }
+        releaseRange(block, nextIndex);
+    }
+
+    uint32_t previousIndex = block.ranges[rangeIndex].previousPhysical;
+    if (previousIndex != NO_RANGE && block.ranges[previousIndex].isFree)
+    {
+        removeFreeRange(block, previousIndex);
+        block.ranges[previousIndex].size += block.ranges[rangeIndex].size;
+        block.ranges[previousIndex].nextPhysical = block.ranges[rangeIndex].nextPhysical;
+        if (block.ranges[previousIndex].nextPhysical != NO_RANGE)
+        {
+            block.ranges[block.ranges[previousIndex].nextPhysical].previousPhysical = previousIndex;
+        }
+        releaseRange(block, rangeIndex);
+        rangeIndex = previousIndex;
+    }
+
+    insertFreeRange(block, rangeIndex);
+}
+
+// The first level is the size's highest set bit, the second level splits that power of two range linearly.
+// Sizes below SECOND_LEVEL_COUNT all land in the first level 0.
+void MemoryAllocator::getSizeClass(vk::DeviceSize size, uint32_t &firstLevel, uint32_t &secondLevel)
+{
+    if (size < SECOND_LEVEL_COUNT)
+    {
+        firstLevel = 0;
+        secondLevel = static_cast<uint32_t>(size);
+        return;
+    }
+
+    uint32_t highestBit = static_cast<uint32_t>(std::bit_width(size)) - 1;
+    firstLevel = highestBit - SECOND_LEVEL_BITS + 1;
+    secondLevel = static_cast<uint32_t>(size >> (highestBit - SECOND_LEVEL_BITS)) & (SECOND_LEVEL_COUNT - 1);
+}
+
+uint32_t MemoryAllocator::findFreeRange(const Block &block, vk::DeviceSize size)
+{
+    // Round up to the next size class so every range in the class found is large enough
+    if (size >= SECOND_LEVEL_COUNT)
+    {
+        uint32_t highestBit = static_cast<uint32_t>(std::bit_width(size)) - 1;
+        size += (1ull << (highestBit - SECOND_LEVEL_BITS)) - 1;
+    }
+
+    uint32_t firstLevel;
+    uint32_t secondLevel;
+    getSizeClass(size, firstLevel, secondLevel);
+
+    uint32_t secondLevelBitmap = block.secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+    if (secondLevelBitmap == 0)
+    {
+        uint64_t firstLevelBitmap = firstLevel + 1 < FIRST_LEVEL_COUNT ? block.firstLevelBitmap & (~0ull << (firstLevel + 1)) : 0;
+        if (firstLevelBitmap == 0)
+        {
+            return NO_RANGE;
+        }
+
+        firstLevel = static_cast<uint32_t>(std::countr_zero(firstLevelBitmap));
+        secondLevelBitmap = block.secondLevelBitmaps[firstLevel];
+    }
+
+    secondLevel = static_cast<uint32_t>(std::countr_zero(secondLevelBitmap));
+    return block.freeHeads[firstLevel * SECOND_LEVEL_COUNT + secondLevel];
+}
+
+void MemoryAllocator::insertFreeRange(Block &block, uint32_t rangeIndex)
+{
+    uint32_t firstLevel;
+    uint32_t secondLevel;
+    getSizeClass(block.ranges[rangeIndex].size, firstLevel, secondLevel);
+
+    uint32_t &head = block.freeHeads[firstLevel * SECOND_LEVEL_COUNT + secondLevel];
+    block.ranges[rangeIndex].previousFree = NO_RANGE;
+    block.ranges[rangeIndex].nextFree = head;
+    if (head != NO_RANGE)
+    {
+        block.ranges[head].previousFree = rangeIndex;
+    }
+    head = rangeIndex;
+
+    block.firstLevelBitmap |= 1ull << firstLevel;
+    block.secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+}
+
+void MemoryAllocator::removeFreeRange(Block &block, uint32_t rangeIndex)
+{
+    uint32_t firstLevel;
+    uint32_t secondLevel;
+    getSizeClass(block.ranges[rangeIndex].size, firstLevel, secondLevel);
+
+    uint32_t previousIndex = block.ranges[rangeIndex].previousFree;
+    uint32_t nextIndex = block.ranges[rangeIndex].nextFree;
+    if (nextIndex != NO_RANGE)
+    {
+        block.ranges[nextIndex].previousFree = previousIndex;
+    }
+
+    if (previousIndex != NO_RANGE)
+    {
+        block.ranges[previousIndex].nextFree = nextIndex;
+        return;
+    }
+
+    uint32_t &head = block.freeHeads[firstLevel * SECOND_LEVEL_COUNT + secondLevel];
+    head = nextIndex;
+    if (head == NO_RANGE)
+    {
+        block.secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+        if (block.secondLevelBitmaps[firstLevel] == 0)
+        {
+            block.firstLevelBitmap &= ~(1ull << firstLevel);
+        }
+    }
+}
+
+uint32_t MemoryAllocator::createRange(Block &block)
+{
+    if (!block.unusedRanges.empty())
+    {
+        uint32_t rangeIndex = block.unusedRanges.back();
+        block.unusedRanges.pop_back();
+        return rangeIndex;
+    }
+
+    block.ranges.push_back(Range{});
+    return static_cast<uint32_t>(block.ranges.size() - 1);
+}
+
+void MemoryAllocator::releaseRange(Block &block, uint32_t rangeIndex)
+{
+    block.unusedRanges.push_back(rangeIndex);
+}
@@ -1,17 +1,83 @@
 #include "model.hpp"
 
-void Model::Load(const char *modelPath, vk::PhysicalDevice physicalDevice, vk::Device logicalDevice, vk::Queue queue, vk::CommandPool commandPool)
+void Model::Load(const char *modelPath, MemoryAllocator &memoryAllocator, vk::Device logicalDevice, StagingRing &stagingRing, uint32_t queueFamily)
 {
-    loadModel(modelPath);
-    createVertexBuffer(physicalDevice, logicalDevice, queue, commandPool);
-    createIndexBuffer(physicalDevice, logicalDevice, queue, commandPool);
+    LoadMeshData(modelPath);
+    UploadMesh(memoryAllocator, logicalDevice, stagingRing, queueFamily, queueFamily);
 }
 
-void Model::LoadInstantiable(const char *modelPath, uint32_t instanceCount, vk::PhysicalDevice physicalDevice, vk::Device logicalDevice, vk::Queue queue, vk::CommandPool commandPool) 
+void Model::LoadInstantiable(const char *modelPath, uint32_t instanceCount, uint32_t drawGroupCount, uint32_t instanceBufferCount, MemoryAllocator &memoryAllocator, vk::Device logicalDevice, StagingRing &stagingRing, uint32_t queueFamily) 
 {
-    loadModel(modelPath);
-    createVertexBuffer(physicalDevice, logicalDevice, queue, commandPool);
-    createIndexBuffer(physicalDevice, logicalDevice, queue, commandPool);
+    LoadMeshData(modelPath);
+    UploadMesh(memoryAllocator, logicalDevice, stagingRing, queueFamily, queueFamily);
+    CreateInstanceBuffers(instanceCount, drawGroupCount, instanceBufferCount, memoryAllocator, logicalDevice);
+}
+
+void Model::CreateInstanceBuffers(uint32_t instanceCount, uint32_t drawGroupCount, uint32_t instanceBufferCount, MemoryAllocator &memoryAllocator, vk::Device logicalDevice)
+{
+    uint32_t drawCount = drawGroupCount * GetLodCount();
+    vk::DeviceSize bufferSize = sizeof(InstanceTransform) * instanceCount;
+
+    instanceBuffers.resize(instanceBufferCount);
+    instanceBuffersMemory.resize(instanceBufferCount);
+    indirectBuffers.resize(instanceBufferCount);
+    indirectBuffersMemory.resize(instanceBufferCount);
+
+    // Storage usage so a compute pass can write the transforms the vertex input stage reads, and the draws that read them
+    for (uint32_t i = 0; i < instanceBufferCount; i++)
+    {
+        Utilities::createBuffer(memoryAllocator, logicalDevice, bufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eVertexBuffer,
+                     vk::MemoryPropertyFlagBits::eDeviceLocal, instanceBuffers[i], instanceBuffersMemory[i]);
+        Utilities::createBuffer(memoryAllocator, logicalDevice, sizeof(vk::DrawIndexedIndirectCommand) * drawCount,
+                     vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
+                     vk::MemoryPropertyFlagBits::eDeviceLocal, indirectBuffers[i], indirectBuffersMemory[i]);
+    }
+}
+
+void Model::DestroyInstanceBuffers(MemoryAllocator &memoryAllocator, vk::Device logicalDevice)
+{
+    for (size_t i = 0; i < instanceBuffers.size(); i++)
+    {
+        logicalDevice.destroyBuffer(instanceBuffers[i]);
+        memoryAllocator.Free(logicalDevice, instanceBuffersMemory[i]);
+        logicalDevice.destroyBuffer(indirectBuffers[i]);
+        memoryAllocator.Free(logicalDevice, indirectBuffersMemory[i]);
+    }
+
+    instanceBuffers.clear();
+    instanceBuffersMemory.clear();
+    indirectBuffers.clear();
+    indirectBuffersMemory.clear();
+}
+
+vk::Buffer Model::GetInstanceBuffer(uint32_t instanceBufferIndex) const
+{
+    return instanceBuffers[instanceBufferIndex];
+}
+
+vk::Buffer Model::GetIndirectBuffer(uint32_t instanceBufferIndex) const
+{
+    return indirectBuffers[instanceBufferIndex];
+}
+
+uint32_t Model::GetLodCount() const
+{
+    return static_cast<uint32_t>(lods.size());
+}
+
+const Model::Lod &Model::GetLod(uint32_t lodIndex) const
+{
+    return lods[lodIndex];
+}
+
+const Model::Lod &Model::GetQuad() const
+{
+    return quad;
+}
+
+float Model::GetBoundingRadius() const
+{
+    return boundingRadius;
 }
 
 void Model::Draw(vk::CommandBuffer commandBuffer) 
@@ -19,28 +85,200 @@ void Model::Draw(vk::CommandBuffer commandBuffer)
     vk::Buffer vertexBuffers[] = {vertexBuffer};
     vk::DeviceSize offsets[] = {0};
     commandBuffer.bindVertexBuffers(0, 1, vertexBuffers, offsets);
-    commandBuffer.bindIndexBuffer(indexBuffer, 0, vk::IndexType::eUint32);
+    commandBuffer.bindIndexBuffer(indexBuffer, 0, indexType);
 
-    commandBuffer.drawIndexed(static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+    commandBuffer.drawIndexed(lods[0].indexCount, 1, lods[0].firstIndex, 0, 0);
 }
 
-void Model::DrawInstanced(vk::CommandBuffer commandBuffer, uint32_t instanceCount) 
+void Model::DrawInstanced(vk::CommandBuffer commandBuffer, uint32_t instanceCount, uint32_t instanceBufferIndex) 
 {
-    vk::Buffer vertexBuffers[] = {vertexBuffer};
-    vk::DeviceSize offsets[] = {0};
-    commandBuffer.bindVertexBuffers(0, 1, vertexBuffers, offsets);
-    commandBuffer.bindIndexBuffer(indexBuffer, 0, vk::IndexType::eUint32);
+    vk::Buffer vertexBuffers[] = {vertexBuffer, instanceBuffers[instanceBufferIndex]};
+    vk::DeviceSize offsets[] = {0, 0};
+    commandBuffer.bindVertexBuffers(0, 2, vertexBuffers, offsets);
+    commandBuffer.bindIndexBuffer(indexBuffer, 0, indexType);
+
+    commandBuffer.drawIndexed(lods[0].indexCount, instanceCount, lods[0].firstIndex, 0, 0);
+}
+
+// Draws however many instances the indirect commands of the draw group say were written to the instance buffer, one draw per LOD.
+// Each command's first instance selects the range of the instance buffer it reads.
+void Model::DrawInstancedIndirect(vk::CommandBuffer commandBuffer, uint32_t instanceBufferIndex, uint32_t drawGroup) 
+{
+    vk::Buffer vertexBuffers[] = {vertexBuffer, instanceBuffers[instanceBufferIndex]};
+    vk::DeviceSize offsets[] = {0, 0};
+    commandBuffer.bindVertexBuffers(0, 2, vertexBuffers, offsets);
+    commandBuffer.bindIndexBuffer(indexBuffer, 0, indexType);
 
-    commandBuffer.drawIndexed(static_cast<uint32_t>(indices.size()), instanceCount, 0, 0, 0);
+    for (uint32_t lod = 0; lod < GetLodCount(); lod++)
+    {
+        vk::DeviceSize drawOffset = sizeof(vk::DrawIndexedIndirectCommand) * (drawGroup * GetLodCount() + lod);
+        commandBuffer.drawIndexedIndirect(indirectBuffers[instanceBufferIndex], drawOffset, 1, sizeof(vk::DrawIndexedIndirectCommand));
+    }
 }
 
-void Model::Destroy(vk::Device logicalDevice) 
+void Model::Destroy(MemoryAllocator &memoryAllocator, vk::Device logicalDevice) 
 {
+    DestroyInstanceBuffers(memoryAllocator, logicalDevice);
+
     logicalDevice.destroyBuffer(indexBuffer);
-    logicalDevice.freeMemory(indexBufferMemory);
+    memoryAllocator.Free(logicalDevice, indexBufferMemory);
 
     logicalDevice.destroyBuffer(vertexBuffer);
-    logicalDevice.freeMemory(vertexBufferMemory);
+    memoryAllocator.Free(logicalDevice, vertexBufferMemory);
+}
+
+// Reads the mesh cache next to the model when it is still valid for it, otherwise builds the mesh from the OBJ and writes the cache
+void Model::LoadMeshData(const char *modelPath)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+    std::string cachePath = std::string(modelPath) + ".meshcache";
+
+    bool isCacheLoaded = loadMeshCache(modelPath, cachePath);
+    if (!isCacheLoaded)
+    {
+        loadModel(modelPath);
+        generateLods();
+        optimizeMesh();
+        appendQuad();
+
+        std::vector<char> indexData = packIndices();
+        vertexDataSize = sizeof(Vertex) * vertices.size();
+
+        saveMeshCache(modelPath, cachePath, indexData);
+
+        meshData.resize(vertexDataSize + indexData.size());
+        memcpy(meshData.data(), vertices.data(), vertexDataSize);
+        memcpy(meshData.data() + vertexDataSize, indexData.data(), indexData.size());
+    }
+
+    // Only needed to build the mesh
+    vertices.clear();
+    indices.clear();
+
+    float loadTimeMS = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+    std::cout << (isCacheLoaded ? "Loaded " : "Built ") << modelPath << (isCacheLoaded ? " from its mesh cache in " : " and its mesh cache in ")
+              << loadTimeMS << " ms" << std::endl;
+}
+
+// The header is followed by the vertex data and the packed index data, exactly as they are uploaded.
+// The source's modification time is checked first, the source is only hashed when it differs.
+bool Model::loadMeshCache(const char *modelPath, const std::string &cachePath)
+{
+    std::fstream cacheFile(cachePath, std::ios::in | std::ios::out | std::ios::binary);
+    if (!cacheFile.is_open())
+    {
+        return false;
+    }
+
+    MeshCacheHeader header{};
+    if (!cacheFile.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != MESH_CACHE_VERSION ||
+        header.vertexSize != sizeof(Vertex) ||
+        header.lodCount == 0 || header.lodCount > MAX_LOD_COUNT)
+    {
+        return false;
+    }
+
+    std::error_code errorCode;
+    int64_t sourceModifiedTime = std::filesystem::last_write_time(modelPath, errorCode).time_since_epoch().count();
+    if (errorCode)
+    {
+        return false;
+    }
+
+    if (sourceModifiedTime != header.sourceModifiedTime)
+    {
+        // Touched or copied without changing, such as by the build copying the models, keep the cache and its new time
+        if (hashFile(modelPath) != header.sourceHash)
+        {
+            return false;
+        }
+
+        header.sourceModifiedTime = sourceModifiedTime;
+        cacheFile.seekp(0);
+        cacheFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        cacheFile.seekg(sizeof(header));
+    }
+
+    vk::DeviceSize indexSize = header.indexType == static_cast<uint32_t>(vk::IndexType::eUint16) ? sizeof(uint16_t) : sizeof(uint32_t);
+    vk::DeviceSize cacheVertexDataSize = sizeof(Vertex) * header.vertexCount;
+    vk::DeviceSize indexDataSize = indexSize * header.indexCount;
+
+    uint64_t cacheSize = std::filesystem::file_size(cachePath, errorCode);
+    if (errorCode || cacheSize != sizeof(header) + cacheVertexDataSize + indexDataSize)
+    {
+        return false;
+    }
+
+    // Read as one block in the buffers' layout, nothing is parsed on the way
+    meshData.resize(cacheVertexDataSize + indexDataSize);
+    if (!cacheFile.read(meshData.data(), static_cast<std::streamsize>(meshData.size())))
+    {
+        throw std::runtime_error("Failed to read mesh cache " + cachePath + "!");
+    }
+    vertexDataSize = cacheVertexDataSize;
+
+    lods.assign(header.lods, header.lods + header.lodCount);
+    quad = header.quad;
+    boundingRadius = header.boundingRadius;
+    indexType = static_cast<vk::IndexType>(header.indexType);
+
+    return true;
+}
+
+// A cache that can't be written only costs the next launch its parsing
+void Model::saveMeshCache(const char *modelPath, const std::string &cachePath, const std::vector<char> &indexData) const
+{
+    std::error_code errorCode;
+    int64_t sourceModifiedTime = std::filesystem::last_write_time(modelPath, errorCode).time_since_epoch().count();
+    if (errorCode)
+    {
+        return;
+    }
+
+    MeshCacheHeader header{};
+    memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+    header.version = MESH_CACHE_VERSION;
+    header.vertexSize = sizeof(Vertex);
+    header.sourceHash = hashFile(modelPath);
+    header.sourceModifiedTime = sourceModifiedTime;
+    header.vertexCount = static_cast<uint32_t>(vertices.size());
+    header.indexCount = static_cast<uint32_t>(indices.size());
+    header.indexType = static_cast<uint32_t>(indexType);
+    header.lodCount = GetLodCount();
+    std::copy(lods.begin(), lods.end(), header.lods);
+    header.quad = quad;
+    header.boundingRadius = boundingRadius;
+
+    std::ofstream cacheFile(cachePath, std::ios::binary | std::ios::trunc);
+    if (!cacheFile.is_open())
+    {
+        std::cerr << "Failed to write mesh cache " << cachePath << std::endl;
+        return;
+    }
+
+    cacheFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    cacheFile.write(reinterpret_cast<const char *>(vertices.data()), sizeof(Vertex) * vertices.size());
+    cacheFile.write(indexData.data(), indexData.size());
+}
+
+// 64-bit FNV-1a of the whole file
+uint64_t Model::hashFile(const char *path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> buffer(1 << 16);
+
+    uint64_t hash = 14695981039346656037ull;
+    while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0)
+    {
+        for (std::streamsize i = 0; i < file.gcount(); i++)
+        {
+            hash = (hash ^ static_cast<uint8_t>(buffer[i])) * 1099511628211ull;
+        }
+    }
+
+    return hash;
 }
 
 void Model::loadModel(const char *path)
@@ -68,16 +306,20 @@ void Model::loadModel(const char *path)
                 attrib.vertices[3 * index.vertex_index + 1],
                 attrib.vertices[3 * index.vertex_index + 2]};
 
-            vertex.textureCoordinates = {
-                attrib.texcoords[2 * index.texcoord_index + 0],
-                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]};
+            vertex.normal = Vertex::packNormal({
+                attrib.normals[3 * index.normal_index + 0],
+                attrib.normals[3 * index.normal_index + 1],
+                attrib.normals[3 * index.normal_index + 2]});
 
-            vertex.color = {1.0f, 1.0f, 1.0f};
+            vertex.textureCoordinates = Vertex::packTextureCoordinates({
+                attrib.texcoords[2 * index.texcoord_index + 0],
+                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]});
 
             if (uniqueVertices.count(vertex) == 0)
             {
                 uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
                 vertices.push_back(vertex);
+                boundingRadius = std::max(boundingRadius, glm::length(vertex.position));
             }
 
             indices.push_back(uniqueVertices[vertex]);
@@ -85,58 +327,334 @@ void Model::loadModel(const char *path)
     }
 }
 
-void Model::createVertexBuffer(vk::PhysicalDevice physicalDevice, vk::Device logicalDevice, vk::Queue queue, vk::CommandPool commandPool)
+// Appends simplified copies of the mesh to the index buffer, each aiming for a quarter of the previous LOD's triangles
+// without going under a few tens of them
+void Model::generateLods()
+{
+    const uint32_t MIN_LOD_TRIANGLE_COUNT = 32;
+    const uint32_t MAX_GRID_RESOLUTION = 32;
+
+    lods.clear();
+    lods.push_back(Lod{0, static_cast<uint32_t>(indices.size()), 0.0f});
+
+    uint32_t gridResolution = MAX_GRID_RESOLUTION;
+    while (lods.size() < MAX_LOD_COUNT && gridResolution > 2)
+    {
+        uint32_t targetTriangleCount = lods.back().indexCount / 3 / 4;
+
+        std::vector<uint32_t> lodIndices;
+        uint32_t lodGridResolution = 0;
+        while (gridResolution > 2)
+        {
+            std::vector<uint32_t> candidateIndices = simplifyByClustering(gridResolution - 1);
+            if (candidateIndices.size() / 3 < MIN_LOD_TRIANGLE_COUNT)
+            {
+                break;
+            }
+
+            gridResolution--;
+            lodIndices = std::move(candidateIndices);
+            lodGridResolution = gridResolution;
+
+            if (lodIndices.size() / 3 <= targetTriangleCount)
+            {
+                break;
+            }
+        }
+
+        if (lodIndices.empty() || lodIndices.size() >= lods.back().indexCount)
+        {
+            break;
+        }
+
+        // A vertex moves at most to another vertex of its cell, the grid spans twice the bounding radius
+        float relativeCellSize = 2.0f / static_cast<float>(lodGridResolution);
+        lods.push_back(Lod{static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lodIndices.size()), relativeCellSize * std::sqrt(3.0f)});
+        indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+    }
+}
+
+// Reorders every LOD's triangles for the post-transform vertex cache, then the vertices into the order the full mesh first
+// fetches them so neighbouring triangles read neighbouring vertices. LOD index ranges stay where they are.
+void Model::optimizeMesh()
+{
+    for (const Lod &lod : lods)
+    {
+        std::vector<uint32_t> lodIndices = optimizeVertexCache(&indices[lod.firstIndex], lod.indexCount, vertices.size());
+        std::copy(lodIndices.begin(), lodIndices.end(), indices.begin() + lod.firstIndex);
+    }
+
+    // The coarser LODs only reference vertices of the full mesh, so its order decides the layout
+    const uint32_t UNUSED_VERTEX = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> vertexRemap(vertices.size(), UNUSED_VERTEX);
+    std::vector<Vertex> fetchOrderedVertices;
+    fetchOrderedVertices.reserve(vertices.size());
+
+    for (uint32_t &index : indices)
+    {
+        if (vertexRemap[index] == UNUSED_VERTEX)
+        {
+            vertexRemap[index] = static_cast<uint32_t>(fetchOrderedVertices.size());
+            fetchOrderedVertices.push_back(vertices[index]);
+        }
+
+        index = vertexRemap[index];
+    }
+
+    vertices = std::move(fetchOrderedVertices);
+}
+
+// Tipsify (Sander et al. 2007): triangles are emitted fanning around one vertex at a time, moving on to the most recently
+// used neighbour that will still be in the cache once its remaining triangles are emitted
+std::vector<uint32_t> Model::optimizeVertexCache(const uint32_t *lodIndices, size_t indexCount, size_t vertexCount)
 {
-    vk::DeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+    const int32_t CACHE_SIZE = 16;
 
-    vk::Buffer stagingBuffer;
-    vk::DeviceMemory stagingBufferMemory;
-    Utilities::createBuffer(physicalDevice, logicalDevice, bufferSize, vk::BufferUsageFlagBits::eTransferSrc,
-                 vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer,
-                 stagingBufferMemory);
+    size_t triangleCount = indexCount / 3;
 
-    void *data;
-    vk::Result result = logicalDevice.mapMemory(stagingBufferMemory, 0, bufferSize, vk::MemoryMapFlags(), &data);
-    if (result != vk::Result::eSuccess)
+    // Triangles around each vertex
+    std::vector<uint32_t> liveTriangleCounts(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; i++)
     {
-        throw std::runtime_error("Failed to map vertex buffer memory! Error Code: " + vk::to_string(result));
+        liveTriangleCounts[lodIndices[i]]++;
     }
 
-    memcpy(data, vertices.data(), (size_t)bufferSize);
-    logicalDevice.unmapMemory(stagingBufferMemory);
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t vertex = 0; vertex < vertexCount; vertex++)
+    {
+        adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangleCounts[vertex];
+    }
 
-    Utilities::createBuffer(physicalDevice, logicalDevice, bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer,
-                 vk::MemoryPropertyFlagBits::eDeviceLocal, vertexBuffer, vertexBufferMemory);
-    Utilities::copyBuffer(logicalDevice, queue, stagingBuffer, vertexBuffer, bufferSize, commandPool);
+    std::vector<uint32_t> adjacency(indexCount);
+    std::vector<uint32_t> adjacencyCursors(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < indexCount; i++)
+    {
+        adjacency[adjacencyCursors[lodIndices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
 
-    logicalDevice.destroyBuffer(stagingBuffer);
-    logicalDevice.freeMemory(stagingBufferMemory);
+    std::vector<int32_t> cacheTimes(vertexCount, 0);
+    std::vector<bool> isEmitted(triangleCount, false);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> optimizedIndices;
+    optimizedIndices.reserve(indexCount);
+
+    int32_t timeStamp = CACHE_SIZE + 1;
+    size_t scanCursor = 0;
+    int64_t fanningVertex = indexCount > 0 ? lodIndices[0] : -1;
+
+    while (fanningVertex >= 0)
+    {
+        candidates.clear();
+
+        for (uint32_t a = adjacencyOffsets[fanningVertex]; a < adjacencyOffsets[fanningVertex + 1]; a++)
+        {
+            uint32_t triangle = adjacency[a];
+            if (isEmitted[triangle])
+            {
+                continue;
+            }
+
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                uint32_t vertex = lodIndices[triangle * 3 + corner];
+                optimizedIndices.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangleCounts[vertex]--;
+
+                if (timeStamp - cacheTimes[vertex] > CACHE_SIZE)
+                {
+                    cacheTimes[vertex] = timeStamp++;
+                }
+            }
+
+            isEmitted[triangle] = true;
+        }
+
+        // The candidate staying in the cache the longest after its fan, preferring ones already deep in it
+        fanningVertex = -1;
+        int32_t bestPriority = -1;
+        for (uint32_t vertex : candidates)
+        {
+            if (liveTriangleCounts[vertex] == 0)
+            {
+                continue;
+            }
+
+            int32_t priority = 0;
+            if (timeStamp - cacheTimes[vertex] + 2 * static_cast<int32_t>(liveTriangleCounts[vertex]) <= CACHE_SIZE)
+            {
+                priority = timeStamp - cacheTimes[vertex];
+            }
+
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                fanningVertex = vertex;
+            }
+        }
+
+        // Dead end, back to a recently emitted vertex with triangles left, or else the next one in input order
+        while (fanningVertex < 0 && !deadEnds.empty())
+        {
+            uint32_t vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangleCounts[vertex] > 0)
+            {
+                fanningVertex = vertex;
+            }
+        }
+
+        while (fanningVertex < 0 && scanCursor < indexCount)
+        {
+            uint32_t vertex = lodIndices[scanCursor++];
+            if (liveTriangleCounts[vertex] > 0)
+            {
+                fanningVertex = vertex;
+            }
+        }
+    }
+
+    return optimizedIndices;
 }
 
-void Model::createIndexBuffer(vk::PhysicalDevice physicalDevice, vk::Device logicalDevice, vk::Queue queue, vk::CommandPool commandPool)
+// The vertex shader derives the corner from gl_VertexIndex, bit 0 picks the side and bit 1 the top or bottom
+void Model::appendQuad()
 {
-    vk::DeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+    quad = Lod{static_cast<uint32_t>(indices.size()), 6, 0.0f};
+    indices.insert(indices.end(), {0, 1, 2, 2, 1, 3});
+}
+
+// Vertex clustering over a grid spanning the bounding sphere: every vertex is replaced by the first vertex of its cell,
+// so the LOD indexes the same vertex buffer. Collapsed and duplicated triangles are dropped.
+std::vector<uint32_t> Model::simplifyByClustering(uint32_t gridResolution) const
+{
+    float cellSize = (2.0f * boundingRadius) / static_cast<float>(gridResolution);
+
+    std::unordered_map<uint32_t, uint32_t> cellRepresentatives;
+    std::vector<uint32_t> vertexRemap(vertices.size());
+
+    for (uint32_t i = 0; i < vertices.size(); i++)
+    {
+        glm::uvec3 cell = glm::uvec3(glm::clamp(glm::floor((vertices[i].position + boundingRadius) / cellSize), glm::vec3(0.0f), glm::vec3(gridResolution - 1)));
+        uint32_t cellIndex = (cell.z * gridResolution + cell.y) * gridResolution + cell.x;
+
+        // Only inserts the first vertex of each cell
+        vertexRemap[i] = cellRepresentatives.emplace(cellIndex, i).first->second;
+    }
+
+    std::vector<uint32_t> lodIndices;
+    std::set<std::array<uint32_t, 3>> triangles;
+
+    // Only the full mesh, any LODs already appended come after it
+    for (size_t i = 0; i < lods[0].indexCount; i += 3)
+    {
+        std::array<uint32_t, 3> triangle = {vertexRemap[indices[i]], vertexRemap[indices[i + 1]], vertexRemap[indices[i + 2]]};
+        if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2])
+        {
+            continue;
+        }
+
+        // Rotated so the smallest index comes first, which keeps the winding when comparing triangles
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+        if (triangles.insert(triangle).second)
+        {
+            lodIndices.insert(lodIndices.end(), triangle.begin(), triangle.end());
+        }
+    }
+
+    return lodIndices;
+}
 
-    vk::Buffer stagingBuffer;
-    vk::DeviceMemory stagingBufferMemory;
-    Utilities::createBuffer(physicalDevice, logicalDevice, bufferSize, vk::BufferUsageFlagBits::eTransferSrc,
-                 vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer,
-                 stagingBufferMemory);
+// Packs the indices into the index buffer's final layout, 16-bit when every vertex can be addressed with them.
+// 0xFFFF is left out as the primitive restart value.
+std::vector<char> Model::packIndices()
+{
+    std::vector<char> indexData;
 
-    void *data;
-    vk::Result result = logicalDevice.mapMemory(stagingBufferMemory, 0, bufferSize, vk::MemoryMapFlags(), &data);
-    if (result != vk::Result::eSuccess)
+    if (vertices.size() < std::numeric_limits<uint16_t>::max())
+    {
+        std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+        indexData.resize(sizeof(uint16_t) * shortIndices.size());
+        memcpy(indexData.data(), shortIndices.data(), indexData.size());
+        indexType = vk::IndexType::eUint16;
+    }
+    else
     {
-        throw std::runtime_error("Failed to map vertex buffer memory! Error Code: " + vk::to_string(result));
+        indexData.resize(sizeof(uint32_t) * indices.size());
+        memcpy(indexData.data(), indices.data(), indexData.size());
+        indexType = vk::IndexType::eUint32;
     }
 
-    memcpy(data, indices.data(), (size_t)bufferSize);
-    logicalDevice.unmapMemory(stagingBufferMemory);
+    return indexData;
+}
+
+// One staging region holding the vertex data followed by the index data, copied in the staging ring's current batch,
+// which the caller flushes
+void Model::UploadMesh(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, StagingRing &stagingRing, uint32_t srcQueueFamily, uint32_t dstQueueFamily)
+{
+    vk::DeviceSize indexDataSize = meshData.size() - vertexDataSize;
+
+    StagingRing::Region stagingRegion = stagingRing.Stage(memoryAllocator, logicalDevice, meshData.size());
+    memcpy(stagingRegion.mapped, meshData.data(), meshData.size());
 
-    Utilities::createBuffer(physicalDevice, logicalDevice, bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer,
+    Utilities::createBuffer(memoryAllocator, logicalDevice, vertexDataSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer,
+                 vk::MemoryPropertyFlagBits::eDeviceLocal, vertexBuffer, vertexBufferMemory);
+    Utilities::createBuffer(memoryAllocator, logicalDevice, indexDataSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer,
                  vk::MemoryPropertyFlagBits::eDeviceLocal, indexBuffer, indexBufferMemory);
-    Utilities::copyBuffer(logicalDevice, queue, stagingBuffer, indexBuffer, bufferSize, commandPool);
 
-    logicalDevice.destroyBuffer(stagingBuffer);
-    logicalDevice.freeMemory(stagingBufferMemory);
-}
\ No newline at end of file
+    vk::CommandBuffer commandBuffer = stagingRing.GetCommandBuffer(logicalDevice);
+
+    vk::BufferCopy vertexCopyRegion = vk::BufferCopy().setSrcOffset(stagingRegion.offset).setSize(vertexDataSize);
+    commandBuffer.copyBuffer(stagingRegion.buffer, vertexBuffer, 1, &vertexCopyRegion);
+
+    vk::BufferCopy indexCopyRegion = vk::BufferCopy().setSrcOffset(stagingRegion.offset + vertexDataSize).setSize(indexDataSize);
+    commandBuffer.copyBuffer(stagingRegion.buffer, indexBuffer, 1, &indexCopyRegion);
+
+    // Release half of the transfer, the staging ring's queue may not even support the vertex input stage
+    if (srcQueueFamily != dstQueueFamily)
+    {
+        std::array<vk::BufferMemoryBarrier, 2> releaseBarriers = {
+            createMeshOwnershipBarrier(vertexBuffer, srcQueueFamily, dstQueueFamily).setSrcAccessMask(vk::AccessFlagBits::eTransferWrite),
+            createMeshOwnershipBarrier(indexBuffer, srcQueueFamily, dstQueueFamily).setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)};
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe,
+                                      vk::DependencyFlags(),
+                                      0, nullptr,
+                                      static_cast<uint32_t>(releaseBarriers.size()), releaseBarriers.data(),
+                                      0, nullptr);
+    }
+
+    meshData.clear();
+    meshData.shrink_to_fit();
+}
+
+// Acquire half of UploadMesh()'s transfer, recorded on dstQueueFamily once the upload has completed
+void Model::RecordMeshAcquire(vk::CommandBuffer commandBuffer, uint32_t srcQueueFamily, uint32_t dstQueueFamily) const
+{
+    if (srcQueueFamily == dstQueueFamily)
+    {
+        return;
+    }
+
+    std::array<vk::BufferMemoryBarrier, 2> acquireBarriers = {
+        createMeshOwnershipBarrier(vertexBuffer, srcQueueFamily, dstQueueFamily).setDstAccessMask(vk::AccessFlagBits::eVertexAttributeRead),
+        createMeshOwnershipBarrier(indexBuffer, srcQueueFamily, dstQueueFamily).setDstAccessMask(vk::AccessFlagBits::eIndexRead)};
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eVertexInput,
+                                  vk::DependencyFlags(),
+                                  0, nullptr,
+                                  static_cast<uint32_t>(acquireBarriers.size()), acquireBarriers.data(),
+                                  0, nullptr);
+}
+
+vk::BufferMemoryBarrier Model::createMeshOwnershipBarrier(vk::Buffer buffer, uint32_t srcQueueFamily, uint32_t dstQueueFamily)
+{
+    return vk::BufferMemoryBarrier()
+        .setSrcQueueFamilyIndex(srcQueueFamily)
+        .setDstQueueFamilyIndex(dstQueueFamily)
+        .setBuffer(buffer)
+        .setOffset(0)
+        .setSize(vk::WholeSize);
+}
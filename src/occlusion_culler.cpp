@@ -0,0 +1,701 @@
+#include "occlusion_culler.hpp"
+
+void OcclusionCuller::Create(vk::PhysicalDevice physicalDevice, vk::Device logicalDevice, vk::PipelineCache pipelineCache)
+{
+    createDescriptorSetLayouts(logicalDevice);
+    createPipelines(logicalDevice, pipelineCache);
+    createSampler(logicalDevice);
+}
+
+void OcclusionCuller::Destroy(vk::Device logicalDevice)
+{
+    logicalDevice.destroyPipeline(cullPipeline);
+    logicalDevice.destroyPipeline(drawOffsetsPipeline);
+    logicalDevice.destroyPipeline(scatterPipeline);
+    logicalDevice.destroyPipeline(pyramidResolvePipeline);
+    logicalDevice.destroyPipeline(pyramidCopyPipeline);
+    logicalDevice.destroyPipeline(pyramidReducePipeline);
+
+    logicalDevice.destroyPipelineLayout(cullPipelineLayout);
+    logicalDevice.destroyPipelineLayout(pyramidPipelineLayout);
+
+    logicalDevice.destroyDescriptorSetLayout(cullDescriptorSetLayout);
+    logicalDevice.destroyDescriptorSetLayout(pyramidSampleDescriptorSetLayout);
+    logicalDevice.destroyDescriptorSetLayout(pyramidLevelDescriptorSetLayout);
+
+    logicalDevice.destroySampler(pyramidSampler);
+}
+
+void OcclusionCuller::CreateInstanceResources(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, uint32_t instanceCapacity, uint32_t frameCount,
+                                              const Model &model)
+{
+    boundingRadius = model.GetBoundingRadius();
+
+    pushConstants.lodCount = model.GetLodCount();
+    pushConstants.lodErrors = glm::vec4(0.0f);
+
+    // Draw group of each phase, the first instance of each draw is set on the GPU once the phase has counted its draws
+    emptyLodDraws.clear();
+    emptyQuadDraws.clear();
+    for (uint32_t phase = 0; phase < ePhaseCount; phase++)
+    {
+        for (uint32_t lod = 0; lod < model.GetLodCount(); lod++)
+        {
+            const Model::Lod &modelLod = model.GetLod(lod);
+            pushConstants.lodErrors[lod] = modelLod.error;
+
+            emptyLodDraws.push_back(vk::DrawIndexedIndirectCommand()
+                                        .setIndexCount(modelLod.indexCount)
+                                        .setFirstIndex(modelLod.firstIndex));
+            emptyQuadDraws.push_back(vk::DrawIndexedIndirectCommand()
+                                         .setIndexCount(model.GetQuad().indexCount)
+                                         .setFirstIndex(model.GetQuad().firstIndex));
+        }
+    }
+
+    candidateBuffers.resize(frameCount);
+    candidateBuffersMemory.resize(frameCount);
+    candidateHeaderBuffers.resize(frameCount);
+    candidateHeaderBuffersMemory.resize(frameCount);
+    lateCandidateBuffers.resize(frameCount);
+    lateCandidateBuffersMemory.resize(frameCount);
+    drawSlotBuffers.resize(frameCount);
+    drawSlotBuffersMemory.resize(frameCount);
+    counterBuffers.resize(frameCount);
+    counterBuffersMemory.resize(frameCount);
+    statisticsBuffers.resize(frameCount);
+    statisticsBuffersMemory.resize(frameCount);
+    statisticsBuffersMapped.resize(frameCount);
+    drawInstanceBuffers.resize(frameCount);
+    drawIndirectBuffers.resize(frameCount);
+
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        Utilities::createBuffer(memoryAllocator, logicalDevice, sizeof(Model::InstanceTransform) * instanceCapacity, vk::BufferUsageFlagBits::eStorageBuffer,
+                                vk::MemoryPropertyFlagBits::eDeviceLocal, candidateBuffers[i], candidateBuffersMemory[i]);
+        Utilities::createBuffer(memoryAllocator, logicalDevice, sizeof(CandidateHeader),
+                                vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
+                                vk::MemoryPropertyFlagBits::eDeviceLocal, candidateHeaderBuffers[i], candidateHeaderBuffersMemory[i]);
+        Utilities::createBuffer(memoryAllocator, logicalDevice, sizeof(CandidateHeader) + sizeof(uint32_t) * instanceCapacity,
+                                vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                                vk::MemoryPropertyFlagBits::eDeviceLocal, lateCandidateBuffers[i], lateCandidateBuffersMemory[i]);
+        Utilities::createBuffer(memoryAllocator, logicalDevice, sizeof(uint32_t) * instanceCapacity, vk::BufferUsageFlagBits::eStorageBuffer,
+                                vk::MemoryPropertyFlagBits::eDeviceLocal, drawSlotBuffers[i], drawSlotBuffersMemory[i]);
+        Utilities::createBuffer(memoryAllocator, logicalDevice, sizeof(uint32_t) * ePhaseCount,
+                                vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
+                                vk::MemoryPropertyFlagBits::eDeviceLocal, counterBuffers[i], counterBuffersMemory[i]);
+        Utilities::createBuffer(memoryAllocator, logicalDevice, sizeof(Statistics), vk::BufferUsageFlagBits::eTransferDst,
+                                vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, statisticsBuffers[i], statisticsBuffersMemory[i]);
+
+        statisticsBuffersMapped[i] = statisticsBuffersMemory[i].mapped;
+        memset(statisticsBuffersMapped[i], 0, sizeof(Statistics));
+
+        drawInstanceBuffers[i] = model.GetInstanceBuffer(i);
+        drawIndirectBuffers[i] = model.GetIndirectBuffer(i);
+    }
+
+    createCullDescriptorSets(logicalDevice, model);
+}
+
+void OcclusionCuller::DestroyInstanceResources(MemoryAllocator &memoryAllocator, vk::Device logicalDevice)
+{
+    logicalDevice.destroyDescriptorPool(cullDescriptorPool);
+
+    for (size_t i = 0; i < candidateBuffers.size(); i++)
+    {
+        logicalDevice.destroyBuffer(candidateBuffers[i]);
+        memoryAllocator.Free(logicalDevice, candidateBuffersMemory[i]);
+        logicalDevice.destroyBuffer(candidateHeaderBuffers[i]);
+        memoryAllocator.Free(logicalDevice, candidateHeaderBuffersMemory[i]);
+        logicalDevice.destroyBuffer(lateCandidateBuffers[i]);
+        memoryAllocator.Free(logicalDevice, lateCandidateBuffersMemory[i]);
+        logicalDevice.destroyBuffer(drawSlotBuffers[i]);
+        memoryAllocator.Free(logicalDevice, drawSlotBuffersMemory[i]);
+        logicalDevice.destroyBuffer(counterBuffers[i]);
+        memoryAllocator.Free(logicalDevice, counterBuffersMemory[i]);
+        logicalDevice.destroyBuffer(statisticsBuffers[i]);
+        memoryAllocator.Free(logicalDevice, statisticsBuffersMemory[i]);
+    }
+}
+
+void OcclusionCuller::CreateDepthPyramid(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, vk::Image depthImage, vk::ImageView depthImageView,
+                                         vk::ImageAspectFlags depthAspect, vk::SampleCountFlagBits depthSamples, vk::Extent2D extent)
+{
+    this->depthImage = depthImage;
+    this->depthAspect = depthAspect;
+    // The resolve pass reads every sample through a sampler2DMS, the copy pass a single sampled attachment through a sampler2D
+    isDepthSampled = static_cast<bool>(depthImageView);
+    isDepthMultisampled = depthSamples != vk::SampleCountFlagBits::e1;
+    isPyramidInitialised = false;
+    pyramidExtent = extent;
+    pyramidLevelCount = static_cast<uint32_t>(std::floor(std::log2(std::max(extent.width, extent.height)))) + 1;
+
+    vk::ImageCreateInfo imageCreateInfo = vk::ImageCreateInfo()
+                                              .setImageType(vk::ImageType::e2D)
+                                              .setExtent(vk::Extent3D(extent.width, extent.height, 1))
+                                              .setMipLevels(pyramidLevelCount)
+                                              .setArrayLayers(1)
+                                              .setFormat(vk::Format::eR32Sfloat)
+                                              .setTiling(vk::ImageTiling::eOptimal)
+                                              .setInitialLayout(vk::ImageLayout::eUndefined)
+                                              .setUsage(vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst)
+                                              .setSamples(vk::SampleCountFlagBits::e1)
+                                              .setSharingMode(vk::SharingMode::eExclusive);
+
+    vk::Result result = logicalDevice.createImage(&imageCreateInfo, nullptr, &pyramidImage);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create depth pyramid image! Error Code: " + vk::to_string(result));
+    }
+
+    pyramidImageMemory = memoryAllocator.AllocateImage(logicalDevice, pyramidImage, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    // A view of the whole chain for the cull pass and one per level for the passes building it
+    vk::ImageViewCreateInfo viewCreateInfo = vk::ImageViewCreateInfo()
+                                                 .setImage(pyramidImage)
+                                                 .setViewType(vk::ImageViewType::e2D)
+                                                 .setFormat(vk::Format::eR32Sfloat)
+                                                 .setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, pyramidLevelCount, 0, 1));
+
+    result = logicalDevice.createImageView(&viewCreateInfo, nullptr, &pyramidImageView);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create depth pyramid image view! Error Code: " + vk::to_string(result));
+    }
+
+    pyramidLevelImageViews.resize(pyramidLevelCount);
+    for (uint32_t level = 0; level < pyramidLevelCount; level++)
+    {
+        viewCreateInfo.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, level, 1, 0, 1));
+
+        result = logicalDevice.createImageView(&viewCreateInfo, nullptr, &pyramidLevelImageViews[level]);
+        if (result != vk::Result::eSuccess)
+        {
+            throw std::runtime_error("Failed to create depth pyramid level image view! Error Code: " + vk::to_string(result));
+        }
+    }
+
+    createPyramidDescriptorSets(logicalDevice, depthImageView);
+}
+
+void OcclusionCuller::DestroyDepthPyramid(MemoryAllocator &memoryAllocator, vk::Device logicalDevice)
+{
+    logicalDevice.destroyDescriptorPool(pyramidDescriptorPool);
+
+    for (vk::ImageView levelImageView : pyramidLevelImageViews)
+    {
+        logicalDevice.destroyImageView(levelImageView);
+    }
+
+    logicalDevice.destroyImageView(pyramidImageView);
+    logicalDevice.destroyImage(pyramidImage);
+    memoryAllocator.Free(logicalDevice, pyramidImageMemory);
+}
+
+void OcclusionCuller::RecordEarlyCull(vk::CommandBuffer commandBuffer, uint32_t frame, const CullSettings &settings)
+{
+    // A new pyramid starts out at the far plane, so nothing is occluded until it has been built once
+    if (!isPyramidInitialised)
+    {
+        vk::ImageSubresourceRange pyramidRange(vk::ImageAspectFlagBits::eColor, 0, pyramidLevelCount, 0, 1);
+
+        vk::ImageMemoryBarrier toGeneralBarrier = vk::ImageMemoryBarrier()
+                                                      .setSrcAccessMask(vk::AccessFlags())
+                                                      .setDstAccessMask(vk::AccessFlagBits::eTransferWrite)
+                                                      .setOldLayout(vk::ImageLayout::eUndefined)
+                                                      .setNewLayout(vk::ImageLayout::eGeneral)
+                                                      .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
+                                                      .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+                                                      .setImage(pyramidImage)
+                                                      .setSubresourceRange(pyramidRange);
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
+                                      vk::DependencyFlags(),
+                                      0, nullptr,
+                                      0, nullptr,
+                                      1, &toGeneralBarrier);
+
+        vk::ClearColorValue farDepth(std::array<float, 4>{1.0f, 1.0f, 1.0f, 1.0f});
+        commandBuffer.clearColorImage(pyramidImage, vk::ImageLayout::eGeneral, &farDepth, 1, &pyramidRange);
+
+        isPyramidInitialised = true;
+    }
+
+    CandidateHeader emptyList{0, 1, 1, 0};
+    const std::vector<vk::DrawIndexedIndirectCommand> &emptyDraws = settings.isQuadDrawn ? emptyQuadDraws : emptyLodDraws;
+    commandBuffer.updateBuffer(drawIndirectBuffers[frame], 0, sizeof(vk::DrawIndexedIndirectCommand) * emptyDraws.size(), emptyDraws.data());
+    commandBuffer.updateBuffer(lateCandidateBuffers[frame], 0, sizeof(emptyList), &emptyList);
+    commandBuffer.fillBuffer(counterBuffers[frame], 0, vk::WholeSize, 0);
+
+    // Also orders the read of the pyramid after the previous frame built it
+    vk::MemoryBarrier memoryBarrier = vk::MemoryBarrier()
+                                          .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderWrite)
+                                          .setDstAccessMask(vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+                                  vk::DependencyFlags(),
+                                  1, &memoryBarrier,
+                                  0, nullptr,
+                                  0, nullptr);
+
+    pushConstants.viewProjection = settings.viewProjection;
+    pushConstants.pyramidSize = glm::vec2(pyramidExtent.width, pyramidExtent.height);
+    pushConstants.pyramidLevelCount = pyramidLevelCount;
+    pushConstants.boundingRadius = boundingRadius;
+    pushConstants.isOcclusionEnabled = settings.isOcclusionEnabled ? 1 : 0;
+    pushConstants.lodScale = settings.lodScale;
+
+    dispatchCull(commandBuffer, frame, eEarly, candidateHeaderBuffers[frame]);
+
+    // The early draw, and the late cull reading the early rejects
+    recordComputeBarrier(commandBuffer,
+                         vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eComputeShader,
+                         vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eShaderRead);
+}
+
+void OcclusionCuller::RecordDepthPyramid(vk::CommandBuffer commandBuffer)
+{
+    if (!pushConstants.isOcclusionEnabled || !isDepthSampled)
+    {
+        return;
+    }
+
+    vk::ImageSubresourceRange depthRange(depthAspect, 0, 1, 0, 1);
+
+    // The early draw's depth writes are read by the resolve pass, the previous frame's late cull must be done with the pyramid
+    vk::ImageMemoryBarrier depthReadBarrier = vk::ImageMemoryBarrier()
+                                                  .setSrcAccessMask(vk::AccessFlagBits::eDepthStencilAttachmentWrite)
+                                                  .setDstAccessMask(vk::AccessFlagBits::eShaderRead)
+                                                  .setOldLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal)
+                                                  .setNewLayout(vk::ImageLayout::eDepthStencilReadOnlyOptimal)
+                                                  .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
+                                                  .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+                                                  .setImage(depthImage)
+                                                  .setSubresourceRange(depthRange);
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests | vk::PipelineStageFlagBits::eComputeShader,
+                                  vk::PipelineStageFlagBits::eComputeShader,
+                                  vk::DependencyFlags(),
+                                  0, nullptr,
+                                  0, nullptr,
+                                  1, &depthReadBarrier);
+
+    for (uint32_t level = 0; level < pyramidLevelCount; level++)
+    {
+        uint32_t levelWidth = std::max(pyramidExtent.width >> level, 1u);
+        uint32_t levelHeight = std::max(pyramidExtent.height >> level, 1u);
+
+        // Level 0 takes the farthest sample of every pixel, every other level the farthest texel of the level above
+        vk::Pipeline levelPipeline = pyramidReducePipeline;
+        if (level == 0)
+        {
+            levelPipeline = isDepthMultisampled ? pyramidResolvePipeline : pyramidCopyPipeline;
+        }
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, levelPipeline);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pyramidPipelineLayout, 0, 1, &pyramidLevelDescriptorSets[level], 0, nullptr);
+        commandBuffer.dispatch((levelWidth + PYRAMID_WORKGROUP_SIZE - 1) / PYRAMID_WORKGROUP_SIZE, (levelHeight + PYRAMID_WORKGROUP_SIZE - 1) / PYRAMID_WORKGROUP_SIZE, 1);
+
+        vk::MemoryBarrier levelBarrier = vk::MemoryBarrier()
+                                             .setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+                                             .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+
+        if (level == 0)
+        {
+            // Hand the depth attachment back to the late draw
+            vk::ImageMemoryBarrier depthAttachmentBarrier = depthReadBarrier;
+            depthAttachmentBarrier
+                .setSrcAccessMask(vk::AccessFlags())
+                .setDstAccessMask(vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite)
+                .setOldLayout(vk::ImageLayout::eDepthStencilReadOnlyOptimal)
+                .setNewLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
+
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                          vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+                                          vk::DependencyFlags(),
+                                          1, &levelBarrier,
+                                          0, nullptr,
+                                          1, &depthAttachmentBarrier);
+        }
+        else
+        {
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+                                          vk::DependencyFlags(),
+                                          1, &levelBarrier,
+                                          0, nullptr,
+                                          0, nullptr);
+        }
+    }
+}
+
+void OcclusionCuller::RecordLateCull(vk::CommandBuffer commandBuffer, uint32_t frame)
+{
+    dispatchCull(commandBuffer, frame, eLate, lateCandidateBuffers[frame]);
+
+    recordComputeBarrier(commandBuffer,
+                         vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eTransfer,
+                         vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eTransferRead);
+
+    vk::BufferCopy candidateCountCopyRegion = vk::BufferCopy()
+                                                  .setSrcOffset(offsetof(CandidateHeader, count))
+                                                  .setDstOffset(offsetof(Statistics, candidateCount))
+                                                  .setSize(sizeof(uint32_t));
+    commandBuffer.copyBuffer(candidateHeaderBuffers[frame], statisticsBuffers[frame], 1, &candidateCountCopyRegion);
+
+    vk::BufferCopy rejectedCountCopyRegion = vk::BufferCopy()
+                                                 .setDstOffset(offsetof(Statistics, rejectedCounts))
+                                                 .setSize(sizeof(uint32_t) * ePhaseCount);
+    commandBuffer.copyBuffer(counterBuffers[frame], statisticsBuffers[frame], 1, &rejectedCountCopyRegion);
+
+    std::vector<vk::BufferCopy> drawnCountCopyRegions;
+    for (uint32_t phase = 0; phase < ePhaseCount; phase++)
+    {
+        for (uint32_t lod = 0; lod < pushConstants.lodCount; lod++)
+        {
+            uint32_t drawIndex = phase * pushConstants.lodCount + lod;
+            drawnCountCopyRegions.push_back(vk::BufferCopy()
+                                                .setSrcOffset(sizeof(vk::DrawIndexedIndirectCommand) * drawIndex + offsetof(VkDrawIndexedIndirectCommand, instanceCount))
+                                                .setDstOffset(offsetof(Statistics, drawnCounts) + sizeof(uint32_t) * (phase * Model::MAX_LOD_COUNT + lod))
+                                                .setSize(sizeof(uint32_t)));
+        }
+    }
+    commandBuffer.copyBuffer(drawIndirectBuffers[frame], statisticsBuffers[frame], static_cast<uint32_t>(drawnCountCopyRegions.size()), drawnCountCopyRegions.data());
+
+    vk::MemoryBarrier hostBarrier = vk::MemoryBarrier()
+                                        .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+                                        .setDstAccessMask(vk::AccessFlagBits::eHostRead);
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+                                  vk::DependencyFlags(),
+                                  1, &hostBarrier,
+                                  0, nullptr,
+                                  0, nullptr);
+}
+
+OcclusionCuller::Statistics OcclusionCuller::GetStatistics(uint32_t frame) const
+{
+    return *static_cast<const Statistics *>(statisticsBuffersMapped[frame]);
+}
+
+bool OcclusionCuller::IsOcclusionSupported() const
+{
+    return isDepthSampled;
+}
+
+vk::Buffer OcclusionCuller::GetCandidateBuffer(uint32_t frame) const
+{
+    return candidateBuffers[frame];
+}
+
+vk::Buffer OcclusionCuller::GetCandidateHeaderBuffer(uint32_t frame) const
+{
+    return candidateHeaderBuffers[frame];
+}
+
+void OcclusionCuller::createDescriptorSetLayouts(vk::Device logicalDevice)
+{
+    // Bindings match occlusion_cull_common.glsl: candidates, candidate header, draw instances, draw commands, late candidates, counters
+    // and draw slots
+    std::vector<vk::DescriptorSetLayoutBinding> layoutBindings;
+    for (uint32_t binding = 0; binding <= 6; binding++)
+    {
+        layoutBindings.push_back(vk::DescriptorSetLayoutBinding()
+                                     .setBinding(binding)
+                                     .setDescriptorCount(1)
+                                     .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                     .setPImmutableSamplers(nullptr)
+                                     .setStageFlags(vk::ShaderStageFlagBits::eCompute));
+    }
+
+    vk::DescriptorSetLayoutCreateInfo layoutCreateInfo = vk::DescriptorSetLayoutCreateInfo()
+                                                             .setBindingCount(static_cast<uint32_t>(layoutBindings.size()))
+                                                             .setPBindings(layoutBindings.data());
+
+    vk::Result result = logicalDevice.createDescriptorSetLayout(&layoutCreateInfo, nullptr, &cullDescriptorSetLayout);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create occlusion cull descriptor set layout! Error Code: " + vk::to_string(result));
+    }
+
+    // The whole pyramid, sampled by the cull pass. Kept apart from the buffers since it follows the swap chain's lifetime.
+    vk::DescriptorSetLayoutBinding pyramidBinding = vk::DescriptorSetLayoutBinding()
+                                                        .setBinding(0)
+                                                        .setDescriptorCount(1)
+                                                        .setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+                                                        .setPImmutableSamplers(nullptr)
+                                                        .setStageFlags(vk::ShaderStageFlagBits::eCompute);
+
+    layoutCreateInfo.setBindingCount(1).setPBindings(&pyramidBinding);
+
+    result = logicalDevice.createDescriptorSetLayout(&layoutCreateInfo, nullptr, &pyramidSampleDescriptorSetLayout);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create depth pyramid descriptor set layout! Error Code: " + vk::to_string(result));
+    }
+
+    // depth_pyramid_*.comp.glsl: the level above (or the depth attachment) in, one pyramid level out
+    std::array<vk::DescriptorSetLayoutBinding, 2> levelBindings = {
+        vk::DescriptorSetLayoutBinding()
+            .setBinding(0)
+            .setDescriptorCount(1)
+            .setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+            .setPImmutableSamplers(nullptr)
+            .setStageFlags(vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding()
+            .setBinding(1)
+            .setDescriptorCount(1)
+            .setDescriptorType(vk::DescriptorType::eStorageImage)
+            .setPImmutableSamplers(nullptr)
+            .setStageFlags(vk::ShaderStageFlagBits::eCompute)};
+
+    layoutCreateInfo.setBindingCount(static_cast<uint32_t>(levelBindings.size())).setPBindings(levelBindings.data());
+
+    result = logicalDevice.createDescriptorSetLayout(&layoutCreateInfo, nullptr, &pyramidLevelDescriptorSetLayout);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create depth pyramid level descriptor set layout! Error Code: " + vk::to_string(result));
+    }
+}
+
+void OcclusionCuller::createPipelines(vk::Device logicalDevice, vk::PipelineCache pipelineCache)
+{
+    vk::PushConstantRange pushConstantRange = vk::PushConstantRange()
+                                                  .setStageFlags(vk::ShaderStageFlagBits::eCompute)
+                                                  .setOffset(0)
+                                                  .setSize(sizeof(CullPushConstants));
+
+    std::array<vk::DescriptorSetLayout, 2> cullSetLayouts = {cullDescriptorSetLayout, pyramidSampleDescriptorSetLayout};
+
+    vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo = vk::PipelineLayoutCreateInfo()
+                                                                .setSetLayoutCount(static_cast<uint32_t>(cullSetLayouts.size()))
+                                                                .setPSetLayouts(cullSetLayouts.data())
+                                                                .setPushConstantRangeCount(1)
+                                                                .setPPushConstantRanges(&pushConstantRange);
+
+    vk::Result result = logicalDevice.createPipelineLayout(&pipelineLayoutCreateInfo, nullptr, &cullPipelineLayout);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create occlusion cull pipeline layout! Error Code: " + vk::to_string(result));
+    }
+
+    vk::PipelineLayoutCreateInfo pyramidPipelineLayoutCreateInfo = vk::PipelineLayoutCreateInfo()
+                                                                       .setSetLayoutCount(1)
+                                                                       .setPSetLayouts(&pyramidLevelDescriptorSetLayout);
+
+    result = logicalDevice.createPipelineLayout(&pyramidPipelineLayoutCreateInfo, nullptr, &pyramidPipelineLayout);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create depth pyramid pipeline layout! Error Code: " + vk::to_string(result));
+    }
+
+    cullPipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/occlusion_cull.comp.spv", cullPipelineLayout);
+    drawOffsetsPipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/occlusion_draw_offsets.comp.spv", cullPipelineLayout);
+    scatterPipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/occlusion_scatter.comp.spv", cullPipelineLayout);
+    pyramidResolvePipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/depth_pyramid_resolve.comp.spv", pyramidPipelineLayout);
+    pyramidCopyPipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/depth_pyramid_copy.comp.spv", pyramidPipelineLayout);
+    pyramidReducePipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/depth_pyramid_reduce.comp.spv", pyramidPipelineLayout);
+}
+
+void OcclusionCuller::createSampler(vk::Device logicalDevice)
+{
+    // Only ever read with texelFetch()
+    vk::SamplerCreateInfo samplerCreateInfo = vk::SamplerCreateInfo()
+                                                  .setMagFilter(vk::Filter::eNearest)
+                                                  .setMinFilter(vk::Filter::eNearest)
+                                                  .setMipmapMode(vk::SamplerMipmapMode::eNearest)
+                                                  .setAddressModeU(vk::SamplerAddressMode::eClampToEdge)
+                                                  .setAddressModeV(vk::SamplerAddressMode::eClampToEdge)
+                                                  .setAddressModeW(vk::SamplerAddressMode::eClampToEdge)
+                                                  .setAnisotropyEnable(vk::False)
+                                                  .setUnnormalizedCoordinates(vk::False)
+                                                  .setCompareEnable(vk::False)
+                                                  .setMinLod(0.0f)
+                                                  .setMaxLod(VK_LOD_CLAMP_NONE);
+
+    vk::Result result = logicalDevice.createSampler(&samplerCreateInfo, nullptr, &pyramidSampler);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create depth pyramid sampler! Error Code: " + vk::to_string(result));
+    }
+}
+
+void OcclusionCuller::createCullDescriptorSets(vk::Device logicalDevice, const Model &model)
+{
+    uint32_t setCount = static_cast<uint32_t>(candidateBuffers.size());
+
+    vk::DescriptorPoolSize poolSize = vk::DescriptorPoolSize()
+                                          .setType(vk::DescriptorType::eStorageBuffer)
+                                          .setDescriptorCount(setCount * 7);
+
+    vk::DescriptorPoolCreateInfo poolCreateInfo = vk::DescriptorPoolCreateInfo()
+                                                      .setPoolSizeCount(1)
+                                                      .setPPoolSizes(&poolSize)
+                                                      .setMaxSets(setCount);
+
+    vk::Result result = logicalDevice.createDescriptorPool(&poolCreateInfo, nullptr, &cullDescriptorPool);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create occlusion cull descriptor pool! Error Code: " + vk::to_string(result));
+    }
+
+    std::vector<vk::DescriptorSetLayout> layouts(setCount, cullDescriptorSetLayout);
+    vk::DescriptorSetAllocateInfo allocateInfo = vk::DescriptorSetAllocateInfo()
+                                                     .setDescriptorPool(cullDescriptorPool)
+                                                     .setDescriptorSetCount(setCount)
+                                                     .setPSetLayouts(layouts.data());
+
+    cullDescriptorSets.resize(setCount);
+    result = logicalDevice.allocateDescriptorSets(&allocateInfo, cullDescriptorSets.data());
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to allocate occlusion cull descriptor sets! Error Code: " + vk::to_string(result));
+    }
+
+    for (uint32_t i = 0; i < setCount; i++)
+    {
+        std::array<vk::Buffer, 7> buffers = {
+            candidateBuffers[i], candidateHeaderBuffers[i],
+            drawInstanceBuffers[i], drawIndirectBuffers[i],
+            lateCandidateBuffers[i], counterBuffers[i],
+            drawSlotBuffers[i]};
+
+        std::array<vk::DescriptorBufferInfo, 7> bufferInfos;
+        std::array<vk::WriteDescriptorSet, 7> descriptorWrites;
+
+        for (uint32_t binding = 0; binding < buffers.size(); binding++)
+        {
+            bufferInfos[binding] = vk::DescriptorBufferInfo()
+                                       .setBuffer(buffers[binding])
+                                       .setOffset(0)
+                                       .setRange(vk::WholeSize);
+
+            descriptorWrites[binding] = vk::WriteDescriptorSet()
+                                            .setDstSet(cullDescriptorSets[i])
+                                            .setDstBinding(binding)
+                                            .setDstArrayElement(0)
+                                            .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                            .setDescriptorCount(1)
+                                            .setPBufferInfo(&bufferInfos[binding]);
+        }
+
+        logicalDevice.updateDescriptorSets(static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+}
+
+void OcclusionCuller::createPyramidDescriptorSets(vk::Device logicalDevice, vk::ImageView depthImageView)
+{
+    // One set per level plus the set sampling the whole pyramid
+    std::array<vk::DescriptorPoolSize, 2> poolSizes = {
+        vk::DescriptorPoolSize()
+            .setType(vk::DescriptorType::eCombinedImageSampler)
+            .setDescriptorCount(pyramidLevelCount + 1),
+        vk::DescriptorPoolSize()
+            .setType(vk::DescriptorType::eStorageImage)
+            .setDescriptorCount(pyramidLevelCount)};
+
+    vk::DescriptorPoolCreateInfo poolCreateInfo = vk::DescriptorPoolCreateInfo()
+                                                      .setPoolSizeCount(static_cast<uint32_t>(poolSizes.size()))
+                                                      .setPPoolSizes(poolSizes.data())
+                                                      .setMaxSets(pyramidLevelCount + 1);
+
+    vk::Result result = logicalDevice.createDescriptorPool(&poolCreateInfo, nullptr, &pyramidDescriptorPool);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create depth pyramid descriptor pool! Error Code: " + vk::to_string(result));
+    }
+
+    std::vector<vk::DescriptorSetLayout> layouts(pyramidLevelCount, pyramidLevelDescriptorSetLayout);
+    vk::DescriptorSetAllocateInfo allocateInfo = vk::DescriptorSetAllocateInfo()
+                                                     .setDescriptorPool(pyramidDescriptorPool)
+                                                     .setDescriptorSetCount(pyramidLevelCount)
+                                                     .setPSetLayouts(layouts.data());
+
+    pyramidLevelDescriptorSets.resize(pyramidLevelCount);
+    result = logicalDevice.allocateDescriptorSets(&allocateInfo, pyramidLevelDescriptorSets.data());
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to allocate depth pyramid level descriptor sets! Error Code: " + vk::to_string(result));
+    }
+
+    allocateInfo.setDescriptorSetCount(1).setPSetLayouts(&pyramidSampleDescriptorSetLayout);
+    result = logicalDevice.allocateDescriptorSets(&allocateInfo, &pyramidSampleDescriptorSet);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to allocate depth pyramid descriptor set! Error Code: " + vk::to_string(result));
+    }
+
+    // Level 0's set is never bound without a depth attachment to read, so it's left unwritten
+    for (uint32_t level = isDepthSampled ? 0 : 1; level < pyramidLevelCount; level++)
+    {
+        vk::DescriptorImageInfo sourceInfo = level == 0
+                                                 ? vk::DescriptorImageInfo(pyramidSampler, depthImageView, vk::ImageLayout::eDepthStencilReadOnlyOptimal)
+                                                 : vk::DescriptorImageInfo(pyramidSampler, pyramidLevelImageViews[level - 1], vk::ImageLayout::eGeneral);
+        vk::DescriptorImageInfo destinationInfo(nullptr, pyramidLevelImageViews[level], vk::ImageLayout::eGeneral);
+
+        std::array<vk::WriteDescriptorSet, 2> descriptorWrites = {
+            vk::WriteDescriptorSet()
+                .setDstSet(pyramidLevelDescriptorSets[level])
+                .setDstBinding(0)
+                .setDstArrayElement(0)
+                .setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+                .setDescriptorCount(1)
+                .setPImageInfo(&sourceInfo),
+            vk::WriteDescriptorSet()
+                .setDstSet(pyramidLevelDescriptorSets[level])
+                .setDstBinding(1)
+                .setDstArrayElement(0)
+                .setDescriptorType(vk::DescriptorType::eStorageImage)
+                .setDescriptorCount(1)
+                .setPImageInfo(&destinationInfo)};
+
+        logicalDevice.updateDescriptorSets(static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+
+    vk::DescriptorImageInfo pyramidInfo(pyramidSampler, pyramidImageView, vk::ImageLayout::eGeneral);
+
+    vk::WriteDescriptorSet pyramidWrite = vk::WriteDescriptorSet()
+                                              .setDstSet(pyramidSampleDescriptorSet)
+                                              .setDstBinding(0)
+                                              .setDstArrayElement(0)
+                                              .setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+                                              .setDescriptorCount(1)
+                                              .setPImageInfo(&pyramidInfo);
+
+    logicalDevice.updateDescriptorSets(1, &pyramidWrite, 0, nullptr);
+}
+
+void OcclusionCuller::recordComputeBarrier(vk::CommandBuffer commandBuffer, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess)
+{
+    vk::MemoryBarrier memoryBarrier = vk::MemoryBarrier()
+                                          .setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+                                          .setDstAccessMask(dstAccess);
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, dstStage,
+                                  vk::DependencyFlags(),
+                                  1, &memoryBarrier,
+                                  0, nullptr,
+                                  0, nullptr);
+}
+
+// One thread per entry of the list the dispatch buffer heads, which also holds the group count. The cull pass counts the
+// phase's draws, a single thread then places them after the previous phase's and the scatter pass copies the transforms over the same list.
+void OcclusionCuller::dispatchCull(vk::CommandBuffer commandBuffer, uint32_t frame, Phase phase, vk::Buffer dispatchBuffer)
+{
+    pushConstants.phase = phase;
+
+    std::array<vk::DescriptorSet, 2> descriptorSets = {cullDescriptorSets[frame], pyramidSampleDescriptorSet};
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, cullPipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, cullPipelineLayout, 0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, nullptr);
+    commandBuffer.pushConstants(cullPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(CullPushConstants), &pushConstants);
+    commandBuffer.dispatchIndirect(dispatchBuffer, 0);
+
+    recordComputeBarrier(commandBuffer, vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, drawOffsetsPipeline);
+    commandBuffer.dispatch(1, 1, 1);
+
+    recordComputeBarrier(commandBuffer, vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, scatterPipeline);
+    commandBuffer.dispatchIndirect(dispatchBuffer, 0);
+}
@@ -0,0 +1,159 @@
+#include "prefix_sum.hpp"
+
+#include <array>
+
+void PrefixSum::Create(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, vk::PipelineCache pipelineCache, vk::Buffer inputBuffer, vk::Buffer outputBuffer, uint32_t count)
+{
+    this->count = count;
+    blockCount = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    Utilities::createBuffer(memoryAllocator, logicalDevice, sizeof(uint32_t) * blockCount, vk::BufferUsageFlagBits::eStorageBuffer,
+                            vk::MemoryPropertyFlagBits::eDeviceLocal, blockSumBuffer, blockSumBufferMemory);
+
+    createDescriptorSet(logicalDevice, inputBuffer, outputBuffer);
+    createPipelines(logicalDevice, pipelineCache);
+}
+
+void PrefixSum::Record(vk::CommandBuffer commandBuffer)
+{
+    PushConstants pushConstants{count};
+
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+    commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(PushConstants), &pushConstants);
+
+    // Block totals -> their exclusive prefix -> every block's values offset by it
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, reducePipeline);
+    commandBuffer.dispatch(blockCount, 1, 1);
+    recordComputeBarrier(commandBuffer);
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, blockScanPipeline);
+    commandBuffer.dispatch(1, 1, 1);
+    recordComputeBarrier(commandBuffer);
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, addPipeline);
+    commandBuffer.dispatch(blockCount, 1, 1);
+}
+
+void PrefixSum::Destroy(MemoryAllocator &memoryAllocator, vk::Device logicalDevice)
+{
+    logicalDevice.destroyPipeline(reducePipeline);
+    logicalDevice.destroyPipeline(blockScanPipeline);
+    logicalDevice.destroyPipeline(addPipeline);
+    logicalDevice.destroyPipelineLayout(pipelineLayout);
+
+    logicalDevice.destroyDescriptorPool(descriptorPool);
+    logicalDevice.destroyDescriptorSetLayout(descriptorSetLayout);
+
+    logicalDevice.destroyBuffer(blockSumBuffer);
+    memoryAllocator.Free(logicalDevice, blockSumBufferMemory);
+}
+
+void PrefixSum::createDescriptorSet(vk::Device logicalDevice, vk::Buffer inputBuffer, vk::Buffer outputBuffer)
+{
+    // Bindings match prefix_sum_common.glsl: values in, exclusive prefix sums out, block totals
+    std::array<vk::Buffer, 3> buffers = {inputBuffer, outputBuffer, blockSumBuffer};
+
+    std::array<vk::DescriptorSetLayoutBinding, 3> layoutBindings;
+    for (uint32_t binding = 0; binding < layoutBindings.size(); binding++)
+    {
+        layoutBindings[binding] = vk::DescriptorSetLayoutBinding()
+                                      .setBinding(binding)
+                                      .setDescriptorCount(1)
+                                      .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                      .setPImmutableSamplers(nullptr)
+                                      .setStageFlags(vk::ShaderStageFlagBits::eCompute);
+    }
+
+    vk::DescriptorSetLayoutCreateInfo layoutCreateInfo = vk::DescriptorSetLayoutCreateInfo()
+                                                             .setBindingCount(static_cast<uint32_t>(layoutBindings.size()))
+                                                             .setPBindings(layoutBindings.data());
+
+    vk::Result result = logicalDevice.createDescriptorSetLayout(&layoutCreateInfo, nullptr, &descriptorSetLayout);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create prefix sum descriptor set layout! Error Code: " + vk::to_string(result));
+    }
+
+    vk::DescriptorPoolSize poolSize = vk::DescriptorPoolSize()
+                                          .setType(vk::DescriptorType::eStorageBuffer)
+                                          .setDescriptorCount(static_cast<uint32_t>(buffers.size()));
+
+    vk::DescriptorPoolCreateInfo poolCreateInfo = vk::DescriptorPoolCreateInfo()
+                                                      .setPoolSizeCount(1)
+                                                      .setPPoolSizes(&poolSize)
+                                                      .setMaxSets(1);
+
+    result = logicalDevice.createDescriptorPool(&poolCreateInfo, nullptr, &descriptorPool);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create prefix sum descriptor pool! Error Code: " + vk::to_string(result));
+    }
+
+    vk::DescriptorSetAllocateInfo allocateInfo = vk::DescriptorSetAllocateInfo()
+                                                     .setDescriptorPool(descriptorPool)
+                                                     .setDescriptorSetCount(1)
+                                                     .setPSetLayouts(&descriptorSetLayout);
+
+    result = logicalDevice.allocateDescriptorSets(&allocateInfo, &descriptorSet);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to allocate prefix sum descriptor set! Error Code: " + vk::to_string(result));
+    }
+
+    std::array<vk::DescriptorBufferInfo, 3> bufferInfos;
+    std::array<vk::WriteDescriptorSet, 3> descriptorWrites;
+    for (uint32_t binding = 0; binding < buffers.size(); binding++)
+    {
+        bufferInfos[binding] = vk::DescriptorBufferInfo()
+                                   .setBuffer(buffers[binding])
+                                   .setOffset(0)
+                                   .setRange(vk::WholeSize);
+
+        descriptorWrites[binding] = vk::WriteDescriptorSet()
+                                        .setDstSet(descriptorSet)
+                                        .setDstBinding(binding)
+                                        .setDstArrayElement(0)
+                                        .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                        .setDescriptorCount(1)
+                                        .setPBufferInfo(&bufferInfos[binding]);
+    }
+
+    logicalDevice.updateDescriptorSets(static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+void PrefixSum::createPipelines(vk::Device logicalDevice, vk::PipelineCache pipelineCache)
+{
+    vk::PushConstantRange pushConstantRange = vk::PushConstantRange()
+                                                  .setStageFlags(vk::ShaderStageFlagBits::eCompute)
+                                                  .setOffset(0)
+                                                  .setSize(sizeof(PushConstants));
+
+    vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo = vk::PipelineLayoutCreateInfo()
+                                                                .setSetLayoutCount(1)
+                                                                .setPSetLayouts(&descriptorSetLayout)
+                                                                .setPushConstantRangeCount(1)
+                                                                .setPPushConstantRanges(&pushConstantRange);
+
+    vk::Result result = logicalDevice.createPipelineLayout(&pipelineLayoutCreateInfo, nullptr, &pipelineLayout);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create prefix sum pipeline layout! Error Code: " + vk::to_string(result));
+    }
+
+    reducePipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/prefix_sum_reduce.comp.spv", pipelineLayout);
+    blockScanPipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/prefix_sum_block_scan.comp.spv", pipelineLayout);
+    addPipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/prefix_sum_add.comp.spv", pipelineLayout);
+}
+
+void PrefixSum::recordComputeBarrier(vk::CommandBuffer commandBuffer)
+{
+    vk::MemoryBarrier memoryBarrier = vk::MemoryBarrier()
+                                          .setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+                                          .setDstAccessMask(vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+                                  vk::DependencyFlags(),
+                                  1, &memoryBarrier,
+                                  0, nullptr,
+                                  0, nullptr);
+}
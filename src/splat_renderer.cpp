@@ -0,0 +1,405 @@
+#include "splat_renderer.hpp"
+
+void SplatRenderer::Create(vk::Device logicalDevice, vk::PipelineCache pipelineCache, vk::RenderPass renderPass, vk::SampleCountFlagBits sampleCount)
+{
+    createDescriptorSetLayouts(logicalDevice);
+    createSplatPipeline(logicalDevice, pipelineCache);
+    createCompositePipeline(logicalDevice, pipelineCache, renderPass, sampleCount);
+}
+
+void SplatRenderer::Destroy(vk::Device logicalDevice)
+{
+    logicalDevice.destroyPipeline(splatPipeline);
+    logicalDevice.destroyPipeline(compositePipeline);
+
+    logicalDevice.destroyPipelineLayout(splatPipelineLayout);
+    logicalDevice.destroyPipelineLayout(compositePipelineLayout);
+
+    logicalDevice.destroyDescriptorSetLayout(candidateDescriptorSetLayout);
+    logicalDevice.destroyDescriptorSetLayout(targetDescriptorSetLayout);
+}
+
+void SplatRenderer::CreateInstanceResources(vk::Device logicalDevice, const OcclusionCuller &occlusionCuller, uint32_t frameCount, const Model &model)
+{
+    boundingRadius = model.GetBoundingRadius();
+
+    candidateHeaderBuffers.resize(frameCount);
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        candidateHeaderBuffers[i] = occlusionCuller.GetCandidateHeaderBuffer(i);
+    }
+
+    createCandidateDescriptorSets(logicalDevice, occlusionCuller, frameCount);
+}
+
+void SplatRenderer::DestroyInstanceResources(vk::Device logicalDevice)
+{
+    logicalDevice.destroyDescriptorPool(candidateDescriptorPool);
+}
+
+void SplatRenderer::CreateTarget(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, vk::Extent2D extent)
+{
+    targetExtent = extent;
+
+    Utilities::createBuffer(memoryAllocator, logicalDevice, sizeof(uint64_t) * extent.width * extent.height,
+                            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                            vk::MemoryPropertyFlagBits::eDeviceLocal, targetBuffer, targetBufferMemory);
+
+    createTargetDescriptorSet(logicalDevice);
+}
+
+void SplatRenderer::DestroyTarget(MemoryAllocator &memoryAllocator, vk::Device logicalDevice)
+{
+    logicalDevice.destroyDescriptorPool(targetDescriptorPool);
+
+    logicalDevice.destroyBuffer(targetBuffer);
+    memoryAllocator.Free(logicalDevice, targetBufferMemory);
+}
+
+void SplatRenderer::RecordSplat(vk::CommandBuffer commandBuffer, uint32_t frame, const glm::mat4 &view, const glm::mat4 &projection)
+{
+    // The previous frame's composite must be done reading the target before it is cleared
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer,
+                                  vk::DependencyFlags(),
+                                  0, nullptr,
+                                  0, nullptr,
+                                  0, nullptr);
+
+    // Both halves of an empty pixel are all ones
+    commandBuffer.fillBuffer(targetBuffer, 0, vk::WholeSize, static_cast<uint32_t>(EMPTY_PIXEL));
+
+    vk::MemoryBarrier clearBarrier = vk::MemoryBarrier()
+                                         .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+                                         .setDstAccessMask(vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader,
+                                  vk::DependencyFlags(),
+                                  1, &clearBarrier,
+                                  0, nullptr,
+                                  0, nullptr);
+
+    // glm's zero-to-one perspective gives a device depth of -P[2][2] - P[3][2] / w for a view depth of w
+    SplatPushConstants pushConstants{};
+    pushConstants.viewProjection = projection * view;
+    pushConstants.targetSize = glm::vec2(targetExtent.width, targetExtent.height);
+    pushConstants.pixelScale = std::abs(projection[1][1]) * 0.5f * static_cast<float>(targetExtent.height);
+    pushConstants.depthOffset = -projection[2][2];
+    pushConstants.depthScale = -projection[3][2];
+    pushConstants.boundingRadius = boundingRadius;
+
+    std::array<vk::DescriptorSet, 2> descriptorSets = {candidateDescriptorSets[frame], targetDescriptorSet};
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, splatPipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, splatPipelineLayout, 0,
+                                     static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, nullptr);
+    commandBuffer.pushConstants(splatPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(SplatPushConstants), &pushConstants);
+    // The candidate header's first three words are sized for OcclusionCuller::WORKGROUP_SIZE, which splat.comp.glsl shares
+    commandBuffer.dispatchIndirect(candidateHeaderBuffers[frame], 0);
+
+    vk::MemoryBarrier splatBarrier = vk::MemoryBarrier()
+                                         .setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+                                         .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eFragmentShader,
+                                  vk::DependencyFlags(),
+                                  1, &splatBarrier,
+                                  0, nullptr,
+                                  0, nullptr);
+}
+
+void SplatRenderer::RecordComposite(vk::CommandBuffer commandBuffer)
+{
+    vk::Viewport viewport = vk::Viewport()
+                                .setX(0.0f)
+                                .setY(0.0f)
+                                .setWidth(static_cast<float>(targetExtent.width))
+                                .setHeight(static_cast<float>(targetExtent.height))
+                                .setMinDepth(0.0f)
+                                .setMaxDepth(1.0f);
+    commandBuffer.setViewport(0, 1, &viewport);
+
+    vk::Rect2D scissor = vk::Rect2D()
+                             .setOffset({0, 0})
+                             .setExtent(targetExtent);
+    commandBuffer.setScissor(0, 1, &scissor);
+
+    CompositePushConstants pushConstants{targetExtent.width};
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, compositePipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, compositePipelineLayout, 0, 1, &targetDescriptorSet, 0, nullptr);
+    commandBuffer.pushConstants(compositePipelineLayout, vk::ShaderStageFlagBits::eFragment, 0, sizeof(CompositePushConstants), &pushConstants);
+    commandBuffer.draw(3, 1, 0, 0);
+}
+
+void SplatRenderer::createDescriptorSetLayouts(vk::Device logicalDevice)
+{
+    // Bindings match splat.comp.glsl: the frame's candidate transforms and candidate header
+    std::array<vk::DescriptorSetLayoutBinding, 2> candidateBindings;
+    for (uint32_t binding = 0; binding < candidateBindings.size(); binding++)
+    {
+        candidateBindings[binding] = vk::DescriptorSetLayoutBinding()
+                                         .setBinding(binding)
+                                         .setDescriptorCount(1)
+                                         .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                         .setPImmutableSamplers(nullptr)
+                                         .setStageFlags(vk::ShaderStageFlagBits::eCompute);
+    }
+
+    vk::DescriptorSetLayoutCreateInfo layoutCreateInfo = vk::DescriptorSetLayoutCreateInfo()
+                                                             .setBindingCount(static_cast<uint32_t>(candidateBindings.size()))
+                                                             .setPBindings(candidateBindings.data());
+
+    vk::Result result = logicalDevice.createDescriptorSetLayout(&layoutCreateInfo, nullptr, &candidateDescriptorSetLayout);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create splat candidate descriptor set layout! Error Code: " + vk::to_string(result));
+    }
+
+    // The packed target, written by the splat pass and read by the composite. Kept apart since it follows the swap chain's lifetime.
+    vk::DescriptorSetLayoutBinding targetBinding = vk::DescriptorSetLayoutBinding()
+                                                       .setBinding(0)
+                                                       .setDescriptorCount(1)
+                                                       .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                                       .setPImmutableSamplers(nullptr)
+                                                       .setStageFlags(vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eFragment);
+
+    layoutCreateInfo.setBindingCount(1).setPBindings(&targetBinding);
+
+    result = logicalDevice.createDescriptorSetLayout(&layoutCreateInfo, nullptr, &targetDescriptorSetLayout);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create splat target descriptor set layout! Error Code: " + vk::to_string(result));
+    }
+}
+
+void SplatRenderer::createSplatPipeline(vk::Device logicalDevice, vk::PipelineCache pipelineCache)
+{
+    vk::PushConstantRange pushConstantRange = vk::PushConstantRange()
+                                                  .setStageFlags(vk::ShaderStageFlagBits::eCompute)
+                                                  .setOffset(0)
+                                                  .setSize(sizeof(SplatPushConstants));
+
+    std::array<vk::DescriptorSetLayout, 2> setLayouts = {candidateDescriptorSetLayout, targetDescriptorSetLayout};
+
+    vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo = vk::PipelineLayoutCreateInfo()
+                                                                .setSetLayoutCount(static_cast<uint32_t>(setLayouts.size()))
+                                                                .setPSetLayouts(setLayouts.data())
+                                                                .setPushConstantRangeCount(1)
+                                                                .setPPushConstantRanges(&pushConstantRange);
+
+    vk::Result result = logicalDevice.createPipelineLayout(&pipelineLayoutCreateInfo, nullptr, &splatPipelineLayout);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create splat pipeline layout! Error Code: " + vk::to_string(result));
+    }
+
+    splatPipeline = Utilities::createComputePipeline(logicalDevice, pipelineCache, "resources/shaders/splat.comp.spv", splatPipelineLayout);
+}
+
+void SplatRenderer::createCompositePipeline(vk::Device logicalDevice, vk::PipelineCache pipelineCache, vk::RenderPass renderPass, vk::SampleCountFlagBits sampleCount)
+{
+    vk::PushConstantRange pushConstantRange = vk::PushConstantRange()
+                                                  .setStageFlags(vk::ShaderStageFlagBits::eFragment)
+                                                  .setOffset(0)
+                                                  .setSize(sizeof(CompositePushConstants));
+
+    vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo = vk::PipelineLayoutCreateInfo()
+                                                                .setSetLayoutCount(1)
+                                                                .setPSetLayouts(&targetDescriptorSetLayout)
+                                                                .setPushConstantRangeCount(1)
+                                                                .setPPushConstantRanges(&pushConstantRange);
+
+    vk::Result result = logicalDevice.createPipelineLayout(&pipelineLayoutCreateInfo, nullptr, &compositePipelineLayout);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create splat composite pipeline layout! Error Code: " + vk::to_string(result));
+    }
+
+    vk::ShaderModule vertexShaderModule = Utilities::createShaderModule(logicalDevice, Utilities::readFile("resources/shaders/splat_composite.vert.spv"));
+    vk::ShaderModule fragmentShaderModule = Utilities::createShaderModule(logicalDevice, Utilities::readFile("resources/shaders/splat_composite.frag.spv"));
+
+    std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages = {
+        vk::PipelineShaderStageCreateInfo()
+            .setStage(vk::ShaderStageFlagBits::eVertex)
+            .setModule(vertexShaderModule)
+            .setPName("main"),
+        vk::PipelineShaderStageCreateInfo()
+            .setStage(vk::ShaderStageFlagBits::eFragment)
+            .setModule(fragmentShaderModule)
+            .setPName("main")};
+
+    // The fullscreen triangle's corners come from gl_VertexIndex
+    vk::PipelineVertexInputStateCreateInfo vertexInputCreateInfo = vk::PipelineVertexInputStateCreateInfo();
+
+    vk::PipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo = vk::PipelineInputAssemblyStateCreateInfo()
+                                                                           .setTopology(vk::PrimitiveTopology::eTriangleList)
+                                                                           .setPrimitiveRestartEnable(vk::False);
+
+    vk::PipelineViewportStateCreateInfo viewportStateCreateInfo = vk::PipelineViewportStateCreateInfo()
+                                                                      .setViewportCount(1)
+                                                                      .setScissorCount(1);
+
+    vk::PipelineRasterizationStateCreateInfo rasterizerCreateInfo = vk::PipelineRasterizationStateCreateInfo()
+                                                                        .setDepthClampEnable(vk::False)
+                                                                        .setRasterizerDiscardEnable(vk::False)
+                                                                        .setPolygonMode(vk::PolygonMode::eFill)
+                                                                        .setLineWidth(1.0f)
+                                                                        .setCullMode(vk::CullModeFlagBits::eNone)
+                                                                        .setFrontFace(vk::FrontFace::eCounterClockwise)
+                                                                        .setDepthBiasEnable(vk::False);
+
+    // One invocation per pixel, its splat covers every sample
+    vk::PipelineMultisampleStateCreateInfo multisamplingCreateInfo = vk::PipelineMultisampleStateCreateInfo()
+                                                                         .setSampleShadingEnable(vk::False)
+                                                                         .setRasterizationSamples(sampleCount)
+                                                                         .setPSampleMask(nullptr)
+                                                                         .setAlphaToCoverageEnable(vk::False)
+                                                                         .setAlphaToOneEnable(vk::False);
+
+    // The splat pass already resolved visibility, the depth is written so the attachment matches what was drawn
+    vk::PipelineDepthStencilStateCreateInfo depthStencilStateCreateInfo = vk::PipelineDepthStencilStateCreateInfo()
+                                                                              .setDepthTestEnable(vk::True)
+                                                                              .setDepthWriteEnable(vk::True)
+                                                                              .setDepthCompareOp(vk::CompareOp::eAlways)
+                                                                              .setDepthBoundsTestEnable(vk::False)
+                                                                              .setStencilTestEnable(vk::False);
+
+    vk::PipelineColorBlendAttachmentState colorBlendAttachmentState = vk::PipelineColorBlendAttachmentState()
+                                                                          .setColorWriteMask(
+                                                                              vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB |
+                                                                              vk::ColorComponentFlagBits::eA)
+                                                                          .setBlendEnable(vk::False);
+
+    vk::PipelineColorBlendStateCreateInfo colorBlendingCreateInfo = vk::PipelineColorBlendStateCreateInfo()
+                                                                        .setLogicOpEnable(vk::False)
+                                                                        .setAttachmentCount(1)
+                                                                        .setPAttachments(&colorBlendAttachmentState);
+
+    std::array<vk::DynamicState, 2> dynamicStates = {
+        vk::DynamicState::eViewport,
+        vk::DynamicState::eScissor};
+
+    vk::PipelineDynamicStateCreateInfo dynamicStateCreateInfo = vk::PipelineDynamicStateCreateInfo()
+                                                                    .setDynamicStateCount(static_cast<uint32_t>(dynamicStates.size()))
+                                                                    .setPDynamicStates(dynamicStates.data());
+
+    vk::GraphicsPipelineCreateInfo pipelineCreateInfo = vk::GraphicsPipelineCreateInfo()
+                                                            .setStageCount(static_cast<uint32_t>(shaderStages.size()))
+                                                            .setPStages(shaderStages.data())
+                                                            .setPVertexInputState(&vertexInputCreateInfo)
+                                                            .setPInputAssemblyState(&inputAssemblyCreateInfo)
+                                                            .setPViewportState(&viewportStateCreateInfo)
+                                                            .setPRasterizationState(&rasterizerCreateInfo)
+                                                            .setPMultisampleState(&multisamplingCreateInfo)
+                                                            .setPDepthStencilState(&depthStencilStateCreateInfo)
+                                                            .setPColorBlendState(&colorBlendingCreateInfo)
+                                                            .setPDynamicState(&dynamicStateCreateInfo)
+                                                            .setLayout(compositePipelineLayout)
+                                                            .setRenderPass(renderPass)
+                                                            .setSubpass(0);
+
+    result = logicalDevice.createGraphicsPipelines(pipelineCache, 1, &pipelineCreateInfo, nullptr, &compositePipeline);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create splat composite pipeline! Error Code: " + vk::to_string(result));
+    }
+
+    logicalDevice.destroyShaderModule(fragmentShaderModule);
+    logicalDevice.destroyShaderModule(vertexShaderModule);
+}
+
+void SplatRenderer::createCandidateDescriptorSets(vk::Device logicalDevice, const OcclusionCuller &occlusionCuller, uint32_t frameCount)
+{
+    vk::DescriptorPoolSize poolSize = vk::DescriptorPoolSize()
+                                          .setType(vk::DescriptorType::eStorageBuffer)
+                                          .setDescriptorCount(frameCount * 2);
+
+    vk::DescriptorPoolCreateInfo poolCreateInfo = vk::DescriptorPoolCreateInfo()
+                                                      .setPoolSizeCount(1)
+                                                      .setPPoolSizes(&poolSize)
+                                                      .setMaxSets(frameCount);
+
+    vk::Result result = logicalDevice.createDescriptorPool(&poolCreateInfo, nullptr, &candidateDescriptorPool);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create splat candidate descriptor pool! Error Code: " + vk::to_string(result));
+    }
+
+    std::vector<vk::DescriptorSetLayout> layouts(frameCount, candidateDescriptorSetLayout);
+    vk::DescriptorSetAllocateInfo allocateInfo = vk::DescriptorSetAllocateInfo()
+                                                     .setDescriptorPool(candidateDescriptorPool)
+                                                     .setDescriptorSetCount(frameCount)
+                                                     .setPSetLayouts(layouts.data());
+
+    candidateDescriptorSets.resize(frameCount);
+    result = logicalDevice.allocateDescriptorSets(&allocateInfo, candidateDescriptorSets.data());
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to allocate splat candidate descriptor sets! Error Code: " + vk::to_string(result));
+    }
+
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        std::array<vk::DescriptorBufferInfo, 2> bufferInfos = {
+            vk::DescriptorBufferInfo().setBuffer(occlusionCuller.GetCandidateBuffer(i)).setOffset(0).setRange(vk::WholeSize),
+            vk::DescriptorBufferInfo().setBuffer(occlusionCuller.GetCandidateHeaderBuffer(i)).setOffset(0).setRange(vk::WholeSize)};
+
+        std::array<vk::WriteDescriptorSet, 2> descriptorWrites;
+        for (uint32_t binding = 0; binding < descriptorWrites.size(); binding++)
+        {
+            descriptorWrites[binding] = vk::WriteDescriptorSet()
+                                            .setDstSet(candidateDescriptorSets[i])
+                                            .setDstBinding(binding)
+                                            .setDstArrayElement(0)
+                                            .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                            .setDescriptorCount(1)
+                                            .setPBufferInfo(&bufferInfos[binding]);
+        }
+
+        logicalDevice.updateDescriptorSets(static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+}
+
+void SplatRenderer::createTargetDescriptorSet(vk::Device logicalDevice)
+{
+    vk::DescriptorPoolSize poolSize = vk::DescriptorPoolSize()
+                                          .setType(vk::DescriptorType::eStorageBuffer)
+                                          .setDescriptorCount(1);
+
+    vk::DescriptorPoolCreateInfo poolCreateInfo = vk::DescriptorPoolCreateInfo()
+                                                      .setPoolSizeCount(1)
+                                                      .setPPoolSizes(&poolSize)
+                                                      .setMaxSets(1);
+
+    vk::Result result = logicalDevice.createDescriptorPool(&poolCreateInfo, nullptr, &targetDescriptorPool);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create splat target descriptor pool! Error Code: " + vk::to_string(result));
+    }
+
+    vk::DescriptorSetAllocateInfo allocateInfo = vk::DescriptorSetAllocateInfo()
+                                                     .setDescriptorPool(targetDescriptorPool)
+                                                     .setDescriptorSetCount(1)
+                                                     .setPSetLayouts(&targetDescriptorSetLayout);
+
+    result = logicalDevice.allocateDescriptorSets(&allocateInfo, &targetDescriptorSet);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to allocate splat target descriptor set! Error Code: " + vk::to_string(result));
+    }
+
+    vk::DescriptorBufferInfo bufferInfo = vk::DescriptorBufferInfo()
+                                              .setBuffer(targetBuffer)
+                                              .setOffset(0)
+                                              .setRange(vk::WholeSize);
+
+    vk::WriteDescriptorSet descriptorWrite = vk::WriteDescriptorSet()
+                                                 .setDstSet(targetDescriptorSet)
+                                                 .setDstBinding(0)
+                                                 .setDstArrayElement(0)
+                                                 .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                                 .setDescriptorCount(1)
+                                                 .setPBufferInfo(&bufferInfo);
+
+    logicalDevice.updateDescriptorSets(1, &descriptorWrite, 0, nullptr);
+}
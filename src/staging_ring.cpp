@@ -0,0 +1,311 @@
+#include "staging_ring.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "utilities.hpp"
+
+void StagingRing::Create(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, vk::Queue queue, uint32_t queueFamily, vk::DeviceSize size)
+{
+    this->queue = queue;
+
+    vk::CommandPoolCreateInfo commandPoolCreateInfo = vk::CommandPoolCreateInfo()
+                                                          .setFlags(vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer)
+                                                          .setQueueFamilyIndex(queueFamily);
+
+    vk::Result result = logicalDevice.createCommandPool(&commandPoolCreateInfo, nullptr, &commandPool);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create staging command pool! Error Code: " + vk::to_string(result));
+    }
+
+    vk::SemaphoreTypeCreateInfo timelineTypeCreateInfo = vk::SemaphoreTypeCreateInfo()
+                                                             .setSemaphoreType(vk::SemaphoreType::eTimeline)
+                                                             .setInitialValue(0);
+
+    vk::SemaphoreCreateInfo timelineCreateInfo = vk::SemaphoreCreateInfo()
+                                                     .setPNext(&timelineTypeCreateInfo);
+
+    result = logicalDevice.createSemaphore(&timelineCreateInfo, nullptr, &timeline);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create staging timeline semaphore! Error Code: " + vk::to_string(result));
+    }
+
+    bufferSize = size;
+    Utilities::createBuffer(memoryAllocator, logicalDevice, bufferSize, vk::BufferUsageFlagBits::eTransferSrc,
+                            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, buffer, bufferMemory);
+}
+
+void StagingRing::Destroy(MemoryAllocator &memoryAllocator, vk::Device logicalDevice)
+{
+    Wait(memoryAllocator, logicalDevice, Flush());
+
+    logicalDevice.destroyBuffer(buffer);
+    memoryAllocator.Free(logicalDevice, bufferMemory);
+
+    logicalDevice.destroySemaphore(timeline);
+    // Frees every batch command buffer along with it
+    logicalDevice.destroyCommandPool(commandPool);
+
+    submittedCommandBuffers.clear();
+    freeCommandBuffers.clear();
+}
+
+StagingRing::Region StagingRing::Stage(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, vk::DeviceSize size, vk::DeviceSize alignment)
+{
+    reclaim(memoryAllocator, logicalDevice);
+
+    if (size > bufferSize)
+    {
+        // Released along with the ring space of the batch it is copied in
+        OversizedBuffer oversizedBuffer{timelineValue + 1};
+        Utilities::createBuffer(memoryAllocator, logicalDevice, size, vk::BufferUsageFlagBits::eTransferSrc,
+                                vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, oversizedBuffer.buffer,
+                                oversizedBuffer.memory, MemoryAllocator::Strategy::eLinear);
+        oversizedBuffers.push_back(oversizedBuffer);
+
+        // Opened so the next Flush() submits the batch the buffer is released with
+        GetCommandBuffer(logicalDevice);
+
+        return Region{oversizedBuffer.buffer, 0, static_cast<char *>(oversizedBuffer.memory.mapped)};
+    }
+
+    // Each pass either submits the current batch or retires the oldest one, until the ring is empty
+    vk::DeviceSize offset;
+    while (!tryStage(size, alignment, offset))
+    {
+        if (isBatchStaged)
+        {
+            Flush();
+        }
+        else
+        {
+            Wait(memoryAllocator, logicalDevice, retirements.front().value);
+        }
+    }
+
+    isBatchStaged = true;
+    GetCommandBuffer(logicalDevice);
+
+    return Region{buffer, offset, static_cast<char *>(bufferMemory.mapped) + offset};
+}
+
+vk::CommandBuffer StagingRing::GetCommandBuffer(vk::Device logicalDevice)
+{
+    if (batchCommandBuffer)
+    {
+        return batchCommandBuffer;
+    }
+
+    if (!freeCommandBuffers.empty())
+    {
+        batchCommandBuffer = freeCommandBuffers.back();
+        freeCommandBuffers.pop_back();
+    }
+    else
+    {
+        vk::CommandBufferAllocateInfo allocateInfo = vk::CommandBufferAllocateInfo()
+                                                         .setLevel(vk::CommandBufferLevel::ePrimary)
+                                                         .setCommandPool(commandPool)
+                                                         .setCommandBufferCount(1);
+
+        vk::Result result = logicalDevice.allocateCommandBuffers(&allocateInfo, &batchCommandBuffer);
+        if (result != vk::Result::eSuccess)
+        {
+            throw std::runtime_error("Failed to allocate staging command buffer! Error Code: " + vk::to_string(result));
+        }
+    }
+
+    vk::CommandBufferBeginInfo commandBufferBeginInfo = vk::CommandBufferBeginInfo()
+                                                            .setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+
+    // Implicitly resets a command buffer from an earlier batch
+    vk::Result result = batchCommandBuffer.begin(&commandBufferBeginInfo);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to begin staging command buffer! Error Code: " + vk::to_string(result));
+    }
+
+    return batchCommandBuffer;
+}
+
+void StagingRing::CopyToBuffer(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, const void *data, vk::DeviceSize size, vk::Buffer dstBuffer, vk::DeviceSize dstOffset)
+{
+    vk::DeviceSize chunkSize = std::max<vk::DeviceSize>(bufferSize / 4, 1);
+
+    for (vk::DeviceSize copied = 0; copied < size; copied += chunkSize)
+    {
+        vk::DeviceSize copySize = std::min(chunkSize, size - copied);
+
+        Region region = Stage(memoryAllocator, logicalDevice, copySize);
+        memcpy(region.mapped, static_cast<const char *>(data) + copied, static_cast<size_t>(copySize));
+
+        vk::BufferCopy copyRegion = vk::BufferCopy()
+                                        .setSrcOffset(region.offset)
+                                        .setDstOffset(dstOffset + copied)
+                                        .setSize(copySize);
+        GetCommandBuffer(logicalDevice).copyBuffer(region.buffer, dstBuffer, 1, &copyRegion);
+    }
+}
+
+uint64_t StagingRing::Flush()
+{
+    if (!batchCommandBuffer)
+    {
+        return timelineValue;
+    }
+
+    // Later submissions on this queue are ordered after the batch's copies and layout transitions by this barrier alone
+    vk::MemoryBarrier memoryBarrier = vk::MemoryBarrier()
+                                          .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+                                          .setDstAccessMask(vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite);
+
+    batchCommandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands,
+                                       vk::DependencyFlags(),
+                                       1, &memoryBarrier,
+                                       0, nullptr,
+                                       0, nullptr);
+
+    batchCommandBuffer.end();
+
+    timelineValue++;
+
+    vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo = vk::TimelineSemaphoreSubmitInfo()
+                                                             .setSignalSemaphoreValueCount(1)
+                                                             .setPSignalSemaphoreValues(&timelineValue);
+
+    vk::SubmitInfo submitInfo = vk::SubmitInfo()
+                                    .setPNext(&timelineSubmitInfo)
+                                    .setCommandBufferCount(1)
+                                    .setPCommandBuffers(&batchCommandBuffer)
+                                    .setSignalSemaphoreCount(1)
+                                    .setPSignalSemaphores(&timeline);
+
+    vk::Result result = queue.submit(1, &submitInfo, nullptr);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to submit staging command buffer! Error Code: " + vk::to_string(result));
+    }
+
+    if (isBatchStaged)
+    {
+        retirements.push_back(Retirement{timelineValue, head});
+    }
+    submittedCommandBuffers.push_back(BatchCommandBuffer{timelineValue, batchCommandBuffer});
+
+    batchCommandBuffer = nullptr;
+    isBatchStaged = false;
+    submittedBatchCount++;
+
+    return timelineValue;
+}
+
+void StagingRing::Wait(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, uint64_t value)
+{
+    if (value > timelineValue)
+    {
+        Flush();
+    }
+
+    vk::SemaphoreWaitInfo waitInfo = vk::SemaphoreWaitInfo()
+                                         .setSemaphoreCount(1)
+                                         .setPSemaphores(&timeline)
+                                         .setPValues(&value);
+
+    vk::Result result = logicalDevice.waitSemaphores(&waitInfo, UINT64_MAX);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to wait for staging timeline value! Error Code: " + vk::to_string(result));
+    }
+
+    reclaim(memoryAllocator, logicalDevice);
+}
+
+bool StagingRing::IsComplete(vk::Device logicalDevice, uint64_t value) const
+{
+    return value <= timelineValue && getCompletedValue(logicalDevice) >= value;
+}
+
+uint32_t StagingRing::GetSubmittedBatchCount() const
+{
+    return submittedBatchCount;
+}
+
+// The free space is [head, bufferSize) plus [0, tail) while head is ahead of tail, and [head, tail) once head has wrapped
+// around behind it. head == tail means a full ring unless nothing is in flight or staged.
+bool StagingRing::tryStage(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize &offset)
+{
+    if (retirements.empty() && !isBatchStaged)
+    {
+        head = 0;
+        tail = 0;
+    }
+
+    vk::DeviceSize start = (head + alignment - 1) / alignment * alignment;
+
+    if (head > tail || (head == tail && retirements.empty() && !isBatchStaged))
+    {
+        if (start + size <= bufferSize)
+        {
+            offset = start;
+            head = start + size;
+            return true;
+        }
+        // The end of the ring is skipped, it is reclaimed along with the batch before it
+        if (size <= tail)
+        {
+            offset = 0;
+            head = size;
+            return true;
+        }
+        return false;
+    }
+
+    if (head < tail && start + size <= tail)
+    {
+        offset = start;
+        head = start + size;
+        return true;
+    }
+
+    return false;
+}
+
+void StagingRing::reclaim(MemoryAllocator &memoryAllocator, vk::Device logicalDevice)
+{
+    uint64_t completedValue = getCompletedValue(logicalDevice);
+
+    while (!retirements.empty() && retirements.front().value <= completedValue)
+    {
+        tail = retirements.front().end;
+        retirements.pop_front();
+    }
+
+    while (!submittedCommandBuffers.empty() && submittedCommandBuffers.front().value <= completedValue)
+    {
+        freeCommandBuffers.push_back(submittedCommandBuffers.front().commandBuffer);
+        submittedCommandBuffers.pop_front();
+    }
+
+    auto completed = std::partition(oversizedBuffers.begin(), oversizedBuffers.end(), [completedValue](const OversizedBuffer &oversizedBuffer)
+                                    { return oversizedBuffer.value > completedValue; });
+    for (auto it = completed; it != oversizedBuffers.end(); it++)
+    {
+        logicalDevice.destroyBuffer(it->buffer);
+        memoryAllocator.Free(logicalDevice, it->memory);
+    }
+    oversizedBuffers.erase(completed, oversizedBuffers.end());
+}
+
+uint64_t StagingRing::getCompletedValue(vk::Device logicalDevice) const
+{
+    uint64_t value = 0;
+    vk::Result result = logicalDevice.getSemaphoreCounterValue(timeline, &value);
+    if (result != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to get staging timeline value! Error Code: " + vk::to_string(result));
+    }
+
+    return value;
+}
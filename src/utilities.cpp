@@ -1,101 +1,83 @@
 #include "utilities.hpp"
 
-vk::CommandBuffer Utilities::beginSingleTimeCommands(vk::Device logicalDevice, vk::CommandPool commandPool)
+void Utilities::createBuffer(MemoryAllocator &memoryAllocator, vk::Device logicalDevice, vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Buffer &buffer, MemoryAllocator::Allocation &bufferMemory,
+                             MemoryAllocator::Strategy strategy)
 {
-    vk::CommandBufferAllocateInfo allocateInfo = vk::CommandBufferAllocateInfo()
-                                                     .setLevel(vk::CommandBufferLevel::ePrimary)
-                                                     .setCommandPool(commandPool)
-                                                     .setCommandBufferCount(1);
-
-    vk::CommandBuffer commandBuffer;
-    vk::Result result = logicalDevice.allocateCommandBuffers(&allocateInfo, &commandBuffer);
-    if (result != vk::Result::eSuccess)
-    {
-        throw std::runtime_error("Failed to allocate command buffers! Error Code: " + vk::to_string(result));
-    }
-
-    vk::CommandBufferBeginInfo commandBufferBeginInfo = vk::CommandBufferBeginInfo()
-                                                            .setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+    vk::BufferCreateInfo bufferCreateInfo = vk::BufferCreateInfo()
+                                                .setSize(size)
+                                                .setUsage(usage)
+                                                .setSharingMode(vk::SharingMode::eExclusive);
 
-    result = commandBuffer.begin(&commandBufferBeginInfo);
+    vk::Result result = logicalDevice.createBuffer(&bufferCreateInfo, nullptr, &buffer);
     if (result != vk::Result::eSuccess)
     {
-        throw std::runtime_error("Failed to begin command buffer! Error Code: " + vk::to_string(result));
+        throw std::runtime_error("Failed to create buffer! Error Code: " + vk::to_string(result));
     }
 
-    return commandBuffer;
+    bufferMemory = memoryAllocator.AllocateBuffer(logicalDevice, buffer, properties, strategy);
 }
 
-void Utilities::endSingleTimeCommands(vk::Device logicalDevice, vk::Queue queue, vk::CommandBuffer commandBuffer, vk::CommandPool commandPool)
+std::vector<char> Utilities::readFile(const std::string &fileName)
 {
-    commandBuffer.end();
-
-    vk::SubmitInfo submitInfo = vk::SubmitInfo()
-                                    .setCommandBufferCount(1)
-                                    .setPCommandBuffers(&commandBuffer);
-
-    vk::Result result = queue.submit(1, &submitInfo, VK_NULL_HANDLE);
-    if (result != vk::Result::eSuccess)
+    std::ifstream file(fileName, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
     {
-        throw std::runtime_error("Failed to submit command buffer to graphics queue! Error Code: " + vk::to_string(result));
+        throw std::runtime_error("Failed to open file " + fileName + "!");
     }
-    queue.waitIdle();
 
-    logicalDevice.freeCommandBuffers(commandPool, 1, &commandBuffer);
+    size_t fileSize = (size_t)file.tellg();
+    std::vector<char> buffer(fileSize);
+
+    file.seekg(0);
+    file.read(buffer.data(), fileSize);
+    file.close();
+
+    return buffer;
 }
 
-uint32_t Utilities::findMemoryType(vk::PhysicalDevice physicalDevice, uint32_t typeFilter, vk::MemoryPropertyFlags properties) 
+vk::ShaderModule Utilities::createShaderModule(vk::Device logicalDevice, const std::vector<char> &code)
 {
-    vk::PhysicalDeviceMemoryProperties physicalDeviceMemoryProperties;
-    physicalDevice.getMemoryProperties(&physicalDeviceMemoryProperties);
+    vk::ShaderModuleCreateInfo shaderModuleCreateInfo = vk::ShaderModuleCreateInfo()
+                                                            .setCodeSize(code.size())
+                                                            .setPCode(reinterpret_cast<const uint32_t *>(code.data()));
 
-    for (uint32_t i = 0; i < physicalDeviceMemoryProperties.memoryTypeCount; i++)
+    vk::ShaderModule shaderModule;
+    vk::Result result = logicalDevice.createShaderModule(&shaderModuleCreateInfo, nullptr, &shaderModule);
+    if (result != vk::Result::eSuccess)
     {
-        if ((typeFilter & (1 << i)) &&
-            (physicalDeviceMemoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
-        {
-            return i;
-        }
+        throw std::runtime_error("Failed to create shader module! Error Code: " + vk::to_string(result));
     }
 
-    throw std::runtime_error("Failed to find suitable memory type!");
+    return shaderModule;
 }
 
-void Utilities::createBuffer(vk::PhysicalDevice physicalDevice, vk::Device logicalDevice, vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Buffer &buffer, vk::DeviceMemory &bufferMemory)
+vk::Pipeline Utilities::createComputePipeline(vk::Device logicalDevice, vk::PipelineCache pipelineCache, const std::string &shaderPath, vk::PipelineLayout pipelineLayout,
+                                              const vk::SpecializationInfo *specializationInfo, uint32_t requiredSubgroupSize)
 {
-    vk::BufferCreateInfo bufferCreateInfo = vk::BufferCreateInfo()
-                                                .setSize(size)
-                                                .setUsage(usage)
-                                                .setSharingMode(vk::SharingMode::eExclusive);
+    vk::ShaderModule computeShaderModule = createShaderModule(logicalDevice, readFile(shaderPath));
 
-    vk::Result result = logicalDevice.createBuffer(&bufferCreateInfo, nullptr, &buffer);
-    if (result != vk::Result::eSuccess)
-    {
-        throw std::runtime_error("Failed to create buffer! Error Code: " + vk::to_string(result));
-    }
+    vk::PipelineShaderStageRequiredSubgroupSizeCreateInfo subgroupSizeCreateInfo = vk::PipelineShaderStageRequiredSubgroupSizeCreateInfo()
+                                                                                       .setRequiredSubgroupSize(requiredSubgroupSize);
 
-    vk::MemoryRequirements memoryRequirements;
-    logicalDevice.getBufferMemoryRequirements(buffer, &memoryRequirements);
+    vk::PipelineShaderStageCreateInfo computeShaderStageCreateInfo = vk::PipelineShaderStageCreateInfo()
+                                                                         .setStage(vk::ShaderStageFlagBits::eCompute)
+                                                                         .setModule(computeShaderModule)
+                                                                         .setPName("main")
+                                                                         .setPSpecializationInfo(specializationInfo)
+                                                                         .setPNext(requiredSubgroupSize != 0 ? &subgroupSizeCreateInfo : nullptr);
 
-    vk::MemoryAllocateInfo memoryAllocateInfo = vk::MemoryAllocateInfo()
-                                                    .setAllocationSize(memoryRequirements.size)
-                                                    .setMemoryTypeIndex(findMemoryType(physicalDevice, memoryRequirements.memoryTypeBits, properties));
+    vk::ComputePipelineCreateInfo computePipelineCreateInfo = vk::ComputePipelineCreateInfo()
+                                                                  .setLayout(pipelineLayout)
+                                                                  .setStage(computeShaderStageCreateInfo);
 
-    result = logicalDevice.allocateMemory(&memoryAllocateInfo, nullptr, &bufferMemory);
+    vk::Pipeline pipeline;
+    vk::Result result = logicalDevice.createComputePipelines(pipelineCache, 1, &computePipelineCreateInfo, nullptr, &pipeline);
     if (result != vk::Result::eSuccess)
     {
-        throw std::runtime_error("Failed to allocate buffer memory! Error Code: " + vk::to_string(result));
+        throw std::runtime_error("Failed to create compute pipeline for " + shaderPath + "! Error Code: " + vk::to_string(result));
     }
 
-    logicalDevice.bindBufferMemory(buffer, bufferMemory, 0);
-}
-
-void Utilities::copyBuffer(vk::Device logicalDevice, vk::Queue queue, vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size, vk::CommandPool commandPool)
-{
-    vk::CommandBuffer commandBuffer = beginSingleTimeCommands(logicalDevice, commandPool);
-
-    vk::BufferCopy copyRegion = vk::BufferCopy().setSize(size);
-    commandBuffer.copyBuffer(srcBuffer, dstBuffer, 1, &copyRegion);
+    logicalDevice.destroyShaderModule(computeShaderModule);
 
-    endSingleTimeCommands(logicalDevice, queue, commandBuffer, commandPool);
+    return pipeline;
 }
\ No newline at end of file
@@ -0,0 +1,488 @@
+// Benchmark driver: runs the application headless once per combination of the swept parameters and collects each
+// run's results into a single CSV and/or JSON table.
+//
+// Usage: benchmark_sweep [--app <path>] [--objects 1024,4096,...] [--workgroup-sizes 32,64,...] [--msaa 1,4]
+//                        [--frames-in-flight 1,2,3] [--lp-threads 1,4,...] [--warmup-frames N]
+//                        [--frames N | --seconds S] [--bvh] [--csv <path>] [--json <path>]
+//
+// --lp-threads sets LP_NUM_THREADS, the rasterizer thread count of lavapipe, and is ignored by other drivers.
+// Without --csv or --json the CSV is written to stdout.
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    struct Configuration
+    {
+        uint32_t objectCount;
+        uint32_t workgroupSize;
+        uint32_t msaaSamples;
+        uint32_t framesInFlight;
+        // 0 leaves LP_NUM_THREADS as it is
+        uint32_t lavapipeThreadCount;
+    };
+
+    struct Result
+    {
+        Configuration configuration;
+        bool isValid = false;
+        std::string device;
+        // Whether the run built and tested against the depth pyramid, it can't on every device and sample count
+        bool isOcclusionCulled = false;
+        uint32_t frameCount = 0;
+        double computeMS = 0.0;
+        double graphicsMS = 0.0;
+        double cpuFrameMS = 0.0;
+        double cpuFrameP99MS = 0.0;
+        double bodyStepsPerSecond = 0.0;
+    };
+
+    // Same as the application's: std::stoul() accepts a leading minus sign and wraps, and a cast to uint32_t would silently wrap again
+    uint32_t parseCount(const std::string &text)
+    {
+        unsigned long long value = std::stoull(text);
+        if (text.find('-') != std::string::npos || value > std::numeric_limits<uint32_t>::max())
+        {
+            throw std::out_of_range("Invalid count: " + text);
+        }
+
+        return static_cast<uint32_t>(value);
+    }
+
+    std::vector<uint32_t> parseList(const char *text)
+    {
+        std::vector<uint32_t> values;
+        std::stringstream stream(text);
+        std::string value;
+        while (std::getline(stream, value, ','))
+        {
+            values.push_back(parseCount(value));
+        }
+
+        if (values.empty())
+        {
+            throw std::runtime_error(std::string("Empty parameter list: ") + text);
+        }
+
+        return values;
+    }
+
+    std::string quote(const std::string &argument)
+    {
+        return "\"" + argument + "\"";
+    }
+
+#ifdef _WIN32
+    // Quotes an argument so CommandLineToArgvW() gives it back unchanged: backslashes are only special before a quote
+    std::wstring quoteWindowsArgument(const std::wstring &argument)
+    {
+        std::wstring quoted = L"\"";
+        size_t backslashCount = 0;
+        for (wchar_t character : argument)
+        {
+            if (character == L'\\')
+            {
+                backslashCount++;
+                continue;
+            }
+
+            quoted.append(character == L'"' ? backslashCount * 2 + 1 : backslashCount, L'\\');
+            quoted.push_back(character);
+            backslashCount = 0;
+        }
+        quoted.append(backslashCount * 2, L'\\');
+        quoted.push_back(L'"');
+
+        return quoted;
+    }
+#endif
+
+    // Runs the executable in the working directory without a shell, so none of the arguments is ever interpreted.
+    // Returns its exit code, or -1 when it couldn't be started or didn't exit normally.
+    int runProcess(const std::filesystem::path &executable, const std::vector<std::string> &arguments, const std::filesystem::path &workingDirectory)
+    {
+#ifdef _WIN32
+        std::wstring commandLine = quoteWindowsArgument(executable.wstring());
+        for (const std::string &argument : arguments)
+        {
+            commandLine += L" " + quoteWindowsArgument(std::filesystem::path(argument).wstring());
+        }
+
+        STARTUPINFOW startupInfo{};
+        startupInfo.cb = sizeof(startupInfo);
+        PROCESS_INFORMATION processInfo{};
+
+        if (!CreateProcessW(executable.c_str(), commandLine.data(), nullptr, nullptr, FALSE, 0, nullptr, workingDirectory.c_str(), &startupInfo, &processInfo))
+        {
+            std::cerr << "Failed to start " << executable.string() << ", error " << GetLastError() << '\n';
+            return -1;
+        }
+
+        WaitForSingleObject(processInfo.hProcess, INFINITE);
+        DWORD exitCode = 0;
+        GetExitCodeProcess(processInfo.hProcess, &exitCode);
+        CloseHandle(processInfo.hThread);
+        CloseHandle(processInfo.hProcess);
+
+        return static_cast<int>(exitCode);
+#else
+        std::string executablePath = executable.string();
+        std::vector<char *> argv = {executablePath.data()};
+        for (const std::string &argument : arguments)
+        {
+            argv.push_back(const_cast<char *>(argument.c_str()));
+        }
+        argv.push_back(nullptr);
+
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            std::cerr << "Failed to start " << executablePath << ": " << std::strerror(errno) << '\n';
+            return -1;
+        }
+
+        // Only async-signal-safe calls between fork() and exec()
+        if (pid == 0)
+        {
+            if (chdir(workingDirectory.c_str()) == 0)
+            {
+                execv(argv[0], argv.data());
+            }
+            _exit(127);
+        }
+
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0)
+        {
+            if (errno != EINTR)
+            {
+                return -1;
+            }
+        }
+
+        return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#endif
+    }
+
+    uint32_t getProcessID()
+    {
+#ifdef _WIN32
+        return static_cast<uint32_t>(GetCurrentProcessId());
+#else
+        return static_cast<uint32_t>(getpid());
+#endif
+    }
+
+    // No value unsets the variable
+    void setEnvironmentVariable(const char *name, const std::optional<std::string> &value)
+    {
+#ifdef _WIN32
+        _putenv_s(name, value ? value->c_str() : "");
+#else
+        if (value)
+        {
+            setenv(name, value->c_str(), 1);
+        }
+        else
+        {
+            unsetenv(name);
+        }
+#endif
+    }
+
+    // Position just past "key": in the application's results, searching from the given position.
+    // The results are always written by writeBenchmarkResults() so a full JSON parser isn't needed.
+    size_t findValue(const std::string &json, const char *key, size_t from = 0)
+    {
+        size_t position = json.find(std::string("\"") + key + "\":", from);
+        if (position == std::string::npos)
+        {
+            throw std::runtime_error(std::string("Missing benchmark result: ") + key);
+        }
+
+        return position + std::strlen(key) + 3;
+    }
+
+    double readNumber(const std::string &json, const char *key, size_t from = 0)
+    {
+        return std::stod(json.substr(findValue(json, key, from)));
+    }
+
+    bool readBool(const std::string &json, const char *key)
+    {
+        return json.compare(json.find_first_not_of(' ', findValue(json, key)), 4, "true") == 0;
+    }
+
+    std::string readString(const std::string &json, const char *key)
+    {
+        size_t begin = json.find('"', findValue(json, key)) + 1;
+        return json.substr(begin, json.find('"', begin) - begin);
+    }
+
+    void readResults(const std::filesystem::path &path, Result &result)
+    {
+        std::ifstream file(path);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open benchmark results: " + path.string());
+        }
+
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        std::string json = buffer.str();
+
+        result.device = readString(json, "device");
+        result.isOcclusionCulled = readBool(json, "occlusion_culling");
+        result.frameCount = static_cast<uint32_t>(readNumber(json, "frames"));
+        result.bodyStepsPerSecond = readNumber(json, "body_steps_per_second");
+        result.computeMS = readNumber(json, "mean", findValue(json, "compute_ms"));
+        result.graphicsMS = readNumber(json, "mean", findValue(json, "graphics_ms"));
+        result.cpuFrameMS = readNumber(json, "mean", findValue(json, "cpu_frame_ms"));
+        result.cpuFrameP99MS = readNumber(json, "p99", findValue(json, "cpu_frame_ms"));
+        result.isValid = true;
+    }
+
+    void writeCSV(std::ostream &stream, const std::vector<Result> &results)
+    {
+        stream << "device,objects,workgroup_size,msaa_samples,frames_in_flight,lp_num_threads,occlusion_culling,frames,"
+                  "compute_ms,graphics_ms,cpu_frame_ms,cpu_frame_p99_ms,body_steps_per_second,status\n";
+        stream << std::fixed << std::setprecision(4);
+
+        for (const Result &result : results)
+        {
+            const Configuration &configuration = result.configuration;
+            stream << quote(result.device) << ',' << configuration.objectCount << ',' << configuration.workgroupSize << ','
+                   << configuration.msaaSamples << ',' << configuration.framesInFlight << ',' << configuration.lavapipeThreadCount << ','
+                   << (result.isOcclusionCulled ? "true" : "false") << ',' << result.frameCount << ',' << result.computeMS << ',' << result.graphicsMS << ',' << result.cpuFrameMS << ','
+                   << result.cpuFrameP99MS << ',' << result.bodyStepsPerSecond << ',' << (result.isValid ? "ok" : "failed") << '\n';
+        }
+    }
+
+    void writeJSON(std::ostream &stream, const std::vector<Result> &results)
+    {
+        stream << std::fixed << std::setprecision(4);
+        stream << "[";
+
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const Result &result = results[i];
+            const Configuration &configuration = result.configuration;
+            stream << (i == 0 ? "\n" : ",\n");
+            stream << "  {\"device\": " << quote(result.device) << ", \"objects\": " << configuration.objectCount
+                   << ", \"workgroup_size\": " << configuration.workgroupSize << ", \"msaa_samples\": " << configuration.msaaSamples
+                   << ", \"frames_in_flight\": " << configuration.framesInFlight << ", \"lp_num_threads\": " << configuration.lavapipeThreadCount
+                   << ", \"status\": \"" << (result.isValid ? "ok" : "failed") << "\"";
+
+            if (result.isValid)
+            {
+                stream << ", \"occlusion_culling\": " << (result.isOcclusionCulled ? "true" : "false") << ", \"frames\": " << result.frameCount << ", \"compute_ms\": " << result.computeMS
+                       << ", \"graphics_ms\": " << result.graphicsMS << ", \"cpu_frame_ms\": " << result.cpuFrameMS
+                       << ", \"cpu_frame_p99_ms\": " << result.cpuFrameP99MS << ", \"body_steps_per_second\": " << result.bodyStepsPerSecond;
+            }
+            stream << "}";
+        }
+
+        stream << "\n]" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+#ifdef _WIN32
+        const char *APP_NAME = "Vulkan-Compute-with-Graphics.exe";
+#else
+        const char *APP_NAME = "Vulkan-Compute-with-Graphics";
+#endif
+        std::filesystem::path appPath = std::filesystem::path(argv[0]).parent_path() / APP_NAME;
+
+        std::vector<uint32_t> objectCounts = {1024, 4096, 16384, 65536};
+        std::vector<uint32_t> workgroupSizes = {32, 64, 128, 256};
+        std::vector<uint32_t> msaaSampleCounts = {1, 4};
+        std::vector<uint32_t> framesInFlightCounts = {1, 2, 3};
+        std::vector<uint32_t> lavapipeThreadCounts = {0};
+        std::vector<std::string> warmupArguments = {"--warmup-frames", "60"};
+        std::vector<std::string> windowArguments = {"--frames", "600"};
+        std::vector<std::string> extraArguments;
+        std::string csvPath;
+        std::string jsonPath;
+
+        for (int i = 1; i < argc; i++)
+        {
+            if (std::strcmp(argv[i], "--app") == 0 && i + 1 < argc)
+            {
+                appPath = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--objects") == 0 && i + 1 < argc)
+            {
+                objectCounts = parseList(argv[++i]);
+            }
+            else if (std::strcmp(argv[i], "--workgroup-sizes") == 0 && i + 1 < argc)
+            {
+                workgroupSizes = parseList(argv[++i]);
+            }
+            else if (std::strcmp(argv[i], "--msaa") == 0 && i + 1 < argc)
+            {
+                msaaSampleCounts = parseList(argv[++i]);
+            }
+            else if (std::strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc)
+            {
+                framesInFlightCounts = parseList(argv[++i]);
+            }
+            else if (std::strcmp(argv[i], "--lp-threads") == 0 && i + 1 < argc)
+            {
+                lavapipeThreadCounts = parseList(argv[++i]);
+            }
+            else if (std::strcmp(argv[i], "--warmup-frames") == 0 && i + 1 < argc)
+            {
+                warmupArguments = {"--warmup-frames", std::to_string(parseCount(argv[++i]))};
+            }
+            else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            {
+                windowArguments = {"--frames", std::to_string(parseCount(argv[++i]))};
+            }
+            else if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+            {
+                windowArguments = {"--seconds", std::to_string(std::stof(argv[++i]))};
+            }
+            else if (std::strcmp(argv[i], "--bvh") == 0)
+            {
+                extraArguments.push_back("--bvh");
+            }
+            else if (std::strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+            {
+                csvPath = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            {
+                jsonPath = argv[++i];
+            }
+            else
+            {
+                throw std::runtime_error(std::string("Unknown argument: ") + argv[i]);
+            }
+        }
+
+        // The application is run from its own directory, it loads its shaders and models relative to it.
+        // The results file is named after this process so concurrent sweeps don't read each other's runs.
+        appPath = std::filesystem::absolute(appPath);
+        std::filesystem::path appDirectory = appPath.parent_path();
+        std::filesystem::path resultsPath = std::filesystem::temp_directory_path() / ("benchmark_sweep_" + std::to_string(getProcessID()) + ".json");
+
+        // 0 runs with LP_NUM_THREADS as the sweep was started, even after a run that set it
+        std::optional<std::string> originalLavapipeThreadCount;
+        if (const char *value = std::getenv("LP_NUM_THREADS"))
+        {
+            originalLavapipeThreadCount = value;
+        }
+
+        std::vector<Result> results;
+        for (uint32_t lavapipeThreadCount : lavapipeThreadCounts)
+        {
+            setEnvironmentVariable("LP_NUM_THREADS", lavapipeThreadCount != 0 ? std::optional<std::string>(std::to_string(lavapipeThreadCount)) : originalLavapipeThreadCount);
+
+            for (uint32_t objectCount : objectCounts)
+            {
+                for (uint32_t workgroupSize : workgroupSizes)
+                {
+                    for (uint32_t msaaSamples : msaaSampleCounts)
+                    {
+                        for (uint32_t framesInFlight : framesInFlightCounts)
+                        {
+                            Result result{};
+                            result.configuration = {objectCount, workgroupSize, msaaSamples, framesInFlight, lavapipeThreadCount};
+
+                            std::vector<std::string> arguments = {"--headless"};
+                            arguments.insert(arguments.end(), warmupArguments.begin(), warmupArguments.end());
+                            arguments.insert(arguments.end(), windowArguments.begin(), windowArguments.end());
+                            arguments.insert(arguments.end(), extraArguments.begin(), extraArguments.end());
+                            arguments.insert(arguments.end(), {"--objects", std::to_string(objectCount), "--workgroup-size", std::to_string(workgroupSize),
+                                                               "--msaa", std::to_string(msaaSamples), "--frames-in-flight", std::to_string(framesInFlight),
+                                                               "--results", resultsPath.string()});
+
+                            std::cerr << "Running " << objectCount << " objects, workgroup size " << workgroupSize << ", " << msaaSamples
+                                      << "x MSAA, " << framesInFlight << " frame(s) in flight";
+                            if (lavapipeThreadCount != 0)
+                            {
+                                std::cerr << ", LP_NUM_THREADS=" << lavapipeThreadCount;
+                            }
+                            std::cerr << std::endl;
+
+                            // A configuration the device can't run is recorded as failed rather than ending the sweep
+                            std::filesystem::remove(resultsPath);
+                            if (runProcess(appPath, arguments, appDirectory) == 0)
+                            {
+                                try
+                                {
+                                    readResults(resultsPath, result);
+                                }
+                                catch (const std::exception &e)
+                                {
+                                    std::cerr << e.what() << '\n';
+                                }
+                            }
+
+                            results.push_back(result);
+                        }
+                    }
+                }
+            }
+        }
+        std::filesystem::remove(resultsPath);
+
+        if (!csvPath.empty())
+        {
+            std::ofstream file(csvPath);
+            if (!file.is_open())
+            {
+                throw std::runtime_error("Failed to open " + csvPath + " for writing!");
+            }
+            writeCSV(file, results);
+        }
+
+        if (!jsonPath.empty())
+        {
+            std::ofstream file(jsonPath);
+            if (!file.is_open())
+            {
+                throw std::runtime_error("Failed to open " + jsonPath + " for writing!");
+            }
+            writeJSON(file, results);
+        }
+
+        if (csvPath.empty() && jsonPath.empty())
+        {
+            writeCSV(std::cout, results);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,612 @@
+// Offline texture converter run by the build: decodes an image, builds its mip chain in linear space and writes it
+// block compressed into a KTX2 file, see include/ktx2.hpp.
+//
+// Usage: ktx2_converter <input image> <output.ktx2> <bc1|etc2>
+
+#include <vulkan/vulkan.h>
+
+#include "stb_image/stb_image.h"
+
+#include "ktx2.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Image
+    {
+        uint32_t width;
+        uint32_t height;
+        // RGBA8, sRGB encoded
+        std::vector<uint8_t> pixels;
+    };
+
+    // A 4x4 block of RGB texels, row-major
+    using Block = std::array<std::array<float, 3>, 16>;
+
+    enum class BlockFormat
+    {
+        eBC1,
+        eETC2
+    };
+
+    const uint32_t BLOCK_SIZE = 8;
+
+    float srgbToLinear(float value)
+    {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float linearToSrgb(float value)
+    {
+        return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    }
+
+    // Box filter over 2x2 texels in linear space, odd edges reuse the last texel
+    Image downsample(const Image &image)
+    {
+        Image level{std::max(image.width / 2, 1u), std::max(image.height / 2, 1u), {}};
+        level.pixels.resize(level.width * level.height * 4);
+
+        for (uint32_t y = 0; y < level.height; y++)
+        {
+            for (uint32_t x = 0; x < level.width; x++)
+            {
+                for (uint32_t channel = 0; channel < 4; channel++)
+                {
+                    float sum = 0.0f;
+                    for (uint32_t sample = 0; sample < 4; sample++)
+                    {
+                        uint32_t sourceX = std::min(x * 2 + (sample & 1), image.width - 1);
+                        uint32_t sourceY = std::min(y * 2 + (sample >> 1), image.height - 1);
+                        float value = image.pixels[(sourceY * image.width + sourceX) * 4 + channel] / 255.0f;
+                        sum += channel < 3 ? srgbToLinear(value) : value;
+                    }
+
+                    float average = sum / 4.0f;
+                    float encoded = channel < 3 ? linearToSrgb(average) : average;
+                    level.pixels[(y * level.width + x) * 4 + channel] = static_cast<uint8_t>(std::lround(std::clamp(encoded, 0.0f, 1.0f) * 255.0f));
+                }
+            }
+        }
+
+        return level;
+    }
+
+    // Texels past the image's edge repeat its last row and column
+    Block readBlock(const Image &image, uint32_t blockX, uint32_t blockY)
+    {
+        Block block{};
+        for (uint32_t y = 0; y < 4; y++)
+        {
+            for (uint32_t x = 0; x < 4; x++)
+            {
+                uint32_t pixelX = std::min(blockX * 4 + x, image.width - 1);
+                uint32_t pixelY = std::min(blockY * 4 + y, image.height - 1);
+                for (uint32_t channel = 0; channel < 3; channel++)
+                {
+                    block[y * 4 + x][channel] = image.pixels[(pixelY * image.width + pixelX) * 4 + channel];
+                }
+            }
+        }
+
+        return block;
+    }
+
+    float squaredDistance(const std::array<float, 3> &a, const std::array<float, 3> &b)
+    {
+        float distance = 0.0f;
+        for (uint32_t channel = 0; channel < 3; channel++)
+        {
+            distance += (a[channel] - b[channel]) * (a[channel] - b[channel]);
+        }
+
+        return distance;
+    }
+
+    uint16_t packRgb565(const std::array<float, 3> &color)
+    {
+        uint32_t r = static_cast<uint32_t>(std::lround(std::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f));
+        uint32_t g = static_cast<uint32_t>(std::lround(std::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f));
+        uint32_t b = static_cast<uint32_t>(std::lround(std::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f));
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    std::array<float, 3> unpackRgb565(uint16_t color)
+    {
+        uint32_t r = (color >> 11) & 31;
+        uint32_t g = (color >> 5) & 63;
+        uint32_t b = color & 31;
+        return {static_cast<float>((r << 3) | (r >> 2)), static_cast<float>((g << 2) | (g >> 4)), static_cast<float>((b << 3) | (b >> 2))};
+    }
+
+    // Nearest of the four palette entries per texel, returns the block's squared error
+    float selectBc1Indices(const Block &block, uint16_t color0, uint16_t color1, uint32_t &indices)
+    {
+        std::array<float, 3> endpoint0 = unpackRgb565(color0);
+        std::array<float, 3> endpoint1 = unpackRgb565(color1);
+
+        std::array<std::array<float, 3>, 4> palette;
+        for (uint32_t channel = 0; channel < 3; channel++)
+        {
+            palette[0][channel] = endpoint0[channel];
+            palette[1][channel] = endpoint1[channel];
+            palette[2][channel] = (2.0f * endpoint0[channel] + endpoint1[channel]) / 3.0f;
+            palette[3][channel] = (endpoint0[channel] + 2.0f * endpoint1[channel]) / 3.0f;
+        }
+
+        float error = 0.0f;
+        indices = 0;
+        for (uint32_t texel = 0; texel < 16; texel++)
+        {
+            uint32_t bestIndex = 0;
+            float bestDistance = std::numeric_limits<float>::max();
+            for (uint32_t index = 0; index < 4; index++)
+            {
+                float distance = squaredDistance(block[texel], palette[index]);
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    bestIndex = index;
+                }
+            }
+
+            indices |= bestIndex << (texel * 2);
+            error += bestDistance;
+        }
+
+        return error;
+    }
+
+    // Endpoints at the extremes of the block's principal axis, refined once by least squares over the chosen indices.
+    // Always in four colour mode, color0 > color1.
+    void encodeBc1Block(const Block &block, uint8_t *output)
+    {
+        std::array<float, 3> mean{};
+        for (const auto &texel : block)
+        {
+            for (uint32_t channel = 0; channel < 3; channel++)
+            {
+                mean[channel] += texel[channel] / 16.0f;
+            }
+        }
+
+        float covariance[3][3] = {};
+        for (const auto &texel : block)
+        {
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                for (uint32_t j = 0; j < 3; j++)
+                {
+                    covariance[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+                }
+            }
+        }
+
+        std::array<float, 3> axis = {1.0f, 1.0f, 1.0f};
+        for (uint32_t iteration = 0; iteration < 8; iteration++)
+        {
+            std::array<float, 3> next{};
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                next[i] = covariance[i][0] * axis[0] + covariance[i][1] * axis[1] + covariance[i][2] * axis[2];
+            }
+
+            float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+            if (length < 1e-6f)
+            {
+                break;
+            }
+
+            axis = {next[0] / length, next[1] / length, next[2] / length};
+        }
+
+        float minProjection = std::numeric_limits<float>::max();
+        float maxProjection = std::numeric_limits<float>::lowest();
+        for (const auto &texel : block)
+        {
+            float projection = (texel[0] - mean[0]) * axis[0] + (texel[1] - mean[1]) * axis[1] + (texel[2] - mean[2]) * axis[2];
+            minProjection = std::min(minProjection, projection);
+            maxProjection = std::max(maxProjection, projection);
+        }
+
+        std::array<float, 3> low;
+        std::array<float, 3> high;
+        for (uint32_t channel = 0; channel < 3; channel++)
+        {
+            low[channel] = mean[channel] + axis[channel] * minProjection;
+            high[channel] = mean[channel] + axis[channel] * maxProjection;
+        }
+
+        uint16_t color0 = packRgb565(high);
+        uint16_t color1 = packRgb565(low);
+        uint32_t indices = 0;
+        float error = selectBc1Indices(block, color0, color1, indices);
+
+        // Least squares endpoints for the chosen indices, each texel a weighted blend of the two
+        const float WEIGHTS[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        std::array<float, 3> ax{}, bx{};
+        for (uint32_t texel = 0; texel < 16; texel++)
+        {
+            float a = WEIGHTS[(indices >> (texel * 2)) & 3];
+            float b = 1.0f - a;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (uint32_t channel = 0; channel < 3; channel++)
+            {
+                ax[channel] += a * block[texel][channel];
+                bx[channel] += b * block[texel][channel];
+            }
+        }
+
+        float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) > 1e-6f)
+        {
+            std::array<float, 3> refined0;
+            std::array<float, 3> refined1;
+            for (uint32_t channel = 0; channel < 3; channel++)
+            {
+                refined0[channel] = (ax[channel] * bb - bx[channel] * ab) / determinant;
+                refined1[channel] = (bx[channel] * aa - ax[channel] * ab) / determinant;
+            }
+
+            uint16_t refinedColor0 = packRgb565(refined0);
+            uint16_t refinedColor1 = packRgb565(refined1);
+            if (refinedColor0 < refinedColor1)
+            {
+                std::swap(refinedColor0, refinedColor1);
+            }
+
+            uint32_t refinedIndices = 0;
+            if (refinedColor0 != refinedColor1 && selectBc1Indices(block, refinedColor0, refinedColor1, refinedIndices) < error)
+            {
+                color0 = refinedColor0;
+                color1 = refinedColor1;
+            }
+        }
+
+        // Four colour mode needs color0 > color1, swapping the endpoints swaps indices 0 with 1 and 2 with 3
+        if (color0 < color1)
+        {
+            std::swap(color0, color1);
+        }
+        if (color0 == color1)
+        {
+            indices = 0;
+        }
+        else
+        {
+            selectBc1Indices(block, color0, color1, indices);
+        }
+
+        memcpy(output, &color0, sizeof(color0));
+        memcpy(output + 2, &color1, sizeof(color1));
+        memcpy(output + 4, &indices, sizeof(indices));
+    }
+
+    const int32_t ETC_MODIFIERS[8][2] = {{2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}};
+
+    struct EtcSubblock
+    {
+        uint32_t table;
+        // Per texel of the subblock, 0: +small, 1: +large, 2: -small, 3: -large
+        std::array<uint32_t, 8> modifiers;
+        float error;
+    };
+
+    // Best modifier table and per-texel modifiers for a subblock around its base colour
+    EtcSubblock fitEtcSubblock(const std::array<std::array<float, 3>, 8> &texels, const std::array<int32_t, 3> &baseColor)
+    {
+        EtcSubblock best{0, {}, std::numeric_limits<float>::max()};
+
+        for (uint32_t table = 0; table < 8; table++)
+        {
+            EtcSubblock candidate{table, {}, 0.0f};
+            for (uint32_t texel = 0; texel < 8; texel++)
+            {
+                float bestDistance = std::numeric_limits<float>::max();
+                for (uint32_t modifier = 0; modifier < 4; modifier++)
+                {
+                    int32_t offset = ETC_MODIFIERS[table][modifier & 1] * ((modifier & 2) ? -1 : 1);
+                    std::array<float, 3> color;
+                    for (uint32_t channel = 0; channel < 3; channel++)
+                    {
+                        color[channel] = static_cast<float>(std::clamp(baseColor[channel] + offset, 0, 255));
+                    }
+
+                    float distance = squaredDistance(texels[texel], color);
+                    if (distance < bestDistance)
+                    {
+                        bestDistance = distance;
+                        candidate.modifiers[texel] = modifier;
+                    }
+                }
+
+                candidate.error += bestDistance;
+            }
+
+            if (candidate.error < best.error)
+            {
+                best = candidate;
+            }
+        }
+
+        return best;
+    }
+
+    // ETC1 individual and differential modes, which ETC2 decodes unchanged as long as the differential colours stay in range.
+    // Both subblock orientations are tried.
+    void encodeEtc2Block(const Block &block, uint8_t *output)
+    {
+        uint64_t bestBits = 0;
+        float bestError = std::numeric_limits<float>::max();
+
+        for (uint32_t flip = 0; flip < 2; flip++)
+        {
+            // Without flip the subblocks are the left and right 2x4 halves, with it the top and bottom 4x2 halves
+            std::array<std::array<std::array<float, 3>, 8>, 2> subblockTexels;
+            std::array<std::array<uint32_t, 8>, 2> subblockPixels;
+            std::array<uint32_t, 2> subblockSizes = {0, 0};
+            for (uint32_t y = 0; y < 4; y++)
+            {
+                for (uint32_t x = 0; x < 4; x++)
+                {
+                    uint32_t subblock = flip ? (y >= 2) : (x >= 2);
+                    subblockTexels[subblock][subblockSizes[subblock]] = block[y * 4 + x];
+                    // ETC indexes pixels column-major
+                    subblockPixels[subblock][subblockSizes[subblock]] = x * 4 + y;
+                    subblockSizes[subblock]++;
+                }
+            }
+
+            std::array<std::array<float, 3>, 2> averages{};
+            for (uint32_t subblock = 0; subblock < 2; subblock++)
+            {
+                for (const auto &texel : subblockTexels[subblock])
+                {
+                    for (uint32_t channel = 0; channel < 3; channel++)
+                    {
+                        averages[subblock][channel] += texel[channel] / 8.0f;
+                    }
+                }
+            }
+
+            for (uint32_t differential = 0; differential < 2; differential++)
+            {
+                uint32_t maxValue = differential ? 31 : 15;
+                std::array<std::array<int32_t, 3>, 2> quantized;
+                std::array<std::array<int32_t, 3>, 2> baseColors;
+                for (uint32_t subblock = 0; subblock < 2; subblock++)
+                {
+                    for (uint32_t channel = 0; channel < 3; channel++)
+                    {
+                        int32_t value = static_cast<int32_t>(std::lround(averages[subblock][channel] * maxValue / 255.0f));
+                        quantized[subblock][channel] = value;
+                        baseColors[subblock][channel] = differential ? (value << 3) | (value >> 2) : (value << 4) | value;
+                    }
+                }
+
+                if (differential)
+                {
+                    bool isInRange = true;
+                    for (uint32_t channel = 0; channel < 3; channel++)
+                    {
+                        int32_t delta = quantized[1][channel] - quantized[0][channel];
+                        isInRange = isInRange && delta >= -4 && delta <= 3;
+                    }
+
+                    if (!isInRange)
+                    {
+                        continue;
+                    }
+                }
+
+                std::array<EtcSubblock, 2> fits = {fitEtcSubblock(subblockTexels[0], baseColors[0]), fitEtcSubblock(subblockTexels[1], baseColors[1])};
+                float error = fits[0].error + fits[1].error;
+                if (error >= bestError)
+                {
+                    continue;
+                }
+
+                uint64_t bits = 0;
+                for (uint32_t channel = 0; channel < 3; channel++)
+                {
+                    uint32_t shift = 59 - channel * 8;
+                    if (differential)
+                    {
+                        uint32_t delta = static_cast<uint32_t>(quantized[1][channel] - quantized[0][channel]) & 7;
+                        bits |= static_cast<uint64_t>(quantized[0][channel]) << shift;
+                        bits |= static_cast<uint64_t>(delta) << (shift - 3);
+                    }
+                    else
+                    {
+                        bits |= static_cast<uint64_t>(quantized[0][channel]) << (shift + 1);
+                        bits |= static_cast<uint64_t>(quantized[1][channel]) << (shift - 3);
+                    }
+                }
+
+                bits |= static_cast<uint64_t>(fits[0].table) << 37;
+                bits |= static_cast<uint64_t>(fits[1].table) << 34;
+                bits |= static_cast<uint64_t>(differential) << 33;
+                bits |= static_cast<uint64_t>(flip) << 32;
+
+                for (uint32_t subblock = 0; subblock < 2; subblock++)
+                {
+                    for (uint32_t texel = 0; texel < 8; texel++)
+                    {
+                        uint32_t pixel = subblockPixels[subblock][texel];
+                        uint32_t modifier = fits[subblock].modifiers[texel];
+                        bits |= static_cast<uint64_t>(modifier >> 1) << (16 + pixel);
+                        bits |= static_cast<uint64_t>(modifier & 1) << pixel;
+                    }
+                }
+
+                bestBits = bits;
+                bestError = error;
+            }
+        }
+
+        // Big-endian
+        for (uint32_t byte = 0; byte < 8; byte++)
+        {
+            output[byte] = static_cast<uint8_t>(bestBits >> (56 - byte * 8));
+        }
+    }
+
+    std::vector<uint8_t> compressLevel(const Image &image, BlockFormat format)
+    {
+        uint32_t blocksX = (image.width + 3) / 4;
+        uint32_t blocksY = (image.height + 3) / 4;
+        std::vector<uint8_t> data(blocksX * blocksY * BLOCK_SIZE);
+
+        for (uint32_t blockY = 0; blockY < blocksY; blockY++)
+        {
+            for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+            {
+                Block block = readBlock(image, blockX, blockY);
+                uint8_t *output = &data[(blockY * blocksX + blockX) * BLOCK_SIZE];
+                if (format == BlockFormat::eBC1)
+                {
+                    encodeBc1Block(block, output);
+                }
+                else
+                {
+                    encodeEtc2Block(block, output);
+                }
+            }
+        }
+
+        return data;
+    }
+
+    // A Khronos Basic Data Format Descriptor with a single sample covering the whole 4x4 block
+    std::vector<uint32_t> createDataFormatDescriptor(BlockFormat format)
+    {
+        const uint32_t KHR_DF_MODEL_BC1A = 128;
+        const uint32_t KHR_DF_MODEL_ETC2 = 161;
+        const uint32_t KHR_DF_CHANNEL_BC1A_COLOR = 0;
+        const uint32_t KHR_DF_CHANNEL_ETC2_COLOR = 2;
+        const uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+        const uint32_t KHR_DF_TRANSFER_SRGB = 2;
+        const uint32_t DESCRIPTOR_BLOCK_SIZE = 24 + 16;
+
+        uint32_t colorModel = format == BlockFormat::eBC1 ? KHR_DF_MODEL_BC1A : KHR_DF_MODEL_ETC2;
+        uint32_t channel = format == BlockFormat::eBC1 ? KHR_DF_CHANNEL_BC1A_COLOR : KHR_DF_CHANNEL_ETC2_COLOR;
+
+        return {
+            4 + DESCRIPTOR_BLOCK_SIZE,
+            0,                                                                          // Khronos vendor, basic descriptor type
+            2 | (DESCRIPTOR_BLOCK_SIZE << 16),                                          // Version 1.3
+            colorModel | (KHR_DF_PRIMARIES_BT709 << 8) | (KHR_DF_TRANSFER_SRGB << 16), // Straight alpha
+            3 | (3 << 8),                                                               // 4x4x1x1 texel blocks
+            BLOCK_SIZE,
+            0,
+            0 | ((BLOCK_SIZE * 8 - 1) << 16) | (channel << 24), // Sample: bit offset, bit length - 1 and channel
+            0,
+            0,
+            0xFFFFFFFF};
+    }
+
+    void writeKtx2(const std::string &path, BlockFormat format, const std::vector<Image> &levels)
+    {
+        std::vector<std::vector<uint8_t>> levelData;
+        for (const Image &level : levels)
+        {
+            levelData.push_back(compressLevel(level, format));
+        }
+
+        std::vector<uint32_t> dataFormatDescriptor = createDataFormatDescriptor(format);
+        uint32_t levelCount = static_cast<uint32_t>(levels.size());
+
+        Ktx2::Header header{};
+        memcpy(header.identifier, Ktx2::IDENTIFIER, sizeof(header.identifier));
+        header.vkFormat = format == BlockFormat::eBC1 ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK;
+        header.typeSize = 1;
+        header.pixelWidth = levels[0].width;
+        header.pixelHeight = levels[0].height;
+        header.faceCount = 1;
+        header.levelCount = levelCount;
+        header.dfdByteOffset = static_cast<uint32_t>(sizeof(Ktx2::Header) + sizeof(Ktx2::LevelIndex) * levelCount);
+        header.dfdByteLength = static_cast<uint32_t>(sizeof(uint32_t) * dataFormatDescriptor.size());
+
+        // Levels are stored smallest first, each aligned to the block size
+        std::vector<Ktx2::LevelIndex> levelIndices(levelCount);
+        uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+        for (uint32_t level = levelCount; level-- > 0;)
+        {
+            offset = (offset + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+            levelIndices[level] = Ktx2::LevelIndex{offset, levelData[level].size(), levelData[level].size()};
+            offset += levelData[level].size();
+        }
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open " + path + " for writing!");
+        }
+
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(levelIndices.data()), sizeof(Ktx2::LevelIndex) * levelIndices.size());
+        file.write(reinterpret_cast<const char *>(dataFormatDescriptor.data()), header.dfdByteLength);
+
+        for (uint32_t level = levelCount; level-- > 0;)
+        {
+            std::vector<char> padding(levelIndices[level].byteOffset - static_cast<uint64_t>(file.tellp()), 0);
+            file.write(padding.data(), padding.size());
+            file.write(reinterpret_cast<const char *>(levelData[level].data()), levelData[level].size());
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 4 || (std::string(argv[3]) != "bc1" && std::string(argv[3]) != "etc2"))
+    {
+        std::cerr << "Usage: " << argv[0] << " <input image> <output.ktx2> <bc1|etc2>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    BlockFormat format = std::string(argv[3]) == "bc1" ? BlockFormat::eBC1 : BlockFormat::eETC2;
+
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    stbi_uc *pixels = stbi_load(argv[1], &width, &height, &channels, STBI_rgb_alpha);
+    if (!pixels)
+    {
+        std::cerr << "Failed to load " << argv[1] << "!" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Image> levels;
+    levels.push_back(Image{static_cast<uint32_t>(width), static_cast<uint32_t>(height), std::vector<uint8_t>(pixels, pixels + width * height * 4)});
+    stbi_image_free(pixels);
+
+    while (levels.back().width > 1 || levels.back().height > 1)
+    {
+        levels.push_back(downsample(levels.back()));
+    }
+
+    try
+    {
+        writeKtx2(argv[2], format, levels);
+    }
+    catch (const std::exception &exception)
+    {
+        std::cerr << exception.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}